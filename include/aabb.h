@@ -0,0 +1,92 @@
+/**
+ * @file aabb.h
+ * @brief Axis-aligned bounding boxes for acceleration structures
+ */
+
+#ifndef AABB_H
+#define AABB_H
+
+#include "vec3.h"
+#include "ray.h"
+#include <stdbool.h>
+
+/**
+ * @brief Axis-aligned bounding box
+ */
+typedef struct {
+    Vec3 min;  ///< Minimum corner
+    Vec3 max;  ///< Maximum corner
+} AABB;
+
+/**
+ * @brief Create a box from two corners
+ */
+static inline AABB aabb_create(Vec3 min, Vec3 max) {
+    return (AABB){min, max};
+}
+
+/**
+ * @brief Empty box (min = +inf, max = -inf), the identity for aabb_union
+ */
+static inline AABB aabb_empty(void) {
+    return (AABB){{INFINITY, INFINITY, INFINITY}, {-INFINITY, -INFINITY, -INFINITY}};
+}
+
+/**
+ * @brief Smallest box enclosing both boxes
+ */
+AABB aabb_union(AABB a, AABB b);
+
+/**
+ * @brief Grow box to enclose a point
+ */
+AABB aabb_expand(AABB box, Vec3 point);
+
+/**
+ * @brief Center point of the box
+ */
+Vec3 aabb_centroid(AABB box);
+
+/**
+ * @brief Size of the box along each axis
+ */
+Vec3 aabb_extent(AABB box);
+
+/**
+ * @brief Surface area of the box (0 for an empty box)
+ */
+float aabb_surface_area(AABB box);
+
+/**
+ * @brief Check if two boxes overlap (touching counts as overlap)
+ */
+bool aabb_overlaps(AABB a, AABB b);
+
+/**
+ * @brief Slab test of a ray against the box
+ * @param box The box
+ * @param ray Ray to test
+ * @param inv_dir Component-wise reciprocal of the ray direction
+ * @param t_min Minimum ray parameter
+ * @param t_max Maximum ray parameter
+ * @param t_enter Output parameter where the ray enters the box (may be NULL)
+ * @param t_exit Output parameter where the ray leaves the box (may be NULL)
+ * @return true if the ray overlaps the box within [t_min, t_max]
+ */
+bool aabb_hit(const AABB *box, const Ray *ray, Vec3 inv_dir, float t_min, float t_max,
+              float *t_enter, float *t_exit);
+
+/**
+ * @brief Component-wise reciprocal of a ray direction for aabb_hit
+ */
+static inline Vec3 aabb_inverse_direction(const Ray *ray) {
+    return vec3_create(1.0f / ray->direction.x, 1.0f / ray->direction.y,
+                       1.0f / ray->direction.z);
+}
+
+/**
+ * @brief Print box information (for debugging)
+ */
+void aabb_print(AABB box);
+
+#endif // AABB_H
@@ -0,0 +1,84 @@
+/**
+ * @file bvh.h
+ * @brief Bounding volume hierarchy over bounded hittable objects
+ */
+
+#ifndef BVH_H
+#define BVH_H
+
+#include "aabb.h"
+#include "hit.h"
+#include "ray.h"
+#include <stdbool.h>
+
+/**
+ * @brief Flattened BVH node
+ * Interior nodes store the index of their second child; the first child
+ * immediately follows the node. Leaves reference a range of objects.
+ */
+typedef struct {
+    AABB bounds;       ///< Bounds of everything below this node
+    int offset;        ///< Leaf: first object index, interior: second child index
+    int count;         ///< Number of objects (0 for interior nodes)
+    int axis;          ///< Split axis of interior nodes (for ordered traversal)
+} BvhNode;
+
+/**
+ * @brief Bounding volume hierarchy
+ */
+typedef struct {
+    BvhNode *nodes;     ///< Depth-first node array (root at index 0)
+    int node_count;     ///< Number of nodes in use
+    Hittable *objects;  ///< Objects reordered to match leaf ranges
+    int object_count;   ///< Number of objects
+} Bvh;
+
+/**
+ * @brief Build a BVH using a binned surface area heuristic
+ * @param bvh BVH to build (any previous contents are not freed)
+ * @param objects Objects to insert; each must be bounded
+ * @param count Number of objects
+ * @return true on success, false on allocation failure or unbounded object
+ */
+bool bvh_build(Bvh *bvh, const Hittable *objects, int count);
+
+/**
+ * @brief Free memory owned by a BVH
+ * @param bvh BVH to destroy
+ */
+void bvh_destroy(Bvh *bvh);
+
+/**
+ * @brief Find the closest hit among all objects in the BVH
+ * @param bvh Pointer to BVH data (cast from void*)
+ * @param ray Ray to test
+ * @param t_min Minimum ray parameter
+ * @param t_max Maximum ray parameter
+ * @param hit_rec Output hit record
+ * @return true if any object was hit
+ */
+bool bvh_hit(const Hittable *bvh, const Ray *ray, float t_min, float t_max, HitRecord *hit_rec);
+
+/**
+ * @brief bvh_hit testing the object a hint remembers before traversing
+ * Primitives are indices into bvh->objects. See HintedHitFunction.
+ */
+bool bvh_hit_hinted(const Hittable *bvh, const Ray *ray, float t_min, float t_max, bool any_hit,
+                    HitHint *hint, HitRecord *hit_rec);
+
+/**
+ * @brief Bounding box of the whole BVH
+ * @param bvh Pointer to BVH data (cast from void*)
+ * @param box Output bounding box
+ * @return false if the BVH is empty
+ */
+bool bvh_bounds(const Hittable *bvh, AABB *box);
+
+/**
+ * @brief Create a hittable object wrapping the BVH
+ * @param bvh Pointer to a built BVH
+ * @return Hittable object
+ */
+Hittable bvh_to_hittable(Bvh *bvh);
+
+#endif // BVH_H
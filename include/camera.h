@@ -10,6 +10,8 @@
 
 #include "vec3.h"
 #include "ray.h"
+#include "aabb.h"
+#include <stdbool.h>
 
 /**
  * @brief Camera structure for ray generation
@@ -39,11 +41,13 @@ Camera camera_create_orthographic(Vec3 origin, Vec3 target, Vec3 up,
                                  int image_width, int image_height);
 
 /**
- * @brief Create a perspective camera (for future use)
+ * @brief Create a perspective (pinhole) camera
+ * The viewport is placed one unit in front of the origin and sized from
+ * the vertical field of view.
  * @param origin Camera position
  * @param target Point camera is looking at
  * @param up Up vector
- * @param fov Field of view in degrees
+ * @param fov Vertical field of view in degrees
  * @param aspect_ratio Width/height ratio
  * @param image_width Image width in pixels
  * @param image_height Image height in pixels
@@ -73,6 +77,37 @@ Ray camera_get_ray(const Camera *camera, float u, float v);
 void camera_pixel_to_uv(const Camera *camera, int pixel_x, int pixel_y, 
                        float *u, float *v);
 
+/**
+ * @brief Convert a point inside a pixel to UV coordinates
+ * An offset of (0, 0) gives the same coordinates as camera_pixel_to_uv.
+ * @param camera The camera
+ * @param pixel_x Pixel x coordinate
+ * @param pixel_y Pixel y coordinate
+ * @param offset_x Horizontal offset within the pixel, in [-0.5, 0.5)
+ * @param offset_y Vertical offset within the pixel, in [-0.5, 0.5)
+ * @param u Output horizontal UV coordinate
+ * @param v Output vertical UV coordinate
+ */
+void camera_sample_to_uv(const Camera *camera, int pixel_x, int pixel_y, float offset_x,
+                         float offset_y, float *u, float *v);
+
+/**
+ * @brief Conservative pixel rectangle a box can cover on screen
+ * Projects the corners of the box through the eye onto the viewport and
+ * pads the result by one pixel, so every primary ray (or sample within a
+ * pixel) that can hit the box starts inside the rectangle. Boxes that
+ * straddle the plane of the eye cover the whole image.
+ * @param camera The camera
+ * @param bounds Box in world space
+ * @param x0 Output: first column
+ * @param y0 Output: first row (row 0 is the top of the image)
+ * @param x1 Output: one past the last column
+ * @param y1 Output: one past the last row
+ * @return false if no primary ray can reach the box (the rectangle is empty)
+ */
+bool camera_project_bounds(const Camera *camera, AABB bounds, int *x0, int *y0, int *x1,
+                           int *y1);
+
 /**
  * @brief Print camera information (for debugging)
  * @param camera The camera to print
@@ -0,0 +1,73 @@
+/**
+ * @file deflate.h
+ * @brief Minimal DEFLATE compressor and zlib/PNG checksums
+ *
+ * Compresses independent chunks with greedy LZ77 (hash chains over a 32 KB
+ * window) and the fixed Huffman code, falling back to stored blocks when
+ * that is smaller. Each non-final chunk ends byte-aligned on an empty
+ * stored block, so chunks compressed on different threads can simply be
+ * concatenated into one stream.
+ */
+
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Hash table entries used for match finding
+ */
+#define DEFLATE_HASH_SIZE (1 << 15)
+
+/**
+ * @brief DEFLATE window size (longest match distance)
+ */
+#define DEFLATE_WINDOW_SIZE 32768
+
+/**
+ * @brief Match finding state, reusable across chunks by one thread
+ */
+typedef struct {
+    int32_t head[DEFLATE_HASH_SIZE];   ///< Most recent position per hash
+    int32_t prev[DEFLATE_WINDOW_SIZE]; ///< Previous position with the same hash
+} DeflateScratch;
+
+/**
+ * @brief Largest possible output of deflate_compress_chunk
+ */
+size_t deflate_bound(size_t size);
+
+/**
+ * @brief Compress one chunk of a DEFLATE stream
+ * Matches never reach outside the chunk.
+ * @param scratch Match finding state
+ * @param input Bytes to compress (at least one)
+ * @param size Number of input bytes
+ * @param final True for the last chunk of the stream
+ * @param output Output buffer of at least deflate_bound(size) bytes
+ * @return Bytes written; the output always ends on a byte boundary
+ */
+size_t deflate_compress_chunk(DeflateScratch *scratch, const uint8_t *input, size_t size,
+                              bool final, uint8_t *output);
+
+/**
+ * @brief Update an Adler-32 checksum (start with 1)
+ */
+uint32_t adler32_update(uint32_t adler, const uint8_t *data, size_t size);
+
+/**
+ * @brief Adler-32 of two concatenated blocks from their separate checksums
+ * @param adler1 Checksum of the first block
+ * @param adler2 Checksum of the second block
+ * @param size2 Length of the second block
+ */
+uint32_t adler32_combine(uint32_t adler1, uint32_t adler2, uint64_t size2);
+
+/**
+ * @brief Update a CRC-32 (ISO-HDLC, as in PNG and gzip; start with 0)
+ */
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t size);
+
+#endif // DEFLATE_H
@@ -0,0 +1,120 @@
+/**
+ * @file demo_scenes.h
+ * @brief Built-in scenes selectable from the command line
+ */
+
+#ifndef DEMO_SCENES_H
+#define DEMO_SCENES_H
+
+#include "camera.h"
+#include "scene.h"
+#include "sphere.h"
+#include "plane.h"
+#include "bvh.h"
+#include "grid.h"
+#include "heightfield.h"
+#include "voxel.h"
+#include "sdf.h"
+#include "point_cloud.h"
+#include <stdbool.h>
+
+/**
+ * @brief Built-in scene selection
+ */
+typedef enum {
+    DEMO_SCENE_DEFAULT,    ///< Two spheres on a ground plane
+    DEMO_SCENE_PARTICLES,  ///< Dense uniform cloud of small spheres
+    DEMO_SCENE_TERRAIN,    ///< Procedural heightfield terrain
+    DEMO_SCENE_VOXELS,     ///< Sparse voxel sculpture
+    DEMO_SCENE_SDF,        ///< Signed-distance-field blobs in a BVH
+    DEMO_SCENE_POINTS,     ///< Compact point cloud (procedural or from a file)
+    DEMO_SCENE_LIGHTS      ///< Spheres on a plane lit by many small lights
+} DemoSceneKind;
+
+/**
+ * @brief Acceleration structure used for aggregates of many objects
+ */
+typedef enum {
+    ACCEL_BVH,   ///< Bounding volume hierarchy (default)
+    ACCEL_GRID   ///< Uniform grid with 3D-DDA traversal
+} AccelType;
+
+/**
+ * @brief Parameters for building a built-in scene
+ */
+typedef struct {
+    DemoSceneKind kind;   ///< Which scene to build
+    int particle_count;   ///< Number of spheres (particles and points scenes)
+    AccelType accel;      ///< Acceleration structure (particles scene)
+    int terrain_size;     ///< Heightfield samples per side (terrain scene)
+    int voxel_resolution; ///< Voxels per side (voxels scene)
+    int sdf_max_steps;    ///< Sphere tracing iteration cap (sdf scene)
+    float sdf_relaxation; ///< Sphere tracing over-relaxation (sdf scene)
+    const char *points_file; ///< Raw float xyz file (points scene, NULL = procedural)
+    float point_radius;   ///< Shared point radius (points scene, <= 0 = automatic)
+    int light_count;      ///< Number of point lights (lights scene)
+} DemoSceneOptions;
+
+/**
+ * @brief A built scene together with the storage its objects point into
+ * The scene references memory inside this struct, so it must not be copied
+ * or moved after demo_scene_build.
+ */
+typedef struct {
+    Scene scene;            ///< Scene to render
+    Camera camera;          ///< Camera for the scene
+    Sphere spheres[2];      ///< Spheres of the default scene
+    Plane ground;           ///< Ground plane
+    Sphere *particles;      ///< Particle spheres
+    Hittable *hittables;    ///< Hittable wrappers for the particles
+    int particle_count;     ///< Number of particles
+    AccelType accel;        ///< Acceleration structure in use
+    Bvh bvh;                ///< Particle BVH (when accel == ACCEL_BVH)
+    Grid grid;              ///< Particle grid (when accel == ACCEL_GRID)
+    Heightfield terrain;    ///< Terrain heightfield
+    bool has_terrain;       ///< True if terrain was built
+    VoxelVolume voxels;     ///< Voxel volume
+    bool has_voxels;        ///< True if the voxel volume was built
+    SdfObject sdfs[6];      ///< SDF objects
+    Hittable sdf_hittables[6]; ///< Hittable wrappers for the SDF objects
+    Bvh sdf_bvh;            ///< BVH over the SDF objects
+    PointCloud points;      ///< Point cloud
+    bool has_points;        ///< True if the point cloud was built
+} DemoScene;
+
+/**
+ * @brief Default scene options
+ */
+DemoSceneOptions demo_scene_default_options(void);
+
+/**
+ * @brief Look up a scene by its command-line name
+ * @param name Scene name ("demo", "particles", "terrain", "voxels", "sdf",
+ *             "points", "lights")
+ * @param kind Output scene kind
+ * @return true if the name is known
+ */
+bool demo_scene_parse_name(const char *name, DemoSceneKind *kind);
+
+/**
+ * @brief Human-readable description of a scene
+ */
+const char *demo_scene_description(DemoSceneKind kind);
+
+/**
+ * @brief Build a scene and its camera
+ * @param demo Output scene (call demo_scene_destroy even on failure)
+ * @param options Scene parameters
+ * @param width Image width in pixels
+ * @param height Image height in pixels
+ * @return true on success
+ */
+bool demo_scene_build(DemoScene *demo, const DemoSceneOptions *options, int width, int height);
+
+/**
+ * @brief Free memory owned by a built scene
+ * @param demo Scene to destroy
+ */
+void demo_scene_destroy(DemoScene *demo);
+
+#endif // DEMO_SCENES_H
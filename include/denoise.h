@@ -0,0 +1,69 @@
+/**
+ * @file denoise.h
+ * @brief Edge-aware A-trous wavelet denoiser guided by surface features
+ *
+ * The noisy image is divided by its albedo, smoothed by a few passes of
+ * an a-trous (dilated 5x5 B-spline) filter and multiplied back, so
+ * texture detail survives. Each filter tap is weighted by how similar
+ * the neighbour is in normal, depth and albedo, and by how far its
+ * luminance differs relative to the pixel's estimated noise, so edges and
+ * converged regions are kept while noisy flat regions are averaged.
+ * This follows the spatial part of SVGF (Schied et al. 2017).
+ */
+
+#ifndef DENOISE_H
+#define DENOISE_H
+
+#include "color.h"
+#include "vec3.h"
+#include <stdbool.h>
+
+/**
+ * @brief Filter passes; pass k samples neighbours 2^k pixels apart
+ */
+#define DENOISE_DEFAULT_ITERATIONS 5
+
+/**
+ * @brief Variance to give pixels whose noise is unknown (they are smoothed freely)
+ */
+#define DENOISE_UNKNOWN_VARIANCE 1e6f
+
+/**
+ * @brief Noisy image and its feature buffers, all width * height, top row first
+ */
+typedef struct {
+    int width;             ///< Image width in pixels
+    int height;            ///< Image height in pixels
+    const Color *color;    ///< Noisy linear color
+    const float *variance; ///< Variance of each pixel's mean luminance (NULL: all unknown)
+    const Vec3 *normal;    ///< Average primary normal (zero where nothing was hit)
+    const float *depth;    ///< Average primary hit distance (0 where nothing was hit)
+    const Color *albedo;   ///< Average primary albedo
+} DenoiseInput;
+
+/**
+ * @brief Filter controls
+ */
+typedef struct {
+    float strength;   ///< Luminance tolerance in noise standard deviations, / 4 (0: off)
+    int iterations;   ///< Filter passes
+    int thread_count; ///< Worker threads (0: one per CPU)
+} DenoiseSettings;
+
+/**
+ * @brief Strength 1, DENOISE_DEFAULT_ITERATIONS passes, one thread per CPU
+ */
+DenoiseSettings denoise_default_settings(void);
+
+/**
+ * @brief Denoise an image
+ * Rows are split into bands filtered in parallel; the result does not
+ * depend on the thread count.
+ * @param input Noisy image and features
+ * @param settings Filter controls
+ * @param output Denoised color (width * height, may not alias input->color)
+ * @return false on allocation failure
+ */
+bool denoise_image(const DenoiseInput *input, const DenoiseSettings *settings, Color *output);
+
+#endif // DENOISE_H
@@ -0,0 +1,126 @@
+/**
+ * @file file_sink.h
+ * @brief Buffered positional file output with asynchronous submission
+ *
+ * Callers reserve space in a large buffer, encode into it, and commit.
+ * Full buffers are written at explicit offsets: through io_uring on Linux
+ * when the kernel allows it, so several buffers can be in flight while the
+ * caller keeps encoding, and with pwrite otherwise.
+ */
+
+#ifndef FILE_SINK_H
+#define FILE_SINK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Size of each output buffer
+ */
+#define FILE_SINK_BUFFER_SIZE (1u << 20)
+
+/**
+ * @brief Number of output buffers (how many writes may be in flight)
+ */
+#define FILE_SINK_BUFFER_COUNT 4
+
+/**
+ * @brief io_uring instance state (unused with the pwrite backend)
+ */
+typedef struct {
+    int fd;                   ///< io_uring file descriptor (-1 if not in use)
+    void *sq_ring;            ///< Mapped submission ring
+    size_t sq_ring_size;      ///< Size of the submission ring mapping
+    void *cq_ring;            ///< Mapped completion ring (may alias sq_ring)
+    size_t cq_ring_size;      ///< Size of the completion ring mapping
+    void *sqes;               ///< Mapped submission queue entries
+    size_t sqes_size;         ///< Size of the entries mapping
+    unsigned *sq_head;        ///< Submission ring head
+    unsigned *sq_tail;        ///< Submission ring tail
+    unsigned *sq_mask;        ///< Submission ring mask
+    unsigned *sq_array;       ///< Submission ring index array
+    unsigned *cq_head;        ///< Completion ring head
+    unsigned *cq_tail;        ///< Completion ring tail
+    unsigned *cq_mask;        ///< Completion ring mask
+    void *cqes;               ///< Completion entries
+} FileSinkRing;
+
+/**
+ * @brief Buffered output to a file descriptor
+ */
+typedef struct {
+    int fd;                                   ///< Destination file descriptor
+    int64_t offset;                           ///< File offset of the current buffer
+    uint8_t *buffers[FILE_SINK_BUFFER_COUNT]; ///< Output buffers
+    int64_t buffer_offset[FILE_SINK_BUFFER_COUNT]; ///< File offset of an in-flight buffer
+    size_t buffer_length[FILE_SINK_BUFFER_COUNT];  ///< Bytes in an in-flight buffer
+    bool in_flight[FILE_SINK_BUFFER_COUNT];   ///< True while a buffer is being written
+    int current;                              ///< Buffer being filled
+    size_t fill;                              ///< Bytes used in the current buffer
+    bool use_ring;                            ///< True if io_uring is in use
+    FileSinkRing ring;                        ///< io_uring state
+    bool failed;                              ///< True after any write error
+    uint64_t bytes_written;                   ///< Bytes committed so far
+    int64_t end;                              ///< Largest file offset written so far
+} FileSink;
+
+/**
+ * @brief Open a sink writing to fd starting at offset
+ * @param sink Sink to initialize
+ * @param fd Destination file descriptor (not closed by the sink)
+ * @param offset File offset of the first byte
+ * @param allow_ring Try io_uring before falling back to pwrite
+ * @return false on allocation failure
+ */
+bool file_sink_open(FileSink *sink, int fd, int64_t offset, bool allow_ring);
+
+/**
+ * @brief Reserve contiguous space in the current buffer
+ * Submits the current buffer first if it lacks room.
+ * @param sink Sink
+ * @param size Bytes needed (at most FILE_SINK_BUFFER_SIZE)
+ * @return Pointer to write to, or NULL on error
+ */
+uint8_t *file_sink_reserve(FileSink *sink, size_t size);
+
+/**
+ * @brief Commit bytes written into the last reservation
+ * @param sink Sink
+ * @param size Bytes actually used (at most the reserved size)
+ */
+void file_sink_commit(FileSink *sink, size_t size);
+
+/**
+ * @brief Copy bytes into the sink
+ * @return false on error
+ */
+bool file_sink_write(FileSink *sink, const void *data, size_t size);
+
+/**
+ * @brief File offset of the next byte
+ */
+int64_t file_sink_position(const FileSink *sink);
+
+/**
+ * @brief Continue writing at another offset
+ * Writes may be in flight concurrently, so the caller must not write over
+ * bytes that were already written; skipped ranges can be filled in later.
+ * @param sink Sink
+ * @param offset File offset of the next byte
+ */
+void file_sink_seek(FileSink *sink, int64_t offset);
+
+/**
+ * @brief Flush remaining data, wait for all writes and release resources
+ * @param sink Sink
+ * @return false if any write failed
+ */
+bool file_sink_close(FileSink *sink);
+
+/**
+ * @brief Name of the active backend ("io_uring" or "pwrite")
+ */
+const char *file_sink_backend(const FileSink *sink);
+
+#endif // FILE_SINK_H
@@ -0,0 +1,82 @@
+/**
+ * @file gbuffer.h
+ * @brief Cached primary hits (geometry buffer) for relighting
+ *
+ * A G-buffer holds, for every pixel, the surface the camera ray hits
+ * first: position, normal, albedo, object (material) id and distance.
+ * Direct shading depends on nothing else, so a frame can be shaded again
+ * under new lights without tracing a single primary ray.
+ */
+
+#ifndef GBUFFER_H
+#define GBUFFER_H
+
+#include "vec3.h"
+#include "color.h"
+#include "hit.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Per-pixel primary hits in output row order (row 0 is the top)
+ */
+typedef struct {
+    int width;          ///< Image width in pixels
+    int height;         ///< Image height in pixels
+    Vec3 *position;     ///< Hit point
+    Vec3 *normal;       ///< Unit shading normal
+    Color *albedo;      ///< Surface color
+    float *depth;       ///< Ray distance to the hit (INFINITY on a miss)
+    int32_t *object;    ///< Scene object index (-1 on a miss)
+    Color background;   ///< Color of pixels whose ray hit nothing
+} GBuffer;
+
+/**
+ * @brief Allocate a G-buffer with every pixel set to a miss
+ * @param gbuffer G-buffer to initialise
+ * @param width Image width
+ * @param height Image height
+ * @return false on allocation failure (the G-buffer is left empty)
+ */
+bool gbuffer_create(GBuffer *gbuffer, int width, int height);
+
+/**
+ * @brief Free the planes of a G-buffer (leaves it empty)
+ */
+void gbuffer_destroy(GBuffer *gbuffer);
+
+/**
+ * @brief Record the primary hit of one pixel
+ * @param gbuffer G-buffer
+ * @param index Pixel index (row * width + column)
+ * @param rec Primary hit, or NULL if the ray hit nothing
+ */
+void gbuffer_store(GBuffer *gbuffer, size_t index, const HitRecord *rec);
+
+/**
+ * @brief Rebuild the hit record of one pixel
+ * @param gbuffer G-buffer
+ * @param index Pixel index
+ * @param rec Output: point, normal, albedo, t and object_index of the hit
+ * @return false if the pixel's ray hit nothing
+ */
+bool gbuffer_hit(const GBuffer *gbuffer, size_t index, HitRecord *rec);
+
+/**
+ * @brief Write a G-buffer to a file
+ * The file is a header ("RTGBUF01", width, height, background) followed
+ * by the planes in declaration order, all in host byte order.
+ * @return false if the file cannot be written
+ */
+bool gbuffer_save(const GBuffer *gbuffer, const char *path);
+
+/**
+ * @brief Read a G-buffer written by gbuffer_save
+ * @param gbuffer G-buffer to fill (any previous contents are not freed)
+ * @param path File to read
+ * @return false if the file is missing, truncated or not a G-buffer
+ */
+bool gbuffer_load(GBuffer *gbuffer, const char *path);
+
+#endif // GBUFFER_H
@@ -0,0 +1,105 @@
+/**
+ * @file heightfield.h
+ * @brief Heightfield terrain over a regular 2D grid
+ *
+ * Heights are sampled on a regular grid in the XZ plane. Each cell between
+ * four samples is split into two triangles. A min/max mipmap (quadtree) over
+ * the cells lets rays skip empty space above and below the terrain
+ * hierarchically, so memory stays at a few bytes per cell and no mesh or
+ * BVH is needed.
+ */
+
+#ifndef HEIGHTFIELD_H
+#define HEIGHTFIELD_H
+
+#include "vec3.h"
+#include "ray.h"
+#include "hit.h"
+#include "color.h"
+#include <stddef.h>
+
+/**
+ * @brief Maximum number of mipmap levels (enough for 2^32 cells per side)
+ */
+#define HEIGHTFIELD_MAX_LEVELS 32
+
+/**
+ * @brief Height range of one mipmap node
+ */
+typedef struct {
+    float min;  ///< Lowest height below the node
+    float max;  ///< Highest height below the node
+} HeightRange;
+
+/**
+ * @brief Heightfield structure
+ */
+typedef struct {
+    int width;               ///< Number of samples along x
+    int depth;               ///< Number of samples along z
+    float *heights;          ///< width * depth heights, row-major in z (owned)
+    Vec3 origin;             ///< World position of sample (0, 0) at height 0
+    float spacing_x;         ///< Distance between samples along x
+    float spacing_z;         ///< Distance between samples along z
+    int level_count;         ///< Number of mipmap levels
+    int level_width[HEIGHTFIELD_MAX_LEVELS];     ///< Nodes along x per level
+    int level_depth[HEIGHTFIELD_MAX_LEVELS];     ///< Nodes along z per level
+    HeightRange *levels[HEIGHTFIELD_MAX_LEVELS]; ///< Level 0 covers 2x2 cells, last is root
+    Color color;             ///< Material color of the terrain
+} Heightfield;
+
+/**
+ * @brief Build a heightfield and its min/max mipmap
+ * @param hf Heightfield to build
+ * @param heights width * depth heights in world units relative to origin.y,
+ *        row-major in z; ownership passes to the heightfield even on failure
+ * @param width Number of samples along x (>= 2)
+ * @param depth Number of samples along z (>= 2)
+ * @param origin World position of the first sample (minimum x and z)
+ * @param extent_x World-space size along x
+ * @param extent_z World-space size along z
+ * @param color Material color
+ * @return true on success, false on invalid size or allocation failure
+ */
+bool heightfield_build(Heightfield *hf, float *heights, int width, int depth,
+                       Vec3 origin, float extent_x, float extent_z, Color color);
+
+/**
+ * @brief Free memory owned by a heightfield (including the heights)
+ * @param hf Heightfield to destroy
+ */
+void heightfield_destroy(Heightfield *hf);
+
+/**
+ * @brief Test ray-heightfield intersection
+ * @param hf Pointer to heightfield data (cast from void*)
+ * @param ray Ray to test
+ * @param t_min Minimum ray parameter
+ * @param t_max Maximum ray parameter
+ * @param hit_rec Output hit record
+ * @return true if intersection found
+ */
+bool heightfield_hit(const Hittable *hf, const Ray *ray,
+                     float t_min, float t_max, HitRecord *hit_rec);
+
+/**
+ * @brief Bounding box of a heightfield
+ * @param hf Pointer to heightfield data (cast from void*)
+ * @param box Output bounding box
+ * @return false if the heightfield is empty (failed build)
+ */
+bool heightfield_bounds(const Hittable *hf, AABB *box);
+
+/**
+ * @brief Create a hittable heightfield object
+ * @param hf Pointer to a built heightfield
+ * @return Hittable object wrapping the heightfield
+ */
+Hittable heightfield_to_hittable(Heightfield *hf);
+
+/**
+ * @brief Bytes of memory owned by the heightfield (heights plus mipmap)
+ */
+size_t heightfield_memory_bytes(const Heightfield *hf);
+
+#endif // HEIGHTFIELD_H
@@ -10,6 +10,8 @@
 
 #include "vec3.h"
 #include "ray.h"
+#include "aabb.h"
+#include "color.h"
 #include <stdbool.h>
 
 /**
@@ -20,6 +22,8 @@ typedef struct {
     Vec3 normal;     ///< Surface normal at intersection (unit vector)
     float t;         ///< Ray parameter at intersection
     bool front_face; ///< True if ray hits front face of surface
+    Color albedo;    ///< Material color of the surface that was hit
+    int object_index; ///< Index of the scene object that was hit (set by scene_hit)
 } HitRecord;
 
 /**
@@ -39,12 +43,59 @@ typedef struct Hittable Hittable;
 typedef bool (*HitFunction)(const Hittable *object, const Ray *ray, 
                            float t_min, float t_max, HitRecord *hit_rec);
 
+/**
+ * @brief Function pointer type for bounding box queries
+ * @param object Pointer to the hittable object
+ * @param box Output world-space bounding box
+ * @return true if the object is bounded, false for infinite objects
+ */
+typedef bool (*BoundsFunction)(const Hittable *object, AABB *box);
+
+/**
+ * @brief Function pointer type for moving an object
+ * @param object Pointer to the hittable object
+ * @param offset World-space translation
+ */
+typedef void (*MoveFunction)(const Hittable *object, Vec3 offset);
+
+/**
+ * @brief One thread's memory of the primitives an aggregate answered with last
+ * Neighbouring rays mostly hit the same primitive of an aggregate (BVH,
+ * grid, point cloud). Testing it before traversing gives a closest-hit
+ * query a tight t_max from the start, and ends a shadow query at once if
+ * it still blocks the ray. Primitives are aggregate-specific indices
+ * (objects of a BVH or grid, leaves of a point cloud); -1 means none.
+ */
+typedef struct {
+    int last_hit;       ///< Primitive of the last closest hit
+    int last_occluder;  ///< Primitive that blocked the last shadow ray
+    bool answered;      ///< The last query was answered by the remembered primitive
+} HitHint;
+
+/**
+ * @brief Function pointer type for hit testing guided by a hint
+ * @param object Pointer to the hittable object
+ * @param ray Ray to test for intersection
+ * @param t_min Minimum ray parameter to consider
+ * @param t_max Maximum ray parameter to consider
+ * @param any_hit Stop at the first hit in range instead of finding the closest (shadow
+ *                rays); hit_rec is then only scratch space
+ * @param hint Calling thread's hint for this object, tested first and updated
+ * @param hit_rec Output hit record (only valid if function returns true)
+ * @return true if intersection found, false otherwise
+ */
+typedef bool (*HintedHitFunction)(const Hittable *object, const Ray *ray, float t_min,
+                                  float t_max, bool any_hit, HitHint *hint, HitRecord *hit_rec);
+
 /**
  * @brief Hittable object interface
  */
 struct Hittable {
-    void *data;           ///< Pointer to object-specific data
-    HitFunction hit_func; ///< Function to test ray intersection
+    void *data;                 ///< Pointer to object-specific data
+    HitFunction hit_func;       ///< Function to test ray intersection
+    BoundsFunction bounds_func; ///< Function to query bounds (NULL if unbounded)
+    HintedHitFunction hinted_hit_func; ///< Hit test guided by a HitHint (NULL if not an aggregate)
+    MoveFunction move_func;     ///< Function to translate the object (NULL if it cannot move)
 };
 
 /**
@@ -55,6 +106,33 @@ struct Hittable {
  */
 Hittable hittable_create(void *data, HitFunction hit_func);
 
+/**
+ * @brief Create a hittable object with finite bounds
+ * Bounded objects can be placed in acceleration structures (BVH, grid).
+ * @param data Pointer to object-specific data
+ * @param hit_func Function to handle ray intersection
+ * @param bounds_func Function returning the object's bounding box
+ * @return Hittable object
+ */
+Hittable hittable_create_bounded(void *data, HitFunction hit_func, BoundsFunction bounds_func);
+
+/**
+ * @brief Query the bounding box of a hittable object
+ * @param object The hittable object
+ * @param box Output bounding box
+ * @return true if the object is bounded
+ */
+bool hittable_bounds(const Hittable *object, AABB *box);
+
+/**
+ * @brief Translate a hittable object
+ * Changes the object's data, so no render may be using it.
+ * @param object The hittable object
+ * @param offset World-space translation
+ * @return false if the object cannot be moved
+ */
+bool hittable_move(const Hittable *object, Vec3 offset);
+
 /**
  * @brief Test ray intersection with hittable object
  * @param object The hittable object
@@ -67,6 +145,27 @@ Hittable hittable_create(void *data, HitFunction hit_func);
 bool hittable_hit(const Hittable *object, const Ray *ray, 
                   float t_min, float t_max, HitRecord *hit_rec);
 
+/**
+ * @brief Test ray intersection guided by the calling thread's hint
+ * Finds the same hit as hittable_hit (any hit in range with any_hit).
+ * Objects that are not aggregates count as a single primitive, 0.
+ * @param object The hittable object
+ * @param ray Ray to test
+ * @param t_min Minimum ray parameter
+ * @param t_max Maximum ray parameter
+ * @param any_hit Stop at the first hit in range instead of finding the closest
+ * @param hint Thread's hint for this object (see hittable_hint_init)
+ * @param hit_rec Output hit record
+ * @return true if intersection found
+ */
+bool hittable_hit_hinted(const Hittable *object, const Ray *ray, float t_min, float t_max,
+                         bool any_hit, HitHint *hint, HitRecord *hit_rec);
+
+/**
+ * @brief Hint that remembers no primitive
+ */
+HitHint hittable_hint_init(void);
+
 /**
  * @brief Set face normal based on ray direction
  * Determines if ray hits front or back face and sets normal accordingly
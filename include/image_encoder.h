@@ -0,0 +1,177 @@
+/**
+ * @file image_encoder.h
+ * @brief Streaming band-by-band image encoders (PPM, QOI, PNG, PFM, EXR)
+ *
+ * Encoding happens in two stages so it can overlap with rendering:
+ * image_encoder_prepare_band may run on any thread as soon as a band is
+ * complete (PNG filters and deflates the band there, so bands compress in
+ * parallel), while image_encoder_write_band runs on the writer thread in
+ * band order (QOI and PPM encode there, since their streams are serial).
+ *
+ * 8-bit formats take bands of RGB8 pixels. Float formats (PFM, EXR) take
+ * bands of interleaved float channels straight from the renderer,
+ * unclamped: Color values for an RGB image, or any number of named
+ * channels for EXR (PFM allows one or three). PFM writes them to the file
+ * as they are, EXR converts each row to planar float or half channels and
+ * RLE-compresses it on the parallel stage.
+ */
+
+#ifndef IMAGE_ENCODER_H
+#define IMAGE_ENCODER_H
+
+#include "color.h"
+#include "deflate.h"
+#include "file_sink.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Output file formats
+ */
+typedef enum {
+    IMAGE_FORMAT_PPM,   ///< Plain-text PPM (P3)
+    IMAGE_FORMAT_QOI,   ///< Quite OK Image format
+    IMAGE_FORMAT_PNG,   ///< PNG with built-in deflate
+    IMAGE_FORMAT_PFM,   ///< Portable float map (32-bit float RGB)
+    IMAGE_FORMAT_EXR    ///< Scanline OpenEXR, RLE (float or half RGB)
+} ImageFormat;
+
+/**
+ * @brief Most channels in a float image
+ */
+#define IMAGE_MAX_CHANNELS 16
+
+/**
+ * @brief Longest EXR channel name (the limit of readers without long-name support)
+ */
+#define IMAGE_MAX_CHANNEL_NAME 31
+
+/**
+ * @brief Layout of an image to encode
+ */
+typedef struct {
+    ImageFormat format;       ///< Output format
+    bool half_float;          ///< EXR: store 16-bit floats
+    int width;                ///< Image width in pixels
+    int height;               ///< Image height in pixels
+    int channel_count;        ///< Float channels per pixel (8-bit formats: 3)
+    const char *channel_names[IMAGE_MAX_CHANNELS]; ///< EXR names, in memory order
+} ImageSpec;
+
+/**
+ * @brief Per-slot state of the parallel stage (PNG and EXR)
+ */
+typedef struct {
+    uint8_t *filtered;        ///< PNG: filtered scanlines; EXR: predicted row
+    uint8_t *trial;           ///< PNG: one scanline for trying filters; EXR: planar row
+    uint8_t *chunk;           ///< PNG: IDAT chunk; EXR: one chunk per row
+    size_t chunk_size;        ///< Bytes in chunk
+    uint32_t *row_chunk_bytes; ///< EXR: bytes of each row's chunk
+    uint32_t adler;           ///< PNG: Adler-32 of the filtered scanlines
+    uint64_t raw_size;        ///< PNG: bytes of filtered scanlines
+    DeflateScratch *scratch;  ///< PNG: match finding state
+} ImageEncoderSlot;
+
+/**
+ * @brief Encoder state for one image
+ */
+typedef struct {
+    ImageFormat format;       ///< Output format
+    bool half_float;          ///< EXR: store 16-bit floats
+    int width;                ///< Image width in pixels
+    int height;               ///< Image height in pixels
+    int channel_count;        ///< Float channels per pixel
+    int exr_channels[IMAGE_MAX_CHANNELS]; ///< EXR: memory channel of each file channel
+    const char *channel_names[IMAGE_MAX_CHANNELS]; ///< EXR: channel names, in memory order
+    int band_height;          ///< Rows per band
+    int band_count;           ///< Number of bands
+    int slot_count;           ///< Band slots that may be prepared concurrently
+    ImageEncoderSlot *slots;  ///< Parallel stage state (NULL unless PNG)
+    uint32_t qoi_index[64];   ///< QOI: recently seen pixels (0xRRGGBB, alpha implied)
+    uint32_t qoi_previous;    ///< QOI: previous pixel
+    int qoi_run;              ///< QOI: pending run length
+    uint32_t png_adler;       ///< PNG: Adler-32 of the bands written so far
+    int64_t data_offset;      ///< PFM: file offset of the pixel data; EXR: of the offset table
+    uint64_t *exr_offsets;    ///< EXR: file offset of each row's chunk
+    size_t memory_bytes;      ///< Memory held by the encoder
+} ImageEncoder;
+
+/**
+ * @brief Pick a format from a file name's extension (.qoi, .png, .pfm, .exr;
+ *        anything else is PPM)
+ */
+ImageFormat image_format_from_path(const char *path);
+
+/**
+ * @brief Short name of a format ("PPM", "QOI", "PNG", "PFM", "EXR")
+ */
+const char *image_format_name(ImageFormat format);
+
+/**
+ * @brief True for formats that take linear float pixels
+ */
+bool image_format_is_float(ImageFormat format);
+
+/**
+ * @brief Bytes per pixel of the RGB bands a format takes (RGB8 or Color)
+ */
+size_t image_format_pixel_bytes(ImageFormat format);
+
+/**
+ * @brief Layout of an RGB image (channels R, G, B)
+ * @param format Output format
+ * @param half_float Store 16-bit floats (EXR only, ignored otherwise)
+ * @param width Image width in pixels
+ * @param height Image height in pixels
+ */
+ImageSpec image_spec_rgb(ImageFormat format, bool half_float, int width, int height);
+
+/**
+ * @brief Bytes per pixel of the bands an image takes
+ */
+size_t image_spec_pixel_bytes(const ImageSpec *spec);
+
+/**
+ * @brief Initialize an encoder
+ * @param encoder Encoder to initialize
+ * @param spec Image layout (copied; channel names must outlive the encoder)
+ * @param band_height Rows per band (the last band may be shorter)
+ * @param slot_count Number of band slots used by the caller
+ * @return false on allocation failure or a channel layout the format cannot store
+ */
+bool image_encoder_init(ImageEncoder *encoder, const ImageSpec *spec, int band_height,
+                        int slot_count);
+
+/**
+ * @brief Release encoder memory
+ */
+void image_encoder_destroy(ImageEncoder *encoder);
+
+/**
+ * @brief Write the file header
+ */
+void image_encoder_begin(ImageEncoder *encoder, FileSink *sink);
+
+/**
+ * @brief Parallel stage for a complete band
+ * Safe to call concurrently for different slots.
+ * @param encoder Encoder
+ * @param slot Slot holding the band
+ * @param band Band index
+ * @param pixels Band pixels (see image_format_pixel_bytes), rows top to bottom
+ */
+void image_encoder_prepare_band(ImageEncoder *encoder, int slot, int band, const void *pixels);
+
+/**
+ * @brief Serial stage: add a prepared band to the file (bands in order)
+ */
+void image_encoder_write_band(ImageEncoder *encoder, FileSink *sink, int slot, int band,
+                              const void *pixels);
+
+/**
+ * @brief Write the file trailer
+ */
+void image_encoder_end(ImageEncoder *encoder, FileSink *sink);
+
+#endif // IMAGE_ENCODER_H
@@ -0,0 +1,138 @@
+/**
+ * @file integrator.h
+ * @brief Light transport: direct shading or iterative path tracing
+ *
+ * The direct integrator is scene_trace: Lambertian shading from every
+ * point light plus a constant ambient term, without shadows or bounces.
+ *
+ * The path integrator follows each camera path in a loop, carrying its
+ * throughput instead of recursing, so any bounce limit runs in constant
+ * stack space. At every diffuse vertex it adds next-event estimation
+ * towards each PointLight (with a shadow ray), then continues along a
+ * cosine-weighted direction; reflective surfaces continue along the
+ * (roughness-jittered) mirror direction. Rays that leave the scene pick
+ * up the background as sky light. After roulette_bounces vertices each
+ * path survives with probability equal to its largest throughput channel
+ * (at most 0.95) and is reweighted, so dim paths stop early without bias.
+ *
+ * Point lights keep the direct integrator's convention: a light gives
+ * color * intensity * cos(theta) at a surface, attenuated only if it has
+ * a falloff distance.
+ *
+ * With light_samples > 0 and a built light tree, both integrators shade
+ * with that many lights picked from the tree instead of every light,
+ * weighted by the inverse of their probability, so scenes with thousands
+ * of lights shade in logarithmic time without bias.
+ */
+
+#ifndef INTEGRATOR_H
+#define INTEGRATOR_H
+
+#include "hit.h"
+#include "ray.h"
+#include "sampler.h"
+#include "scene.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Default bounce limit and roulette start of the path integrator
+ */
+#define INTEGRATOR_DEFAULT_MAX_BOUNCES 16
+#define INTEGRATOR_DEFAULT_ROULETTE_BOUNCES 3
+
+/**
+ * @brief First sampler dimension used by paths (0-3 place the camera sample)
+ */
+#define INTEGRATOR_FIRST_DIMENSION 4
+
+/**
+ * @brief Sampler dimensions a path vertex uses to scatter
+ * Each light sample takes one more dimension after these.
+ */
+#define INTEGRATOR_DIMENSIONS_PER_BOUNCE 4
+
+/**
+ * @brief Light transport algorithms
+ */
+typedef enum {
+    INTEGRATOR_DIRECT, ///< Direct Lambertian shading (scene_trace)
+    INTEGRATOR_PATH    ///< Iterative path tracing with next-event estimation
+} IntegratorType;
+
+/**
+ * @brief Integrator selection and path limits
+ */
+typedef struct {
+    IntegratorType type;   ///< Algorithm
+    int max_bounces;       ///< Path: scattering events after the primary hit
+    int roulette_bounces;  ///< Path: vertices before Russian roulette starts
+    int light_samples;     ///< Lights sampled from the light tree per shading point (0: all)
+} IntegratorSettings;
+
+/**
+ * @brief Where a path draws its random numbers
+ */
+typedef struct {
+    const Sampler *sampler; ///< Sample streams
+    uint32_t x;             ///< Pixel column
+    uint32_t y;             ///< Pixel row
+    uint32_t index;         ///< Sample index within the pixel
+} PathSample;
+
+/**
+ * @brief Direct integrator over every light, with the default path limits
+ */
+IntegratorSettings integrator_default_settings(void);
+
+/**
+ * @brief Parse "direct" or "path"
+ * @return false for an unknown name
+ */
+bool integrator_parse_type(const char *name, IntegratorType *type);
+
+/**
+ * @brief Name of an integrator, as accepted by integrator_parse_type
+ */
+const char *integrator_type_name(IntegratorType type);
+
+/**
+ * @brief Radiance arriving along a camera ray
+ * @param scene Scene to render
+ * @param settings Integrator and limits
+ * @param sample Random number source (may be NULL for the direct integrator over all lights)
+ * @param ray Camera ray
+ * @param color Output: radiance
+ * @param primary Output: first hit (only valid if the function returns true)
+ * @return true if the camera ray hit a surface
+ */
+bool integrator_trace(const Scene *scene, const IntegratorSettings *settings,
+                      const PathSample *sample, const Ray *ray, Color *color,
+                      HitRecord *primary);
+
+/**
+ * @brief integrator_trace with the camera ray tested against some objects only
+ * Same result as integrator_trace if the set holds every object the camera
+ * ray can hit (see scene_bin_objects); later path vertices test all objects.
+ * @param primary_objects Objects the camera ray is tested against
+ * @param cache Calling thread's hit cache for closest-hit and shadow queries; every
+ *              ray the path casts goes through it, so scene_hit_cache_rays counts them
+ */
+bool integrator_trace_objects(const Scene *scene, const IntegratorSettings *settings,
+                              const PathSample *sample, const Ray *ray,
+                              SceneObjectSet primary_objects, SceneHitCache *cache,
+                              Color *color, HitRecord *primary);
+
+/**
+ * @brief Radiance along a camera ray whose first hit is already known
+ * Same result as integrator_trace when primary is the hit it would find,
+ * without tracing the camera ray again (e.g. from a G-buffer).
+ * @param primary First hit of the ray (NULL: the ray leaves the scene)
+ * @param cache Calling thread's hit cache for later path vertices and shadow rays
+ * @return Radiance
+ */
+Color integrator_shade(const Scene *scene, const IntegratorSettings *settings,
+                       const PathSample *sample, const Ray *ray, const HitRecord *primary,
+                       SceneHitCache *cache);
+
+#endif // INTEGRATOR_H
@@ -0,0 +1,73 @@
+/**
+ * @file light.h
+ * @brief Point light sources
+ */
+
+#ifndef LIGHT_H
+#define LIGHT_H
+
+#include "vec3.h"
+#include "color.h"
+#include <math.h>
+#include <stdbool.h>
+
+/**
+ * @brief Point light structure
+ * Lights shine equally in every direction. Without falloff (falloff_start 0)
+ * a light gives color * intensity * cos(theta) at any distance; with it,
+ * that value holds within falloff_start and drops with the inverse square
+ * of the distance beyond. A light with an influence radius does not reach
+ * past it at all, which lets renderers skip it for distant surfaces.
+ */
+typedef struct {
+    Vec3 position;       ///< Light position
+    Color color;         ///< Light color/intensity
+    float intensity;     ///< Light intensity multiplier
+    float falloff_start; ///< Distance where inverse-square falloff begins (0: no falloff)
+    float radius;        ///< Influence radius: no light beyond it (0: unlimited)
+} PointLight;
+
+/**
+ * @brief Fraction of a light's intensity that reaches a given distance
+ * @param light Light
+ * @param distance_squared Squared distance from the light
+ * @return Attenuation in (0, 1]
+ */
+static inline float point_light_attenuation(const PointLight *light, float distance_squared) {
+    float start_squared = light->falloff_start * light->falloff_start;
+    if (start_squared <= 0.0f || distance_squared <= start_squared) {
+        return 1.0f;
+    }
+    return start_squared / distance_squared;
+}
+
+/**
+ * @brief Whether a light reaches a given distance (is within its influence radius)
+ */
+static inline bool point_light_reaches(const PointLight *light, float distance_squared) {
+    return light->radius <= 0.0f || distance_squared <= light->radius * light->radius;
+}
+
+/**
+ * @brief Influence radius beyond which a light with falloff adds less than threshold
+ * @param light Light with falloff_start > 0
+ * @param threshold Smallest color value worth keeping (e.g. 1/256)
+ * @return Radius (0 if the light has no falloff)
+ */
+static inline float point_light_cutoff_radius(const PointLight *light, float threshold) {
+    float brightest = fmaxf(light->color.x, fmaxf(light->color.y, light->color.z));
+    float peak = light->intensity * brightest;
+    if (light->falloff_start <= 0.0f || peak <= threshold) {
+        return light->falloff_start;
+    }
+    return light->falloff_start * sqrtf(peak / threshold);
+}
+
+/**
+ * @brief Scalar emitted power of a light, used to rank lights by importance
+ */
+static inline float point_light_power(const PointLight *light) {
+    return light->intensity * (light->color.x + light->color.y + light->color.z);
+}
+
+#endif // LIGHT_H
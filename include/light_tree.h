@@ -0,0 +1,78 @@
+/**
+ * @file light_tree.h
+ * @brief Bounding hierarchy over point lights for many-light sampling
+ *
+ * Each node bounds the positions of its lights and sums their power, so
+ * at a shading point it can estimate an upper bound of how much light
+ * its subtree may deliver: power (attenuated by the distance to the node
+ * for lights with falloff) times the largest cosine any light of the
+ * node can make with the surface normal. Sampling walks from the root to
+ * one light, choosing each child in proportion to that estimate, so a
+ * light is picked in O(log n) with a known probability and the direct
+ * lighting estimate (contribution / probability) stays unbiased. Whole
+ * subtrees behind the surface or out of their lights' influence radius
+ * are never chosen.
+ *
+ * Point lights shine in every direction, so the emitter side of the
+ * orientation bound is always the full sphere; only the cone the node
+ * subtends from the shading point limits the cosine term.
+ */
+
+#ifndef LIGHT_TREE_H
+#define LIGHT_TREE_H
+
+#include "aabb.h"
+#include "light.h"
+#include <stdbool.h>
+
+/**
+ * @brief Flattened light tree node
+ * Interior nodes store the index of their second child; the first child
+ * immediately follows the node. Every leaf holds exactly one light.
+ */
+typedef struct {
+    AABB bounds;            ///< Bounds of the light positions below this node
+    float power;            ///< Summed power of lights without falloff
+    float falloff_power;    ///< Summed power * falloff_start^2 of lights with falloff
+    float min_falloff_squared; ///< Smallest falloff_start^2 below (INFINITY if none)
+    float max_radius;       ///< Largest influence radius below (INFINITY if any is unlimited)
+    int offset;             ///< Leaf: light index, interior: second child index
+    int count;              ///< Number of lights below this node
+} LightTreeNode;
+
+/**
+ * @brief Light hierarchy
+ */
+typedef struct {
+    LightTreeNode *nodes; ///< Depth-first node array (root at index 0)
+    int node_count;       ///< Number of nodes in use (0: no lights)
+} LightTree;
+
+/**
+ * @brief Build a tree over a set of lights
+ * Splits minimise bounding-box area weighted by power, so bright lights
+ * end up in tight nodes.
+ * @param tree Tree to build (any previous contents are not freed)
+ * @param lights Lights; leaves refer to them by index
+ * @param count Number of lights
+ * @return false on allocation failure
+ */
+bool light_tree_build(LightTree *tree, const PointLight *lights, int count);
+
+/**
+ * @brief Free memory owned by a light tree (leaves it empty)
+ */
+void light_tree_destroy(LightTree *tree);
+
+/**
+ * @brief Pick a light for a shading point in proportion to its estimated contribution
+ * @param tree Built tree
+ * @param point Shading point
+ * @param normal Unit surface normal (only lights in front of it contribute)
+ * @param u Uniform random number in [0, 1)
+ * @param pdf Output: probability of the returned light
+ * @return Light index, or -1 if no light can reach the point
+ */
+int light_tree_sample(const LightTree *tree, Vec3 point, Vec3 normal, float u, float *pdf);
+
+#endif // LIGHT_TREE_H
@@ -0,0 +1,104 @@
+/**
+ * @file output_pipeline.h
+ * @brief Asynchronous, in-order image output
+ *
+ * The image is split into bands of whole rows. Render workers fill bands
+ * (in any pieces they like) in a bounded ring of band slots. The worker
+ * that completes a band runs the encoder's parallel stage on it; a
+ * dedicated writer thread then finishes encoding bands in scanline order
+ * and streams them to the file through a FileSink, so encoding and I/O
+ * overlap with rendering. A worker that gets too far ahead of the writer blocks until
+ * its slot has been written, which bounds memory to the ring size no
+ * matter how large the image is.
+ */
+
+#ifndef OUTPUT_PIPELINE_H
+#define OUTPUT_PIPELINE_H
+
+#include "file_sink.h"
+#include "image_encoder.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief Output pipeline state
+ */
+typedef struct {
+    int width;                  ///< Image width in pixels
+    int height;                 ///< Image height in pixels
+    int band_height;            ///< Rows per band
+    int band_count;             ///< Number of bands in the image
+    int capacity;               ///< Band slots in the ring
+    size_t band_bytes;          ///< Bytes per band slot
+    size_t pixel_bytes;         ///< Bytes per pixel (image_spec_pixel_bytes)
+    uint8_t *slots;             ///< capacity bands of pixels
+    uint64_t *filled;           ///< Per slot: pixels submitted so far
+    bool *ready;                ///< Per slot: band complete and prepared
+    int next_write;             ///< Next band the writer will encode
+    bool aborted;               ///< Writer told to stop without finishing the file
+    pthread_mutex_t lock;       ///< Protects filled, ready, next_write and aborted
+    pthread_cond_t band_ready;  ///< Signalled when a band is ready for the writer
+    pthread_cond_t slot_free;   ///< Signalled when the writer frees a slot
+    pthread_t writer;           ///< Writer thread
+    FILE *output;               ///< Output stream (positioned after the image on finish)
+    FileSink sink;              ///< Buffered file output
+    ImageEncoder encoder;       ///< Output format encoder
+    double prepare_seconds;     ///< Worker time spent in the parallel encode stage
+    double encode_seconds;      ///< Writer time spent encoding
+    double wait_seconds;        ///< Writer time spent waiting for bands
+    uint64_t bytes_written;     ///< Bytes written (set by output_pipeline_finish)
+    const char *io_backend;     ///< Sink backend used (set by output_pipeline_finish)
+    size_t memory_bytes;        ///< Band slots, encoder and sink buffers
+} OutputPipeline;
+
+/**
+ * @brief Start the writer thread
+ * @param pipeline Pipeline to initialize
+ * @param output Output stream; written from its current position
+ * @param spec Image layout
+ * @param band_height Rows per band (the last band may be shorter)
+ * @param capacity Band slots in flight (memory is capacity * band_height * width pixels)
+ * @return false on allocation or thread creation failure, or an unsupported layout
+ */
+bool output_pipeline_start(OutputPipeline *pipeline, FILE *output, const ImageSpec *spec,
+                           int band_height, int capacity);
+
+/**
+ * @brief Get the buffer for a band, waiting until its slot is free
+ * Workers should claim work in increasing band order, so that the band
+ * the writer waits for never belongs to a worker blocked here. Several
+ * workers may fill disjoint parts of the same band.
+ * @param pipeline Pipeline
+ * @param band Band index (0 = top of the image)
+ * @return band_height * width pixels, rows top to bottom: RGB8, or
+ *         channel_count floats for float formats (image_spec_pixel_bytes)
+ */
+void *output_pipeline_acquire_band(OutputPipeline *pipeline, int band);
+
+/**
+ * @brief Report filled pixels of an acquired band
+ * The caller that submits a band's last pixel also runs the encoder's
+ * parallel stage on it before handing it to the writer.
+ * @param pipeline Pipeline
+ * @param band Band previously acquired
+ * @param pixels Number of pixels just filled
+ */
+void output_pipeline_submit(OutputPipeline *pipeline, int band, uint64_t pixels);
+
+/**
+ * @brief Stop the writer after the band it is on, leaving the file incomplete
+ * For giving up on a pipeline no band will be submitted to; finish must
+ * still be called and then reports failure.
+ */
+void output_pipeline_abort(OutputPipeline *pipeline);
+
+/**
+ * @brief Wait for every row to be written and release resources
+ * @param pipeline Pipeline
+ * @return false if any write failed
+ */
+bool output_pipeline_finish(OutputPipeline *pipeline);
+
+#endif // OUTPUT_PIPELINE_H
@@ -61,6 +61,13 @@ Plane plane_create_xz(float y, Color color);
 bool plane_hit(const Hittable *plane, const Ray *ray, 
                float t_min, float t_max, HitRecord *hit_rec);
 
+/**
+ * @brief Move a plane along its normal (offsets within the plane change nothing)
+ * @param plane Pointer to plane data (cast from void*)
+ * @param offset World-space translation
+ */
+void plane_move(const Hittable *plane, Vec3 offset);
+
 /**
  * @brief Create a hittable plane object
  * @param plane Pointer to plane structure
@@ -84,6 +91,18 @@ float plane_distance_to_point(const Plane *plane, Vec3 point);
  */
 bool plane_point_in_front(const Plane *plane, Vec3 point);
 
+/**
+ * @brief Check whether rays from a point can reach the plane
+ * Covers every ray whose direction is a non-negative combination of the
+ * given directions (e.g. the corner rays of a screen tile).
+ * @param plane The plane
+ * @param origin Common ray origin
+ * @param directions Directions spanning the rays
+ * @param count Number of directions
+ * @return false only if none of the rays can hit the plane
+ */
+bool plane_reachable(const Plane *plane, Vec3 origin, const Vec3 *directions, int count);
+
 /**
  * @brief Print plane information (for debugging)
  * @param plane The plane to print
@@ -0,0 +1,122 @@
+/**
+ * @file point_cloud.h
+ * @brief Compact point cloud of equal-radius spheres
+ *
+ * Built for very large particle sets (hundreds of millions of points).
+ * Points are sorted along a Morton curve and the BVH is built directly
+ * over the sorted array by splitting ranges where the Morton codes first
+ * differ, so leaves are contiguous runs of points and no per-object
+ * Hittable or index list is stored. Each leaf keeps its points as 16-bit
+ * integers per axis relative to the leaf's bounds (6 bytes per point).
+ * Including nodes, a cloud costs roughly 15-20 bytes per point.
+ */
+
+#ifndef POINT_CLOUD_H
+#define POINT_CLOUD_H
+
+#include "vec3.h"
+#include "ray.h"
+#include "hit.h"
+#include "color.h"
+#include "aabb.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Points per BVH leaf
+ */
+#define POINT_CLOUD_LEAF_SIZE 8
+
+/**
+ * @brief Point cloud BVH node
+ * Interior nodes store the index of their second child; the first child
+ * immediately follows the node. Leaves reference a run of points.
+ */
+typedef struct {
+    AABB bounds;      ///< Bounds of every sphere below this node
+    uint32_t offset;  ///< Leaf: first point index, interior: second child index
+    uint16_t count;   ///< Number of points (0 for interior nodes)
+    uint16_t axis;    ///< Split axis of interior nodes (for ordered traversal)
+} PointCloudNode;
+
+/**
+ * @brief Point cloud with an implicit BVH over quantized positions
+ */
+typedef struct {
+    uint16_t *positions;    ///< Quantized x, y, z per point, relative to the leaf bounds
+    size_t point_count;     ///< Number of points
+    PointCloudNode *nodes;  ///< Depth-first node array (root at index 0)
+    size_t node_count;      ///< Number of nodes
+    float radius;           ///< Radius shared by all points
+    Color color;            ///< Material color
+} PointCloud;
+
+/**
+ * @brief Build a point cloud from packed float positions
+ * @param cloud Point cloud to build
+ * @param positions x, y, z per point
+ * @param count Number of points (at most INT32_MAX)
+ * @param radius Shared sphere radius; <= 0 derives one from the point density
+ * @param color Material color
+ * @return true on success, false on empty input or allocation failure
+ */
+bool point_cloud_build(PointCloud *cloud, const float *positions, size_t count,
+                       float radius, Color color);
+
+/**
+ * @brief Build a point cloud from a raw binary file of float x, y, z triples
+ * The file is memory-mapped, so its positions are never copied into memory.
+ * @param cloud Point cloud to build
+ * @param path File of native-endian float32 triples
+ * @param radius Shared sphere radius; <= 0 derives one from the point density
+ * @param color Material color
+ * @return true on success, false if the file cannot be mapped or is malformed
+ */
+bool point_cloud_load(PointCloud *cloud, const char *path, float radius, Color color);
+
+/**
+ * @brief Free memory owned by a point cloud
+ * @param cloud Point cloud to destroy
+ */
+void point_cloud_destroy(PointCloud *cloud);
+
+/**
+ * @brief Find the closest point sphere hit by a ray
+ * @param cloud Pointer to point cloud data (cast from void*)
+ * @param ray Ray to test
+ * @param t_min Minimum ray parameter
+ * @param t_max Maximum ray parameter
+ * @param hit_rec Output hit record
+ * @return true if any point was hit
+ */
+bool point_cloud_hit(const Hittable *cloud, const Ray *ray,
+                     float t_min, float t_max, HitRecord *hit_rec);
+
+/**
+ * @brief point_cloud_hit testing the leaf a hint remembers before traversing
+ * Primitives are leaf indices into cloud->nodes. See HintedHitFunction.
+ */
+bool point_cloud_hit_hinted(const Hittable *cloud, const Ray *ray, float t_min, float t_max,
+                            bool any_hit, HitHint *hint, HitRecord *hit_rec);
+
+/**
+ * @brief Bounding box of a point cloud
+ * @param cloud Pointer to point cloud data (cast from void*)
+ * @param box Output bounding box
+ * @return false if the cloud is empty
+ */
+bool point_cloud_bounds(const Hittable *cloud, AABB *box);
+
+/**
+ * @brief Create a hittable point cloud object
+ * @param cloud Pointer to the point cloud
+ * @return Hittable object wrapping the point cloud
+ */
+Hittable point_cloud_to_hittable(PointCloud *cloud);
+
+/**
+ * @brief Bytes of memory owned by the point cloud
+ */
+size_t point_cloud_memory_bytes(const PointCloud *cloud);
+
+#endif // POINT_CLOUD_H
@@ -0,0 +1,84 @@
+/**
+ * @file preview.h
+ * @brief Reduced-resolution previews refined towards the full image
+ *
+ * A preview shades only every factor-th pixel in both directions (1/4,
+ * 1/16 or 1/64 of the pixels) and fills in the rest with a joint
+ * bilateral upsampler (Kopf et al. 2007). A full-resolution guide pass
+ * traces only the primary rays, without shading, into a G-buffer. A shaded
+ * sample then contributes to a pixel only if it sees the same object at a
+ * similar depth, so silhouettes stay sharp instead of blurring across
+ * objects.
+ *
+ * Refinement halves the factor until the image is complete. Each level
+ * shades only the pixels that are new to it, starting from their G-buffer
+ * hits, so all levels together cost about as much as a plain render and
+ * the full-resolution level reproduces render_scene's image exactly.
+ * Every level is written to the output and the live framebuffer as soon
+ * as it is upsampled.
+ */
+
+#ifndef PREVIEW_H
+#define PREVIEW_H
+
+#include "camera.h"
+#include "render.h"
+#include "scene.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Coarsest subsampling factor
+ */
+#define PREVIEW_MAX_FACTOR 8
+
+/**
+ * @brief Relative depth difference at which a sample's weight falls to 1/sqrt(e)
+ */
+#define PREVIEW_DEPTH_SIGMA 0.05f
+
+/**
+ * @brief Outcome of a preview render
+ */
+typedef struct {
+    int levels;                 ///< Levels written, coarsest first
+    int final_factor;           ///< Subsampling factor of the last written level (1: full)
+    double guide_seconds;       ///< Time of the full-resolution depth and object pass
+    double first_frame_seconds; ///< Time from the start until the first level was written
+    uint64_t shaded_pixels;     ///< Pixels shaded over all levels
+} PreviewStats;
+
+/**
+ * @brief Whether a factor is a valid starting factor (2, 4 or 8)
+ */
+bool preview_factor_valid(int factor);
+
+/**
+ * @brief Ask a running preview to stop refining
+ * Async-signal-safe; the last complete level stays in the output.
+ */
+void preview_request_stop(void);
+
+/**
+ * @brief Render a preview at 1/factor resolution and refine it to full resolution
+ * Settings are used as by render_scene; AOVs, G-buffers, render caches and
+ * light culling are not supported. Once settings->cancel is set, no
+ * further rows or levels are started and the preview returns false, with
+ * the last complete level in the output. stats->first_tile_seconds is the
+ * time until the first level was written.
+ * @param camera Camera configuration
+ * @param scene Scene to render
+ * @param settings Rendering parameters (threads, tiles, format, integrator, live framebuffer
+ *                 by name or already mapped, cancel flag)
+ * @param factor Starting subsampling factor (see preview_factor_valid)
+ * @param output_path Image file, replaced by each level
+ * @param stats Optional output statistics (may be NULL)
+ * @param preview_stats Optional level figures (may be NULL)
+ * @return false on invalid settings, allocation, thread creation or write failure, if
+ *         the framebuffer does not match the image, or when cancelled
+ */
+bool render_preview(const Camera *camera, const Scene *scene, const RenderSettings *settings,
+                    int factor, const char *output_path, RenderStats *stats,
+                    PreviewStats *preview_stats);
+
+#endif // PREVIEW_H
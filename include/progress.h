@@ -0,0 +1,133 @@
+/**
+ * @file progress.h
+ * @brief Lock-free, rate-limited render progress reporting
+ *
+ * Render workers only bump atomic counters. A single reporter thread wakes
+ * at a fixed interval and prints percent done, rays per second, ETA and
+ * per-thread utilization, either as a human-readable status line or as
+ * one JSON object per line for job runners.
+ */
+
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+
+/**
+ * @brief Default seconds between progress reports
+ */
+#define PROGRESS_DEFAULT_INTERVAL 0.5
+
+/**
+ * @brief How progress is reported
+ */
+typedef enum {
+    PROGRESS_BAR,    ///< Status line rewritten in place (default)
+    PROGRESS_QUIET,  ///< No output
+    PROGRESS_JSON    ///< One JSON object per report
+} ProgressMode;
+
+/**
+ * @brief Per-thread counters, padded to a cache line to avoid false sharing
+ */
+typedef struct {
+    _Alignas(64) atomic_uint_fast64_t busy_ns; ///< Nanoseconds spent working
+} ProgressThreadSlot;
+
+/**
+ * @brief Progress state shared by workers and the reporter thread
+ */
+typedef struct {
+    ProgressMode mode;            ///< Report format
+    double interval;              ///< Seconds between reports
+    FILE *stream;                 ///< Report destination
+    atomic_uint_fast64_t total_work; ///< Work units (e.g. rows) in the whole job
+    atomic_uint_fast64_t work_done; ///< Work units completed
+    atomic_uint_fast64_t rays;    ///< Rays traced so far
+    int thread_count;             ///< Number of worker slots
+    ProgressThreadSlot *threads;  ///< Per-worker counters
+    double start_time;            ///< Wall-clock start in seconds
+    atomic_bool running;          ///< Cleared to stop the reporter
+    pthread_t reporter;           ///< Reporter thread
+    bool has_reporter;            ///< True if the reporter thread was started
+} Progress;
+
+/**
+ * @brief Derived progress figures at one point in time
+ */
+typedef struct {
+    double elapsed;          ///< Seconds since start
+    double fraction;         ///< Completed fraction in [0, 1]
+    double rays_per_second;  ///< Average ray throughput since start
+    double eta;              ///< Estimated seconds remaining (negative if unknown)
+} ProgressSample;
+
+/**
+ * @brief Parse a progress mode name ("bar", "quiet", "json")
+ * @return true if the name is known
+ */
+bool progress_parse_mode(const char *name, ProgressMode *mode);
+
+/**
+ * @brief Start tracking a job and, unless quiet, the reporter thread
+ * @param progress Progress state to initialize
+ * @param mode Report format
+ * @param interval Seconds between reports
+ * @param total_work Work units in the job
+ * @param thread_count Number of worker threads that will report
+ * @param stream Report destination
+ * @return false on allocation or thread creation failure
+ */
+bool progress_start(Progress *progress, ProgressMode mode, double interval,
+                    uint64_t total_work, int thread_count, FILE *stream);
+
+/**
+ * @brief Record completed work (callable from any worker)
+ * @param progress Progress state
+ * @param work Work units completed
+ * @param rays Rays traced for that work
+ */
+static inline void progress_add_work(Progress *progress, uint64_t work, uint64_t rays) {
+    atomic_fetch_add_explicit(&progress->work_done, work, memory_order_relaxed);
+    atomic_fetch_add_explicit(&progress->rays, rays, memory_order_relaxed);
+}
+
+/**
+ * @brief Revise the size of the job (for jobs whose end is estimated as they go)
+ * @param progress Progress state
+ * @param total_work Work units in the whole job
+ */
+static inline void progress_set_total(Progress *progress, uint64_t total_work) {
+    atomic_store_explicit(&progress->total_work, total_work, memory_order_relaxed);
+}
+
+/**
+ * @brief Record time a worker spent busy
+ * @param progress Progress state
+ * @param thread Worker index
+ * @param seconds Busy time to add
+ */
+static inline void progress_add_busy(Progress *progress, int thread, double seconds) {
+    atomic_fetch_add_explicit(&progress->threads[thread].busy_ns,
+                              (uint_fast64_t)(seconds * 1e9), memory_order_relaxed);
+}
+
+/**
+ * @brief Compute progress figures at a given time
+ * @param progress Progress state
+ * @param now Wall-clock time in seconds
+ * @param sample Output figures
+ */
+void progress_sample(const Progress *progress, double now, ProgressSample *sample);
+
+/**
+ * @brief Stop the reporter, print a final report and free resources
+ * @param progress Progress state
+ */
+void progress_finish(Progress *progress);
+
+#endif // PROGRESS_H
@@ -0,0 +1,124 @@
+/**
+ * @file progressive.h
+ * @brief Progressive rendering under a time, sample or noise budget
+ *
+ * Instead of one sample per pixel, the image is rendered in passes that
+ * each add a sample to every pixel of a full-resolution accumulator.
+ * Rendering stops at the first of a wall-clock deadline, a sample count,
+ * a noise level or an external stop request (e.g. from a SIGINT handler),
+ * and the image is written from whatever has been accumulated. Output can
+ * also be refreshed at fixed intervals; every refresh is written to a
+ * temporary file and renamed over the output, so the file on disk is
+ * always a complete image.
+ *
+ * With adaptive sampling, a tile stops receiving samples once its own
+ * noise falls to a threshold, so later passes only revisit the tiles that
+ * are still noisy (edges, soft shadows) instead of the whole image.
+ */
+
+#ifndef PROGRESSIVE_H
+#define PROGRESSIVE_H
+
+#include "camera.h"
+#include "render.h"
+#include "sampler.h"
+#include "scene.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Noise is measured relative to pixel luminance, but never below this
+ */
+#define PROGRESSIVE_NOISE_FLOOR 0.05
+
+/**
+ * @brief Samples every tile takes before adaptive sampling may retire it
+ */
+#define PROGRESSIVE_DEFAULT_MIN_SAMPLES 8
+
+/**
+ * @brief Stopping and output rules
+ */
+typedef struct {
+    int max_samples;        ///< Samples per pixel to stop at (0: no limit)
+    double time_budget;     ///< Seconds to stop after (0: no limit)
+    double target_noise;    ///< Relative noise to stop at (0: no limit)
+    double update_interval; ///< Seconds between output refreshes (0: only at the end)
+    double adaptive_threshold; ///< Tile noise at which a tile stops sampling (0: uniform)
+    int min_samples;        ///< Samples every tile takes before it can stop (adaptive only)
+    float denoise_strength; ///< Denoise every written image at this strength (0: off)
+} ProgressiveSettings;
+
+/**
+ * @brief Why a progressive render stopped
+ */
+typedef enum {
+    PROGRESSIVE_STOP_SAMPLES,   ///< Reached max_samples
+    PROGRESSIVE_STOP_DEADLINE,  ///< Ran out of time_budget
+    PROGRESSIVE_STOP_NOISE,     ///< Noise fell to target_noise
+    PROGRESSIVE_STOP_REQUEST,   ///< progressive_request_stop was called
+    PROGRESSIVE_STOP_CONVERGED  ///< Every tile converged or reached max_samples
+} ProgressiveStopReason;
+
+/**
+ * @brief Outcome of a progressive render
+ */
+typedef struct {
+    int passes;                    ///< Passes started (the last may be partial)
+    int min_samples;               ///< Fewest samples any pixel received
+    int max_samples;               ///< Most samples any pixel received
+    double noise;                  ///< Final noise estimate (infinite below 2 samples)
+    uint64_t samples;              ///< Camera samples taken over all pixels
+    double mean_samples;           ///< Samples per pixel on average
+    uint64_t converged_tiles;      ///< Tiles retired by adaptive sampling
+    double denoise_seconds;        ///< Time spent denoising written images
+    int updates;                   ///< Output files written, including the final one
+    ProgressiveStopReason reason;  ///< What ended the render
+} ProgressiveStats;
+
+/**
+ * @brief No limits, no intermediate updates and uniform sampling
+ */
+ProgressiveSettings progressive_default_settings(void);
+
+/**
+ * @brief Short description of a stop reason ("samples", "deadline", ...)
+ */
+const char *progressive_stop_reason_name(ProgressiveStopReason reason);
+
+/**
+ * @brief Ask a running progressive render to stop and write its image
+ * Async-signal-safe; workers finish the tile they are on and stop. A
+ * render always completes its first pass, so every pixel has a sample.
+ */
+void progressive_request_stop(void);
+
+/**
+ * @brief Render passes until a limit is reached, then write the image
+ * Without any limit the render runs until progressive_request_stop.
+ * Stop requests and the deadline are honoured from the second pass on:
+ * every tile gets its first sample, however early the render is stopped.
+ * Pixel i, j gets its first sample at the pixel position render_scene
+ * uses, so one sample reproduces render_scene's image exactly; later
+ * samples are placed within the pixel by settings->sampler, so the image
+ * does not depend on the thread count or tile order. AOVs are not supported.
+ * With an adaptive threshold, a tile that has at least min_samples (and
+ * two) samples and whose noise is at or below the threshold is left out
+ * of later passes; the render ends when no tile is left.
+ * With a denoise strength, the primary normal, depth and albedo are
+ * accumulated alongside the color and every written image goes through
+ * denoise_image; the live framebuffer shows the raw accumulation.
+ * @param camera Camera configuration
+ * @param scene Scene to render
+ * @param settings Rendering parameters (threads, tiles, format, progress, live framebuffer)
+ * @param progressive Stopping and output rules
+ * @param output_path Image file, replaced by each update
+ * @param stats Optional output statistics (may be NULL)
+ * @param progressive_stats Optional pass and sample figures (may be NULL)
+ * @return false on allocation, thread creation or write failure
+ */
+bool render_progressive(const Camera *camera, const Scene *scene, const RenderSettings *settings,
+                        const ProgressiveSettings *progressive, const char *output_path,
+                        RenderStats *stats, ProgressiveStats *progressive_stats);
+
+#endif // PROGRESSIVE_H
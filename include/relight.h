@@ -0,0 +1,39 @@
+/**
+ * @file relight.h
+ * @brief Re-shading a cached G-buffer under new lights
+ *
+ * Lights change far more often than geometry while a shot is being lit.
+ * A render can keep its primary hits in a G-buffer (RenderSettings.gbuffer);
+ * relighting then shades those hits again with the scene's current lights
+ * instead of tracing primary rays, culling the lights per tile like
+ * RenderSettings.cull_lights does. Without shadows the result is exactly
+ * the image a direct render with the same lights produces.
+ */
+
+#ifndef RELIGHT_H
+#define RELIGHT_H
+
+#include "gbuffer.h"
+#include "render.h"
+#include "scene.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * @brief Shade a G-buffer with a scene's lights and write the image
+ * Tiles are shaded in parallel and streamed to the output like
+ * render_scene does; the output is identical for any thread count and
+ * tile size.
+ * @param gbuffer Primary hits of the frame
+ * @param scene Lights to shade with; with shadows, also the geometry
+ *              the G-buffer was captured from
+ * @param settings Threads, tile size and output format (other fields are ignored)
+ * @param shadows Trace a shadow ray towards every light that reaches a hit
+ * @param output Output file stream (written from its current position)
+ * @param stats Optional output statistics (may be NULL)
+ * @return false on allocation, thread creation or write failure
+ */
+bool relight_render(const GBuffer *gbuffer, const Scene *scene, const RenderSettings *settings,
+                    bool shadows, FILE *output, RenderStats *stats);
+
+#endif // RELIGHT_H
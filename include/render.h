@@ -0,0 +1,165 @@
+/**
+ * @file render.h
+ * @brief Multithreaded image rendering
+ */
+
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "camera.h"
+#include "scene.h"
+#include "progress.h"
+#include "image_encoder.h"
+#include "integrator.h"
+#include "gbuffer.h"
+#include "render_cache.h"
+#include "shared_framebuffer.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief Maximum ray recursion depth for primary rays
+ */
+#define RENDER_MAX_DEPTH 10
+
+/**
+ * @brief Default tile edge in pixels (tiles are also the height of an output band)
+ */
+#define RENDER_DEFAULT_TILE_SIZE 32
+
+/**
+ * @brief Output bands buffered beyond those the threads are working on
+ */
+#define RENDER_PIPELINE_SPARE_BANDS 2
+
+/**
+ * @brief Auxiliary outputs (AOVs) captured from the primary hit
+ */
+typedef enum {
+    RENDER_AOV_DEPTH = 1u << 0,   ///< Ray distance to the first hit, "Z" (infinite on a miss)
+    RENDER_AOV_NORMAL = 1u << 1,  ///< World-space shading normal, "N.X", "N.Y", "N.Z"
+    RENDER_AOV_OBJECT = 1u << 2,  ///< Scene object index, "id" (-1 on a miss)
+    RENDER_AOV_ALBEDO = 1u << 3,  ///< Surface color, "albedo.R/G/B" (background on a miss)
+    RENDER_AOV_COST = 1u << 4     ///< Nanoseconds spent on the pixel, "cost"
+} RenderAov;
+
+/**
+ * @brief Number of AOV kinds
+ */
+#define RENDER_AOV_COUNT 5
+
+/**
+ * @brief Rendering parameters
+ */
+typedef struct {
+    int thread_count;           ///< Worker threads (<= 0: one per online CPU)
+    int tile_size;              ///< Tile edge in pixels
+    ImageFormat output_format;  ///< Output file format
+    bool half_float;            ///< Store 16-bit floats (EXR output only)
+    unsigned aovs;              ///< RenderAov bits to write to the AOV file (0: none)
+    const char *shm_name;       ///< Live shared-memory framebuffer name (NULL: none)
+    ProgressMode progress_mode; ///< Progress report format
+    double progress_interval;   ///< Seconds between progress reports
+    IntegratorSettings integrator; ///< Light transport algorithm and path limits
+    SamplerType sampler;        ///< Sequence for path bounces and progressive samples
+    bool cull_lights;           ///< Direct shading: shade each tile with only the lights reaching it
+    GBuffer *gbuffer;           ///< Also record every primary hit here (NULL: none)
+    RenderCache *cache;         ///< Render only its dirty tiles, copy the rest (NULL: none)
+    SharedFramebuffer *framebuffer; ///< Mapped live framebuffer to use instead of shm_name
+                                    ///< (NULL: none)
+    const atomic_bool *cancel;  ///< Stop handing out tiles once set (NULL: never)
+} RenderSettings;
+
+/**
+ * @brief Timing and output figures of one render
+ */
+typedef struct {
+    int thread_count;        ///< Worker threads used
+    double render_seconds;   ///< Wall-clock time from start to last byte written
+    double encode_seconds;   ///< Time spent encoding (workers' parallel stage plus writer)
+    double writer_wait_seconds; ///< Writer thread time spent waiting for rows
+    uint64_t bytes_written;  ///< Bytes of image data written
+    uint64_t aov_bytes_written; ///< Bytes of AOV data written
+    size_t working_set_bytes; ///< Pixel and output buffer memory held during the render
+    const char *io_backend;  ///< File output backend ("io_uring" or "pwrite")
+    double lights_per_tile;  ///< Average light list length with cull_lights (0: not culled)
+    uint64_t cached_tiles;   ///< Tiles copied from the render cache instead of rendered
+    uint64_t empty_tiles;    ///< Tiles no object covers, filled with the background untraced
+    uint64_t hit_queries;    ///< Closest-hit queries made through the threads' hit caches
+    uint64_t hit_cache_hits; ///< Closest-hit queries whose cached primitive was the closest hit
+    uint64_t occlusion_queries; ///< Shadow ray queries made through the threads' hit caches
+    uint64_t occlusion_cache_hits; ///< Shadow rays blocked by the cached occluding primitive
+    double first_tile_seconds; ///< Time from the start until the first tile was finished
+    uint64_t rays;           ///< Rays traced, as counted for progress (cached and empty
+                             ///< tiles trace none)
+} RenderStats;
+
+/**
+ * @brief Default settings: one thread per CPU, status-line progress
+ */
+RenderSettings render_default_settings(void);
+
+/**
+ * @brief Number of online CPUs (at least 1)
+ */
+int render_default_thread_count(void);
+
+/**
+ * @brief Parse a comma-separated AOV list ("depth,normal,id,albedo,cost" or "all")
+ * @param list AOV names
+ * @param aovs Output RenderAov bits
+ * @return false if a name is unknown
+ */
+bool render_parse_aovs(const char *list, unsigned *aovs);
+
+/**
+ * @brief Number of float channels the AOV file holds
+ */
+int render_aov_channel_count(unsigned aovs);
+
+/**
+ * @brief Render a scene to an image file
+ * The image is cut into tile_size-row bands of tile_size-wide tiles.
+ * Tiles are handed out dynamically to worker threads in scanline order
+ * and completed bands are streamed to a writer thread, so encoding and
+ * file I/O overlap with rendering and memory stays bounded by a few bands
+ * regardless of image size. The output is identical for any thread count
+ * and tile size.
+ *
+ * Before tracing, every bounded object is binned into the tiles its
+ * projected screen rectangle covers (scene_bin_objects); primary rays
+ * are tested only against their tile's objects, and tiles no object
+ * covers are filled with the background without tracing a ray.
+ *
+ * AOVs selected in settings->aovs are captured from the primary hit of
+ * the same pass and streamed alongside the image into one multi-channel
+ * float OpenEXR file; no AOV memory is allocated when none are selected.
+ * With settings->shm_name set, every finished tile is also published to
+ * a shared-memory framebuffer (shared_framebuffer.h) for live viewers.
+ * With settings->gbuffer set (created at the camera's image size), the
+ * primary hits of the same pass are kept for relighting (relight.h).
+ * With settings->cache set, only its dirty tiles are rendered and the
+ * others are copied from the previous render (render_cache.h); tiles the
+ * cache copies leave the G-buffer untouched.
+ * With settings->framebuffer set, tiles go to that already mapped
+ * framebuffer, which starts a new frame and stays mapped afterwards.
+ * Once settings->cancel is set, no further tiles are started; the tiles
+ * in flight are finished and the render returns false with the output
+ * incomplete.
+ * @param camera Camera configuration
+ * @param scene Scene to render
+ * @param settings Rendering parameters
+ * @param output Output file stream (written from its current position)
+ * @param aov_output AOV file stream (used only if settings->aovs is not 0)
+ * @param stats Optional output statistics (may be NULL)
+ * @return false on allocation, thread creation or write failure, if the
+ *         shared-memory framebuffer cannot be created, if the G-buffer,
+ *         cache or framebuffer does not match the image, if a cache is
+ *         combined with AOVs, or when cancelled
+ */
+bool render_scene(const Camera *camera, const Scene *scene, const RenderSettings *settings,
+                  FILE *output, FILE *aov_output, RenderStats *stats);
+
+#endif // RENDER_H
@@ -0,0 +1,81 @@
+/**
+ * @file render_cache.h
+ * @brief Per-tile object dependencies for incremental re-rendering
+ *
+ * A render given a cache (RenderSettings.cache) keeps every pixel it
+ * produces and, for every tile, the set of scene objects its primary
+ * rays hit. After an object is edited, only tiles that may look
+ * different have to be rendered again: those whose rays hit the object
+ * (where it was) and those its new bounds project onto (where it is
+ * now). All other tiles are copied from the cache.
+ *
+ * Direct shading depends only on the primary hit and the lights, so this
+ * is exact for the direct integrator; path-traced frames depend on every
+ * object a path bounces off and are always rendered in full.
+ */
+
+#ifndef RENDER_CACHE_H
+#define RENDER_CACHE_H
+
+#include "camera.h"
+#include "color.h"
+#include "scene.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Pixels and tile dependencies of the last render
+ */
+typedef struct {
+    int width;                     ///< Image width in pixels
+    int height;                    ///< Image height in pixels
+    int tile_size;                 ///< Tile edge in pixels
+    int tiles_x;                   ///< Tiles per row of tiles
+    int tile_count;                ///< Tiles in the image
+    Color *pixels;                 ///< Colors of the last render (row 0 is the top)
+    SceneObjectSet *tile_objects;  ///< Objects hit by each tile's primary rays
+    uint8_t *tile_dirty;           ///< Non-zero: render the tile on the next pass
+} RenderCache;
+
+/**
+ * @brief Allocate a cache with every tile dirty
+ * @param cache Cache to initialise
+ * @param width Image width
+ * @param height Image height
+ * @param tile_size Tile edge (must match the renders that use the cache)
+ * @return false on allocation failure
+ */
+bool render_cache_create(RenderCache *cache, int width, int height, int tile_size);
+
+/**
+ * @brief Free the memory owned by a cache
+ */
+void render_cache_destroy(RenderCache *cache);
+
+/**
+ * @brief Mark every tile dirty (after camera or light changes)
+ */
+void render_cache_invalidate_all(RenderCache *cache);
+
+/**
+ * @brief Mark the tiles an edited object can change
+ * Call after the edit: tiles that saw the object are known from the last
+ * render, and the object's current bounds give the tiles it may cover
+ * now. An unbounded object (a plane) dirties every tile. Tiles are
+ * tracked per scene object, so an edit inside an aggregate (one sphere of
+ * a BVH) dirties every tile the aggregate covers.
+ * @param cache Cache
+ * @param camera Camera of the renders
+ * @param scene Scene after the edit
+ * @param object_index Index of the edited object
+ * @return false if object_index is not an object of the scene (nothing is marked)
+ */
+bool render_cache_invalidate_object(RenderCache *cache, const Camera *camera, const Scene *scene,
+                                    int object_index);
+
+/**
+ * @brief Number of tiles the next render will trace
+ */
+int render_cache_dirty_count(const RenderCache *cache);
+
+#endif // RENDER_CACHE_H
@@ -0,0 +1,83 @@
+/**
+ * @file sampler.h
+ * @brief Low-discrepancy sample streams for pixel integration
+ *
+ * A sampler maps (pixel, sample index, dimension) to a number in [0, 1)
+ * without any state, so a sample can be drawn by any thread in any order
+ * and images are identical for every thread count and tile order.
+ *
+ * - Sobol: the first four Sobol dimensions, Owen-scrambled per pixel with
+ *   hash-based nested uniform scrambling. Higher dimensions reuse those
+ *   four with a differently shuffled index for every group of four
+ *   ("padding"), which keeps each 2D projection stratified.
+ * - Blue noise: one Sobol sequence shared by all pixels, shifted per pixel
+ *   and dimension by a tiled blue-noise mask (Cranley-Patterson rotation),
+ *   so the error that remains at low sample counts is spread as
+ *   high-frequency noise rather than clumps.
+ * - Random: independent hashed values, for comparison.
+ */
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Edge of the tiled blue-noise mask in pixels (a power of two)
+ */
+#define SAMPLER_MASK_SIZE 64
+
+/**
+ * @brief Sample sequence kinds
+ */
+typedef enum {
+    SAMPLER_SOBOL,      ///< Owen-scrambled Sobol, decorrelated per pixel
+    SAMPLER_BLUE_NOISE, ///< Sobol dithered per pixel with a blue-noise mask
+    SAMPLER_RANDOM      ///< Hashed uniform values
+} SamplerType;
+
+/**
+ * @brief Sample stream configuration
+ */
+typedef struct {
+    SamplerType type; ///< Sequence kind
+    uint32_t seed;    ///< Decorrelates whole images (0 is a valid seed)
+    float *mask;      ///< Blue-noise ranks in [0, 1), SAMPLER_MASK_SIZE squared (blue noise only)
+} Sampler;
+
+/**
+ * @brief Set up a sampler; the blue-noise mask is generated here (a few ms)
+ * @return false if the mask cannot be allocated
+ */
+bool sampler_init(Sampler *sampler, SamplerType type, uint32_t seed);
+
+/**
+ * @brief Release a sampler's mask
+ */
+void sampler_destroy(Sampler *sampler);
+
+/**
+ * @brief Parse "sobol", "blue-noise" or "random"
+ * @return false for an unknown name
+ */
+bool sampler_parse_type(const char *name, SamplerType *type);
+
+/**
+ * @brief Name of a sampler type, as accepted by sampler_parse_type
+ */
+const char *sampler_type_name(SamplerType type);
+
+/**
+ * @brief Sample value for a pixel
+ * @param sampler Sampler
+ * @param x Pixel column
+ * @param y Pixel row
+ * @param index Sample index within the pixel
+ * @param dimension Dimension of the sample (0 and 1: position in the pixel)
+ * @return Value in [0, 1)
+ */
+float sampler_get(const Sampler *sampler, uint32_t x, uint32_t y, uint32_t index,
+                  uint32_t dimension);
+
+#endif // SAMPLER_H
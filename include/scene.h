@@ -13,27 +13,80 @@
 #include "ray.h"
 #include "hit.h"
 #include "camera.h"
+#include "light.h"
+#include "light_tree.h"
+#include <stdint.h>
 #include <stdio.h>
 
 #define MAX_OBJECTS 32
 
 /**
- * @brief Point light structure
+ * @brief Set of scene objects, one bit per object index
+ */
+typedef uint32_t SceneObjectSet;
+
+_Static_assert(MAX_OBJECTS <= 32, "SceneObjectSet needs a bit per scene object");
+
+/**
+ * @brief Set holding every object of any scene
+ */
+#define SCENE_ALL_OBJECTS ((SceneObjectSet)0xffffffffu)
+
+/**
+ * @brief Smallest hit distance of scene rays (avoids self-intersection)
+ */
+#define SCENE_RAY_EPSILON 0.001f
+
+/**
+ * @brief How a surface scatters light (used by the path integrator)
+ */
+typedef enum {
+    MATERIAL_DIFFUSE,   ///< Lambertian, tinted by the hit albedo
+    MATERIAL_REFLECTIVE ///< Mirror tinted by the hit albedo, blurred by roughness
+} MaterialType;
+
+/**
+ * @brief Surface material of a scene object
+ * The color comes from the primitive (HitRecord.albedo); the material
+ * only says how it scatters.
  */
 typedef struct {
-    Vec3 position;     ///< Light position
-    Color color;       ///< Light color/intensity
-    float intensity;   ///< Light intensity multiplier
-} PointLight;
+    MaterialType type; ///< Scattering model
+    float roughness;   ///< Reflective only: radius of the reflection jitter (0: perfect mirror)
+} Material;
+
+/**
+ * @brief Per-thread memory of the objects and primitives recent rays hit
+ * Neighbouring pixels mostly hit the same primitive, and neighbouring
+ * shadow rays are mostly blocked by the same occluder. The object hit last
+ * is tested first, and inside it the primitive its hint remembers (the
+ * object of a BVH or grid, the leaf of a point cloud; see HitHint). That
+ * gives a closest-hit query a tight t_max before anything else is tested,
+ * and answers a shadow query with a single primitive test. Objects that
+ * are not aggregates count as one primitive. A cache belongs to one
+ * thread; the counters give its hit rates per primitive.
+ */
+typedef struct {
+    int last_hit;               ///< Object of the last closest hit (-1: none)
+    int last_occluder;          ///< Object that blocked the last shadow ray (-1: none)
+    HitHint hints[MAX_OBJECTS]; ///< Primitives each object's last hits were on
+    uint64_t hit_queries;       ///< Closest-hit queries made through the cache
+    uint64_t hit_hits;          ///< Queries whose closest hit was the cached primitive
+    uint64_t occlusion_queries; ///< Shadow queries made through the cache
+    uint64_t occlusion_hits;    ///< Shadow queries answered by the cached occluding primitive
+} SceneHitCache;
 
 /**
  * @brief Scene containing objects and lighting
  */
 typedef struct {
     Hittable objects[MAX_OBJECTS];  ///< Array of hittable objects
+    Material materials[MAX_OBJECTS]; ///< Material of each object (diffuse by default)
     int object_count;               ///< Number of objects in scene
-    PointLight lights[8];           ///< Array of point lights
+    PointLight *lights;             ///< Point lights (owned, grown by scene_add_light)
     int light_count;                ///< Number of lights in scene
+    int light_capacity;             ///< Allocated entries of lights
+    LightTree light_tree;           ///< Hierarchy over the lights (empty until built)
     Color background_color;         ///< Background color
 } Scene;
 
@@ -52,14 +105,58 @@ Scene scene_create(Color background_color);
  */
 bool scene_add_object(Scene *scene, Hittable object);
 
+/**
+ * @brief Set the material of an object already in the scene
+ * Every object of an aggregate (BVH, grid) shares the aggregate's material.
+ * @param scene Scene holding the object
+ * @param object_index Index of the object (order of scene_add_object)
+ * @param material Material to use
+ * @return false if there is no such object
+ */
+bool scene_set_material(Scene *scene, int object_index, Material material);
+
 /**
  * @brief Add a point light to the scene
+ * Any light tree is dropped; rebuild it after the last light is added.
  * @param scene Scene to add to
  * @param light Point light to add
- * @return true if added successfully, false if scene is full
+ * @return true if added successfully, false if memory runs out
  */
 bool scene_add_light(Scene *scene, PointLight light);
 
+/**
+ * @brief Build the light tree used to sample many lights
+ * @param scene Scene whose lights are all added
+ * @return false on allocation failure
+ */
+bool scene_build_light_tree(Scene *scene);
+
+/**
+ * @brief Replace the scene's lights with those listed in a text file
+ * One light per line: "x y z r g b intensity [falloff_start [radius]]";
+ * blank lines and text after '#' are ignored. The light tree is rebuilt.
+ * On failure the scene keeps its previous lights.
+ * @param scene Scene whose lights are replaced
+ * @param path Light set file
+ * @param error_line Output: line of the first malformed entry (0 if the
+ *                   file cannot be read or memory runs out)
+ * @return true if every line was valid
+ */
+bool scene_load_lights(Scene *scene, const char *path, int *error_line);
+
+/**
+ * @brief Write the scene's lights in the format read by scene_load_lights
+ * @return false if the file cannot be written
+ */
+bool scene_save_lights(const Scene *scene, const char *path);
+
+/**
+ * @brief Free the lights and light tree owned by a scene
+ * Objects are not owned by the scene and are left alone.
+ * @param scene Scene to destroy
+ */
+void scene_destroy(Scene *scene);
+
 /**
  * @brief Test ray intersection with all objects in scene
  * @param scene Scene to test
@@ -71,6 +168,61 @@ bool scene_add_light(Scene *scene, PointLight light);
  */
 bool scene_hit(const Scene *scene, const Ray *ray, float t_min, float t_max, HitRecord *hit_rec);
 
+/**
+ * @brief Test ray intersection with a subset of the scene's objects
+ * Same result as scene_hit if the subset holds every object the ray can hit.
+ * @param scene Scene to test
+ * @param ray Ray to test
+ * @param t_min Minimum ray parameter
+ * @param t_max Maximum ray parameter
+ * @param objects Objects to test
+ * @param cache Thread's hit cache, tested first and updated (may be NULL)
+ * @param hit_rec Output hit record
+ * @return true if any of the objects was hit
+ */
+bool scene_hit_objects(const Scene *scene, const Ray *ray, float t_min, float t_max,
+                       SceneObjectSet objects, SceneHitCache *cache, HitRecord *hit_rec);
+
+/**
+ * @brief Whether anything blocks a ray between t_min and t_max
+ * Stops at the first object hit instead of searching for the closest.
+ * @param scene Scene to test
+ * @param ray Shadow ray
+ * @param t_min Minimum ray parameter
+ * @param t_max Maximum ray parameter (the light's distance)
+ * @param cache Thread's hit cache, tested first and updated (may be NULL)
+ * @return true if the ray is blocked
+ */
+bool scene_occluded(const Scene *scene, const Ray *ray, float t_min, float t_max,
+                    SceneHitCache *cache);
+
+/**
+ * @brief Empty hit cache with zero counters
+ */
+void scene_hit_cache_init(SceneHitCache *cache);
+
+/**
+ * @brief Rays traced through a hit cache so far (closest-hit and shadow queries)
+ */
+static inline uint64_t scene_hit_cache_rays(const SceneHitCache *cache) {
+    return cache->hit_queries + cache->occlusion_queries;
+}
+
+/**
+ * @brief Objects whose bounds may cover each tile of the image
+ * Bounded objects are binned by their projected screen rectangle
+ * (camera_project_bounds); unbounded objects are in every tile, except
+ * planes, which skip the tiles whose rays all point away from them (the
+ * sky above a ground plane). A primary ray can only hit objects of its
+ * tile's set.
+ * @param scene Scene
+ * @param camera Camera of the image
+ * @param tile_size Tile edge in pixels
+ * @param tile_objects Output: one set per tile, in scanline order
+ */
+void scene_bin_objects(const Scene *scene, const Camera *camera, int tile_size,
+                       SceneObjectSet *tile_objects);
+
 /**
  * @brief Calculate color for a ray in the scene
  * @param scene Scene to render
@@ -80,6 +232,19 @@ bool scene_hit(const Scene *scene, const Ray *ray, float t_min, float t_max, Hit
  */
 Color scene_ray_color(const Scene *scene, const Ray *ray, int depth);
 
+/**
+ * @brief Calculate color for a ray and report the surface it hits first
+ * Same result as scene_ray_color; the hit record comes from the same
+ * intersection query, so auxiliary outputs cost no extra traversal.
+ * @param scene Scene to render
+ * @param ray Ray to trace
+ * @param depth Recursion depth (for reflections)
+ * @param color Output: final color for the ray
+ * @param primary Output: first hit (only valid if the function returns true)
+ * @return true if the ray hit a surface
+ */
+bool scene_trace(const Scene *scene, const Ray *ray, int depth, Color *color, HitRecord *primary);
+
 /**
  * @brief Simple Lambertian shading calculation
  * @param scene Scene with lights
@@ -90,12 +255,28 @@ Color scene_ray_color(const Scene *scene, const Ray *ray, int depth);
 Color scene_shade_lambertian(const Scene *scene, const HitRecord *hit_rec, Color material_color);
 
 /**
- * @brief Render a scene to PPM output
- * @param camera Camera configuration
- * @param scene Scene to render
- * @param output Output file stream
+ * @brief Lambertian shading from a subset of the scene's lights
+ * Same result as scene_shade_lambertian if the subset holds every light
+ * that reaches the hit point.
+ * @param scene Scene with lights
+ * @param hit_rec Hit information
+ * @param material_color Base material color
+ * @param light_indices Indices of the lights to use
+ * @param light_count Number of indices
+ * @return Shaded color
+ */
+Color scene_shade_lights(const Scene *scene, const HitRecord *hit_rec, Color material_color,
+                         const int *light_indices, int light_count);
+
+/**
+ * @brief List the lights whose influence reaches a box
+ * Lights without an influence radius are always listed.
+ * @param scene Scene with lights
+ * @param bounds Box around the points to be shaded
+ * @param light_indices Output: light indices (room for scene->light_count)
+ * @return Number of lights listed
  */
-void render_scene(Camera *camera, Scene *scene, FILE *output);
+int scene_cull_lights(const Scene *scene, AABB bounds, int *light_indices);
 
 /**
  * @brief Print scene information
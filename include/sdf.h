@@ -0,0 +1,144 @@
+/**
+ * @file sdf.h
+ * @brief Signed-distance-field objects rendered by bounded sphere tracing
+ *
+ * An SdfObject is a small expression tree of analytic distance functions
+ * (spheres, rounded boxes) combined with hard or smooth unions. Each object
+ * carries a conservative bounding box, so it can be placed in a BVH and
+ * rays are only marched over the part of the ray inside the box.
+ */
+
+#ifndef SDF_H
+#define SDF_H
+
+#include "vec3.h"
+#include "ray.h"
+#include "hit.h"
+#include "color.h"
+#include "aabb.h"
+
+/**
+ * @brief Maximum number of nodes in one SDF expression
+ */
+#define SDF_MAX_NODES 32
+
+/**
+ * @brief Default sphere tracing iteration cap
+ */
+#define SDF_DEFAULT_MAX_STEPS 128
+
+/**
+ * @brief Default over-relaxation factor (1.0 disables over-relaxation)
+ */
+#define SDF_DEFAULT_RELAXATION 1.6f
+
+/**
+ * @brief SDF node type
+ */
+typedef enum {
+    SDF_SPHERE,        ///< Sphere (center, radius)
+    SDF_BOX,           ///< Rounded box (center, half_extent, radius = rounding)
+    SDF_UNION,         ///< Hard union of two children
+    SDF_SMOOTH_UNION   ///< Polynomial smooth union of two children
+} SdfNodeType;
+
+/**
+ * @brief One node of an SDF expression
+ */
+typedef struct {
+    SdfNodeType type;  ///< Node type
+    Vec3 center;       ///< Primitive center
+    Vec3 half_extent;  ///< Box half size (before rounding)
+    float radius;      ///< Sphere radius or box rounding radius
+    float smoothness;  ///< Blend radius of a smooth union
+    int left;          ///< First child (unions)
+    int right;         ///< Second child (unions)
+    AABB bounds;       ///< Conservative bounds of this subtree
+} SdfNode;
+
+/**
+ * @brief SDF object with bounds and marching parameters
+ */
+typedef struct {
+    SdfNode nodes[SDF_MAX_NODES]; ///< Expression nodes
+    int node_count;               ///< Number of nodes in use
+    int root;                     ///< Root node index (-1 while empty)
+    int max_steps;                ///< Sphere tracing iteration cap
+    float relaxation;             ///< Over-relaxation factor in [1, 2)
+    float hit_epsilon;            ///< Distance below which the surface is hit
+    Color color;                  ///< Material color
+} SdfObject;
+
+/**
+ * @brief Create an empty SDF object with default marching parameters
+ * @param color Material color
+ * @return SDF object
+ */
+SdfObject sdf_object_create(Color color);
+
+/**
+ * @brief Add a sphere node
+ * @return Node index, or -1 if the object is full
+ */
+int sdf_add_sphere(SdfObject *sdf, Vec3 center, float radius);
+
+/**
+ * @brief Add a rounded box node
+ * @param half_extent Half size of the box core
+ * @param rounding Radius added around the core (0 for sharp edges)
+ * @return Node index, or -1 if the object is full
+ */
+int sdf_add_box(SdfObject *sdf, Vec3 center, Vec3 half_extent, float rounding);
+
+/**
+ * @brief Add a hard union of two nodes
+ * @return Node index, or -1 if the object is full or a child is invalid
+ */
+int sdf_add_union(SdfObject *sdf, int left, int right);
+
+/**
+ * @brief Add a smooth union of two nodes
+ * @param smoothness Blend radius (0 behaves like a hard union)
+ * @return Node index, or -1 if the object is full or a child is invalid
+ */
+int sdf_add_smooth_union(SdfObject *sdf, int left, int right, float smoothness);
+
+/**
+ * @brief Select the node that defines the object's surface
+ * Defaults to the most recently added node.
+ */
+void sdf_set_root(SdfObject *sdf, int root);
+
+/**
+ * @brief Evaluate the signed distance at a point
+ * @return Distance (negative inside); a lower bound for smooth unions
+ */
+float sdf_evaluate(const SdfObject *sdf, Vec3 point);
+
+/**
+ * @brief Sphere-trace a ray against the SDF inside its bounding box
+ * @param sdf Pointer to SDF data (cast from void*)
+ * @param ray Ray to test
+ * @param t_min Minimum ray parameter
+ * @param t_max Maximum ray parameter
+ * @param hit_rec Output hit record
+ * @return true if the surface was reached within the iteration cap
+ */
+bool sdf_hit(const Hittable *sdf, const Ray *ray, float t_min, float t_max, HitRecord *hit_rec);
+
+/**
+ * @brief Bounding box of an SDF object
+ * @param sdf Pointer to SDF data (cast from void*)
+ * @param box Output bounding box
+ * @return false if the object is empty
+ */
+bool sdf_bounds(const Hittable *sdf, AABB *box);
+
+/**
+ * @brief Create a hittable SDF object
+ * @param sdf Pointer to the SDF object
+ * @return Hittable object wrapping the SDF
+ */
+Hittable sdf_to_hittable(SdfObject *sdf);
+
+#endif // SDF_H
@@ -0,0 +1,105 @@
+/**
+ * @file session.h
+ * @brief Long-lived rendering session driven by commands on a stream
+ *
+ * A session keeps one scene, with its acceleration structures and light
+ * tree, in memory and renders a frame after every command that changes
+ * the camera, the integrator or an object. Frames render on their own thread while
+ * the next command is read. A new command cancels the frame in flight:
+ * its workers stop claiming tiles, so the next frame starts as soon as
+ * the tiles already started are done. Nothing is rebuilt between frames.
+ *
+ * Frames render through a render cache (render_cache.h): after an object
+ * is moved, direct-shaded frames render only the tiles the object was or
+ * is now seen in and copy the rest from the previous frame. Camera and
+ * integrator changes render the whole frame.
+ *
+ * With a preview factor, every frame is a preview (preview.h): the
+ * coarse level is written first and refined to full resolution until the
+ * next command cancels it, leaving the last complete level in the output.
+ * Previews do not use the render cache.
+ *
+ * Completed frames replace the output file (written under a temporary
+ * name and renamed), and with a shared-memory name every tile is also
+ * published live. The segment is created once and reused, its frame
+ * counter increasing with every frame.
+ *
+ * Commands, one per line (blank lines and lines starting with '#' are
+ * ignored):
+ *
+ *     camera X Y Z TX TY TZ [FOV]  Eye, target and optional vertical field of view
+ *     move DX DY DZ                Move the eye and the target together
+ *     move-object I DX DY DZ       Move scene object I (a sphere or a plane)
+ *     fov DEGREES                  Vertical field of view
+ *     integrator direct|path       Light transport
+ *     max-bounces N                Path: scattering events after the first hit
+ *     rr-bounces N                 Path: bounces before Russian roulette
+ *     light-samples N              Lights sampled per shading point (0: all)
+ *     render                       Render again with the current parameters
+ *     wait                         Let the frame in flight finish before reading on
+ *     quit                         Cancel the frame in flight and end the session
+ *
+ * Every frame is answered with one line (the last form for frames
+ * cancelled before their first tile; for previews, read "first level"
+ * for "first tile"):
+ *
+ *     frame N complete: first tile A ms, last B ms after the command
+ *     frame N failed
+ *     frame N cancelled: first tile A ms after the command, stopped after B ms
+ *     frame N cancelled after B ms
+ *
+ * and every rejected command with "error: COMMAND: REASON". The end of
+ * the input ends the session after the frame in flight is finished.
+ */
+
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "camera.h"
+#include "render.h"
+#include "scene.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief Longest command line in bytes
+ */
+#define SESSION_MAX_LINE 256
+
+/**
+ * @brief Figures of a finished session
+ */
+typedef struct {
+    int commands;                    ///< Non-empty command lines read (including rejected ones)
+    int frames;                      ///< Frames started, the initial one included
+    int completed;                   ///< Frames rendered to the end and written
+    int cancelled;                   ///< Frames stopped by a newer command
+    uint64_t cached_tiles;           ///< Tiles copied from the previous frame, all frames
+    double mean_first_tile_seconds;  ///< Command to first finished tile, mean over frames
+    double max_first_tile_seconds;   ///< Command to first finished tile, worst frame
+} SessionStats;
+
+/**
+ * @brief Run a session until the commands end or a quit command
+ * The first frame is rendered right away with the given camera. Settings
+ * are used as by render_scene; AOVs, G-buffers and render caches are not
+ * supported (the session keeps its own cache), and progress reporting is
+ * turned off.
+ * @param camera Initial camera
+ * @param scene Scene, whose objects move-object commands move
+ * @param settings Rendering parameters (shm_name: publish frames live)
+ * @param preview_factor Starting factor of preview frames (2, 4 or 8; 0: full frames)
+ * @param output_path Image file, replaced by every completed frame and preview level
+ * @param commands Command stream (e.g. stdin)
+ * @param replies Stream for frame reports and errors (e.g. stdout)
+ * @param stats Optional session figures (may be NULL)
+ * @return false if the settings or the preview factor are unsupported (a
+ *         preview cannot cull lights) or the cache, the
+ *         framebuffer or the frame thread cannot be created
+ */
+bool session_run(const Camera *camera, Scene *scene, const RenderSettings *settings,
+                 int preview_factor, const char *output_path, FILE *commands, FILE *replies,
+                 SessionStats *stats);
+
+#endif // SESSION_H
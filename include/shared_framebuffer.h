@@ -0,0 +1,137 @@
+/**
+ * @file shared_framebuffer.h
+ * @brief Live framebuffer in POSIX shared memory
+ *
+ * The renderer copies every finished tile into a shared-memory segment
+ * that other processes can map read-only and display while the render
+ * runs. The segment starts with a fixed header (dimensions, pixel format,
+ * render state) followed by one generation counter per tile and the
+ * pixels, row-major and top row first.
+ *
+ * Each tile's counter works as a sequence lock: it is odd while the
+ * renderer writes the tile and even once the tile is stable, so a reader
+ * can use the pixels in place and check afterwards that the counter did
+ * not change. Readers never block the renderer.
+ */
+
+#ifndef SHARED_FRAMEBUFFER_H
+#define SHARED_FRAMEBUFFER_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Segment signature and layout version
+ */
+#define SHARED_FRAMEBUFFER_MAGIC "RAYSHMFB"
+#define SHARED_FRAMEBUFFER_VERSION 1
+
+/**
+ * @brief Pixel formats of the segment
+ */
+typedef enum {
+    SHARED_FRAMEBUFFER_RGB8 = 0,   ///< 3 bytes per pixel, display-ready
+    SHARED_FRAMEBUFFER_RGB32F = 1  ///< 3 native floats per pixel, linear and unclamped
+} SharedFramebufferFormat;
+
+/**
+ * @brief Render state published in the header
+ */
+typedef enum {
+    SHARED_FRAMEBUFFER_RENDERING = 0, ///< Tiles are still being written
+    SHARED_FRAMEBUFFER_COMPLETE = 1,  ///< Every tile holds its final pixels
+    SHARED_FRAMEBUFFER_FAILED = 2     ///< The render stopped early
+} SharedFramebufferState;
+
+/**
+ * @brief Segment header, at offset 0
+ */
+typedef struct {
+    char magic[8];               ///< SHARED_FRAMEBUFFER_MAGIC (not NUL-terminated)
+    uint32_t version;            ///< SHARED_FRAMEBUFFER_VERSION
+    uint32_t format;             ///< SharedFramebufferFormat
+    uint32_t width;              ///< Image width in pixels
+    uint32_t height;             ///< Image height in pixels
+    uint32_t pixel_bytes;        ///< Bytes per pixel
+    uint32_t tile_size;          ///< Tile edge in pixels
+    uint32_t tiles_x;            ///< Tiles per row
+    uint32_t tiles_y;            ///< Tile rows
+    uint64_t pixel_offset;       ///< Offset of the pixels from the segment start
+    uint64_t segment_bytes;      ///< Size of the whole segment
+    _Atomic uint32_t state;      ///< SharedFramebufferState
+    _Atomic uint32_t frame;      ///< Incremented each time a render starts
+    _Atomic uint64_t tiles_written; ///< Tile updates so far (changes on every update)
+} SharedFramebufferHeader;
+
+/**
+ * @brief A mapped segment, as creator or reader
+ */
+typedef struct {
+    SharedFramebufferHeader *header; ///< Mapped header (NULL if not mapped)
+    _Atomic uint32_t *generations;   ///< Per tile: odd while being written
+    uint8_t *pixels;                 ///< Pixel data, row-major, top row first
+    size_t size;                     ///< Mapped bytes
+    bool writable;                   ///< Mapped by the renderer
+} SharedFramebuffer;
+
+/**
+ * @brief Create (or replace) a segment and publish an empty image
+ * The segment stays in place after shared_framebuffer_close so a viewer
+ * can keep showing the last render; remove it with shm_unlink.
+ * @param framebuffer Framebuffer to initialize
+ * @param name POSIX shared-memory name ("/raydemo")
+ * @param width Image width in pixels
+ * @param height Image height in pixels
+ * @param format Pixel format
+ * @param tile_size Tile edge in pixels
+ * @return false if the segment cannot be created or mapped
+ */
+bool shared_framebuffer_create(SharedFramebuffer *framebuffer, const char *name, int width,
+                               int height, SharedFramebufferFormat format, int tile_size);
+
+/**
+ * @brief Map an existing segment read-only
+ * @return false if it does not exist or is not a framebuffer of this version
+ */
+bool shared_framebuffer_open(SharedFramebuffer *framebuffer, const char *name);
+
+/**
+ * @brief Unmap a segment
+ */
+void shared_framebuffer_close(SharedFramebuffer *framebuffer);
+
+/**
+ * @brief Copy a finished tile into the segment
+ * Tiles may be written concurrently from different threads.
+ * @param framebuffer Writable framebuffer
+ * @param tile Tile index (row-major)
+ * @param pixels The tile's top-left pixel in a buffer of the segment's format
+ * @param stride Bytes between rows of that buffer
+ */
+void shared_framebuffer_write_tile(SharedFramebuffer *framebuffer, uint64_t tile,
+                                   const void *pixels, size_t stride);
+
+/**
+ * @brief Publish the render state
+ */
+void shared_framebuffer_set_state(SharedFramebuffer *framebuffer, SharedFramebufferState state);
+
+/**
+ * @brief Start reading a tile in place
+ * @return The tile's generation; odd means it is being written
+ */
+uint32_t shared_framebuffer_read_begin(const SharedFramebuffer *framebuffer, uint64_t tile);
+
+/**
+ * @brief Check that a tile did not change since shared_framebuffer_read_begin
+ * @param framebuffer Framebuffer
+ * @param tile Tile index
+ * @param generation Value returned by shared_framebuffer_read_begin
+ * @return true if the pixels read in between are consistent
+ */
+bool shared_framebuffer_read_end(const SharedFramebuffer *framebuffer, uint64_t tile,
+                                 uint32_t generation);
+
+#endif // SHARED_FRAMEBUFFER_H
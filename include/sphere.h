@@ -12,6 +12,7 @@
 #include "ray.h"
 #include "hit.h"
 #include "color.h"
+#include <math.h>
 
 /**
  * @brief Sphere structure
@@ -31,6 +32,43 @@ typedef struct {
  */
 Sphere sphere_create(Vec3 center, float radius, Color color);
 
+/**
+ * @brief Ray-sphere intersection math shared by all sphere-based primitives
+ * @param center Sphere center
+ * @param radius Sphere radius
+ * @param ray Ray to test
+ * @param t_min Minimum ray parameter
+ * @param t_max Maximum ray parameter
+ * @param t Output ray parameter of the nearest intersection in range
+ * @return true if intersection found
+ */
+static inline bool sphere_intersect(Vec3 center, float radius, const Ray *ray,
+                                    float t_min, float t_max, float *t) {
+    // Ray-sphere intersection using quadratic formula
+    Vec3 oc = vec3_sub(ray->origin, center);
+    float a = vec3_dot(ray->direction, ray->direction);
+    float b = 2.0f * vec3_dot(oc, ray->direction);
+    float c = vec3_dot(oc, oc) - radius * radius;
+    
+    float discriminant = b * b - 4.0f * a * c;
+    if (discriminant < 0.0f) {
+        return false; // No intersection
+    }
+    
+    // Find the nearest intersection
+    float sqrt_discriminant = sqrtf(discriminant);
+    float root = (-b - sqrt_discriminant) / (2.0f * a);
+    
+    if (root < t_min || root > t_max) {
+        root = (-b + sqrt_discriminant) / (2.0f * a);
+        if (root < t_min || root > t_max) {
+            return false;
+        }
+    }
+    *t = root;
+    return true;
+}
+
 /**
  * @brief Test ray-sphere intersection
  * @param sphere Pointer to sphere data (cast from void*)
@@ -43,6 +81,21 @@ Sphere sphere_create(Vec3 center, float radius, Color color);
 bool sphere_hit(const Hittable *sphere, const Ray *ray, 
                 float t_min, float t_max, HitRecord *hit_rec);
 
+/**
+ * @brief Bounding box of a sphere
+ * @param sphere Pointer to sphere data (cast from void*)
+ * @param box Output bounding box
+ * @return Always true (spheres are bounded)
+ */
+bool sphere_bounds(const Hittable *sphere, AABB *box);
+
+/**
+ * @brief Move a sphere's center
+ * @param sphere Pointer to sphere data (cast from void*)
+ * @param offset World-space translation
+ */
+void sphere_move(const Hittable *sphere, Vec3 offset);
+
 /**
  * @brief Create a hittable sphere object
  * @param sphere Pointer to sphere structure
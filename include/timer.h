@@ -0,0 +1,30 @@
+/**
+ * @file timer.h
+ * @brief Wall-clock timing helpers
+ */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * @brief Wall-clock time in seconds (C11 timespec_get)
+ */
+static inline double timer_now_seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Wall-clock time in integer nanoseconds, for timing short intervals exactly
+ */
+static inline int64_t timer_now_nanoseconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (int64_t)ts.tv_sec * 1000000000 + (int64_t)ts.tv_nsec;
+}
+
+#endif // TIMER_H
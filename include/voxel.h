@@ -0,0 +1,132 @@
+/**
+ * @file voxel.h
+ * @brief Sparse voxel volume stored as a two-level brick hierarchy
+ *
+ * The volume is divided into bricks of VOXEL_BRICK_SIZE^3 voxels. A coarse
+ * grid holds one index per brick, and only bricks containing at least one
+ * solid voxel are allocated. Each brick keeps an occupancy bitmask plus a
+ * material id per voxel. Rays traverse the coarse grid with a 3D-DDA and
+ * only descend into allocated bricks, so empty space costs one step per
+ * brick.
+ */
+
+#ifndef VOXEL_H
+#define VOXEL_H
+
+#include "vec3.h"
+#include "ray.h"
+#include "hit.h"
+#include "color.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Voxels per brick along each axis
+ */
+#define VOXEL_BRICK_SIZE 8
+
+/**
+ * @brief Voxels per brick
+ */
+#define VOXEL_BRICK_VOXELS (VOXEL_BRICK_SIZE * VOXEL_BRICK_SIZE * VOXEL_BRICK_SIZE)
+
+/**
+ * @brief Material id reserved for empty space
+ */
+#define VOXEL_EMPTY 0
+
+/**
+ * @brief One allocated brick
+ */
+typedef struct {
+    uint64_t occupancy[VOXEL_BRICK_VOXELS / 64]; ///< One bit per voxel, x fastest
+    uint8_t materials[VOXEL_BRICK_VOXELS];       ///< Material id per voxel
+    size_t cell;                                 ///< Coarse cell whose index points here
+} VoxelBrick;
+
+/**
+ * @brief Sparse voxel volume
+ */
+typedef struct {
+    Vec3 origin;             ///< World position of the volume's minimum corner
+    float voxel_size;        ///< World-space edge length of one voxel
+    int size[3];             ///< Volume size in voxels
+    int brick_res[3];        ///< Volume size in bricks
+    int32_t *brick_index;    ///< Per coarse cell: index into bricks, or -1 if empty
+    VoxelBrick *bricks;      ///< Allocated bricks
+    int brick_count;         ///< Number of allocated bricks
+    int brick_capacity;      ///< Capacity of the bricks array
+    Color palette[256];      ///< Material id to color
+} VoxelVolume;
+
+/**
+ * @brief Create an empty voxel volume
+ * @param volume Volume to initialize
+ * @param size_x Size in voxels along x
+ * @param size_y Size in voxels along y
+ * @param size_z Size in voxels along z
+ * @param origin World position of the minimum corner
+ * @param voxel_size World-space edge length of one voxel
+ * @return true on success, false on invalid size or allocation failure
+ */
+bool voxel_volume_init(VoxelVolume *volume, int size_x, int size_y, int size_z,
+                       Vec3 origin, float voxel_size);
+
+/**
+ * @brief Free memory owned by a voxel volume
+ * @param volume Volume to destroy
+ */
+void voxel_volume_destroy(VoxelVolume *volume);
+
+/**
+ * @brief Set a voxel's material (VOXEL_EMPTY clears it)
+ * Bricks are allocated on first write of a solid voxel and freed when
+ * their last solid voxel is cleared; the last brick then moves into the
+ * freed slot, so brick indices are not stable across calls.
+ * @return false if out of bounds or allocation failed
+ */
+bool voxel_volume_set(VoxelVolume *volume, int x, int y, int z, uint8_t material);
+
+/**
+ * @brief Get a voxel's material (VOXEL_EMPTY outside the volume or in empty space)
+ */
+uint8_t voxel_volume_get(const VoxelVolume *volume, int x, int y, int z);
+
+/**
+ * @brief Assign a color to a material id
+ */
+void voxel_volume_set_material(VoxelVolume *volume, uint8_t material, Color color);
+
+/**
+ * @brief Test ray-volume intersection with hierarchical 3D-DDA
+ * @param volume Pointer to volume data (cast from void*)
+ * @param ray Ray to test
+ * @param t_min Minimum ray parameter
+ * @param t_max Maximum ray parameter
+ * @param hit_rec Output hit record
+ * @return true if a solid voxel was hit
+ */
+bool voxel_volume_hit(const Hittable *volume, const Ray *ray,
+                      float t_min, float t_max, HitRecord *hit_rec);
+
+/**
+ * @brief Bounding box of a voxel volume
+ * @param volume Pointer to volume data (cast from void*)
+ * @param box Output bounding box
+ * @return Always true (volumes are bounded)
+ */
+bool voxel_volume_bounds(const Hittable *volume, AABB *box);
+
+/**
+ * @brief Create a hittable voxel volume object
+ * @param volume Pointer to the volume
+ * @return Hittable object wrapping the volume
+ */
+Hittable voxel_volume_to_hittable(VoxelVolume *volume);
+
+/**
+ * @brief Bytes of memory owned by the volume (coarse index plus bricks in use)
+ */
+size_t voxel_volume_memory_bytes(const VoxelVolume *volume);
+
+#endif // VOXEL_H
@@ -0,0 +1,92 @@
+/**
+ * @file aabb.c
+ * @brief Axis-aligned bounding box implementation
+ */
+
+#include "aabb.h"
+#include <stdio.h>
+#include <math.h>
+
+AABB aabb_union(AABB a, AABB b) {
+    return aabb_create(vec3_create(fminf(a.min.x, b.min.x), fminf(a.min.y, b.min.y),
+                                   fminf(a.min.z, b.min.z)),
+                       vec3_create(fmaxf(a.max.x, b.max.x), fmaxf(a.max.y, b.max.y),
+                                   fmaxf(a.max.z, b.max.z)));
+}
+
+AABB aabb_expand(AABB box, Vec3 point) {
+    return aabb_union(box, aabb_create(point, point));
+}
+
+Vec3 aabb_centroid(AABB box) {
+    return vec3_scale(vec3_add(box.min, box.max), 0.5f);
+}
+
+Vec3 aabb_extent(AABB box) {
+    return vec3_sub(box.max, box.min);
+}
+
+float aabb_surface_area(AABB box) {
+    Vec3 e = aabb_extent(box);
+    if (e.x < 0.0f || e.y < 0.0f || e.z < 0.0f) {
+        return 0.0f;
+    }
+    return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+bool aabb_overlaps(AABB a, AABB b) {
+    return a.min.x <= b.max.x && a.max.x >= b.min.x &&
+           a.min.y <= b.max.y && a.max.y >= b.min.y &&
+           a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+/**
+ * @brief Ray parameters where a ray enters and leaves one slab of a box
+ * A ray parallel to the slab that starts on one of its planes gives
+ * 0 * inf = NaN there; it runs inside the slab, so the slab is open.
+ * (fminf/fmaxf alone would return the other plane's infinity twice and
+ * lose the box.)
+ */
+static inline void slab_interval(float min, float max, float origin, float inv_dir, float *near,
+                                 float *far) {
+    float t0 = (min - origin) * inv_dir;
+    float t1 = (max - origin) * inv_dir;
+    if (t0 != t0 || t1 != t1) {
+        *near = -INFINITY;
+        *far = INFINITY;
+    } else {
+        *near = fminf(t0, t1);
+        *far = fmaxf(t0, t1);
+    }
+}
+
+bool aabb_hit(const AABB *box, const Ray *ray, Vec3 inv_dir, float t_min, float t_max,
+              float *t_enter, float *t_exit) {
+    float x0, x1, y0, y1, z0, z1;
+    slab_interval(box->min.x, box->max.x, ray->origin.x, inv_dir.x, &x0, &x1);
+    slab_interval(box->min.y, box->max.y, ray->origin.y, inv_dir.y, &y0, &y1);
+    slab_interval(box->min.z, box->max.z, ray->origin.z, inv_dir.z, &z0, &z1);
+
+    float t0 = fmaxf(fmaxf(x0, y0), fmaxf(z0, t_min));
+    float t1 = fminf(fminf(x1, y1), fminf(z1, t_max));
+
+    if (t0 > t1) {
+        return false;
+    }
+    if (t_enter) {
+        *t_enter = t0;
+    }
+    if (t_exit) {
+        *t_exit = t1;
+    }
+    return true;
+}
+
+void aabb_print(AABB box) {
+    printf("AABB {\n");
+    printf("  min: ");
+    vec3_print(box.min);
+    printf("  max: ");
+    vec3_print(box.max);
+    printf("}\n");
+}
@@ -0,0 +1,335 @@
+/**
+ * @file bvh.c
+ * @brief Bounding volume hierarchy implementation
+ */
+
+#include "bvh.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define BVH_BINS 12
+#define BVH_MAX_LEAF 4
+#define BVH_STACK_SIZE 64
+
+/**
+ * @brief Depth below which nodes are split by the SAH
+ * Deeper nodes are split at the object median, which halves the range, so
+ * even 2^31 objects end within BVH_STACK_SIZE levels and traversal never
+ * runs out of stack.
+ */
+#define BVH_SAH_MAX_DEPTH (BVH_STACK_SIZE - 32)
+
+/**
+ * @brief Per-object build information
+ */
+typedef struct {
+    AABB bounds;
+    Vec3 centroid;
+    int index;
+} BuildRef;
+
+static float vec3_axis(Vec3 v, int axis) {
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+/**
+ * @brief Reorder refs so that the object at mid has the median centroid on an axis
+ * Everything before mid is not above it and everything after not below.
+ */
+static void bvh_select_median(BuildRef *refs, int start, int end, int mid, int axis) {
+    int lo = start;
+    int hi = end - 1;
+    while (lo < hi) {
+        float pivot = vec3_axis(refs[lo + (hi - lo) / 2].centroid, axis);
+        int i = lo;
+        int j = hi;
+        while (i <= j) {
+            while (vec3_axis(refs[i].centroid, axis) < pivot) {
+                i++;
+            }
+            while (vec3_axis(refs[j].centroid, axis) > pivot) {
+                j--;
+            }
+            if (i <= j) {
+                BuildRef tmp = refs[i];
+                refs[i] = refs[j];
+                refs[j] = tmp;
+                i++;
+                j--;
+            }
+        }
+        if (mid <= j) {
+            hi = j;
+        } else if (mid >= i) {
+            lo = i;
+        } else {
+            return;
+        }
+    }
+}
+
+static int bvh_build_range(Bvh *bvh, BuildRef *refs, int start, int end, int depth) {
+    int node_index = bvh->node_count++;
+    BvhNode *node = &bvh->nodes[node_index];
+
+    AABB bounds = aabb_empty();
+    AABB centroid_bounds = aabb_empty();
+    for (int i = start; i < end; i++) {
+        bounds = aabb_union(bounds, refs[i].bounds);
+        centroid_bounds = aabb_expand(centroid_bounds, refs[i].centroid);
+    }
+    node->bounds = bounds;
+    node->axis = 0;
+
+    int count = end - start;
+    Vec3 extent = aabb_extent(centroid_bounds);
+    int axis = 0;
+    if (extent.y > extent.x) {
+        axis = 1;
+    }
+    if (extent.z > vec3_axis(extent, axis)) {
+        axis = 2;
+    }
+    float axis_min = vec3_axis(centroid_bounds.min, axis);
+    float axis_extent = vec3_axis(extent, axis);
+
+    if (count <= BVH_MAX_LEAF || axis_extent <= 0.0f) {
+        node->offset = start;
+        node->count = count;
+        return node_index;
+    }
+
+    if (depth >= BVH_SAH_MAX_DEPTH) {
+        // Skewed distributions can peel one object off per SAH split; stop the chain
+        int mid = start + count / 2;
+        bvh_select_median(refs, start, end, mid, axis);
+        bvh_build_range(bvh, refs, start, mid, depth + 1);
+        node->offset = bvh_build_range(bvh, refs, mid, end, depth + 1);
+        node->count = 0;
+        node->axis = axis;
+        return node_index;
+    }
+
+    // Bin centroids along the widest axis and evaluate the SAH at each bin boundary
+    int bin_counts[BVH_BINS] = {0};
+    AABB bin_bounds[BVH_BINS];
+    for (int b = 0; b < BVH_BINS; b++) {
+        bin_bounds[b] = aabb_empty();
+    }
+    float scale = BVH_BINS / axis_extent;
+    for (int i = start; i < end; i++) {
+        int b = (int)((vec3_axis(refs[i].centroid, axis) - axis_min) * scale);
+        b = b < 0 ? 0 : (b >= BVH_BINS ? BVH_BINS - 1 : b);
+        bin_counts[b]++;
+        bin_bounds[b] = aabb_union(bin_bounds[b], refs[i].bounds);
+    }
+
+    float best_cost = INFINITY;
+    int best_split = -1;
+    for (int split = 1; split < BVH_BINS; split++) {
+        AABB left = aabb_empty();
+        AABB right = aabb_empty();
+        int left_count = 0;
+        int right_count = 0;
+        for (int b = 0; b < split; b++) {
+            left = aabb_union(left, bin_bounds[b]);
+            left_count += bin_counts[b];
+        }
+        for (int b = split; b < BVH_BINS; b++) {
+            right = aabb_union(right, bin_bounds[b]);
+            right_count += bin_counts[b];
+        }
+        if (left_count == 0 || right_count == 0) {
+            continue;
+        }
+        float cost = aabb_surface_area(left) * left_count + aabb_surface_area(right) * right_count;
+        if (cost < best_cost) {
+            best_cost = cost;
+            best_split = split;
+        }
+    }
+
+    int mid = start;
+    if (best_split > 0) {
+        // Partition refs so that objects in bins below the split come first
+        int j = end - 1;
+        while (mid <= j) {
+            int b = (int)((vec3_axis(refs[mid].centroid, axis) - axis_min) * scale);
+            b = b < 0 ? 0 : (b >= BVH_BINS ? BVH_BINS - 1 : b);
+            if (b < best_split) {
+                mid++;
+            } else {
+                BuildRef tmp = refs[mid];
+                refs[mid] = refs[j];
+                refs[j] = tmp;
+                j--;
+            }
+        }
+    }
+    if (mid == start || mid == end) {
+        mid = start + count / 2;
+    }
+
+    bvh_build_range(bvh, refs, start, mid, depth + 1);
+    int second = bvh_build_range(bvh, refs, mid, end, depth + 1);
+
+    node->offset = second;
+    node->count = 0;
+    node->axis = axis;
+    return node_index;
+}
+
+bool bvh_build(Bvh *bvh, const Hittable *objects, int count) {
+    bvh->nodes = NULL;
+    bvh->node_count = 0;
+    bvh->objects = NULL;
+    bvh->object_count = 0;
+
+    if (count <= 0) {
+        return true;
+    }
+
+    BuildRef *refs = malloc((size_t)count * sizeof(BuildRef));
+    if (!refs) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!hittable_bounds(&objects[i], &refs[i].bounds)) {
+            free(refs);
+            return false;
+        }
+        refs[i].centroid = aabb_centroid(refs[i].bounds);
+        refs[i].index = i;
+    }
+
+    // A binary tree with at least one object per leaf has at most 2n - 1 nodes
+    bvh->nodes = malloc((size_t)(2 * count - 1) * sizeof(BvhNode));
+    bvh->objects = malloc((size_t)count * sizeof(Hittable));
+    if (!bvh->nodes || !bvh->objects) {
+        free(refs);
+        bvh_destroy(bvh);
+        return false;
+    }
+
+    bvh_build_range(bvh, refs, 0, count, 0);
+
+    for (int i = 0; i < count; i++) {
+        bvh->objects[i] = objects[refs[i].index];
+    }
+    bvh->object_count = count;
+
+    free(refs);
+    return true;
+}
+
+void bvh_destroy(Bvh *bvh) {
+    free(bvh->nodes);
+    free(bvh->objects);
+    bvh->nodes = NULL;
+    bvh->objects = NULL;
+    bvh->node_count = 0;
+    bvh->object_count = 0;
+}
+
+/**
+ * @brief Traverse the BVH for the closest hit below t_max, or any hit
+ * @param skip Object the caller has already tested (-1: none)
+ * @param hit_rec Output hit record, left unchanged without a hit
+ * @param hit_index Output object of the hit, left unchanged without a hit
+ */
+static bool bvh_traverse(const Bvh *bvh, const Ray *ray, float t_min, float t_max, bool any_hit,
+                         int skip, HitRecord *hit_rec, int *hit_index) {
+    Vec3 inv_dir = aabb_inverse_direction(ray);
+    int dir_negative[3] = {inv_dir.x < 0.0f, inv_dir.y < 0.0f, inv_dir.z < 0.0f};
+
+    HitRecord temp_rec;
+    int stack[BVH_STACK_SIZE];
+    int stack_size = 0;
+    int node_index = 0;
+    bool hit_anything = false;
+    float closest_so_far = t_max;
+
+    for (;;) {
+        const BvhNode *node = &bvh->nodes[node_index];
+        if (aabb_hit(&node->bounds, ray, inv_dir, t_min, closest_so_far, NULL, NULL)) {
+            if (node->count > 0) {
+                for (int i = node->offset; i < node->offset + node->count; i++) {
+                    if (i != skip &&
+                        hittable_hit(&bvh->objects[i], ray, t_min, closest_so_far, &temp_rec)) {
+                        hit_anything = true;
+                        closest_so_far = temp_rec.t;
+                        *hit_rec = temp_rec;
+                        *hit_index = i;
+                        if (any_hit) {
+                            return true;
+                        }
+                    }
+                }
+            } else {
+                // Visit the child on the near side of the split plane first
+                // (the build keeps the depth, and so the stack, below BVH_STACK_SIZE)
+                if (dir_negative[node->axis]) {
+                    stack[stack_size++] = node_index + 1;
+                    node_index = node->offset;
+                } else {
+                    stack[stack_size++] = node->offset;
+                    node_index = node_index + 1;
+                }
+                continue;
+            }
+        }
+        if (stack_size == 0) {
+            break;
+        }
+        node_index = stack[--stack_size];
+    }
+
+    return hit_anything;
+}
+
+bool bvh_hit(const Hittable *hittable, const Ray *ray, float t_min, float t_max,
+             HitRecord *hit_rec) {
+    const Bvh *bvh = (const Bvh *)hittable->data;
+    int hit_index;
+    return bvh->node_count > 0 &&
+           bvh_traverse(bvh, ray, t_min, t_max, false, -1, hit_rec, &hit_index);
+}
+
+bool bvh_hit_hinted(const Hittable *hittable, const Ray *ray, float t_min, float t_max,
+                    bool any_hit, HitHint *hint, HitRecord *hit_rec) {
+    const Bvh *bvh = (const Bvh *)hittable->data;
+    int *last = any_hit ? &hint->last_occluder : &hint->last_hit;
+    int cached = *last < bvh->object_count ? *last : -1;
+    hint->answered = false;
+    if (bvh->node_count == 0) {
+        return false;
+    }
+    bool hit = cached >= 0 && hittable_hit(&bvh->objects[cached], ray, t_min, t_max, hit_rec);
+    if (hit && any_hit) {
+        hint->answered = true;
+        return true;
+    }
+    int hit_index = cached;
+    float closest = hit ? hit_rec->t : t_max;
+    hit = bvh_traverse(bvh, ray, t_min, closest, any_hit, cached, hit_rec, &hit_index) || hit;
+    if (hit) {
+        hint->answered = hit_index == cached;
+        *last = hit_index;
+    }
+    return hit;
+}
+
+bool bvh_bounds(const Hittable *hittable, AABB *box) {
+    const Bvh *bvh = (const Bvh *)hittable->data;
+    if (bvh->node_count == 0) {
+        return false;
+    }
+    *box = bvh->nodes[0].bounds;
+    return true;
+}
+
+Hittable bvh_to_hittable(Bvh *bvh) {
+    Hittable hittable = hittable_create_bounded(bvh, bvh_hit, bvh_bounds);
+    hittable.hinted_hit_func = bvh_hit_hinted;
+    return hittable;
+}
@@ -46,10 +46,15 @@ Camera camera_create_perspective(Vec3 origin, Vec3 target, Vec3 up,
     float half_height = tanf(theta / 2.0f);
     float half_width = aspect_ratio * half_height;
     
-    // Use orthographic for now - perspective will be future enhancement
-    return camera_create_orthographic(origin, target, up,
-                                     2.0f * half_width, 2.0f * half_height,
-                                     image_width, image_height);
+    Camera camera = camera_create_orthographic(origin, target, up,
+                                               2.0f * half_width, 2.0f * half_height,
+                                               image_width, image_height);
+    
+    // Pinhole projection: move the viewport one unit in front of the eye
+    Vec3 w = vec3_normalize(vec3_sub(origin, target));
+    camera.lower_left = vec3_sub(camera.lower_left, w);
+    
+    return camera;
 }
 
 Ray camera_get_ray(const Camera *camera, float u, float v) {
@@ -67,6 +72,76 @@ void camera_pixel_to_uv(const Camera *camera, int pixel_x, int pixel_y,
     *v = (float)pixel_y / (float)(camera->image_height - 1);
 }
 
+void camera_sample_to_uv(const Camera *camera, int pixel_x, int pixel_y, float offset_x,
+                         float offset_y, float *u, float *v) {
+    *u = ((float)pixel_x + offset_x) / (float)(camera->image_width - 1);
+    *v = ((float)pixel_y + offset_y) / (float)(camera->image_height - 1);
+}
+
+bool camera_project_bounds(const Camera *camera, AABB bounds, int *x0, int *y0, int *x1,
+                           int *y1) {
+    int width = camera->image_width;
+    int height = camera->image_height;
+    *x0 = 0;
+    *y0 = 0;
+    *x1 = width;
+    *y1 = height;
+    if (bounds.min.x > bounds.max.x) {
+        *x1 = 0;
+        *y1 = 0;
+        return false;
+    }
+    Vec3 forward = vec3_normalize(vec3_cross(camera->vertical, camera->horizontal));
+    float plane_depth = vec3_dot(vec3_sub(camera->lower_left, camera->origin), forward);
+    if (plane_depth <= 0.0f) {
+        return true;
+    }
+    float horizontal_scale = 1.0f / vec3_length_squared(camera->horizontal);
+    float vertical_scale = 1.0f / vec3_length_squared(camera->vertical);
+    float u_min = INFINITY, u_max = -INFINITY, v_min = INFINITY, v_max = -INFINITY;
+    int behind = 0;
+    for (int corner = 0; corner < 8; corner++) {
+        Vec3 p = vec3_create(corner & 1 ? bounds.max.x : bounds.min.x,
+                             corner & 2 ? bounds.max.y : bounds.min.y,
+                             corner & 4 ? bounds.max.z : bounds.min.z);
+        Vec3 d = vec3_sub(p, camera->origin);
+        float depth = vec3_dot(d, forward);
+        if (depth <= 0.0f) {
+            behind++;
+            continue;
+        }
+        // Where the line from the eye through the corner crosses the viewport
+        Vec3 q = vec3_sub(vec3_add(camera->origin, vec3_scale(d, plane_depth / depth)),
+                          camera->lower_left);
+        float u = vec3_dot(q, camera->horizontal) * horizontal_scale;
+        float v = vec3_dot(q, camera->vertical) * vertical_scale;
+        u_min = fminf(u_min, u);
+        u_max = fmaxf(u_max, u);
+        v_min = fminf(v_min, v);
+        v_max = fmaxf(v_max, v);
+    }
+    if (behind == 8) {
+        *x1 = 0;
+        *y1 = 0;
+        return false;
+    }
+    if (behind > 0) {
+        return true;
+    }
+    // u = i / (width - 1), v = j / (height - 1); rows count down from the top
+    float columns = (float)(width - 1);
+    float rows = (float)(height - 1);
+    float left = floorf(u_min * columns) - 1.0f;
+    float right = ceilf(u_max * columns) + 2.0f;
+    float top = floorf(rows - v_max * rows) - 1.0f;
+    float bottom = ceilf(rows - v_min * rows) + 2.0f;
+    *x0 = left < 0.0f ? 0 : (left > (float)width ? width : (int)left);
+    *x1 = right < 0.0f ? 0 : (right > (float)width ? width : (int)right);
+    *y0 = top < 0.0f ? 0 : (top > (float)height ? height : (int)top);
+    *y1 = bottom < 0.0f ? 0 : (bottom > (float)height ? height : (int)bottom);
+    return *x0 < *x1 && *y0 < *y1;
+}
+
 void camera_print(const Camera *camera) {
     printf("Camera {\n");
     printf("  origin: ");
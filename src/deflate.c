@@ -0,0 +1,345 @@
+/**
+ * @file deflate.c
+ * @brief Minimal DEFLATE compressor and zlib/PNG checksums
+ */
+
+#include "deflate.h"
+#include <pthread.h>
+#include <string.h>
+
+/**
+ * @brief Longest and shortest DEFLATE match
+ */
+#define DEFLATE_MAX_MATCH 258
+#define DEFLATE_MIN_MATCH 3
+
+/**
+ * @brief Hash chain entries examined per position
+ */
+#define DEFLATE_MAX_CHAIN 8
+
+/**
+ * @brief Matches longer than this do not insert their inner positions
+ */
+#define DEFLATE_MAX_INSERT 16
+
+/**
+ * @brief Largest stored block payload
+ */
+#define DEFLATE_MAX_STORED 65535
+
+/**
+ * @brief Adler-32 modulus and the longest run before the sums must be reduced
+ */
+#define ADLER_BASE 65521u
+#define ADLER_NMAX 5552
+
+static const uint16_t length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t distance_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t distance_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+/**
+ * @brief Precomputed fixed Huffman codes (bit-reversed for LSB-first output)
+ */
+typedef struct {
+    uint16_t literal_code[288];    ///< Literal/length code
+    uint8_t literal_bits[288];     ///< Literal/length code length
+    uint8_t length_symbol[259];    ///< Length (3..258) to code index 0..28
+    uint8_t distance_symbol[512];  ///< Distance to code (see distance_code)
+    uint8_t distance_code[30];     ///< 5-bit distance codes, reversed
+    uint32_t crc[256];             ///< CRC-32 byte table
+} DeflateTables;
+
+static DeflateTables tables;
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static uint32_t reverse_bits(uint32_t code, int bits) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < bits; i++) {
+        reversed = (reversed << 1) | ((code >> i) & 1u);
+    }
+    return reversed;
+}
+
+static void tables_init(void) {
+    for (int s = 0; s < 288; s++) {
+        uint32_t code;
+        int bits;
+        if (s < 144) {
+            code = 0x30u + (uint32_t)s;
+            bits = 8;
+        } else if (s < 256) {
+            code = 0x190u + (uint32_t)(s - 144);
+            bits = 9;
+        } else if (s < 280) {
+            code = (uint32_t)(s - 256);
+            bits = 7;
+        } else {
+            code = 0xC0u + (uint32_t)(s - 280);
+            bits = 8;
+        }
+        tables.literal_code[s] = (uint16_t)reverse_bits(code, bits);
+        tables.literal_bits[s] = (uint8_t)bits;
+    }
+    for (int symbol = 0; symbol < 29; symbol++) {
+        int end = symbol < 28 ? length_base[symbol + 1] : 259;
+        for (int length = length_base[symbol]; length < end; length++) {
+            tables.length_symbol[length] = (uint8_t)symbol;
+        }
+    }
+    // Distances up to 256 index directly; larger ones by (distance - 1) >> 7
+    for (int symbol = 0; symbol < 30; symbol++) {
+        int end = symbol < 29 ? distance_base[symbol + 1] : 32769;
+        for (int distance = distance_base[symbol]; distance < end; distance++) {
+            if (distance <= 256) {
+                tables.distance_symbol[distance - 1] = (uint8_t)symbol;
+            } else {
+                tables.distance_symbol[256 + ((distance - 1) >> 7)] = (uint8_t)symbol;
+            }
+        }
+        tables.distance_code[symbol] = (uint8_t)reverse_bits((uint32_t)symbol, 5);
+    }
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1u) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        tables.crc[n] = c;
+    }
+}
+
+/**
+ * @brief LSB-first bit output
+ */
+typedef struct {
+    uint8_t *out;   ///< Output buffer
+    size_t pos;     ///< Bytes written
+    uint64_t bits;  ///< Pending bits
+    int count;      ///< Number of pending bits
+} BitWriter;
+
+static inline void put_bits(BitWriter *writer, uint32_t value, int count) {
+    writer->bits |= (uint64_t)value << writer->count;
+    writer->count += count;
+    if (writer->count >= 32) {
+        // Output is little-endian by definition, so store bytes explicitly
+        uint32_t word = (uint32_t)writer->bits;
+        writer->out[writer->pos] = (uint8_t)word;
+        writer->out[writer->pos + 1] = (uint8_t)(word >> 8);
+        writer->out[writer->pos + 2] = (uint8_t)(word >> 16);
+        writer->out[writer->pos + 3] = (uint8_t)(word >> 24);
+        writer->pos += 4;
+        writer->bits >>= 32;
+        writer->count -= 32;
+    }
+}
+
+static void align_to_byte(BitWriter *writer) {
+    while (writer->count > 0) {
+        writer->out[writer->pos++] = (uint8_t)writer->bits;
+        writer->bits >>= 8;
+        writer->count -= 8;
+    }
+    writer->bits = 0;
+    writer->count = 0;
+}
+
+/**
+ * @brief Length of the common prefix of a and b, up to limit
+ */
+static inline int match_length(const uint8_t *a, const uint8_t *b, int limit) {
+    int length = 0;
+    while (length + 8 <= limit) {
+        uint64_t x, y;
+        memcpy(&x, a + length, 8);
+        memcpy(&y, b + length, 8);
+        if (x != y) {
+            break;
+        }
+        length += 8;
+    }
+    while (length < limit && a[length] == b[length]) {
+        length++;
+    }
+    return length;
+}
+
+static inline void put_literal(BitWriter *writer, uint8_t literal) {
+    put_bits(writer, tables.literal_code[literal], tables.literal_bits[literal]);
+}
+
+static inline void put_match(BitWriter *writer, int length, int distance) {
+    int symbol = tables.length_symbol[length];
+    put_bits(writer, tables.literal_code[257 + symbol], tables.literal_bits[257 + symbol]);
+    put_bits(writer, (uint32_t)(length - length_base[symbol]), length_extra[symbol]);
+
+    int index = distance <= 256 ? distance - 1 : 256 + ((distance - 1) >> 7);
+    int dsymbol = tables.distance_symbol[index];
+    put_bits(writer, tables.distance_code[dsymbol], 5);
+    put_bits(writer, (uint32_t)(distance - distance_base[dsymbol]), distance_extra[dsymbol]);
+}
+
+static inline uint32_t hash3(const uint8_t *p) {
+    uint32_t v = (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+    return (v * 2654435761u) >> (32 - 15);
+}
+
+static inline void insert_position(DeflateScratch *scratch, const uint8_t *input, int32_t pos) {
+    uint32_t h = hash3(input + pos);
+    scratch->prev[pos & (DEFLATE_WINDOW_SIZE - 1)] = scratch->head[h];
+    scratch->head[h] = pos;
+}
+
+static size_t stored_size(size_t size) {
+    size_t blocks = (size + DEFLATE_MAX_STORED - 1) / DEFLATE_MAX_STORED;
+    return size + 5 * blocks;
+}
+
+static size_t write_stored(const uint8_t *input, size_t size, bool final, uint8_t *output) {
+    size_t pos = 0;
+    while (size > 0) {
+        size_t length = size < DEFLATE_MAX_STORED ? size : DEFLATE_MAX_STORED;
+        size -= length;
+        output[pos++] = (final && size == 0) ? 1 : 0;
+        output[pos++] = (uint8_t)length;
+        output[pos++] = (uint8_t)(length >> 8);
+        output[pos++] = (uint8_t)~length;
+        output[pos++] = (uint8_t)(~length >> 8);
+        memcpy(output + pos, input, length);
+        pos += length;
+        input += length;
+    }
+    return pos;
+}
+
+size_t deflate_bound(size_t size) {
+    return size + size / 8 + stored_size(size) - size + 16;
+}
+
+size_t deflate_compress_chunk(DeflateScratch *scratch, const uint8_t *input, size_t size,
+                              bool final, uint8_t *output) {
+    pthread_once(&tables_once, tables_init);
+    // Chunks beyond 2 GB are not worth matching: store them
+    if (size > INT32_MAX - DEFLATE_MAX_MATCH) {
+        return write_stored(input, size, final, output);
+    }
+
+    memset(scratch->head, 0xFF, sizeof(scratch->head));
+    BitWriter writer = {output, 0, 0, 0};
+    put_bits(&writer, final ? 1u : 0u, 1);
+    put_bits(&writer, 1u, 2);   // Fixed Huffman block
+
+    int32_t n = (int32_t)size;
+    int32_t i = 0;
+    while (i < n) {
+        int best_length = 0;
+        int best_distance = 0;
+        if (i + DEFLATE_MIN_MATCH <= n) {
+            int max_length = n - i < DEFLATE_MAX_MATCH ? n - i : DEFLATE_MAX_MATCH;
+            const uint8_t *current = input + i;
+            int32_t candidate = scratch->head[hash3(current)];
+            for (int chain = 0; chain < DEFLATE_MAX_CHAIN && candidate >= 0 &&
+                                i - candidate <= DEFLATE_WINDOW_SIZE;
+                 chain++) {
+                const uint8_t *match = input + candidate;
+                if (match[best_length] == current[best_length] && match[0] == current[0]) {
+                    int length = match_length(match, current, max_length);
+                    if (length > best_length) {
+                        best_length = length;
+                        best_distance = i - candidate;
+                        if (length == max_length) {
+                            break;
+                        }
+                    }
+                }
+                candidate = scratch->prev[candidate & (DEFLATE_WINDOW_SIZE - 1)];
+            }
+            insert_position(scratch, input, i);
+        }
+
+        if (best_length >= DEFLATE_MIN_MATCH) {
+            put_match(&writer, best_length, best_distance);
+            if (best_length <= DEFLATE_MAX_INSERT) {
+                for (int32_t k = i + 1; k < i + best_length && k + DEFLATE_MIN_MATCH <= n; k++) {
+                    insert_position(scratch, input, k);
+                }
+            }
+            i += best_length;
+        } else {
+            put_literal(&writer, input[i]);
+            i++;
+        }
+    }
+    put_bits(&writer, tables.literal_code[256], tables.literal_bits[256]);
+    if (!final) {
+        // Empty stored block: byte-aligns the chunk end for concatenation
+        put_bits(&writer, 0u, 3);
+        align_to_byte(&writer);
+        output[writer.pos++] = 0x00;
+        output[writer.pos++] = 0x00;
+        output[writer.pos++] = 0xFF;
+        output[writer.pos++] = 0xFF;
+    } else {
+        align_to_byte(&writer);
+    }
+
+    if (writer.pos > stored_size(size)) {
+        return write_stored(input, size, final, output);
+    }
+    return writer.pos;
+}
+
+uint32_t adler32_update(uint32_t adler, const uint8_t *data, size_t size) {
+    uint32_t a = adler & 0xFFFFu;
+    uint32_t b = adler >> 16;
+    while (size > 0) {
+        size_t block = size < ADLER_NMAX ? size : ADLER_NMAX;
+        size -= block;
+        while (block-- > 0) {
+            a += *data++;
+            b += a;
+        }
+        a %= ADLER_BASE;
+        b %= ADLER_BASE;
+    }
+    return (b << 16) | a;
+}
+
+uint32_t adler32_combine(uint32_t adler1, uint32_t adler2, uint64_t size2) {
+    uint32_t remainder = (uint32_t)(size2 % ADLER_BASE);
+    uint32_t sum1 = adler1 & 0xFFFFu;
+    uint32_t sum2 = (uint32_t)(((uint64_t)remainder * sum1) % ADLER_BASE);
+    sum1 += (adler2 & 0xFFFFu) + ADLER_BASE - 1;
+    sum2 += (adler1 >> 16) + (adler2 >> 16) + ADLER_BASE - remainder;
+    if (sum1 >= ADLER_BASE) {
+        sum1 -= ADLER_BASE;
+    }
+    if (sum1 >= ADLER_BASE) {
+        sum1 -= ADLER_BASE;
+    }
+    if (sum2 >= 2 * ADLER_BASE) {
+        sum2 -= 2 * ADLER_BASE;
+    }
+    if (sum2 >= ADLER_BASE) {
+        sum2 -= ADLER_BASE;
+    }
+    return (sum2 << 16) | sum1;
+}
+
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t size) {
+    pthread_once(&tables_once, tables_init);
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = tables.crc[(crc ^ data[i]) & 0xFFu] ^ (crc >> 8);
+    }
+    return ~crc;
+}
@@ -0,0 +1,589 @@
+/**
+ * @file demo_scenes.c
+ * @brief Built-in scenes selectable from the command line
+ */
+
+#include "demo_scenes.h"
+#include "timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/**
+ * @brief Small deterministic random generator (xorshift32) for scene generation
+ */
+static float random_float(unsigned int *state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return (float)(x >> 8) / 16777216.0f;
+}
+
+DemoSceneOptions demo_scene_default_options(void) {
+    DemoSceneOptions options;
+    options.kind = DEMO_SCENE_DEFAULT;
+    options.particle_count = 100000;
+    options.accel = ACCEL_BVH;
+    options.terrain_size = 1024;
+    options.voxel_resolution = 256;
+    options.sdf_max_steps = SDF_DEFAULT_MAX_STEPS;
+    options.sdf_relaxation = SDF_DEFAULT_RELAXATION;
+    options.points_file = NULL;
+    options.point_radius = 0.0f;
+    options.light_count = 4096;
+    return options;
+}
+
+bool demo_scene_parse_name(const char *name, DemoSceneKind *kind) {
+    if (strcmp(name, "demo") == 0) {
+        *kind = DEMO_SCENE_DEFAULT;
+    } else if (strcmp(name, "particles") == 0) {
+        *kind = DEMO_SCENE_PARTICLES;
+    } else if (strcmp(name, "terrain") == 0) {
+        *kind = DEMO_SCENE_TERRAIN;
+    } else if (strcmp(name, "voxels") == 0) {
+        *kind = DEMO_SCENE_VOXELS;
+    } else if (strcmp(name, "sdf") == 0) {
+        *kind = DEMO_SCENE_SDF;
+    } else if (strcmp(name, "points") == 0) {
+        *kind = DEMO_SCENE_POINTS;
+    } else if (strcmp(name, "lights") == 0) {
+        *kind = DEMO_SCENE_LIGHTS;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char *demo_scene_description(DemoSceneKind kind) {
+    switch (kind) {
+        case DEMO_SCENE_PARTICLES:
+            return "Dense particle cloud";
+        case DEMO_SCENE_TERRAIN:
+            return "Procedural heightfield terrain";
+        case DEMO_SCENE_VOXELS:
+            return "Sparse voxel sculpture";
+        case DEMO_SCENE_SDF:
+            return "Signed-distance-field blobs";
+        case DEMO_SCENE_POINTS:
+            return "Compact point cloud";
+        case DEMO_SCENE_LIGHTS:
+            return "Spheres lit by many small lights";
+        default:
+            return "Red sphere and blue plane with point lighting";
+    }
+}
+
+/**
+ * @brief Default scene: two spheres on a ground plane
+ */
+static void build_default_scene(DemoScene *demo, int width, int height) {
+    // 90 degree vertical FOV: a 2-unit tall viewport one unit in front of the eye
+    demo->camera = camera_create_perspective(vec3_create(0.0f, 0.0f, 0.0f),
+                                             vec3_create(0.0f, 0.0f, -1.0f),
+                                             vec3_create(0.0f, 1.0f, 0.0f),
+                                             90.0f, (float)width / (float)height,
+                                             width, height);
+    
+    // Create scene with a nice blue sky background
+    demo->scene = scene_create(color_create(0.5f, 0.7f, 1.0f));
+    
+    // Create a red sphere in the center
+    demo->spheres[0] = sphere_create(
+        vec3_create(0.0f, 0.0f, -1.0f),  // center
+        0.5f,                            // radius
+        color_create(0.8f, 0.3f, 0.3f)   // red color
+    );
+    scene_add_object(&demo->scene, sphere_to_hittable(&demo->spheres[0]));
+    
+    // Create a green ground plane
+    demo->ground = plane_create_xz(
+        -0.5f,                           // y position
+        color_create(0.3f, 0.8f, 0.3f)   // green color
+    );
+    scene_add_object(&demo->scene, plane_to_hittable(&demo->ground));
+    
+    // Add a second smaller sphere for interest
+    demo->spheres[1] = sphere_create(
+        vec3_create(-1.0f, 0.0f, -1.0f), // center (to the left)
+        0.3f,                           // smaller radius
+        color_create(0.3f, 0.3f, 0.8f)  // blue color
+    );
+    scene_add_object(&demo->scene, sphere_to_hittable(&demo->spheres[1]));
+    // A slightly rough blue mirror (only the path integrator shows reflections)
+    Material mirror = {MATERIAL_REFLECTIVE, 0.05f};
+    scene_set_material(&demo->scene, demo->scene.object_count - 1, mirror);
+    
+    // Add a point light above and to the side
+    PointLight light;
+    light.position = vec3_create(1.0f, 1.0f, 0.0f);
+    light.color = color_white();
+    light.intensity = 1.5f;
+    light.falloff_start = 0.0f;
+    light.radius = 0.0f;
+    scene_add_light(&demo->scene, light);
+    
+    // Add a second light for softer shadows
+    PointLight light2;
+    light2.position = vec3_create(-0.5f, 1.5f, 0.5f);
+    light2.color = color_create(1.0f, 0.9f, 0.8f); // Slightly warm
+    light2.intensity = 0.8f;
+    light2.falloff_start = 0.0f;
+    light2.radius = 0.0f;
+    scene_add_light(&demo->scene, light2);
+}
+
+/**
+ * @brief Particle scene: a dense, uniform cloud of small spheres
+ */
+static bool build_particle_scene(DemoScene *demo, const DemoSceneOptions *options,
+                                 int width, int height) {
+    demo->camera = camera_create_perspective(vec3_create(0.0f, 0.3f, 1.5f),
+                                             vec3_create(0.0f, 0.0f, -2.0f),
+                                             vec3_create(0.0f, 1.0f, 0.0f),
+                                             60.0f, (float)width / (float)height,
+                                             width, height);
+    demo->scene = scene_create(color_create(0.5f, 0.7f, 1.0f));
+    
+    int count = options->particle_count;
+    demo->accel = options->accel;
+    demo->particles = malloc((size_t)count * sizeof(Sphere));
+    demo->hittables = malloc((size_t)count * sizeof(Hittable));
+    if (!demo->particles || !demo->hittables) {
+        return false;
+    }
+    demo->particle_count = count;
+    
+    // Uniform cloud in a 4 x 2 x 4 box; radius keeps the fill ratio constant in N
+    Vec3 box_min = vec3_create(-2.0f, -0.5f, -5.0f);
+    Vec3 box_size = vec3_create(4.0f, 2.0f, 4.0f);
+    float spacing = cbrtf(box_size.x * box_size.y * box_size.z / (float)count);
+    float radius = 0.25f * spacing;
+    unsigned int rng = 0x9E3779B9u;
+    for (int i = 0; i < count; i++) {
+        float fx = random_float(&rng);
+        float fy = random_float(&rng);
+        float fz = random_float(&rng);
+        Vec3 center = vec3_create(box_min.x + fx * box_size.x,
+                                  box_min.y + fy * box_size.y,
+                                  box_min.z + fz * box_size.z);
+        Color color = color_create(0.3f + 0.6f * fx, 0.3f + 0.6f * fy, 0.3f + 0.6f * fz);
+        demo->particles[i] = sphere_create(center, radius, color);
+        demo->hittables[i] = sphere_to_hittable(&demo->particles[i]);
+    }
+    
+    double start = timer_now_seconds();
+    bool built;
+    Hittable aggregate;
+    if (demo->accel == ACCEL_GRID) {
+        built = grid_build(&demo->grid, demo->hittables, count, GRID_DEFAULT_CELLS_PER_OBJECT);
+        aggregate = grid_to_hittable(&demo->grid);
+    } else {
+        built = bvh_build(&demo->bvh, demo->hittables, count);
+        aggregate = bvh_to_hittable(&demo->bvh);
+    }
+    if (!built) {
+        return false;
+    }
+    printf("Built %s over %d spheres in %.1f ms\n", demo->accel == ACCEL_GRID ? "grid" : "BVH",
+           count, (timer_now_seconds() - start) * 1000.0);
+    if (demo->accel == ACCEL_GRID) {
+        printf("Grid resolution: %d x %d x %d\n",
+               demo->grid.res[0], demo->grid.res[1], demo->grid.res[2]);
+    }
+    scene_add_object(&demo->scene, aggregate);
+    
+    demo->ground = plane_create_xz(-0.6f, color_create(0.8f, 0.8f, 0.8f));
+    scene_add_object(&demo->scene, plane_to_hittable(&demo->ground));
+    
+    PointLight light;
+    light.position = vec3_create(2.0f, 4.0f, 1.0f);
+    light.color = color_white();
+    light.intensity = 1.0f;
+    light.falloff_start = 0.0f;
+    light.radius = 0.0f;
+    scene_add_light(&demo->scene, light);
+    
+    return true;
+}
+
+/**
+ * @brief Hash-based lattice value in [0, 1) for value noise
+ */
+static float lattice_value(int x, int z, unsigned int seed) {
+    unsigned int h = (unsigned int)x * 374761393u + (unsigned int)z * 668265263u + seed;
+    h = (h ^ (h >> 13)) * 1274126177u;
+    h ^= h >> 16;
+    return (float)(h & 0xFFFFFFu) / 16777216.0f;
+}
+
+/**
+ * @brief Smoothly interpolated value noise
+ */
+static float value_noise(float x, float z, unsigned int seed) {
+    int xi = (int)floorf(x);
+    int zi = (int)floorf(z);
+    float fx = x - (float)xi;
+    float fz = z - (float)zi;
+    float sx = fx * fx * (3.0f - 2.0f * fx);
+    float sz = fz * fz * (3.0f - 2.0f * fz);
+    float a = lattice_value(xi, zi, seed);
+    float b = lattice_value(xi + 1, zi, seed);
+    float c = lattice_value(xi, zi + 1, seed);
+    float d = lattice_value(xi + 1, zi + 1, seed);
+    return (a + (b - a) * sx) + ((c + (d - c) * sx) - (a + (b - a) * sx)) * sz;
+}
+
+/**
+ * @brief Terrain scene: fractal value-noise heightfield under a low sun
+ */
+static bool build_terrain_scene(DemoScene *demo, const DemoSceneOptions *options,
+                                int width, int height) {
+    demo->camera = camera_create_perspective(vec3_create(0.0f, 5.0f, 11.0f),
+                                             vec3_create(0.0f, 0.0f, -2.0f),
+                                             vec3_create(0.0f, 1.0f, 0.0f),
+                                             55.0f, (float)width / (float)height,
+                                             width, height);
+    demo->scene = scene_create(color_create(0.6f, 0.75f, 0.95f));
+    
+    int size = options->terrain_size;
+    float *heights = malloc((size_t)size * size * sizeof(float));
+    if (!heights) {
+        return false;
+    }
+    
+    // Five octaves of value noise, 6 base features across the terrain
+    for (int z = 0; z < size; z++) {
+        for (int x = 0; x < size; x++) {
+            float u = 6.0f * (float)x / (float)(size - 1);
+            float v = 6.0f * (float)z / (float)(size - 1);
+            float h = 0.0f;
+            float amplitude = 1.0f;
+            for (int octave = 0; octave < 5; octave++) {
+                h += amplitude * value_noise(u, v, 1013u * (unsigned int)octave);
+                u *= 2.0f;
+                v *= 2.0f;
+                amplitude *= 0.5f;
+            }
+            heights[(size_t)z * size + x] = 2.5f * h * h;
+        }
+    }
+    
+    double start = timer_now_seconds();
+    demo->has_terrain = true;
+    if (!heightfield_build(&demo->terrain, heights, size, size, vec3_create(-10.0f, -1.5f, -10.0f),
+                           20.0f, 20.0f, color_create(0.55f, 0.5f, 0.4f))) {
+        demo->has_terrain = false;
+        return false;
+    }
+    size_t cells = (size_t)(size - 1) * (size - 1);
+    size_t mesh_bytes = (size_t)size * size * sizeof(Vec3) + cells * 2 * 3 * sizeof(int);
+    printf("Built %dx%d heightfield in %.1f ms: %.1f MB (indexed mesh would be %.1f MB)\n",
+           size, size, (timer_now_seconds() - start) * 1000.0,
+           heightfield_memory_bytes(&demo->terrain) / 1048576.0, mesh_bytes / 1048576.0);
+    scene_add_object(&demo->scene, heightfield_to_hittable(&demo->terrain));
+    
+    PointLight sun;
+    sun.position = vec3_create(-30.0f, 20.0f, -10.0f);
+    sun.color = color_create(1.0f, 0.95f, 0.85f);
+    sun.intensity = 1.2f;
+    sun.falloff_start = 0.0f;
+    sun.radius = 0.0f;
+    scene_add_light(&demo->scene, sun);
+    
+    return true;
+}
+
+/**
+ * @brief Voxel scene: a perforated hollow sphere standing on a checkered slab
+ */
+static bool build_voxel_scene(DemoScene *demo, const DemoSceneOptions *options,
+                              int width, int height) {
+    demo->camera = camera_create_perspective(vec3_create(0.0f, 1.2f, 3.2f),
+                                             vec3_create(0.0f, 0.0f, 0.0f),
+                                             vec3_create(0.0f, 1.0f, 0.0f),
+                                             50.0f, (float)width / (float)height,
+                                             width, height);
+    demo->scene = scene_create(color_create(0.5f, 0.7f, 1.0f));
+    
+    int n = options->voxel_resolution;
+    float extent = 2.0f;
+    if (!voxel_volume_init(&demo->voxels, n, n, n, vec3_create(-1.0f, -1.0f, -1.0f),
+                           extent / (float)n)) {
+        return false;
+    }
+    demo->has_voxels = true;
+    voxel_volume_set_material(&demo->voxels, 1, color_create(0.8f, 0.8f, 0.75f));
+    voxel_volume_set_material(&demo->voxels, 2, color_create(0.3f, 0.3f, 0.35f));
+    voxel_volume_set_material(&demo->voxels, 3, color_create(0.9f, 0.4f, 0.2f));
+    voxel_volume_set_material(&demo->voxels, 4, color_create(0.9f, 0.8f, 0.2f));
+    
+    double start = timer_now_seconds();
+    int slab = n / 16 > 1 ? n / 16 : 1;
+    int checker = n / 8 > 1 ? n / 8 : 1;
+    float center = 0.5f * (float)n;
+    float outer = 0.42f * (float)n;
+    float inner = 0.36f * (float)n;
+    for (int z = 0; z < n; z++) {
+        for (int y = 0; y < n; y++) {
+            for (int x = 0; x < n; x++) {
+                uint8_t material = VOXEL_EMPTY;
+                if (y < slab) {
+                    material = ((x / checker + z / checker) & 1) ? 1 : 2;
+                } else {
+                    float dx = (float)x + 0.5f - center;
+                    float dy = (float)y + 0.5f - (center + 0.05f * (float)n);
+                    float dz = (float)z + 0.5f - center;
+                    float r2 = dx * dx + dy * dy + dz * dz;
+                    // Shell with round windows cut along the three axes
+                    bool window = dx * dx + dy * dy < 0.04f * n * n ||
+                                  dy * dy + dz * dz < 0.04f * n * n ||
+                                  dx * dx + dz * dz < 0.02f * n * n;
+                    if (r2 < outer * outer && r2 > inner * inner && !window) {
+                        material = dy > 0.0f ? 3 : 4;
+                    }
+                }
+                if (material != VOXEL_EMPTY &&
+                    !voxel_volume_set(&demo->voxels, x, y, z, material)) {
+                    return false;
+                }
+            }
+        }
+    }
+    size_t dense_bytes = (size_t)n * n * n;
+    printf("Built %d^3 voxel volume in %.1f ms: %d bricks, %.1f MB (dense would be %.1f MB)\n",
+           n, (timer_now_seconds() - start) * 1000.0, demo->voxels.brick_count,
+           voxel_volume_memory_bytes(&demo->voxels) / 1048576.0, dense_bytes / 1048576.0);
+    scene_add_object(&demo->scene, voxel_volume_to_hittable(&demo->voxels));
+    
+    PointLight light;
+    light.position = vec3_create(2.0f, 3.0f, 2.0f);
+    light.color = color_white();
+    light.intensity = 1.2f;
+    light.falloff_start = 0.0f;
+    light.radius = 0.0f;
+    scene_add_light(&demo->scene, light);
+    
+    return true;
+}
+
+/**
+ * @brief SDF scene: six smooth-union compositions grouped under a BVH
+ */
+static bool build_sdf_scene(DemoScene *demo, const DemoSceneOptions *options,
+                            int width, int height) {
+    demo->camera = camera_create_perspective(vec3_create(0.0f, 1.0f, 3.5f),
+                                             vec3_create(0.0f, 0.0f, -1.0f),
+                                             vec3_create(0.0f, 1.0f, 0.0f),
+                                             55.0f, (float)width / (float)height,
+                                             width, height);
+    demo->scene = scene_create(color_create(0.5f, 0.7f, 1.0f));
+    
+    for (int i = 0; i < 6; i++) {
+        float x = -2.5f + (float)(i % 3) * 2.5f;
+        float z = -0.5f - (float)(i / 3) * 2.5f;
+        float blend = 0.1f + 0.15f * (float)i;
+        SdfObject *sdf = &demo->sdfs[i];
+        *sdf = sdf_object_create(color_create(0.9f - 0.12f * i, 0.35f + 0.1f * i, 0.4f));
+        sdf->max_steps = options->sdf_max_steps;
+        sdf->relaxation = options->sdf_relaxation;
+        
+        // A rounded box with a sphere on top and one on the side, blended together
+        int box = sdf_add_box(sdf, vec3_create(x, -0.3f, z), vec3_create(0.45f, 0.2f, 0.45f),
+                              0.05f);
+        int top = sdf_add_sphere(sdf, vec3_create(x, 0.25f, z), 0.35f);
+        int side = sdf_add_sphere(sdf, vec3_create(x + 0.45f, -0.05f, z + 0.2f), 0.2f);
+        int body = sdf_add_smooth_union(sdf, box, top, blend);
+        sdf_add_smooth_union(sdf, body, side, blend);
+        demo->sdf_hittables[i] = sdf_to_hittable(sdf);
+    }
+    if (!bvh_build(&demo->sdf_bvh, demo->sdf_hittables, 6)) {
+        return false;
+    }
+    scene_add_object(&demo->scene, bvh_to_hittable(&demo->sdf_bvh));
+    
+    demo->ground = plane_create_xz(-0.55f, color_create(0.8f, 0.8f, 0.8f));
+    scene_add_object(&demo->scene, plane_to_hittable(&demo->ground));
+    
+    PointLight light;
+    light.position = vec3_create(2.0f, 4.0f, 3.0f);
+    light.color = color_white();
+    light.intensity = 1.2f;
+    light.falloff_start = 0.0f;
+    light.radius = 0.0f;
+    scene_add_light(&demo->scene, light);
+    
+    return true;
+}
+
+/**
+ * @brief Points scene: a point cloud loaded from a file, or a procedural spiral galaxy
+ */
+static bool build_points_scene(DemoScene *demo, const DemoSceneOptions *options,
+                               int width, int height) {
+    demo->camera = camera_create_perspective(vec3_create(0.0f, 1.1f, 1.3f),
+                                             vec3_create(0.0f, -0.1f, 0.0f),
+                                             vec3_create(0.0f, 1.0f, 0.0f),
+                                             50.0f, (float)width / (float)height,
+                                             width, height);
+    demo->scene = scene_create(color_create(0.05f, 0.05f, 0.1f));
+    Color color = color_create(0.9f, 0.85f, 0.7f);
+    
+    double start = timer_now_seconds();
+    if (options->points_file) {
+        if (!point_cloud_load(&demo->points, options->points_file, options->point_radius, color)) {
+            fprintf(stderr, "Error: Could not load point cloud '%s'\n", options->points_file);
+            return false;
+        }
+    } else {
+        // Two-armed spiral galaxy in a unit disk
+        size_t count = (size_t)options->particle_count;
+        float *positions = malloc(count * 3 * sizeof(float));
+        if (!positions) {
+            return false;
+        }
+        unsigned int rng = 0x2545F491u;
+        for (size_t i = 0; i < count; i++) {
+            float r = sqrtf(random_float(&rng));
+            float arm = (float)(i & 1u) * 3.14159265f;
+            float angle = arm + 5.0f * r + 1.2f * (random_float(&rng) - 0.5f) * (1.2f - r);
+            float thickness = 0.08f * (1.0f - r) + 0.01f;
+            positions[3 * i] = r * cosf(angle);
+            positions[3 * i + 1] = thickness * (random_float(&rng) - 0.5f);
+            positions[3 * i + 2] = r * sinf(angle);
+        }
+        start = timer_now_seconds();
+        bool built = point_cloud_build(&demo->points, positions, count, options->point_radius, color);
+        free(positions);
+        if (!built) {
+            return false;
+        }
+    }
+    demo->has_points = true;
+    printf("Built point cloud of %zu points in %.1f ms (%.1f MB, radius %g)\n",
+           demo->points.point_count, (timer_now_seconds() - start) * 1000.0,
+           (double)point_cloud_memory_bytes(&demo->points) / (1024.0 * 1024.0),
+           (double)demo->points.radius);
+    scene_add_object(&demo->scene, point_cloud_to_hittable(&demo->points));
+    
+    PointLight light;
+    light.position = vec3_create(1.0f, 3.0f, 2.0f);
+    light.color = color_white();
+    light.intensity = 1.2f;
+    light.falloff_start = 0.0f;
+    light.radius = 0.0f;
+    scene_add_light(&demo->scene, light);
+    
+    return true;
+}
+
+/**
+ * @brief Lights scene: spheres on a plane under a field of small colored lights
+ * The lights fall off with distance, so each shading point is lit mostly
+ * by its few nearest lights; sampling them through the light tree is what
+ * keeps this scene fast.
+ */
+static bool build_lights_scene(DemoScene *demo, const DemoSceneOptions *options,
+                               int width, int height) {
+    demo->camera = camera_create_perspective(vec3_create(0.0f, 1.5f, 3.0f),
+                                             vec3_create(0.0f, 0.3f, -4.0f),
+                                             vec3_create(0.0f, 1.0f, 0.0f),
+                                             60.0f, (float)width / (float)height,
+                                             width, height);
+    demo->scene = scene_create(color_create(0.02f, 0.02f, 0.04f));
+
+    demo->ground = plane_create_xz(0.0f, color_create(0.8f, 0.8f, 0.8f));
+    scene_add_object(&demo->scene, plane_to_hittable(&demo->ground));
+    demo->spheres[0] = sphere_create(vec3_create(0.5f, 1.0f, -4.0f), 1.0f,
+                                     color_create(0.9f, 0.9f, 0.9f));
+    scene_add_object(&demo->scene, sphere_to_hittable(&demo->spheres[0]));
+    demo->spheres[1] = sphere_create(vec3_create(-1.8f, 0.5f, -3.0f), 0.5f,
+                                     color_create(0.8f, 0.6f, 0.3f));
+    scene_add_object(&demo->scene, sphere_to_hittable(&demo->spheres[1]));
+
+    // Lights hover over a 16 x 16 patch; the total brightness does not depend on the count
+    unsigned int rng = 0x2545F491u;
+    float intensity = 600.0f / (float)options->light_count;
+    for (int i = 0; i < options->light_count; i++) {
+        PointLight light;
+        light.position = vec3_create(-8.0f + 16.0f * random_float(&rng),
+                                     0.2f + 0.8f * random_float(&rng),
+                                     -12.0f + 16.0f * random_float(&rng));
+        // Saturated colors: one channel full, the others random
+        float r = random_float(&rng);
+        float g = random_float(&rng);
+        float b = random_float(&rng);
+        int full = (int)(3.0f * random_float(&rng));
+        light.color = color_create(full == 0 ? 1.0f : r * r, full == 1 ? 1.0f : g * g,
+                                   full == 2 ? 1.0f : b * b);
+        light.intensity = intensity;
+        light.falloff_start = 0.2f;
+        // Past this radius a light adds less than one 8-bit step
+        light.radius = point_light_cutoff_radius(&light, 1.0f / 256.0f);
+        if (!scene_add_light(&demo->scene, light)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool demo_scene_build(DemoScene *demo, const DemoSceneOptions *options, int width, int height) {
+    memset(demo, 0, sizeof(*demo));
+    bool built = true;
+    switch (options->kind) {
+        case DEMO_SCENE_PARTICLES:
+            built = build_particle_scene(demo, options, width, height);
+            break;
+        case DEMO_SCENE_TERRAIN:
+            built = build_terrain_scene(demo, options, width, height);
+            break;
+        case DEMO_SCENE_VOXELS:
+            built = build_voxel_scene(demo, options, width, height);
+            break;
+        case DEMO_SCENE_SDF:
+            built = build_sdf_scene(demo, options, width, height);
+            break;
+        case DEMO_SCENE_POINTS:
+            built = build_points_scene(demo, options, width, height);
+            break;
+        case DEMO_SCENE_LIGHTS:
+            built = build_lights_scene(demo, options, width, height);
+            break;
+        default:
+            build_default_scene(demo, width, height);
+            break;
+    }
+    return built && scene_build_light_tree(&demo->scene);
+}
+
+void demo_scene_destroy(DemoScene *demo) {
+    scene_destroy(&demo->scene);
+    if (demo->particle_count > 0) {
+        if (demo->accel == ACCEL_GRID) {
+            grid_destroy(&demo->grid);
+        } else {
+            bvh_destroy(&demo->bvh);
+        }
+    }
+    free(demo->particles);
+    free(demo->hittables);
+    demo->particles = NULL;
+    demo->hittables = NULL;
+    demo->particle_count = 0;
+    if (demo->has_terrain) {
+        heightfield_destroy(&demo->terrain);
+        demo->has_terrain = false;
+    }
+    bvh_destroy(&demo->sdf_bvh);
+    if (demo->has_points) {
+        point_cloud_destroy(&demo->points);
+        demo->has_points = false;
+    }
+    if (demo->has_voxels) {
+        voxel_volume_destroy(&demo->voxels);
+        demo->has_voxels = false;
+    }
+}
@@ -0,0 +1,375 @@
+/**
+ * @file denoise.c
+ * @brief Edge-aware A-trous wavelet denoiser guided by surface features
+ *
+ * Buffers are kept as separate float planes and every pass loops over
+ * filter taps outside and pixels of a row inside, so the inner loops are
+ * plain arithmetic on contiguous arrays that the compiler vectorizes.
+ */
+
+#include "denoise.h"
+#include "render.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Rows per work item
+ */
+#define DENOISE_BAND_ROWS 16
+
+/**
+ * @brief Edge-stopping scales: squared normal difference, depth difference
+ *        relative to distance per pixel of spacing, summed albedo difference
+ */
+#define NORMAL_WEIGHT 64.0f
+#define DEPTH_TOLERANCE 0.05f
+#define ALBEDO_WEIGHT 8.0f
+
+/**
+ * @brief Albedo below this is not divided out (keeps black surfaces stable)
+ */
+#define ALBEDO_EPSILON 0.01f
+
+/**
+ * @brief Planes of the working image
+ */
+enum { PLANE_R, PLANE_G, PLANE_B, PLANE_VAR, PLANE_COUNT };
+
+/**
+ * @brief Work shared by the filter threads
+ */
+typedef struct {
+    int width;                      ///< Image width
+    int height;                     ///< Image height
+    float *current[PLANE_COUNT];    ///< Image being filtered (demodulated color, variance)
+    float *next[PLANE_COUNT];       ///< Result of the current pass
+    const float *normal[3];         ///< Normal planes
+    const float *depth;             ///< Depth plane
+    const float *albedo[3];         ///< Albedo planes
+    float *luminance;               ///< Luminance of current
+    float *inverse_tolerance;       ///< Per pixel: 1 / luminance tolerance
+    float *inverse_depth;           ///< Per pixel: 1 / depth tolerance at the current step
+    float sigma_luminance;          ///< Luminance tolerance in standard deviations
+    int step;                       ///< Tap spacing of the current pass
+    bool prepare;                   ///< Phase: compute luminance and tolerance, or filter
+    atomic_int next_band;           ///< Next band of rows to claim
+} DenoiseJob;
+
+/**
+ * @brief Per-thread arguments and row accumulators
+ */
+typedef struct {
+    DenoiseJob *job;    ///< Shared job
+    float *sums;        ///< PLANE_COUNT + 1 rows of width floats
+} DenoiseWorker;
+
+/**
+ * @brief e^x for x <= 0, relative error below 1e-5
+ * Branch-free so loops that call it vectorize: the clamp at -80 compares
+ * bit patterns (larger means more negative for negative floats, and a
+ * float comparison would not be if-converted), and 2^x is split at the
+ * nearest integer with the float rounding trick.
+ */
+static inline float fast_exp(float x) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    bits = bits > 0xC2A00000u ? 0xC2A00000u : bits; // -80.0f
+    memcpy(&x, &bits, sizeof(x));
+    float t = x * 1.44269504f;
+    float whole = (t + 12582912.0f) - 12582912.0f;
+    float f = t - whole;
+    float p = 1.0f + f * (0.69314718f +
+                          f * (0.24022651f + f * (0.05550411f + f * (0.00961813f +
+                                                                     f * 0.00133336f))));
+    int32_t exponent = ((int32_t)whole + 127) * (1 << 23);
+    float scale;
+    memcpy(&scale, &exponent, sizeof(scale));
+    return p * scale;
+}
+
+DenoiseSettings denoise_default_settings(void) {
+    DenoiseSettings settings;
+    settings.strength = 1.0f;
+    settings.iterations = DENOISE_DEFAULT_ITERATIONS;
+    settings.thread_count = 0;
+    return settings;
+}
+
+/**
+ * @brief Luminance of each pixel, its tolerance from 3x3-blurred variance
+ *        and its depth tolerance
+ */
+static void prepare_rows(DenoiseJob *job, int y0, int y1) {
+    static const float blur[3] = {0.25f, 0.5f, 0.25f};
+    int width = job->width;
+    const float *r = job->current[PLANE_R];
+    const float *g = job->current[PLANE_G];
+    const float *b = job->current[PLANE_B];
+    const float *var = job->current[PLANE_VAR];
+    for (int y = y0; y < y1; y++) {
+        for (int x = 0; x < width; x++) {
+            size_t p = (size_t)y * (size_t)width + (size_t)x;
+            job->luminance[p] = 0.2126f * r[p] + 0.7152f * g[p] + 0.0722f * b[p];
+            float sum = 0.0f;
+            float weight = 0.0f;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    int qx = x + dx;
+                    int qy = y + dy;
+                    if (qx < 0 || qy < 0 || qx >= width || qy >= job->height) {
+                        continue;
+                    }
+                    float w = blur[dx + 1] * blur[dy + 1];
+                    sum += w * var[(size_t)qy * (size_t)width + (size_t)qx];
+                    weight += w;
+                }
+            }
+            job->inverse_tolerance[p] =
+                1.0f / (job->sigma_luminance * sqrtf(sum / weight) + 1e-4f);
+            job->inverse_depth[p] =
+                1.0f / (DEPTH_TOLERANCE * (float)job->step * job->depth[p] + 1e-3f);
+        }
+    }
+}
+
+/**
+ * @brief Add one filter tap to the sums of pixels xa..xb-1 of a row
+ * The sums are only written through the restrict pointers, which lets the
+ * loop vectorize without alias checks against the many input planes.
+ * @param p0 Plane index of the row's first pixel
+ * @param q0 Plane index of the tap's neighbour of that pixel
+ */
+static void accumulate_tap(const DenoiseJob *job, size_t p0, size_t q0, int xa, int xb,
+                           float tap, float *restrict sum_w, float *restrict sum_r,
+                           float *restrict sum_g, float *restrict sum_b,
+                           float *restrict sum_v) {
+    const float *lum = job->luminance;
+    const float *tolerance = job->inverse_tolerance;
+    const float *inverse_depth = job->inverse_depth;
+    const float *nx = job->normal[0];
+    const float *ny = job->normal[1];
+    const float *nz = job->normal[2];
+    const float *z = job->depth;
+    const float *ar = job->albedo[0];
+    const float *ag = job->albedo[1];
+    const float *ab = job->albedo[2];
+    const float *r = job->current[PLANE_R];
+    const float *g = job->current[PLANE_G];
+    const float *b = job->current[PLANE_B];
+    const float *var = job->current[PLANE_VAR];
+    for (int x = xa; x < xb; x++) {
+        size_t p = p0 + (size_t)x;
+        size_t q = q0 + (size_t)x;
+        float dl = fabsf(lum[p] - lum[q]) * tolerance[p];
+        float dnx = nx[p] - nx[q];
+        float dny = ny[p] - ny[q];
+        float dnz = nz[p] - nz[q];
+        float dn = dnx * dnx + dny * dny + dnz * dnz;
+        float dz = fabsf(z[p] - z[q]) * inverse_depth[p];
+        float da = fabsf(ar[p] - ar[q]) + fabsf(ag[p] - ag[q]) + fabsf(ab[p] - ab[q]);
+        float w = tap * fast_exp(-(dl + NORMAL_WEIGHT * dn + dz + ALBEDO_WEIGHT * da));
+        sum_w[x] += w;
+        sum_r[x] += w * r[q];
+        sum_g[x] += w * g[q];
+        sum_b[x] += w * b[q];
+        sum_v[x] += w * w * var[q];
+    }
+}
+
+/**
+ * @brief One a-trous pass over a band of rows
+ */
+static void filter_rows(DenoiseJob *job, float *sums, int y0, int y1) {
+    static const float kernel[5] = {1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f,
+                                    1.0f / 16.0f};
+    int width = job->width;
+    int step = job->step;
+    float *sum_w = sums;
+    float *sum_r = sums + width;
+    float *sum_g = sums + 2 * (size_t)width;
+    float *sum_b = sums + 3 * (size_t)width;
+    float *sum_v = sums + 4 * (size_t)width;
+    for (int y = y0; y < y1; y++) {
+        memset(sums, 0, (PLANE_COUNT + 1) * (size_t)width * sizeof(float));
+        size_t row = (size_t)y * (size_t)width;
+        for (int ky = -2; ky <= 2; ky++) {
+            int qy = y + ky * step;
+            if (qy < 0 || qy >= job->height) {
+                continue;
+            }
+            for (int kx = -2; kx <= 2; kx++) {
+                int offset = kx * step;
+                int xa = offset < 0 ? -offset : 0;
+                int xb = offset > 0 ? width - offset : width;
+                if (xa < xb) {
+                    accumulate_tap(job, row, (size_t)qy * (size_t)width + (size_t)offset, xa, xb,
+                                   kernel[ky + 2] * kernel[kx + 2], sum_w, sum_r, sum_g, sum_b,
+                                   sum_v);
+                }
+            }
+        }
+        // The centre tap always contributes, so sum_w > 0
+        for (int x = 0; x < width; x++) {
+            float inv = 1.0f / sum_w[x];
+            job->next[PLANE_R][row + (size_t)x] = sum_r[x] * inv;
+            job->next[PLANE_G][row + (size_t)x] = sum_g[x] * inv;
+            job->next[PLANE_B][row + (size_t)x] = sum_b[x] * inv;
+            job->next[PLANE_VAR][row + (size_t)x] = sum_v[x] * inv * inv;
+        }
+    }
+}
+
+static void *denoise_worker(void *arg) {
+    DenoiseWorker *worker = (DenoiseWorker *)arg;
+    DenoiseJob *job = worker->job;
+    for (;;) {
+        int band = atomic_fetch_add_explicit(&job->next_band, 1, memory_order_relaxed);
+        int y0 = band * DENOISE_BAND_ROWS;
+        if (y0 >= job->height) {
+            break;
+        }
+        int y1 = y0 + DENOISE_BAND_ROWS < job->height ? y0 + DENOISE_BAND_ROWS : job->height;
+        if (job->prepare) {
+            prepare_rows(job, y0, y1);
+        } else {
+            filter_rows(job, worker->sums, y0, y1);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Run one phase over all rows on the worker threads
+ */
+static void run_phase(DenoiseJob *job, DenoiseWorker *workers, pthread_t *threads,
+                      int thread_count) {
+    atomic_store(&job->next_band, 0);
+    int started = 0;
+    for (; started < thread_count; started++) {
+        if (pthread_create(&threads[started], NULL, denoise_worker, &workers[started]) != 0) {
+            break;
+        }
+    }
+    if (started == 0) {
+        denoise_worker(&workers[0]);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+bool denoise_image(const DenoiseInput *input, const DenoiseSettings *settings, Color *output) {
+    int width = input->width;
+    int height = input->height;
+    size_t count = (size_t)width * (size_t)height;
+    if (settings->strength <= 0.0f || settings->iterations <= 0) {
+        memcpy(output, input->color, count * sizeof(Color));
+        return true;
+    }
+    int bands = (height + DENOISE_BAND_ROWS - 1) / DENOISE_BAND_ROWS;
+    int thread_count = settings->thread_count > 0 ? settings->thread_count
+                                                  : render_default_thread_count();
+    thread_count = thread_count < bands ? thread_count : bands;
+
+    // current, next, normal, depth, albedo, luminance and tolerances
+    enum { PLANES = 2 * PLANE_COUNT + 3 + 1 + 3 + 3 };
+    float *planes = malloc(PLANES * count * sizeof(float));
+    DenoiseWorker *workers = calloc((size_t)thread_count, sizeof(DenoiseWorker));
+    pthread_t *threads = malloc((size_t)thread_count * sizeof(pthread_t));
+    bool ok = planes && workers && threads;
+    for (int i = 0; ok && i < thread_count; i++) {
+        workers[i].sums = malloc((PLANE_COUNT + 1) * (size_t)width * sizeof(float));
+        ok = workers[i].sums != NULL;
+    }
+    if (!ok) {
+        for (int i = 0; workers && i < thread_count; i++) {
+            free(workers[i].sums);
+        }
+        free(planes);
+        free(workers);
+        free(threads);
+        return false;
+    }
+
+    DenoiseJob job;
+    job.width = width;
+    job.height = height;
+    float *plane = planes;
+    for (int c = 0; c < PLANE_COUNT; c++, plane += count) {
+        job.current[c] = plane;
+    }
+    for (int c = 0; c < PLANE_COUNT; c++, plane += count) {
+        job.next[c] = plane;
+    }
+    float *normal[3], *albedo[3];
+    for (int c = 0; c < 3; c++, plane += count) {
+        normal[c] = plane;
+        job.normal[c] = plane;
+    }
+    float *depth = plane;
+    job.depth = plane;
+    plane += count;
+    for (int c = 0; c < 3; c++, plane += count) {
+        albedo[c] = plane;
+        job.albedo[c] = plane;
+    }
+    job.luminance = plane;
+    job.inverse_tolerance = plane + count;
+    job.inverse_depth = plane + 2 * count;
+    job.sigma_luminance = 4.0f * settings->strength;
+    atomic_init(&job.next_band, 0);
+
+    // Split into planes and divide out the albedo
+    for (size_t p = 0; p < count; p++) {
+        Color a = input->albedo[p];
+        float da[3] = {fmaxf(a.x, ALBEDO_EPSILON), fmaxf(a.y, ALBEDO_EPSILON),
+                       fmaxf(a.z, ALBEDO_EPSILON)};
+        job.current[PLANE_R][p] = input->color[p].x / da[0];
+        job.current[PLANE_G][p] = input->color[p].y / da[1];
+        job.current[PLANE_B][p] = input->color[p].z / da[2];
+        float lum = 0.2126f * da[0] + 0.7152f * da[1] + 0.0722f * da[2];
+        job.current[PLANE_VAR][p] = input->variance ? input->variance[p] / (lum * lum)
+                                                    : DENOISE_UNKNOWN_VARIANCE;
+        normal[0][p] = input->normal[p].x;
+        normal[1][p] = input->normal[p].y;
+        normal[2][p] = input->normal[p].z;
+        depth[p] = input->depth[p];
+        albedo[0][p] = a.x;
+        albedo[1][p] = a.y;
+        albedo[2][p] = a.z;
+    }
+    for (int i = 0; i < thread_count; i++) {
+        workers[i].job = &job;
+    }
+
+    for (int iteration = 0; iteration < settings->iterations; iteration++) {
+        job.step = 1 << iteration;
+        job.prepare = true;
+        run_phase(&job, workers, threads, thread_count);
+        job.prepare = false;
+        run_phase(&job, workers, threads, thread_count);
+        for (int c = 0; c < PLANE_COUNT; c++) {
+            float *swap = job.current[c];
+            job.current[c] = job.next[c];
+            job.next[c] = swap;
+        }
+    }
+
+    for (size_t p = 0; p < count; p++) {
+        Color a = input->albedo[p];
+        output[p] = color_create(job.current[PLANE_R][p] * fmaxf(a.x, ALBEDO_EPSILON),
+                                 job.current[PLANE_G][p] * fmaxf(a.y, ALBEDO_EPSILON),
+                                 job.current[PLANE_B][p] * fmaxf(a.z, ALBEDO_EPSILON));
+    }
+    for (int i = 0; i < thread_count; i++) {
+        free(workers[i].sums);
+    }
+    free(planes);
+    free(workers);
+    free(threads);
+    return true;
+}
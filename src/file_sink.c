@@ -0,0 +1,365 @@
+/**
+ * @file file_sink.c
+ * @brief Buffered positional file output (io_uring with pwrite fallback)
+ */
+
+#if defined(__linux__)
+#define _DEFAULT_SOURCE
+#endif
+#define _POSIX_C_SOURCE 200809L
+
+#include "file_sink.h"
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define FILE_SINK_HAVE_IO_URING 1
+#endif
+#endif
+
+#ifdef FILE_SINK_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+/**
+ * @brief Write a whole buffer at an offset, retrying short writes
+ */
+static bool pwrite_all(int fd, const uint8_t *data, size_t size, int64_t offset) {
+    while (size > 0) {
+        ssize_t written = pwrite(fd, data, size, (off_t)offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= (size_t)written;
+        offset += written;
+    }
+    return true;
+}
+
+#ifdef FILE_SINK_HAVE_IO_URING
+
+static bool ring_setup(FileSinkRing *ring, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) {
+        return false;
+    }
+    ring->fd = fd;
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap && ring->cq_ring_size > ring->sq_ring_size) {
+        ring->sq_ring_size = ring->cq_ring_size;
+    }
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        ring->sq_ring = NULL;
+        return false;
+    }
+    if (single_mmap) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) {
+            ring->cq_ring = NULL;
+            return false;
+        }
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        return false;
+    }
+
+    uint8_t *sq = ring->sq_ring;
+    uint8_t *cq = ring->cq_ring;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = cq + params.cq_off.cqes;
+    return true;
+}
+
+static void ring_teardown(FileSinkRing *ring) {
+    if (ring->sqes) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_ring && ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    if (ring->sq_ring) {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+    if (ring->fd >= 0) {
+        close(ring->fd);
+    }
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+static bool ring_submit_write(FileSinkRing *ring, int fd, const uint8_t *data, size_t size,
+                              int64_t offset, uint64_t user_data) {
+    unsigned tail = atomic_load_explicit((_Atomic unsigned *)ring->sq_tail, memory_order_relaxed);
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &((struct io_uring_sqe *)ring->sqes)[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)data;
+    sqe->len = (uint32_t)size;
+    sqe->off = (uint64_t)offset;
+    sqe->user_data = user_data;
+    ring->sq_array[index] = index;
+    atomic_store_explicit((_Atomic unsigned *)ring->sq_tail, tail + 1, memory_order_release);
+
+    for (;;) {
+        long submitted = syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0);
+        if (submitted >= 0) {
+            return submitted == 1;
+        }
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+/**
+ * @brief Wait for one completion
+ * @param user_data Output user data of the completed request
+ * @return Result of the request (bytes written or -errno)
+ */
+static int ring_wait(FileSinkRing *ring, uint64_t *user_data) {
+    for (;;) {
+        unsigned head = atomic_load_explicit((_Atomic unsigned *)ring->cq_head,
+                                             memory_order_relaxed);
+        unsigned tail = atomic_load_explicit((_Atomic unsigned *)ring->cq_tail,
+                                             memory_order_acquire);
+        if (head != tail) {
+            struct io_uring_cqe *cqe = &((struct io_uring_cqe *)ring->cqes)[head & *ring->cq_mask];
+            *user_data = cqe->user_data;
+            int res = cqe->res;
+            atomic_store_explicit((_Atomic unsigned *)ring->cq_head, head + 1,
+                                  memory_order_release);
+            return res;
+        }
+        long waited = syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS,
+                              NULL, 0);
+        if (waited < 0 && errno != EINTR) {
+            return -errno;
+        }
+    }
+}
+
+#else
+
+static bool ring_setup(FileSinkRing *ring, unsigned entries) {
+    (void)ring;
+    (void)entries;
+    return false;
+}
+
+static void ring_teardown(FileSinkRing *ring) {
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+static bool ring_submit_write(FileSinkRing *ring, int fd, const uint8_t *data, size_t size,
+                              int64_t offset, uint64_t user_data) {
+    (void)ring;
+    (void)fd;
+    (void)data;
+    (void)size;
+    (void)offset;
+    (void)user_data;
+    return false;
+}
+
+static int ring_wait(FileSinkRing *ring, uint64_t *user_data) {
+    (void)ring;
+    *user_data = 0;
+    return -1;
+}
+
+#endif
+
+/**
+ * @brief Reap one in-flight write, finishing it with pwrite if it failed or was short
+ */
+static void sink_reap_one(FileSink *sink) {
+    uint64_t user_data = UINT64_MAX;
+    int res = ring_wait(&sink->ring, &user_data);
+    if (user_data >= FILE_SINK_BUFFER_COUNT || !sink->in_flight[user_data]) {
+        // The ring itself failed: rewrite everything still outstanding synchronously
+        for (int b = 0; b < FILE_SINK_BUFFER_COUNT; b++) {
+            if (sink->in_flight[b] &&
+                !pwrite_all(sink->fd, sink->buffers[b], sink->buffer_length[b],
+                            sink->buffer_offset[b])) {
+                sink->failed = true;
+            }
+            sink->in_flight[b] = false;
+        }
+        sink->use_ring = false;
+        return;
+    }
+    int b = (int)user_data;
+    size_t done = res > 0 ? (size_t)res : 0;
+    if (done < sink->buffer_length[b] &&
+        !pwrite_all(sink->fd, sink->buffers[b] + done, sink->buffer_length[b] - done,
+                    sink->buffer_offset[b] + (int64_t)done)) {
+        sink->failed = true;
+    }
+    if (res < 0) {
+        // The kernel refused the request (e.g. no IORING_OP_WRITE): stop using the ring
+        sink->use_ring = false;
+    }
+    sink->in_flight[b] = false;
+}
+
+static bool sink_any_in_flight(const FileSink *sink) {
+    for (int b = 0; b < FILE_SINK_BUFFER_COUNT; b++) {
+        if (sink->in_flight[b]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Hand the current buffer to the backend and switch to a free one
+ */
+static void sink_submit_current(FileSink *sink) {
+    if (sink->fill == 0) {
+        return;
+    }
+    int b = sink->current;
+    sink->buffer_offset[b] = sink->offset;
+    sink->buffer_length[b] = sink->fill;
+    sink->offset += (int64_t)sink->fill;
+    sink->fill = 0;
+
+    if (sink->use_ring && ring_submit_write(&sink->ring, sink->fd, sink->buffers[b],
+                                            sink->buffer_length[b], sink->buffer_offset[b],
+                                            (uint64_t)b)) {
+        sink->in_flight[b] = true;
+    } else if (!pwrite_all(sink->fd, sink->buffers[b], sink->buffer_length[b],
+                           sink->buffer_offset[b])) {
+        sink->failed = true;
+    }
+
+    // Next buffer: any that is not in flight, waiting for a completion if needed
+    for (;;) {
+        for (int i = 1; i <= FILE_SINK_BUFFER_COUNT; i++) {
+            int candidate = (b + i) % FILE_SINK_BUFFER_COUNT;
+            if (!sink->in_flight[candidate]) {
+                sink->current = candidate;
+                return;
+            }
+        }
+        sink_reap_one(sink);
+    }
+}
+
+bool file_sink_open(FileSink *sink, int fd, int64_t offset, bool allow_ring) {
+    memset(sink, 0, sizeof(*sink));
+    sink->fd = fd;
+    sink->offset = offset;
+    sink->end = offset;
+    sink->ring.fd = -1;
+    for (int b = 0; b < FILE_SINK_BUFFER_COUNT; b++) {
+        sink->buffers[b] = malloc(FILE_SINK_BUFFER_SIZE);
+        if (!sink->buffers[b]) {
+            for (int i = 0; i < b; i++) {
+                free(sink->buffers[i]);
+            }
+            return false;
+        }
+    }
+    if (allow_ring) {
+        sink->use_ring = ring_setup(&sink->ring, FILE_SINK_BUFFER_COUNT);
+        if (!sink->use_ring) {
+            ring_teardown(&sink->ring);
+        }
+    }
+    return true;
+}
+
+uint8_t *file_sink_reserve(FileSink *sink, size_t size) {
+    if (size > FILE_SINK_BUFFER_SIZE) {
+        return NULL;
+    }
+    if (FILE_SINK_BUFFER_SIZE - sink->fill < size) {
+        sink_submit_current(sink);
+    }
+    return sink->buffers[sink->current] + sink->fill;
+}
+
+void file_sink_commit(FileSink *sink, size_t size) {
+    sink->fill += size;
+    sink->bytes_written += size;
+    if (sink->offset + (int64_t)sink->fill > sink->end) {
+        sink->end = sink->offset + (int64_t)sink->fill;
+    }
+}
+
+bool file_sink_write(FileSink *sink, const void *data, size_t size) {
+    const uint8_t *bytes = data;
+    while (size > 0) {
+        size_t chunk = size < FILE_SINK_BUFFER_SIZE ? size : FILE_SINK_BUFFER_SIZE;
+        uint8_t *out = file_sink_reserve(sink, chunk);
+        if (!out) {
+            return false;
+        }
+        memcpy(out, bytes, chunk);
+        file_sink_commit(sink, chunk);
+        bytes += chunk;
+        size -= chunk;
+    }
+    return !sink->failed;
+}
+
+int64_t file_sink_position(const FileSink *sink) {
+    return sink->offset + (int64_t)sink->fill;
+}
+
+void file_sink_seek(FileSink *sink, int64_t offset) {
+    sink_submit_current(sink);
+    sink->offset = offset;
+}
+
+bool file_sink_close(FileSink *sink) {
+    sink_submit_current(sink);
+    while (sink_any_in_flight(sink)) {
+        sink_reap_one(sink);
+    }
+    ring_teardown(&sink->ring);
+    sink->use_ring = false;
+    for (int b = 0; b < FILE_SINK_BUFFER_COUNT; b++) {
+        free(sink->buffers[b]);
+        sink->buffers[b] = NULL;
+    }
+    return !sink->failed;
+}
+
+const char *file_sink_backend(const FileSink *sink) {
+    return sink->use_ring ? "io_uring" : "pwrite";
+}
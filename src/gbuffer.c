@@ -0,0 +1,131 @@
+/**
+ * @file gbuffer.c
+ * @brief G-buffer storage and file I/O
+ */
+
+#include "gbuffer.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char gbuffer_magic[8] = {'R', 'T', 'G', 'B', 'U', 'F', '0', '1'};
+
+/**
+ * @brief Largest image accepted from a file (guards the allocation size)
+ */
+#define GBUFFER_MAX_EDGE 65536
+
+bool gbuffer_create(GBuffer *gbuffer, int width, int height) {
+    size_t pixels = (size_t)width * (size_t)height;
+    gbuffer->width = width;
+    gbuffer->height = height;
+    gbuffer->position = malloc(pixels * sizeof(Vec3));
+    gbuffer->normal = malloc(pixels * sizeof(Vec3));
+    gbuffer->albedo = malloc(pixels * sizeof(Color));
+    gbuffer->depth = malloc(pixels * sizeof(float));
+    gbuffer->object = malloc(pixels * sizeof(int32_t));
+    gbuffer->background = color_black();
+    if (!gbuffer->position || !gbuffer->normal || !gbuffer->albedo || !gbuffer->depth ||
+        !gbuffer->object) {
+        gbuffer_destroy(gbuffer);
+        return false;
+    }
+    for (size_t i = 0; i < pixels; i++) {
+        gbuffer_store(gbuffer, i, NULL);
+    }
+    return true;
+}
+
+void gbuffer_destroy(GBuffer *gbuffer) {
+    free(gbuffer->position);
+    free(gbuffer->normal);
+    free(gbuffer->albedo);
+    free(gbuffer->depth);
+    free(gbuffer->object);
+    memset(gbuffer, 0, sizeof(*gbuffer));
+}
+
+void gbuffer_store(GBuffer *gbuffer, size_t index, const HitRecord *rec) {
+    if (!rec) {
+        gbuffer->position[index] = vec3_zero();
+        gbuffer->normal[index] = vec3_zero();
+        gbuffer->albedo[index] = color_black();
+        gbuffer->depth[index] = INFINITY;
+        gbuffer->object[index] = -1;
+        return;
+    }
+    gbuffer->position[index] = rec->point;
+    gbuffer->normal[index] = rec->normal;
+    gbuffer->albedo[index] = rec->albedo;
+    gbuffer->depth[index] = rec->t;
+    gbuffer->object[index] = rec->object_index;
+}
+
+bool gbuffer_hit(const GBuffer *gbuffer, size_t index, HitRecord *rec) {
+    if (gbuffer->object[index] < 0) {
+        return false;
+    }
+    rec->point = gbuffer->position[index];
+    rec->normal = gbuffer->normal[index];
+    rec->albedo = gbuffer->albedo[index];
+    rec->t = gbuffer->depth[index];
+    rec->front_face = true;
+    rec->object_index = gbuffer->object[index];
+    return true;
+}
+
+bool gbuffer_save(const GBuffer *gbuffer, const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    size_t pixels = (size_t)gbuffer->width * (size_t)gbuffer->height;
+    int32_t size[2] = {gbuffer->width, gbuffer->height};
+    float background[3] = {gbuffer->background.x, gbuffer->background.y,
+                           gbuffer->background.z};
+    bool ok = fwrite(gbuffer_magic, sizeof(gbuffer_magic), 1, file) == 1 &&
+              fwrite(size, sizeof(size), 1, file) == 1 &&
+              fwrite(background, sizeof(background), 1, file) == 1 &&
+              fwrite(gbuffer->position, sizeof(Vec3), pixels, file) == pixels &&
+              fwrite(gbuffer->normal, sizeof(Vec3), pixels, file) == pixels &&
+              fwrite(gbuffer->albedo, sizeof(Color), pixels, file) == pixels &&
+              fwrite(gbuffer->depth, sizeof(float), pixels, file) == pixels &&
+              fwrite(gbuffer->object, sizeof(int32_t), pixels, file) == pixels;
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        remove(path);
+    }
+    return ok;
+}
+
+bool gbuffer_load(GBuffer *gbuffer, const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    char magic[sizeof(gbuffer_magic)];
+    int32_t size[2];
+    float background[3];
+    if (fread(magic, sizeof(magic), 1, file) != 1 ||
+        memcmp(magic, gbuffer_magic, sizeof(magic)) != 0 ||
+        fread(size, sizeof(size), 1, file) != 1 ||
+        fread(background, sizeof(background), 1, file) != 1 || size[0] <= 0 || size[1] <= 0 ||
+        size[0] > GBUFFER_MAX_EDGE || size[1] > GBUFFER_MAX_EDGE ||
+        !gbuffer_create(gbuffer, size[0], size[1])) {
+        fclose(file);
+        return false;
+    }
+    gbuffer->background = color_create(background[0], background[1], background[2]);
+    size_t pixels = (size_t)size[0] * (size_t)size[1];
+    bool ok = fread(gbuffer->position, sizeof(Vec3), pixels, file) == pixels &&
+              fread(gbuffer->normal, sizeof(Vec3), pixels, file) == pixels &&
+              fread(gbuffer->albedo, sizeof(Color), pixels, file) == pixels &&
+              fread(gbuffer->depth, sizeof(float), pixels, file) == pixels &&
+              fread(gbuffer->object, sizeof(int32_t), pixels, file) == pixels;
+    fclose(file);
+    if (!ok) {
+        gbuffer_destroy(gbuffer);
+    }
+    return ok;
+}
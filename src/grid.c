@@ -0,0 +1,302 @@
+/**
+ * @file grid.c
+ * @brief Uniform grid acceleration structure implementation
+ */
+
+#include "grid.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define GRID_MAX_RES 512
+#define GRID_MAX_CELLS (1 << 26)
+#define GRID_MAILBOX_SIZE 64
+
+static int clamp_int(int v, int lo, int hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static void grid_cell_range(const Grid *grid, AABB box, int lo[3], int hi[3]) {
+    Vec3 a = vec3_sub(box.min, grid->bounds.min);
+    Vec3 b = vec3_sub(box.max, grid->bounds.min);
+    lo[0] = clamp_int((int)floorf(a.x * grid->inv_cell_size.x), 0, grid->res[0] - 1);
+    lo[1] = clamp_int((int)floorf(a.y * grid->inv_cell_size.y), 0, grid->res[1] - 1);
+    lo[2] = clamp_int((int)floorf(a.z * grid->inv_cell_size.z), 0, grid->res[2] - 1);
+    hi[0] = clamp_int((int)floorf(b.x * grid->inv_cell_size.x), 0, grid->res[0] - 1);
+    hi[1] = clamp_int((int)floorf(b.y * grid->inv_cell_size.y), 0, grid->res[1] - 1);
+    hi[2] = clamp_int((int)floorf(b.z * grid->inv_cell_size.z), 0, grid->res[2] - 1);
+}
+
+bool grid_build(Grid *grid, const Hittable *objects, int count, float cells_per_object) {
+    grid->cell_start = NULL;
+    grid->cell_items = NULL;
+    grid->objects = NULL;
+    grid->object_count = 0;
+    grid->bounds = aabb_empty();
+    grid->res[0] = grid->res[1] = grid->res[2] = 0;
+
+    if (count <= 0) {
+        return true;
+    }
+    if (cells_per_object <= 0.0f) {
+        cells_per_object = GRID_DEFAULT_CELLS_PER_OBJECT;
+    }
+
+    AABB *boxes = malloc((size_t)count * sizeof(AABB));
+    grid->objects = malloc((size_t)count * sizeof(Hittable));
+    if (!boxes || !grid->objects) {
+        free(boxes);
+        grid_destroy(grid);
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!hittable_bounds(&objects[i], &boxes[i])) {
+            free(boxes);
+            grid_destroy(grid);
+            return false;
+        }
+        grid->bounds = aabb_union(grid->bounds, boxes[i]);
+        grid->objects[i] = objects[i];
+    }
+    grid->object_count = count;
+
+    // Keep flat distributions from producing a zero-volume grid
+    Vec3 extent = aabb_extent(grid->bounds);
+    float max_extent = fmaxf(extent.x, fmaxf(extent.y, extent.z));
+    float min_extent = fmaxf(max_extent * 1e-3f, 1e-6f);
+    Vec3 pad = vec3_create(fmaxf(min_extent - extent.x, 0.0f) * 0.5f,
+                           fmaxf(min_extent - extent.y, 0.0f) * 0.5f,
+                           fmaxf(min_extent - extent.z, 0.0f) * 0.5f);
+    grid->bounds.min = vec3_sub(grid->bounds.min, pad);
+    grid->bounds.max = vec3_add(grid->bounds.max, pad);
+    extent = aabb_extent(grid->bounds);
+
+    // Cells per unit length such that the total cell count is cells_per_object * count
+    float volume = extent.x * extent.y * extent.z;
+    float cells = fminf(cells_per_object * (float)count, (float)GRID_MAX_CELLS);
+    float k = cbrtf(cells / volume);
+    grid->res[0] = clamp_int((int)lroundf(extent.x * k), 1, GRID_MAX_RES);
+    grid->res[1] = clamp_int((int)lroundf(extent.y * k), 1, GRID_MAX_RES);
+    grid->res[2] = clamp_int((int)lroundf(extent.z * k), 1, GRID_MAX_RES);
+    grid->cell_size = vec3_create(extent.x / grid->res[0], extent.y / grid->res[1],
+                                  extent.z / grid->res[2]);
+    grid->inv_cell_size = vec3_create(1.0f / grid->cell_size.x, 1.0f / grid->cell_size.y,
+                                      1.0f / grid->cell_size.z);
+
+    // Two passes over the objects: count references per cell, then scatter them (CSR layout)
+    size_t cell_count = (size_t)grid->res[0] * grid->res[1] * grid->res[2];
+    grid->cell_start = calloc(cell_count + 1, sizeof(uint32_t));
+    if (!grid->cell_start) {
+        free(boxes);
+        grid_destroy(grid);
+        return false;
+    }
+
+    int lo[3], hi[3];
+    for (int i = 0; i < count; i++) {
+        grid_cell_range(grid, boxes[i], lo, hi);
+        for (int z = lo[2]; z <= hi[2]; z++) {
+            for (int y = lo[1]; y <= hi[1]; y++) {
+                for (int x = lo[0]; x <= hi[0]; x++) {
+                    size_t cell = ((size_t)z * grid->res[1] + y) * grid->res[0] + x;
+                    grid->cell_start[cell + 1]++;
+                }
+            }
+        }
+    }
+    // Objects spanning many cells can push the total past the 32-bit offsets
+    for (size_t c = 0; c < cell_count; c++) {
+        if (grid->cell_start[c + 1] > UINT32_MAX - grid->cell_start[c]) {
+            free(boxes);
+            grid_destroy(grid);
+            return false;
+        }
+        grid->cell_start[c + 1] += grid->cell_start[c];
+    }
+
+    uint32_t *fill = malloc(cell_count * sizeof(uint32_t));
+    grid->cell_items = malloc(((size_t)grid->cell_start[cell_count] + 1) * sizeof(uint32_t));
+    if (!fill || !grid->cell_items) {
+        free(fill);
+        free(boxes);
+        grid_destroy(grid);
+        return false;
+    }
+    for (size_t c = 0; c < cell_count; c++) {
+        fill[c] = grid->cell_start[c];
+    }
+    for (int i = 0; i < count; i++) {
+        grid_cell_range(grid, boxes[i], lo, hi);
+        for (int z = lo[2]; z <= hi[2]; z++) {
+            for (int y = lo[1]; y <= hi[1]; y++) {
+                for (int x = lo[0]; x <= hi[0]; x++) {
+                    size_t cell = ((size_t)z * grid->res[1] + y) * grid->res[0] + x;
+                    grid->cell_items[fill[cell]++] = (uint32_t)i;
+                }
+            }
+        }
+    }
+
+    free(fill);
+    free(boxes);
+    return true;
+}
+
+void grid_destroy(Grid *grid) {
+    free(grid->cell_start);
+    free(grid->cell_items);
+    free(grid->objects);
+    grid->cell_start = NULL;
+    grid->cell_items = NULL;
+    grid->objects = NULL;
+    grid->object_count = 0;
+}
+
+/**
+ * @brief Walk the grid's cells for the closest hit below t_max, or any hit
+ * @param skip Object the caller has already tested (-1: none)
+ * @param hit_rec Output hit record, left unchanged without a hit
+ * @param hit_index Output object of the hit, left unchanged without a hit
+ */
+static bool grid_traverse(const Grid *grid, const Ray *ray, float t_min, float t_max,
+                          bool any_hit, int skip, HitRecord *hit_rec, int *hit_index) {
+    Vec3 inv_dir = aabb_inverse_direction(ray);
+    float t_enter, t_exit;
+    if (!aabb_hit(&grid->bounds, ray, inv_dir, t_min, t_max, &t_enter, &t_exit)) {
+        return false;
+    }
+
+    // Set up the 3D-DDA (Amanatides & Woo) from the entry point
+    Vec3 entry = vec3_sub(ray_at(ray, t_enter), grid->bounds.min);
+    float origin[3] = {ray->origin.x, ray->origin.y, ray->origin.z};
+    float dir[3] = {ray->direction.x, ray->direction.y, ray->direction.z};
+    float inv[3] = {inv_dir.x, inv_dir.y, inv_dir.z};
+    float local[3] = {entry.x, entry.y, entry.z};
+    float size[3] = {grid->cell_size.x, grid->cell_size.y, grid->cell_size.z};
+    float inv_size[3] = {grid->inv_cell_size.x, grid->inv_cell_size.y, grid->inv_cell_size.z};
+    float grid_min[3] = {grid->bounds.min.x, grid->bounds.min.y, grid->bounds.min.z};
+
+    int cell[3], step[3], out[3];
+    float t_next[3], t_delta[3];
+    for (int a = 0; a < 3; a++) {
+        cell[a] = clamp_int((int)floorf(local[a] * inv_size[a]), 0, grid->res[a] - 1);
+        if (dir[a] > 0.0f) {
+            step[a] = 1;
+            out[a] = grid->res[a];
+            t_next[a] = (grid_min[a] + (cell[a] + 1) * size[a] - origin[a]) * inv[a];
+            t_delta[a] = size[a] * inv[a];
+        } else if (dir[a] < 0.0f) {
+            step[a] = -1;
+            out[a] = -1;
+            t_next[a] = (grid_min[a] + cell[a] * size[a] - origin[a]) * inv[a];
+            t_delta[a] = -size[a] * inv[a];
+        } else {
+            step[a] = 0;
+            out[a] = -1;
+            t_next[a] = INFINITY;
+            t_delta[a] = INFINITY;
+        }
+    }
+
+    // Objects spanning several cells are tested once per ray (mailboxing)
+    int mailbox[GRID_MAILBOX_SIZE];
+    for (int i = 0; i < GRID_MAILBOX_SIZE; i++) {
+        mailbox[i] = -1;
+    }
+
+    HitRecord temp_rec;
+    bool hit_anything = false;
+    float closest_so_far = t_max;
+
+    for (;;) {
+        size_t c = ((size_t)cell[2] * grid->res[1] + cell[1]) * grid->res[0] + cell[0];
+        for (uint32_t k = grid->cell_start[c]; k < grid->cell_start[c + 1]; k++) {
+            int id = (int)grid->cell_items[k];
+            int slot = id & (GRID_MAILBOX_SIZE - 1);
+            if (mailbox[slot] == id) {
+                continue;
+            }
+            mailbox[slot] = id;
+            if (id != skip &&
+                hittable_hit(&grid->objects[id], ray, t_min, closest_so_far, &temp_rec)) {
+                hit_anything = true;
+                closest_so_far = temp_rec.t;
+                *hit_rec = temp_rec;
+                *hit_index = id;
+                if (any_hit) {
+                    return true;
+                }
+            }
+        }
+
+        int axis = 0;
+        if (t_next[1] < t_next[axis]) {
+            axis = 1;
+        }
+        if (t_next[2] < t_next[axis]) {
+            axis = 2;
+        }
+        float cell_exit = t_next[axis];
+
+        // A hit inside the current cell cannot be beaten by any later cell
+        if (hit_anything && closest_so_far <= cell_exit) {
+            break;
+        }
+        if (cell_exit > t_exit || cell_exit > closest_so_far) {
+            break;
+        }
+        cell[axis] += step[axis];
+        if (cell[axis] == out[axis]) {
+            break;
+        }
+        t_next[axis] += t_delta[axis];
+    }
+
+    return hit_anything;
+}
+
+bool grid_hit(const Hittable *hittable, const Ray *ray, float t_min, float t_max,
+              HitRecord *hit_rec) {
+    const Grid *grid = (const Grid *)hittable->data;
+    int hit_index;
+    return grid->object_count > 0 &&
+           grid_traverse(grid, ray, t_min, t_max, false, -1, hit_rec, &hit_index);
+}
+
+bool grid_hit_hinted(const Hittable *hittable, const Ray *ray, float t_min, float t_max,
+                     bool any_hit, HitHint *hint, HitRecord *hit_rec) {
+    const Grid *grid = (const Grid *)hittable->data;
+    int *last = any_hit ? &hint->last_occluder : &hint->last_hit;
+    int cached = *last < grid->object_count ? *last : -1;
+    hint->answered = false;
+    if (grid->object_count == 0) {
+        return false;
+    }
+    bool hit = cached >= 0 && hittable_hit(&grid->objects[cached], ray, t_min, t_max, hit_rec);
+    if (hit && any_hit) {
+        hint->answered = true;
+        return true;
+    }
+    int hit_index = cached;
+    float closest = hit ? hit_rec->t : t_max;
+    hit = grid_traverse(grid, ray, t_min, closest, any_hit, cached, hit_rec, &hit_index) || hit;
+    if (hit) {
+        hint->answered = hit_index == cached;
+        *last = hit_index;
+    }
+    return hit;
+}
+
+bool grid_bounds(const Hittable *hittable, AABB *box) {
+    const Grid *grid = (const Grid *)hittable->data;
+    if (grid->object_count == 0) {
+        return false;
+    }
+    *box = grid->bounds;
+    return true;
+}
+
+Hittable grid_to_hittable(Grid *grid) {
+    Hittable hittable = hittable_create_bounded(grid, grid_hit, grid_bounds);
+    hittable.hinted_hit_func = grid_hit_hinted;
+    return hittable;
+}
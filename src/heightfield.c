@@ -0,0 +1,284 @@
+/**
+ * @file heightfield.c
+ * @brief Heightfield terrain implementation
+ */
+
+#include "heightfield.h"
+#include "aabb.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define HEIGHTFIELD_STACK_SIZE 128
+#define EPSILON 1e-8f
+
+/**
+ * @brief Pending quadtree node during traversal (level -1 is a single cell)
+ */
+typedef struct {
+    int level;
+    int i;
+    int j;
+} NodeRef;
+
+static float heightfield_at(const Heightfield *hf, int x, int z) {
+    return hf->heights[(size_t)z * hf->width + x];
+}
+
+bool heightfield_build(Heightfield *hf, float *heights, int width, int depth,
+                       Vec3 origin, float extent_x, float extent_z, Color color) {
+    hf->heights = heights;
+    hf->level_count = 0;
+    if (width < 2 || depth < 2 || !heights) {
+        heightfield_destroy(hf);
+        return false;
+    }
+
+    hf->width = width;
+    hf->depth = depth;
+    hf->origin = origin;
+    hf->spacing_x = extent_x / (float)(width - 1);
+    hf->spacing_z = extent_z / (float)(depth - 1);
+    hf->color = color;
+
+    // Level 0: one node per 2x2 block of cells (3x3 samples)
+    int cols = width - 1;
+    int rows = depth - 1;
+    int lw = (cols + 1) / 2;
+    int ld = (rows + 1) / 2;
+    for (int level = 0; level < HEIGHTFIELD_MAX_LEVELS; level++) {
+        HeightRange *nodes = malloc((size_t)lw * ld * sizeof(HeightRange));
+        if (!nodes) {
+            heightfield_destroy(hf);
+            return false;
+        }
+        hf->levels[level] = nodes;
+        hf->level_width[level] = lw;
+        hf->level_depth[level] = ld;
+        hf->level_count = level + 1;
+
+        for (int j = 0; j < ld; j++) {
+            for (int i = 0; i < lw; i++) {
+                HeightRange range = {INFINITY, -INFINITY};
+                if (level == 0) {
+                    int x1 = 2 * i + 2 < width - 1 ? 2 * i + 2 : width - 1;
+                    int z1 = 2 * j + 2 < depth - 1 ? 2 * j + 2 : depth - 1;
+                    for (int z = 2 * j; z <= z1; z++) {
+                        for (int x = 2 * i; x <= x1; x++) {
+                            float h = heightfield_at(hf, x, z);
+                            range.min = fminf(range.min, h);
+                            range.max = fmaxf(range.max, h);
+                        }
+                    }
+                } else {
+                    const HeightRange *below = hf->levels[level - 1];
+                    int bw = hf->level_width[level - 1];
+                    int bd = hf->level_depth[level - 1];
+                    for (int dz = 0; dz < 2; dz++) {
+                        for (int dx = 0; dx < 2; dx++) {
+                            int ci = 2 * i + dx;
+                            int cj = 2 * j + dz;
+                            if (ci < bw && cj < bd) {
+                                HeightRange child = below[(size_t)cj * bw + ci];
+                                range.min = fminf(range.min, child.min);
+                                range.max = fmaxf(range.max, child.max);
+                            }
+                        }
+                    }
+                }
+                nodes[(size_t)j * lw + i] = range;
+            }
+        }
+
+        if (lw == 1 && ld == 1) {
+            break;
+        }
+        lw = (lw + 1) / 2;
+        ld = (ld + 1) / 2;
+    }
+
+    return true;
+}
+
+void heightfield_destroy(Heightfield *hf) {
+    for (int level = 0; level < hf->level_count; level++) {
+        free(hf->levels[level]);
+    }
+    hf->level_count = 0;
+    free(hf->heights);
+    hf->heights = NULL;
+}
+
+/**
+ * @brief World-space box of a quadtree node or cell
+ */
+static AABB heightfield_node_box(const Heightfield *hf, NodeRef node) {
+    int cells = 1 << (node.level + 1);
+    int x0 = node.i * cells;
+    int z0 = node.j * cells;
+    int x1 = x0 + cells < hf->width - 1 ? x0 + cells : hf->width - 1;
+    int z1 = z0 + cells < hf->depth - 1 ? z0 + cells : hf->depth - 1;
+
+    HeightRange range;
+    if (node.level < 0) {
+        float h00 = heightfield_at(hf, x0, z0);
+        float h10 = heightfield_at(hf, x1, z0);
+        float h01 = heightfield_at(hf, x0, z1);
+        float h11 = heightfield_at(hf, x1, z1);
+        range.min = fminf(fminf(h00, h10), fminf(h01, h11));
+        range.max = fmaxf(fmaxf(h00, h10), fmaxf(h01, h11));
+    } else {
+        range = hf->levels[node.level][(size_t)node.j * hf->level_width[node.level] + node.i];
+    }
+
+    return aabb_create(vec3_create(hf->origin.x + x0 * hf->spacing_x, hf->origin.y + range.min,
+                                   hf->origin.z + z0 * hf->spacing_z),
+                       vec3_create(hf->origin.x + x1 * hf->spacing_x, hf->origin.y + range.max,
+                                   hf->origin.z + z1 * hf->spacing_z));
+}
+
+/**
+ * @brief Moller-Trumbore ray-triangle test
+ */
+static bool triangle_hit(const Ray *ray, Vec3 p0, Vec3 p1, Vec3 p2, float t_min, float t_max,
+                         float *t_out) {
+    Vec3 e1 = vec3_sub(p1, p0);
+    Vec3 e2 = vec3_sub(p2, p0);
+    Vec3 pvec = vec3_cross(ray->direction, e2);
+    float det = vec3_dot(e1, pvec);
+    if (fabsf(det) < EPSILON) {
+        return false;
+    }
+    float inv_det = 1.0f / det;
+    Vec3 tvec = vec3_sub(ray->origin, p0);
+    float u = vec3_dot(tvec, pvec) * inv_det;
+    if (u < 0.0f || u > 1.0f) {
+        return false;
+    }
+    Vec3 qvec = vec3_cross(tvec, e1);
+    float v = vec3_dot(ray->direction, qvec) * inv_det;
+    if (v < 0.0f || u + v > 1.0f) {
+        return false;
+    }
+    float t = vec3_dot(e2, qvec) * inv_det;
+    if (t < t_min || t > t_max) {
+        return false;
+    }
+    *t_out = t;
+    return true;
+}
+
+/**
+ * @brief Intersect the two triangles of cell (x, z)
+ */
+static bool heightfield_cell_hit(const Heightfield *hf, int x, int z, const Ray *ray,
+                                 float t_min, float t_max, float *t_out, Vec3 *normal) {
+    float x0 = hf->origin.x + x * hf->spacing_x;
+    float x1 = x0 + hf->spacing_x;
+    float z0 = hf->origin.z + z * hf->spacing_z;
+    float z1 = z0 + hf->spacing_z;
+    Vec3 p00 = vec3_create(x0, hf->origin.y + heightfield_at(hf, x, z), z0);
+    Vec3 p10 = vec3_create(x1, hf->origin.y + heightfield_at(hf, x + 1, z), z0);
+    Vec3 p01 = vec3_create(x0, hf->origin.y + heightfield_at(hf, x, z + 1), z1);
+    Vec3 p11 = vec3_create(x1, hf->origin.y + heightfield_at(hf, x + 1, z + 1), z1);
+
+    bool hit = false;
+    float t;
+    // Winding chosen so that cross(e1, e2) points up (+y)
+    if (triangle_hit(ray, p00, p01, p11, t_min, t_max, &t)) {
+        hit = true;
+        t_max = t;
+        *t_out = t;
+        *normal = vec3_cross(vec3_sub(p01, p00), vec3_sub(p11, p00));
+    }
+    if (triangle_hit(ray, p00, p11, p10, t_min, t_max, &t)) {
+        hit = true;
+        *t_out = t;
+        *normal = vec3_cross(vec3_sub(p11, p00), vec3_sub(p10, p00));
+    }
+    return hit;
+}
+
+bool heightfield_hit(const Hittable *hittable, const Ray *ray,
+                     float t_min, float t_max, HitRecord *hit_rec) {
+    const Heightfield *hf = (const Heightfield *)hittable->data;
+    if (hf->level_count == 0) {
+        return false;
+    }
+
+    Vec3 inv_dir = aabb_inverse_direction(ray);
+
+    // Children are pushed far-to-near so the nearest one is popped first
+    int flip_x = ray->direction.x < 0.0f;
+    int flip_z = ray->direction.z < 0.0f;
+
+    NodeRef stack[HEIGHTFIELD_STACK_SIZE];
+    int stack_size = 0;
+    stack[stack_size++] = (NodeRef){hf->level_count - 1, 0, 0};
+
+    bool hit_anything = false;
+    float closest_so_far = t_max;
+    Vec3 hit_normal = vec3_unit_y();
+
+    while (stack_size > 0) {
+        NodeRef node = stack[--stack_size];
+        AABB box = heightfield_node_box(hf, node);
+        if (!aabb_hit(&box, ray, inv_dir, t_min, closest_so_far, NULL, NULL)) {
+            continue;
+        }
+
+        if (node.level < 0) {
+            float t;
+            Vec3 normal;
+            if (heightfield_cell_hit(hf, node.i, node.j, ray, t_min, closest_so_far, &t,
+                                     &normal)) {
+                hit_anything = true;
+                closest_so_far = t;
+                hit_normal = normal;
+            }
+            continue;
+        }
+
+        // Children are nodes of the level below, or cells below level 0
+        int child_level = node.level - 1;
+        int child_w = child_level < 0 ? hf->width - 1 : hf->level_width[child_level];
+        int child_d = child_level < 0 ? hf->depth - 1 : hf->level_depth[child_level];
+        for (int k = 3; k >= 0; k--) {
+            int ci = 2 * node.i + ((k & 1) ^ flip_x);
+            int cj = 2 * node.j + (((k >> 1) & 1) ^ flip_z);
+            if (ci < child_w && cj < child_d && stack_size < HEIGHTFIELD_STACK_SIZE) {
+                stack[stack_size++] = (NodeRef){child_level, ci, cj};
+            }
+        }
+    }
+
+    if (!hit_anything) {
+        return false;
+    }
+
+    hit_rec->t = closest_so_far;
+    hit_rec->point = ray_at(ray, closest_so_far);
+    hit_record_set_face_normal(hit_rec, ray, vec3_normalize(hit_normal));
+    hit_rec->albedo = hf->color;
+    return true;
+}
+
+bool heightfield_bounds(const Hittable *hittable, AABB *box) {
+    const Heightfield *hf = (const Heightfield *)hittable->data;
+    if (hf->level_count == 0) {
+        return false;
+    }
+    *box = heightfield_node_box(hf, (NodeRef){hf->level_count - 1, 0, 0});
+    return true;
+}
+
+Hittable heightfield_to_hittable(Heightfield *hf) {
+    return hittable_create_bounded(hf, heightfield_hit, heightfield_bounds);
+}
+
+size_t heightfield_memory_bytes(const Heightfield *hf) {
+    size_t bytes = (size_t)hf->width * hf->depth * sizeof(float);
+    for (int level = 0; level < hf->level_count; level++) {
+        bytes += (size_t)hf->level_width[level] * hf->level_depth[level] * sizeof(HeightRange);
+    }
+    return bytes;
+}
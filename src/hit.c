@@ -12,14 +12,57 @@ Hittable hittable_create(void *data, HitFunction hit_func) {
     Hittable obj;
     obj.data = data;
     obj.hit_func = hit_func;
+    obj.bounds_func = NULL;
+    obj.hinted_hit_func = NULL;
+    obj.move_func = NULL;
     return obj;
 }
 
+Hittable hittable_create_bounded(void *data, HitFunction hit_func, BoundsFunction bounds_func) {
+    Hittable obj = hittable_create(data, hit_func);
+    obj.bounds_func = bounds_func;
+    return obj;
+}
+
+bool hittable_bounds(const Hittable *object, AABB *box) {
+    if (!object->bounds_func) {
+        return false;
+    }
+    return object->bounds_func(object, box);
+}
+
+bool hittable_move(const Hittable *object, Vec3 offset) {
+    if (!object->move_func) {
+        return false;
+    }
+    object->move_func(object, offset);
+    return true;
+}
+
 bool hittable_hit(const Hittable *object, const Ray *ray, 
                   float t_min, float t_max, HitRecord *hit_rec) {
     return object->hit_func(object, ray, t_min, t_max, hit_rec);
 }
 
+bool hittable_hit_hinted(const Hittable *object, const Ray *ray, float t_min, float t_max,
+                         bool any_hit, HitHint *hint, HitRecord *hit_rec) {
+    if (object->hinted_hit_func) {
+        return object->hinted_hit_func(object, ray, t_min, t_max, any_hit, hint, hit_rec);
+    }
+    bool hit = object->hit_func(object, ray, t_min, t_max, hit_rec);
+    int *last = any_hit ? &hint->last_occluder : &hint->last_hit;
+    hint->answered = hit && *last == 0;
+    if (hit) {
+        *last = 0;
+    }
+    return hit;
+}
+
+HitHint hittable_hint_init(void) {
+    HitHint hint = {-1, -1, false};
+    return hint;
+}
+
 void hit_record_set_face_normal(HitRecord *hit_rec, const Ray *ray, Vec3 outward_normal) {
     hit_rec->front_face = vec3_dot(ray->direction, outward_normal) < 0.0f;
     hit_rec->normal = hit_rec->front_face ? outward_normal : vec3_negate(outward_normal);
@@ -0,0 +1,875 @@
+/**
+ * @file image_encoder.c
+ * @brief Streaming band-by-band image encoders (PPM, QOI, PNG, PFM, EXR)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "image_encoder.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/**
+ * @brief Pixels encoded per sink reservation on the serial stage
+ */
+#define ENCODE_CHUNK_PIXELS 4096
+
+/**
+ * @brief Longest P3 pixel: "255 255 255\n"
+ */
+#define P3_MAX_PIXEL_BYTES 12
+
+/**
+ * @brief Longest QOI pixel (QOI_OP_RGB)
+ */
+#define QOI_MAX_PIXEL_BYTES 4
+
+/**
+ * @brief QOI opcodes
+ */
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF 0x40
+#define QOI_OP_LUMA 0x80
+#define QOI_OP_RUN 0xC0
+#define QOI_OP_RGB 0xFE
+#define QOI_MAX_RUN 62
+
+/**
+ * @brief PNG chunk framing: length, type and CRC
+ */
+#define PNG_CHUNK_OVERHEAD 12
+
+/**
+ * @brief OpenEXR constants
+ */
+#define EXR_MAGIC 20000630
+#define EXR_PIXEL_HALF 1
+#define EXR_PIXEL_FLOAT 2
+#define EXR_COMPRESSION_RLE 1
+#define EXR_CHUNK_HEADER 8
+#define EXR_MIN_RUN 3
+#define EXR_MAX_RUN 127
+
+ImageFormat image_format_from_path(const char *path) {
+    const char *dot = strrchr(path, '.');
+    if (dot && strcasecmp(dot, ".qoi") == 0) {
+        return IMAGE_FORMAT_QOI;
+    }
+    if (dot && strcasecmp(dot, ".png") == 0) {
+        return IMAGE_FORMAT_PNG;
+    }
+    if (dot && strcasecmp(dot, ".pfm") == 0) {
+        return IMAGE_FORMAT_PFM;
+    }
+    if (dot && strcasecmp(dot, ".exr") == 0) {
+        return IMAGE_FORMAT_EXR;
+    }
+    return IMAGE_FORMAT_PPM;
+}
+
+const char *image_format_name(ImageFormat format) {
+    switch (format) {
+        case IMAGE_FORMAT_QOI:
+            return "QOI";
+        case IMAGE_FORMAT_PNG:
+            return "PNG";
+        case IMAGE_FORMAT_PFM:
+            return "PFM";
+        case IMAGE_FORMAT_EXR:
+            return "EXR";
+        default:
+            return "PPM";
+    }
+}
+
+bool image_format_is_float(ImageFormat format) {
+    return format == IMAGE_FORMAT_PFM || format == IMAGE_FORMAT_EXR;
+}
+
+size_t image_format_pixel_bytes(ImageFormat format) {
+    return image_format_is_float(format) ? sizeof(Color) : 3;
+}
+
+ImageSpec image_spec_rgb(ImageFormat format, bool half_float, int width, int height) {
+    ImageSpec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.format = format;
+    spec.half_float = half_float;
+    spec.width = width;
+    spec.height = height;
+    spec.channel_count = 3;
+    spec.channel_names[0] = "R";
+    spec.channel_names[1] = "G";
+    spec.channel_names[2] = "B";
+    return spec;
+}
+
+size_t image_spec_pixel_bytes(const ImageSpec *spec) {
+    return image_format_is_float(spec->format) ? (size_t)spec->channel_count * sizeof(float)
+                                               : 3;
+}
+
+static int band_rows(const ImageEncoder *encoder, int band) {
+    int first = band * encoder->band_height;
+    return encoder->height - first < encoder->band_height ? encoder->height - first
+                                                           : encoder->band_height;
+}
+
+static void store_be32(uint8_t *out, uint32_t value) {
+    out[0] = (uint8_t)(value >> 24);
+    out[1] = (uint8_t)(value >> 16);
+    out[2] = (uint8_t)(value >> 8);
+    out[3] = (uint8_t)value;
+}
+
+static void store_le32(uint8_t *out, uint32_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+}
+
+static bool host_is_little_endian(void) {
+    uint16_t probe = 1;
+    uint8_t first;
+    memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+// ---------------------------------------------------------------------------
+// PPM (P3)
+// ---------------------------------------------------------------------------
+
+/**
+ * @brief Decimal text of one byte value
+ */
+typedef struct {
+    char text[3];    ///< Digits (not terminated)
+    uint8_t length;  ///< Number of digits
+} DecimalByte;
+
+static DecimalByte decimal_table[256];
+static pthread_once_t decimal_table_once = PTHREAD_ONCE_INIT;
+
+static void decimal_table_init(void) {
+    for (int v = 0; v < 256; v++) {
+        char buffer[4];
+        int length = snprintf(buffer, sizeof(buffer), "%d", v);
+        memcpy(decimal_table[v].text, buffer, (size_t)length);
+        decimal_table[v].length = (uint8_t)length;
+    }
+}
+
+/**
+ * @brief Encode RGB8 pixels as P3 text ("r g b\n" per pixel)
+ * @return Bytes written
+ */
+static size_t encode_p3(const uint8_t *rgb, int count, uint8_t *out) {
+    uint8_t *p = out;
+    for (int i = 0; i < count; i++) {
+        for (int c = 0; c < 3; c++) {
+            const DecimalByte *d = &decimal_table[rgb[3 * i + c]];
+            memcpy(p, d->text, 3);
+            p += d->length;
+            *p++ = c < 2 ? ' ' : '\n';
+        }
+    }
+    return (size_t)(p - out);
+}
+
+// ---------------------------------------------------------------------------
+// QOI
+// ---------------------------------------------------------------------------
+
+static inline int qoi_hash(uint32_t pixel) {
+    uint32_t r = pixel >> 16, g = (pixel >> 8) & 0xFFu, b = pixel & 0xFFu;
+    return (int)((r * 3 + g * 5 + b * 7 + 255 * 11) % 64);
+}
+
+/**
+ * @brief Encode RGB8 pixels, continuing the encoder's QOI stream
+ * @return Bytes written
+ */
+static size_t encode_qoi(ImageEncoder *encoder, const uint8_t *rgb, int count, uint8_t *out) {
+    uint8_t *p = out;
+    uint32_t previous = encoder->qoi_previous;
+    int run = encoder->qoi_run;
+    for (int i = 0; i < count; i++, rgb += 3) {
+        uint32_t pixel = (uint32_t)rgb[0] << 16 | (uint32_t)rgb[1] << 8 | rgb[2];
+        if (pixel == previous) {
+            if (++run == QOI_MAX_RUN) {
+                *p++ = (uint8_t)(QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0) {
+            *p++ = (uint8_t)(QOI_OP_RUN | (run - 1));
+            run = 0;
+        }
+        int index = qoi_hash(pixel);
+        if (encoder->qoi_index[index] == pixel) {
+            *p++ = (uint8_t)(QOI_OP_INDEX | index);
+        } else {
+            encoder->qoi_index[index] = pixel;
+            int dr = (int8_t)(rgb[0] - (uint8_t)(previous >> 16));
+            int dg = (int8_t)(rgb[1] - (uint8_t)(previous >> 8));
+            int db = (int8_t)(rgb[2] - (uint8_t)previous);
+            int dr_dg = dr - dg;
+            int db_dg = db - dg;
+            if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                *p++ = (uint8_t)(QOI_OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+            } else if (dr_dg >= -8 && dr_dg <= 7 && dg >= -32 && dg <= 31 && db_dg >= -8 &&
+                       db_dg <= 7) {
+                *p++ = (uint8_t)(QOI_OP_LUMA | (dg + 32));
+                *p++ = (uint8_t)((dr_dg + 8) << 4 | (db_dg + 8));
+            } else {
+                *p++ = QOI_OP_RGB;
+                *p++ = rgb[0];
+                *p++ = rgb[1];
+                *p++ = rgb[2];
+            }
+        }
+        previous = pixel;
+    }
+    encoder->qoi_previous = previous;
+    encoder->qoi_run = run;
+    return (size_t)(p - out);
+}
+
+// ---------------------------------------------------------------------------
+// PNG
+// ---------------------------------------------------------------------------
+
+static inline int paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    int ab = pb < pa ? b : a;
+    return pc < (pa < pb ? pa : pb) ? c : ab;
+}
+
+/**
+ * @brief Apply one PNG filter to a scanline (above may be NULL for None/Sub)
+ */
+static void png_apply_filter(int filter, const uint8_t *row, const uint8_t *above, int bytes,
+                             uint8_t *dst) {
+    switch (filter) {
+        case 0:
+            memcpy(dst, row, (size_t)bytes);
+            break;
+        case 1:
+            for (int i = 0; i < bytes; i++) {
+                dst[i] = (uint8_t)(row[i] - (i >= 3 ? row[i - 3] : 0));
+            }
+            break;
+        case 2:
+            for (int i = 0; i < bytes; i++) {
+                dst[i] = (uint8_t)(row[i] - above[i]);
+            }
+            break;
+        case 3:
+            for (int i = 0; i < bytes; i++) {
+                int a = i >= 3 ? row[i - 3] : 0;
+                dst[i] = (uint8_t)(row[i] - ((a + above[i]) >> 1));
+            }
+            break;
+        default:
+            for (int i = 0; i < 3 && i < bytes; i++) {
+                dst[i] = (uint8_t)(row[i] - above[i]);
+            }
+            for (int i = 3; i < bytes; i++) {
+                dst[i] = (uint8_t)(row[i] - paeth(row[i - 3], above[i], above[i - 3]));
+            }
+            break;
+    }
+}
+
+/**
+ * @brief Sum of absolute residuals, the usual cheap estimate of compressibility
+ */
+static uint32_t png_filter_cost(const uint8_t *filtered, int bytes) {
+    uint32_t cost = 0;
+    for (int i = 0; i < bytes; i++) {
+        cost += (uint32_t)abs((int8_t)filtered[i]);
+    }
+    return cost;
+}
+
+/**
+ * @brief Filter one scanline with the filter of least absolute residual
+ * @param row Pixels of the row (RGB8)
+ * @param above Row above, or NULL for the first row of a band (only None/Sub are
+ *        allowed there, since the previous band is compressed independently)
+ * @param bytes Bytes in the row
+ * @param trial Scratch space of bytes bytes
+ * @param out Filter type byte followed by the filtered row
+ */
+static void png_filter_row(const uint8_t *row, const uint8_t *above, int bytes, uint8_t *trial,
+                           uint8_t *out) {
+    // Keep the best candidate in out, try the others in trial
+    int best = 0;
+    png_apply_filter(0, row, above, bytes, out + 1);
+    uint32_t best_cost = png_filter_cost(out + 1, bytes);
+    int candidates = above ? 5 : 2;
+    for (int filter = 1; filter < candidates; filter++) {
+        png_apply_filter(filter, row, above, bytes, trial);
+        uint32_t cost = png_filter_cost(trial, bytes);
+        if (cost < best_cost) {
+            best_cost = cost;
+            best = filter;
+            memcpy(out + 1, trial, (size_t)bytes);
+        }
+    }
+    out[0] = (uint8_t)best;
+}
+
+static void png_write_chunk(FileSink *sink, const char *type, const uint8_t *data,
+                            uint32_t size) {
+    uint8_t header[8];
+    store_be32(header, size);
+    memcpy(header + 4, type, 4);
+    uint32_t crc = crc32_update(crc32_update(0, header + 4, 4), data, size);
+    uint8_t footer[4];
+    store_be32(footer, crc);
+    file_sink_write(sink, header, sizeof(header));
+    file_sink_write(sink, data, size);
+    file_sink_write(sink, footer, sizeof(footer));
+}
+
+static void png_prepare_band(ImageEncoder *encoder, int slot_index, int band,
+                             const uint8_t *rgb) {
+    ImageEncoderSlot *slot = &encoder->slots[slot_index];
+    int rows = band_rows(encoder, band);
+    int row_bytes = encoder->width * 3;
+    size_t line = (size_t)row_bytes + 1;
+    for (int r = 0; r < rows; r++) {
+        const uint8_t *row = rgb + (size_t)r * row_bytes;
+        png_filter_row(row, r > 0 ? row - row_bytes : NULL, row_bytes, slot->trial,
+                       slot->filtered + (size_t)r * line);
+    }
+    slot->raw_size = (uint64_t)rows * line;
+    slot->adler = adler32_update(1, slot->filtered, (size_t)slot->raw_size);
+
+    uint8_t *chunk = slot->chunk;
+    size_t compressed = deflate_compress_chunk(slot->scratch, slot->filtered,
+                                               (size_t)slot->raw_size,
+                                               band == encoder->band_count - 1, chunk + 8);
+    store_be32(chunk, (uint32_t)compressed);
+    memcpy(chunk + 4, "IDAT", 4);
+    store_be32(chunk + 8 + compressed, crc32_update(0, chunk + 4, compressed + 4));
+    slot->chunk_size = compressed + PNG_CHUNK_OVERHEAD;
+}
+
+// ---------------------------------------------------------------------------
+// PFM and OpenEXR
+// ---------------------------------------------------------------------------
+
+/**
+ * @brief Convert to IEEE half precision, rounding to nearest even
+ */
+static uint16_t float_to_half(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t exponent = (bits >> 23) & 0xFFu;
+    uint32_t mantissa = bits & 0x7FFFFFu;
+    if (exponent == 0xFFu) {
+        return (uint16_t)(sign | 0x7C00u | (mantissa ? 0x200u : 0u));   // Inf or NaN
+    }
+    int half_exponent = (int)exponent - 127 + 15;
+    if (half_exponent >= 31) {
+        return (uint16_t)(sign | 0x7C00u);   // Overflow to infinity
+    }
+    if (half_exponent <= 0) {
+        if (half_exponent < -10) {
+            return (uint16_t)sign;   // Underflow to zero
+        }
+        // Denormal: shift the mantissa (with its implicit bit) into place
+        mantissa |= 0x800000u;
+        int shift = 14 - half_exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1u))) {
+            half++;
+        }
+        return (uint16_t)(sign | half);
+    }
+    uint32_t half = sign | (uint32_t)half_exponent << 10 | mantissa >> 13;
+    uint32_t remainder = mantissa & 0x1FFFu;
+    // A carry out of the mantissa correctly bumps the exponent
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))) {
+        half++;
+    }
+    return (uint16_t)half;
+}
+
+static size_t exr_row_bytes(const ImageEncoder *encoder) {
+    return (size_t)encoder->width * (size_t)encoder->channel_count *
+           (encoder->half_float ? 2 : 4);
+}
+
+/**
+ * @brief Largest chunk (header plus data) of one EXR row
+ */
+static size_t exr_max_chunk_bytes(const ImageEncoder *encoder) {
+    size_t raw = exr_row_bytes(encoder);
+    return EXR_CHUNK_HEADER + raw + raw / EXR_MAX_RUN + 2;
+}
+
+/**
+ * @brief Convert a row to planar little-endian channels in name order (B, G, R for RGB)
+ */
+static void exr_pack_row(const ImageEncoder *encoder, const float *row, uint8_t *out) {
+    int width = encoder->width;
+    int stride = encoder->channel_count;
+    for (int channel = 0; channel < encoder->channel_count; channel++) {
+        const float *in = row + encoder->exr_channels[channel];
+        for (int x = 0; x < width; x++) {
+            float value = in[(size_t)x * (size_t)stride];
+            if (encoder->half_float) {
+                uint16_t half = float_to_half(value);
+                out[0] = (uint8_t)half;
+                out[1] = (uint8_t)(half >> 8);
+                out += 2;
+            } else {
+                uint32_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                store_le32(out, bits);
+                out += 4;
+            }
+        }
+    }
+}
+
+/**
+ * @brief OpenEXR RLE: byte split, delta predictor, then run-length coding
+ * @param in Row data
+ * @param size Bytes in the row
+ * @param temp Scratch of size bytes
+ * @param out Output of at least size + size / 127 + 2 bytes
+ * @return Compressed size
+ */
+static size_t exr_rle_compress(const uint8_t *in, size_t size, uint8_t *temp, uint8_t *out) {
+    // Even bytes to the first half, odd bytes to the second
+    size_t half = (size + 1) / 2;
+    for (size_t i = 0; i < size; i++) {
+        temp[(i & 1) ? half + i / 2 : i / 2] = in[i];
+    }
+    for (size_t i = size - 1; i > 0; i--) {
+        temp[i] = (uint8_t)(temp[i] - temp[i - 1] + 128);
+    }
+
+    const uint8_t *end = temp + size;
+    const uint8_t *run_start = temp;
+    const uint8_t *run_end = temp + 1;
+    uint8_t *p = out;
+    while (run_start < end) {
+        while (run_end < end && *run_start == *run_end && run_end - run_start - 1 < EXR_MAX_RUN) {
+            run_end++;
+        }
+        if (run_end - run_start >= EXR_MIN_RUN) {
+            *p++ = (uint8_t)((run_end - run_start) - 1);
+            *p++ = *run_start;
+            run_start = run_end;
+        } else {
+            while (run_end < end &&
+                   ((run_end + 1 >= end || run_end[0] != run_end[1]) ||
+                    (run_end + 2 >= end || run_end[1] != run_end[2])) &&
+                   run_end - run_start < EXR_MAX_RUN) {
+                run_end++;
+            }
+            *p++ = (uint8_t)(run_start - run_end);
+            while (run_start < run_end) {
+                *p++ = *run_start++;
+            }
+        }
+        run_end++;
+    }
+    return (size_t)(p - out);
+}
+
+static void exr_prepare_band(ImageEncoder *encoder, int slot_index, int band,
+                             const float *pixels) {
+    ImageEncoderSlot *slot = &encoder->slots[slot_index];
+    int rows = band_rows(encoder, band);
+    size_t raw = exr_row_bytes(encoder);
+    uint8_t *out = slot->chunk;
+    for (int r = 0; r < rows; r++) {
+        exr_pack_row(encoder, pixels + (size_t)r * encoder->width * encoder->channel_count,
+                     slot->trial);
+        uint8_t *data = out + EXR_CHUNK_HEADER;
+        size_t size = exr_rle_compress(slot->trial, raw, slot->filtered, data);
+        if (size >= raw) {
+            // Readers take a chunk of the uncompressed size as stored
+            memcpy(data, slot->trial, raw);
+            size = raw;
+        }
+        store_le32(out, (uint32_t)(band * encoder->band_height + r));
+        store_le32(out + 4, (uint32_t)size);
+        slot->row_chunk_bytes[r] = (uint32_t)(EXR_CHUNK_HEADER + size);
+        out += EXR_CHUNK_HEADER + size;
+    }
+    slot->chunk_size = (size_t)(out - slot->chunk);
+}
+
+/**
+ * @brief Append one header attribute
+ */
+static uint8_t *exr_attribute(uint8_t *p, const char *name, const char *type, const void *value,
+                              uint32_t size) {
+    size_t name_length = strlen(name) + 1;
+    size_t type_length = strlen(type) + 1;
+    memcpy(p, name, name_length);
+    p += name_length;
+    memcpy(p, type, type_length);
+    p += type_length;
+    store_le32(p, size);
+    p += 4;
+    memcpy(p, value, size);
+    return p + size;
+}
+
+static void exr_write_header(ImageEncoder *encoder, FileSink *sink) {
+    uint8_t header[512 + IMAGE_MAX_CHANNELS * (IMAGE_MAX_CHANNEL_NAME + 17)];
+    uint8_t *p = header;
+    store_le32(p, EXR_MAGIC);
+    store_le32(p + 4, 2);   // Version 2, single-part scanline
+    p += 8;
+
+    uint8_t channels[IMAGE_MAX_CHANNELS * (IMAGE_MAX_CHANNEL_NAME + 17) + 1];
+    uint8_t *c = channels;
+    for (int i = 0; i < encoder->channel_count; i++) {
+        const char *name = encoder->channel_names[encoder->exr_channels[i]];
+        size_t length = strlen(name) + 1;
+        memcpy(c, name, length);
+        c += length;
+        store_le32(c, encoder->half_float ? EXR_PIXEL_HALF : EXR_PIXEL_FLOAT);
+        c[4] = 0;   // pLinear
+        c[5] = c[6] = c[7] = 0;
+        store_le32(c + 8, 1);   // x sampling
+        store_le32(c + 12, 1);  // y sampling
+        c += 16;
+    }
+    *c++ = 0;
+    p = exr_attribute(p, "channels", "chlist", channels, (uint32_t)(c - channels));
+
+    uint8_t compression = EXR_COMPRESSION_RLE;
+    p = exr_attribute(p, "compression", "compression", &compression, 1);
+    uint8_t window[16];
+    store_le32(window, 0);
+    store_le32(window + 4, 0);
+    store_le32(window + 8, (uint32_t)(encoder->width - 1));
+    store_le32(window + 12, (uint32_t)(encoder->height - 1));
+    p = exr_attribute(p, "dataWindow", "box2i", window, sizeof(window));
+    p = exr_attribute(p, "displayWindow", "box2i", window, sizeof(window));
+    uint8_t line_order = 0;   // Increasing y
+    p = exr_attribute(p, "lineOrder", "lineOrder", &line_order, 1);
+    float one = 1.0f;
+    uint32_t one_bits;
+    memcpy(&one_bits, &one, sizeof(one_bits));
+    uint8_t float_value[4];
+    store_le32(float_value, one_bits);
+    p = exr_attribute(p, "pixelAspectRatio", "float", float_value, 4);
+    uint8_t center[8] = {0};
+    p = exr_attribute(p, "screenWindowCenter", "v2f", center, sizeof(center));
+    p = exr_attribute(p, "screenWindowWidth", "float", float_value, 4);
+    *p++ = 0;
+    file_sink_write(sink, header, (size_t)(p - header));
+
+    // Leave room for the offset table; it is filled in by image_encoder_end
+    encoder->data_offset = file_sink_position(sink);
+    file_sink_seek(sink, encoder->data_offset + 8 * (int64_t)encoder->height);
+}
+
+static void exr_write_offsets(ImageEncoder *encoder, FileSink *sink) {
+    file_sink_seek(sink, encoder->data_offset);
+    for (int y = 0; y < encoder->height; y += ENCODE_CHUNK_PIXELS) {
+        int count = encoder->height - y < ENCODE_CHUNK_PIXELS ? encoder->height - y
+                                                               : ENCODE_CHUNK_PIXELS;
+        uint8_t *out = file_sink_reserve(sink, (size_t)count * 8);
+        if (!out) {
+            return;
+        }
+        for (int i = 0; i < count; i++) {
+            uint64_t offset = encoder->exr_offsets[y + i];
+            store_le32(out + 8 * i, (uint32_t)offset);
+            store_le32(out + 8 * i + 4, (uint32_t)(offset >> 32));
+        }
+        file_sink_commit(sink, (size_t)count * 8);
+    }
+}
+
+/**
+ * @brief Write a band of a PFM file, whose rows run bottom to top
+ * The band's rows form one contiguous range of the file, written in reverse.
+ */
+static void pfm_write_band(const ImageEncoder *encoder, FileSink *sink, int band,
+                           const float *pixels) {
+    int rows = band_rows(encoder, band);
+    int first = band * encoder->band_height;
+    size_t row_floats = (size_t)encoder->width * (size_t)encoder->channel_count;
+    size_t row_bytes = row_floats * sizeof(float);
+    file_sink_seek(sink, encoder->data_offset +
+                             (int64_t)(encoder->height - first - rows) * (int64_t)row_bytes);
+    for (int r = rows - 1; r >= 0; r--) {
+        file_sink_write(sink, pixels + (size_t)r * row_floats, row_bytes);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Common interface
+// ---------------------------------------------------------------------------
+
+/**
+ * @brief Allocate the EXR offset table and per-slot row buffers
+ */
+static bool exr_init(ImageEncoder *encoder) {
+    size_t raw = exr_row_bytes(encoder);
+    size_t chunk = (size_t)encoder->band_height * exr_max_chunk_bytes(encoder);
+    encoder->exr_offsets = calloc((size_t)encoder->height, sizeof(uint64_t));
+    encoder->slots = calloc((size_t)encoder->slot_count, sizeof(ImageEncoderSlot));
+    if (!encoder->exr_offsets || !encoder->slots) {
+        image_encoder_destroy(encoder);
+        return false;
+    }
+    for (int s = 0; s < encoder->slot_count; s++) {
+        ImageEncoderSlot *slot = &encoder->slots[s];
+        slot->trial = malloc(raw);
+        slot->filtered = malloc(raw);
+        slot->chunk = malloc(chunk);
+        slot->row_chunk_bytes = malloc((size_t)encoder->band_height * sizeof(uint32_t));
+        if (!slot->trial || !slot->filtered || !slot->chunk || !slot->row_chunk_bytes) {
+            image_encoder_destroy(encoder);
+            return false;
+        }
+    }
+    encoder->memory_bytes = (size_t)encoder->height * sizeof(uint64_t) +
+                            (size_t)encoder->slot_count * (2 * raw + chunk);
+    return true;
+}
+
+/**
+ * @brief Check a channel layout and sort EXR channels by name, as the format requires
+ */
+static bool init_channels(ImageEncoder *encoder, const ImageSpec *spec) {
+    int count = spec->channel_count;
+    encoder->channel_count = count;
+    if (!image_format_is_float(spec->format)) {
+        return count == 3;
+    }
+    if (spec->format == IMAGE_FORMAT_PFM) {
+        return count == 1 || count == 3;
+    }
+    if (count < 1 || count > IMAGE_MAX_CHANNELS) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        const char *name = spec->channel_names[i];
+        if (!name || name[0] == '\0' || strlen(name) > IMAGE_MAX_CHANNEL_NAME) {
+            return false;
+        }
+        encoder->channel_names[i] = name;
+        // Insertion sort; equal names are invalid
+        int j = i;
+        for (; j > 0; j--) {
+            int order = strcmp(spec->channel_names[encoder->exr_channels[j - 1]], name);
+            if (order == 0) {
+                return false;
+            }
+            if (order < 0) {
+                break;
+            }
+            encoder->exr_channels[j] = encoder->exr_channels[j - 1];
+        }
+        encoder->exr_channels[j] = i;
+    }
+    return true;
+}
+
+bool image_encoder_init(ImageEncoder *encoder, const ImageSpec *spec, int band_height,
+                        int slot_count) {
+    ImageFormat format = spec->format;
+    int width = spec->width;
+    int height = spec->height;
+    memset(encoder, 0, sizeof(*encoder));
+    encoder->format = format;
+    encoder->half_float = spec->half_float && format == IMAGE_FORMAT_EXR;
+    encoder->width = width;
+    encoder->height = height;
+    if (!init_channels(encoder, spec)) {
+        return false;
+    }
+    encoder->band_height = band_height < height ? band_height : height;
+    encoder->band_count = (height + encoder->band_height - 1) / encoder->band_height;
+    encoder->slot_count = slot_count;
+    pthread_once(&decimal_table_once, decimal_table_init);
+
+    if (format == IMAGE_FORMAT_QOI) {
+        // Matches the implicit initial pixel of the format (black, opaque)
+        encoder->qoi_previous = 0;
+        for (int i = 0; i < 64; i++) {
+            encoder->qoi_index[i] = UINT32_MAX;
+        }
+    }
+    if (format == IMAGE_FORMAT_EXR) {
+        return exr_init(encoder);
+    }
+    if (format != IMAGE_FORMAT_PNG) {
+        return true;
+    }
+
+    encoder->png_adler = 1;
+    encoder->slots = calloc((size_t)slot_count, sizeof(ImageEncoderSlot));
+    if (!encoder->slots) {
+        return false;
+    }
+    size_t raw = (size_t)encoder->band_height * ((size_t)width * 3 + 1);
+    size_t chunk = deflate_bound(raw) + PNG_CHUNK_OVERHEAD;
+    for (int s = 0; s < slot_count; s++) {
+        ImageEncoderSlot *slot = &encoder->slots[s];
+        slot->filtered = malloc(raw);
+        slot->trial = malloc((size_t)width * 3);
+        slot->chunk = malloc(chunk);
+        slot->scratch = malloc(sizeof(DeflateScratch));
+        if (!slot->filtered || !slot->trial || !slot->chunk || !slot->scratch) {
+            image_encoder_destroy(encoder);
+            return false;
+        }
+    }
+    encoder->memory_bytes =
+        (size_t)slot_count * (raw + (size_t)width * 3 + chunk + sizeof(DeflateScratch));
+    return true;
+}
+
+void image_encoder_destroy(ImageEncoder *encoder) {
+    if (encoder->slots) {
+        for (int s = 0; s < encoder->slot_count; s++) {
+            free(encoder->slots[s].filtered);
+            free(encoder->slots[s].trial);
+            free(encoder->slots[s].chunk);
+            free(encoder->slots[s].row_chunk_bytes);
+            free(encoder->slots[s].scratch);
+        }
+        free(encoder->slots);
+        encoder->slots = NULL;
+    }
+    free(encoder->exr_offsets);
+    encoder->exr_offsets = NULL;
+    encoder->memory_bytes = 0;
+}
+
+void image_encoder_begin(ImageEncoder *encoder, FileSink *sink) {
+    if (encoder->format == IMAGE_FORMAT_PPM) {
+        char header[64];
+        int length = snprintf(header, sizeof(header), "P3\n%d %d\n255\n", encoder->width,
+                              encoder->height);
+        file_sink_write(sink, header, (size_t)length);
+    } else if (encoder->format == IMAGE_FORMAT_QOI) {
+        uint8_t header[14];
+        memcpy(header, "qoif", 4);
+        store_be32(header + 4, (uint32_t)encoder->width);
+        store_be32(header + 8, (uint32_t)encoder->height);
+        header[12] = 3;   // RGB
+        header[13] = 0;   // sRGB
+        file_sink_write(sink, header, sizeof(header));
+    } else if (encoder->format == IMAGE_FORMAT_PFM) {
+        // A negative scale marks little-endian data; pixels are written as stored in memory
+        char header[64];
+        int length = snprintf(header, sizeof(header), "%s\n%d %d\n%s\n",
+                              encoder->channel_count == 1 ? "Pf" : "PF", encoder->width,
+                              encoder->height, host_is_little_endian() ? "-1.0" : "1.0");
+        file_sink_write(sink, header, (size_t)length);
+        encoder->data_offset = file_sink_position(sink);
+    } else if (encoder->format == IMAGE_FORMAT_EXR) {
+        exr_write_header(encoder, sink);
+    } else {
+        static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+        file_sink_write(sink, signature, sizeof(signature));
+        uint8_t ihdr[13];
+        store_be32(ihdr, (uint32_t)encoder->width);
+        store_be32(ihdr + 4, (uint32_t)encoder->height);
+        ihdr[8] = 8;    // Bit depth
+        ihdr[9] = 2;    // Truecolor
+        ihdr[10] = 0;   // Deflate
+        ihdr[11] = 0;   // Adaptive filtering
+        ihdr[12] = 0;   // No interlace
+        png_write_chunk(sink, "IHDR", ihdr, sizeof(ihdr));
+        // zlib header (32 KB window, no dictionary); band chunks follow as more IDATs
+        static const uint8_t zlib_header[2] = {0x78, 0x01};
+        png_write_chunk(sink, "IDAT", zlib_header, sizeof(zlib_header));
+    }
+}
+
+void image_encoder_prepare_band(ImageEncoder *encoder, int slot, int band, const void *pixels) {
+    if (encoder->format == IMAGE_FORMAT_PNG) {
+        png_prepare_band(encoder, slot, band, pixels);
+    } else if (encoder->format == IMAGE_FORMAT_EXR) {
+        exr_prepare_band(encoder, slot, band, pixels);
+    }
+}
+
+void image_encoder_write_band(ImageEncoder *encoder, FileSink *sink, int slot, int band,
+                              const void *pixels) {
+    if (encoder->format == IMAGE_FORMAT_PNG) {
+        const ImageEncoderSlot *prepared = &encoder->slots[slot];
+        file_sink_write(sink, prepared->chunk, prepared->chunk_size);
+        encoder->png_adler = adler32_combine(encoder->png_adler, prepared->adler,
+                                             prepared->raw_size);
+        return;
+    }
+    if (encoder->format == IMAGE_FORMAT_EXR) {
+        const ImageEncoderSlot *prepared = &encoder->slots[slot];
+        uint64_t offset = (uint64_t)file_sink_position(sink);
+        int first = band * encoder->band_height;
+        for (int r = 0; r < band_rows(encoder, band); r++) {
+            encoder->exr_offsets[first + r] = offset;
+            offset += prepared->row_chunk_bytes[r];
+        }
+        file_sink_write(sink, prepared->chunk, prepared->chunk_size);
+        return;
+    }
+    if (encoder->format == IMAGE_FORMAT_PFM) {
+        pfm_write_band(encoder, sink, band, pixels);
+        return;
+    }
+
+    const uint8_t *rgb = pixels;
+    bool qoi = encoder->format == IMAGE_FORMAT_QOI;
+    size_t max_pixel_bytes = qoi ? QOI_MAX_PIXEL_BYTES : P3_MAX_PIXEL_BYTES;
+    uint64_t total = (uint64_t)band_rows(encoder, band) * (uint64_t)encoder->width;
+    for (uint64_t done = 0; done < total; done += ENCODE_CHUNK_PIXELS) {
+        int count = total - done < ENCODE_CHUNK_PIXELS ? (int)(total - done)
+                                                       : ENCODE_CHUNK_PIXELS;
+        uint8_t *out = file_sink_reserve(sink, (size_t)count * max_pixel_bytes);
+        if (out) {
+            const uint8_t *in = &rgb[3 * done];
+            file_sink_commit(sink, qoi ? encode_qoi(encoder, in, count, out)
+                                       : encode_p3(in, count, out));
+        }
+    }
+}
+
+void image_encoder_end(ImageEncoder *encoder, FileSink *sink) {
+    if (encoder->format == IMAGE_FORMAT_QOI) {
+        uint8_t trailer[9];
+        size_t length = 0;
+        if (encoder->qoi_run > 0) {
+            trailer[length++] = (uint8_t)(QOI_OP_RUN | (encoder->qoi_run - 1));
+            encoder->qoi_run = 0;
+        }
+        static const uint8_t end_marker[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+        memcpy(trailer + length, end_marker, sizeof(end_marker));
+        file_sink_write(sink, trailer, length + sizeof(end_marker));
+    } else if (encoder->format == IMAGE_FORMAT_PNG) {
+        uint8_t adler[4];
+        store_be32(adler, encoder->png_adler);
+        png_write_chunk(sink, "IDAT", adler, sizeof(adler));
+        png_write_chunk(sink, "IEND", NULL, 0);
+    } else if (encoder->format == IMAGE_FORMAT_EXR) {
+        exr_write_offsets(encoder, sink);
+    }
+}
@@ -0,0 +1,270 @@
+/**
+ * @file integrator.c
+ * @brief Direct shading and iterative path tracing
+ */
+
+#include "integrator.h"
+#include <math.h>
+#include <string.h>
+
+#define EPSILON 0.001f
+#define PI_F 3.14159265358979323846f
+
+/**
+ * @brief Highest survival probability of Russian roulette
+ * Keeps bright paths (white walls, mirrors) from bouncing forever.
+ */
+#define ROULETTE_MAX_SURVIVAL 0.95f
+
+IntegratorSettings integrator_default_settings(void) {
+    IntegratorSettings settings;
+    settings.type = INTEGRATOR_DIRECT;
+    settings.max_bounces = INTEGRATOR_DEFAULT_MAX_BOUNCES;
+    settings.roulette_bounces = INTEGRATOR_DEFAULT_ROULETTE_BOUNCES;
+    settings.light_samples = 0;
+    return settings;
+}
+
+bool integrator_parse_type(const char *name, IntegratorType *type) {
+    if (strcmp(name, "direct") == 0) {
+        *type = INTEGRATOR_DIRECT;
+    } else if (strcmp(name, "path") == 0) {
+        *type = INTEGRATOR_PATH;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char *integrator_type_name(IntegratorType type) {
+    return type == INTEGRATOR_PATH ? "path" : "direct";
+}
+
+/**
+ * @brief Random number for one dimension of a path
+ */
+static float path_sample(const PathSample *sample, uint32_t dimension) {
+    return sampler_get(sample->sampler, sample->x, sample->y, sample->index, dimension);
+}
+
+/**
+ * @brief Light one point light delivers to a diffuse surface
+ * @param shadows Hit cache of the shadow ray (NULL: no shadow ray, as in
+ *                the direct integrator)
+ * @return color * intensity * cos(theta) * attenuation, or black if occluded
+ */
+static Color light_contribution(const Scene *scene, const PointLight *light,
+                                const HitRecord *rec, SceneHitCache *shadows) {
+    Vec3 to_light = vec3_sub(light->position, rec->point);
+    float distance_squared = vec3_length_squared(to_light);
+    float distance = sqrtf(distance_squared);
+    if (distance <= EPSILON || !point_light_reaches(light, distance_squared)) {
+        return color_black();
+    }
+    Vec3 direction = vec3_scale(to_light, 1.0f / distance);
+    float cosine = vec3_dot(rec->normal, direction);
+    if (cosine <= 0.0f) {
+        return color_black();
+    }
+    if (shadows) {
+        Ray shadow = {rec->point, direction};
+        if (scene_occluded(scene, &shadow, EPSILON, distance - EPSILON, shadows)) {
+            return color_black();
+        }
+    }
+    float attenuation = point_light_attenuation(light, distance_squared);
+    return color_scale(light->color, light->intensity * cosine * attenuation);
+}
+
+/**
+ * @brief Light from the point lights reaching a diffuse surface
+ * Sums every light, or estimates the sum from light_samples picks from the
+ * light tree, each taking one sampler dimension from dimension on.
+ */
+static Color direct_light(const Scene *scene, const IntegratorSettings *settings,
+                          const PathSample *sample, uint32_t dimension, const HitRecord *rec,
+                          SceneHitCache *shadows) {
+    Color total = color_black();
+    if (settings->light_samples <= 0 || scene->light_tree.node_count == 0) {
+        for (int i = 0; i < scene->light_count; i++) {
+            total = color_add(total, light_contribution(scene, &scene->lights[i], rec, shadows));
+        }
+        return total;
+    }
+    for (int k = 0; k < settings->light_samples; k++) {
+        float pdf;
+        int index = light_tree_sample(&scene->light_tree, rec->point, rec->normal,
+                                      path_sample(sample, dimension + (uint32_t)k), &pdf);
+        if (index >= 0) {
+            Color light = light_contribution(scene, &scene->lights[index], rec, shadows);
+            total = color_add(total, color_scale(light, 1.0f / pdf));
+        }
+    }
+    return color_scale(total, 1.0f / (float)settings->light_samples);
+}
+
+/**
+ * @brief First sampler dimension of a path vertex
+ */
+static uint32_t vertex_dimension(const IntegratorSettings *settings, int bounce) {
+    uint32_t light_samples = settings->light_samples > 0 ? (uint32_t)settings->light_samples : 0;
+    return INTEGRATOR_FIRST_DIMENSION +
+           (uint32_t)bounce * (INTEGRATOR_DIMENSIONS_PER_BOUNCE + light_samples);
+}
+
+/**
+ * @brief Cosine-weighted direction around a unit normal
+ * Builds the tangent frame without branches (Duff et al. 2017).
+ */
+static Vec3 cosine_direction(Vec3 n, float u1, float u2) {
+    float sign = copysignf(1.0f, n.z);
+    float a = -1.0f / (sign + n.z);
+    float b = n.x * n.y * a;
+    Vec3 tangent = vec3_create(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+    Vec3 bitangent = vec3_create(b, sign + n.y * n.y * a, -n.y);
+    float r = sqrtf(u1);
+    float phi = 2.0f * PI_F * u2;
+    float z = sqrtf(fmaxf(0.0f, 1.0f - u1));
+    Vec3 direction = vec3_add(vec3_scale(tangent, r * cosf(phi)),
+                              vec3_scale(bitangent, r * sinf(phi)));
+    return vec3_add(direction, vec3_scale(n, z));
+}
+
+/**
+ * @brief Point in the unit ball from three uniform numbers
+ */
+static Vec3 ball_point(float u1, float u2, float u3) {
+    float z = 1.0f - 2.0f * u1;
+    float r = sqrtf(fmaxf(0.0f, 1.0f - z * z));
+    float phi = 2.0f * PI_F * u2;
+    float radius = cbrtf(u3);
+    return vec3_scale(vec3_create(r * cosf(phi), r * sinf(phi), z), radius);
+}
+
+/**
+ * @brief Trace one camera path
+ * Each vertex uses INTEGRATOR_DIMENSIONS_PER_BOUNCE sampler dimensions:
+ * two for the scattered direction, one for Russian roulette and one for
+ * the length of the reflection jitter, then one per light sample.
+ * @param first Known first hit of the ray (NULL: intersect it with primary_objects)
+ */
+static bool trace_path(const Scene *scene, const IntegratorSettings *settings,
+                       const PathSample *sample, const Ray *ray, SceneObjectSet primary_objects,
+                       const HitRecord *first, SceneHitCache *cache, Color *color,
+                       HitRecord *primary) {
+    Color radiance = color_black();
+    Color throughput = color_white();
+    Ray current = *ray;
+    bool hit = false;
+    for (int bounce = 0;; bounce++) {
+        HitRecord rec;
+        SceneObjectSet objects = bounce == 0 ? primary_objects : SCENE_ALL_OBJECTS;
+        if (bounce == 0 && first) {
+            rec = *first;
+        } else if (!scene_hit_objects(scene, &current, EPSILON, INFINITY, objects, cache, &rec)) {
+            radiance = color_add(radiance, color_multiply(throughput, scene->background_color));
+            break;
+        }
+        if (bounce == 0) {
+            *primary = rec;
+            hit = true;
+        }
+        const Material *material = &scene->materials[rec.object_index];
+        uint32_t dimension = vertex_dimension(settings, bounce);
+        if (material->type == MATERIAL_DIFFUSE) {
+            Color light = direct_light(scene, settings, sample,
+                                       dimension + INTEGRATOR_DIMENSIONS_PER_BOUNCE, &rec, cache);
+            light = color_multiply(rec.albedo, light);
+            radiance = color_add(radiance, color_multiply(throughput, light));
+        }
+        if (bounce >= settings->max_bounces) {
+            break;
+        }
+
+        float u1 = path_sample(sample, dimension);
+        float u2 = path_sample(sample, dimension + 1);
+        Vec3 direction;
+        if (material->type == MATERIAL_DIFFUSE) {
+            direction = cosine_direction(rec.normal, u1, u2);
+        } else {
+            direction = vec3_reflect(vec3_normalize(current.direction), rec.normal);
+            if (material->roughness > 0.0f) {
+                Vec3 jitter = ball_point(u1, u2, path_sample(sample, dimension + 3));
+                direction = vec3_add(direction, vec3_scale(jitter, material->roughness));
+            }
+            // Jitter that points into the surface absorbs the path
+            if (vec3_dot(direction, rec.normal) <= 0.0f) {
+                break;
+            }
+        }
+        // Lambertian: the cosine pdf cancels BRDF and cosine, leaving the albedo
+        throughput = color_multiply(throughput, rec.albedo);
+
+        if (bounce + 1 >= settings->roulette_bounces) {
+            float survival = fmaxf(throughput.x, fmaxf(throughput.y, throughput.z));
+            survival = fminf(survival, ROULETTE_MAX_SURVIVAL);
+            if (path_sample(sample, dimension + 2) >= survival) {
+                break;
+            }
+            throughput = color_scale(throughput, 1.0f / survival);
+        }
+        current.origin = rec.point;
+        current.direction = vec3_normalize(direction);
+    }
+    *color = radiance;
+    return hit;
+}
+
+/**
+ * @brief Direct integrator at a camera ray's first hit
+ */
+static Color shade_direct(const Scene *scene, const IntegratorSettings *settings,
+                          const PathSample *sample, const HitRecord *primary) {
+    if (settings->light_samples <= 0 || scene->light_tree.node_count == 0) {
+        // scene_trace from the hit
+        return scene_shade_lambertian(scene, primary, primary->albedo);
+    }
+    // scene_shade_lambertian with sampled instead of summed lights
+    Color light = direct_light(scene, settings, sample, INTEGRATOR_FIRST_DIMENSION, primary, NULL);
+    return color_add(color_scale(primary->albedo, 0.1f), color_multiply(primary->albedo, light));
+}
+
+bool integrator_trace(const Scene *scene, const IntegratorSettings *settings,
+                      const PathSample *sample, const Ray *ray, Color *color,
+                      HitRecord *primary) {
+    SceneHitCache cache;
+    scene_hit_cache_init(&cache);
+    return integrator_trace_objects(scene, settings, sample, ray, SCENE_ALL_OBJECTS, &cache,
+                                    color, primary);
+}
+
+bool integrator_trace_objects(const Scene *scene, const IntegratorSettings *settings,
+                              const PathSample *sample, const Ray *ray,
+                              SceneObjectSet primary_objects, SceneHitCache *cache,
+                              Color *color, HitRecord *primary) {
+    if (settings->type == INTEGRATOR_PATH) {
+        return trace_path(scene, settings, sample, ray, primary_objects, NULL, cache, color,
+                          primary);
+    }
+    if (!scene_hit_objects(scene, ray, EPSILON, INFINITY, primary_objects, cache, primary)) {
+        *color = scene->background_color;
+        return false;
+    }
+    *color = shade_direct(scene, settings, sample, primary);
+    return true;
+}
+
+Color integrator_shade(const Scene *scene, const IntegratorSettings *settings,
+                       const PathSample *sample, const Ray *ray, const HitRecord *primary,
+                       SceneHitCache *cache) {
+    if (!primary) {
+        return scene->background_color;
+    }
+    if (settings->type == INTEGRATOR_DIRECT) {
+        return shade_direct(scene, settings, sample, primary);
+    }
+    Color color;
+    HitRecord first;
+    trace_path(scene, settings, sample, ray, 0, primary, cache, &color, &first);
+    return color;
+}
@@ -0,0 +1,252 @@
+/**
+ * @file light_tree.c
+ * @brief Light hierarchy construction and stochastic traversal
+ */
+
+#include "light_tree.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define LIGHT_TREE_BINS 12
+
+/**
+ * @brief Largest float below 1, to keep rescaled random numbers in [0, 1)
+ */
+#define ONE_MINUS_EPSILON 0x1.fffffep-1f
+
+/**
+ * @brief Per-light build information
+ */
+typedef struct {
+    Vec3 position;
+    float power;          ///< Power for split costs
+    float falloff_squared; ///< falloff_start^2 (0: no falloff)
+    float radius;         ///< Influence radius (INFINITY: unlimited)
+    int index;
+} LightRef;
+
+static float vec3_axis(Vec3 v, int axis) {
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+static int light_tree_build_range(LightTree *tree, LightRef *refs, int start, int end) {
+    int node_index = tree->node_count++;
+    LightTreeNode *node = &tree->nodes[node_index];
+
+    AABB bounds = aabb_empty();
+    node->power = 0.0f;
+    node->falloff_power = 0.0f;
+    node->min_falloff_squared = INFINITY;
+    node->max_radius = 0.0f;
+    for (int i = start; i < end; i++) {
+        bounds = aabb_expand(bounds, refs[i].position);
+        node->max_radius = fmaxf(node->max_radius, refs[i].radius);
+        if (refs[i].falloff_squared > 0.0f) {
+            node->falloff_power += refs[i].power * refs[i].falloff_squared;
+            node->min_falloff_squared = fminf(node->min_falloff_squared,
+                                              refs[i].falloff_squared);
+        } else {
+            node->power += refs[i].power;
+        }
+    }
+    node->bounds = bounds;
+    node->count = end - start;
+    if (node->count == 1) {
+        node->offset = refs[start].index;
+        return node_index;
+    }
+
+    Vec3 extent = aabb_extent(bounds);
+    int axis = 0;
+    if (extent.y > extent.x) {
+        axis = 1;
+    }
+    if (extent.z > vec3_axis(extent, axis)) {
+        axis = 2;
+    }
+    float axis_min = vec3_axis(bounds.min, axis);
+    float axis_extent = vec3_axis(extent, axis);
+
+    // Bin along the widest axis; a split costs the power-weighted area of both halves
+    int mid = start + node->count / 2;
+    if (axis_extent > 0.0f) {
+        float bin_power[LIGHT_TREE_BINS] = {0};
+        int bin_counts[LIGHT_TREE_BINS] = {0};
+        AABB bin_bounds[LIGHT_TREE_BINS];
+        for (int b = 0; b < LIGHT_TREE_BINS; b++) {
+            bin_bounds[b] = aabb_empty();
+        }
+        float scale = LIGHT_TREE_BINS / axis_extent;
+        for (int i = start; i < end; i++) {
+            int b = (int)((vec3_axis(refs[i].position, axis) - axis_min) * scale);
+            b = b < 0 ? 0 : (b >= LIGHT_TREE_BINS ? LIGHT_TREE_BINS - 1 : b);
+            bin_counts[b]++;
+            bin_power[b] += refs[i].power;
+            bin_bounds[b] = aabb_expand(bin_bounds[b], refs[i].position);
+        }
+
+        float best_cost = INFINITY;
+        int best_split = -1;
+        for (int split = 1; split < LIGHT_TREE_BINS; split++) {
+            AABB left = aabb_empty();
+            AABB right = aabb_empty();
+            float left_power = 0.0f;
+            float right_power = 0.0f;
+            int left_count = 0;
+            int right_count = 0;
+            for (int b = 0; b < split; b++) {
+                left = aabb_union(left, bin_bounds[b]);
+                left_power += bin_power[b];
+                left_count += bin_counts[b];
+            }
+            for (int b = split; b < LIGHT_TREE_BINS; b++) {
+                right = aabb_union(right, bin_bounds[b]);
+                right_power += bin_power[b];
+                right_count += bin_counts[b];
+            }
+            if (left_count == 0 || right_count == 0) {
+                continue;
+            }
+            float cost = aabb_surface_area(left) * left_power +
+                         aabb_surface_area(right) * right_power;
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_split = split;
+            }
+        }
+
+        if (best_split > 0) {
+            // Partition refs so that lights in bins below the split come first
+            int i = start;
+            int j = end - 1;
+            while (i <= j) {
+                int b = (int)((vec3_axis(refs[i].position, axis) - axis_min) * scale);
+                b = b < 0 ? 0 : (b >= LIGHT_TREE_BINS ? LIGHT_TREE_BINS - 1 : b);
+                if (b < best_split) {
+                    i++;
+                } else {
+                    LightRef tmp = refs[i];
+                    refs[i] = refs[j];
+                    refs[j] = tmp;
+                    j--;
+                }
+            }
+            if (i > start && i < end) {
+                mid = i;
+            }
+        }
+    }
+
+    light_tree_build_range(tree, refs, start, mid);
+    node->offset = light_tree_build_range(tree, refs, mid, end);
+    return node_index;
+}
+
+bool light_tree_build(LightTree *tree, const PointLight *lights, int count) {
+    tree->nodes = NULL;
+    tree->node_count = 0;
+    if (count <= 0) {
+        return true;
+    }
+
+    LightRef *refs = malloc((size_t)count * sizeof(LightRef));
+    // A binary tree with one light per leaf has 2n - 1 nodes
+    tree->nodes = malloc((size_t)(2 * count - 1) * sizeof(LightTreeNode));
+    if (!refs || !tree->nodes) {
+        free(refs);
+        light_tree_destroy(tree);
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        refs[i].position = lights[i].position;
+        refs[i].power = point_light_power(&lights[i]);
+        refs[i].falloff_squared = lights[i].falloff_start * lights[i].falloff_start;
+        refs[i].radius = lights[i].radius > 0.0f ? lights[i].radius : INFINITY;
+        refs[i].index = i;
+    }
+    light_tree_build_range(tree, refs, 0, count);
+    free(refs);
+    return true;
+}
+
+void light_tree_destroy(LightTree *tree) {
+    free(tree->nodes);
+    tree->nodes = NULL;
+    tree->node_count = 0;
+}
+
+/**
+ * @brief Upper estimate of the light a node delivers to a shading point
+ * The bound is conservative: it is zero only if every light of the node
+ * is behind the surface or out of reach, so no light that can contribute
+ * is ever given probability zero. For a single light it is exact, and so
+ * is the falloff term.
+ */
+static float node_importance(const LightTreeNode *node, Vec3 point, Vec3 normal) {
+    if (node->max_radius < INFINITY) {
+        // Nothing to sample if the point is outside every light's influence radius
+        Vec3 nearest = vec3_create(fminf(fmaxf(point.x, node->bounds.min.x), node->bounds.max.x),
+                                   fminf(fmaxf(point.y, node->bounds.min.y), node->bounds.max.y),
+                                   fminf(fmaxf(point.z, node->bounds.min.z), node->bounds.max.z));
+        if (vec3_length_squared(vec3_sub(nearest, point)) > node->max_radius * node->max_radius) {
+            return 0.0f;
+        }
+    }
+    Vec3 center = aabb_centroid(node->bounds);
+    Vec3 to_center = vec3_sub(center, point);
+    float distance_squared = vec3_length_squared(to_center);
+    // Padded so that rounding never pushes a light outside the bounding sphere
+    float radius = 0.5f * vec3_length(aabb_extent(node->bounds)) * 1.0001f + 1e-6f;
+    float radius_squared = radius * radius;
+
+    float cos_bound = 1.0f;
+    if (distance_squared > radius_squared) {
+        // cos(max(0, theta - theta_u)): theta is the angle to the node centre,
+        // theta_u the half angle of the node's bounding sphere seen from the point
+        float distance = sqrtf(distance_squared);
+        float cos_theta = vec3_dot(normal, to_center) / distance;
+        float sin_u_squared = radius_squared / distance_squared;
+        float cos_u = sqrtf(1.0f - sin_u_squared);
+        if (cos_theta < cos_u) {
+            float sin_theta = sqrtf(fmaxf(0.0f, 1.0f - cos_theta * cos_theta));
+            cos_bound = fmaxf(0.0f, cos_theta * cos_u + sin_theta * sqrtf(sin_u_squared));
+        }
+    }
+    if (node->count > 1) {
+        distance_squared = fmaxf(distance_squared, radius_squared);
+    }
+    float falloff = node->falloff_power /
+                    fmaxf(distance_squared, node->min_falloff_squared);
+    return cos_bound * (node->power + falloff);
+}
+
+int light_tree_sample(const LightTree *tree, Vec3 point, Vec3 normal, float u, float *pdf) {
+    *pdf = 0.0f;
+    if (tree->node_count == 0 || node_importance(&tree->nodes[0], point, normal) <= 0.0f) {
+        return -1;
+    }
+    float probability = 1.0f;
+    int index = 0;
+    while (tree->nodes[index].count > 1) {
+        int first = index + 1;
+        int second = tree->nodes[index].offset;
+        float first_importance = node_importance(&tree->nodes[first], point, normal);
+        float second_importance = node_importance(&tree->nodes[second], point, normal);
+        float total = first_importance + second_importance;
+        if (total <= 0.0f) {
+            return -1;
+        }
+        float p_first = first_importance / total;
+        if (u < p_first) {
+            u = fminf(u / p_first, ONE_MINUS_EPSILON);
+            probability *= p_first;
+            index = first;
+        } else {
+            u = fminf((u - p_first) / (1.0f - p_first), ONE_MINUS_EPSILON);
+            probability *= 1.0f - p_first;
+            index = second;
+        }
+    }
+    *pdf = probability;
+    return tree->nodes[index].offset;
+}
@@ -5,10 +5,13 @@
  * @date June 2025
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <getopt.h>
+#include <signal.h>
 
 // Include all our headers
 #include "vec3.h"
@@ -19,6 +22,13 @@
 #include "sphere.h"
 #include "plane.h"
 #include "scene.h"
+#include "demo_scenes.h"
+#include "render.h"
+#include "preview.h"
+#include "session.h"
+#include "progressive.h"
+#include "relight.h"
+#include "timer.h"
 
 /**
  * @brief Print usage information
@@ -29,76 +39,203 @@ static void print_usage(const char *program_name) {
     printf("\nOptions:\n");
     printf("  -w, --width WIDTH    Image width in pixels (default: 400)\n");
     printf("  -h, --height HEIGHT  Image height in pixels (default: 225)\n");
-    printf("  -o, --output FILE    Output PPM file (default: output.ppm)\n");
+    printf("  -o, --output FILE    Output image by extension: .png .qoi .pfm .exr, else PPM (default: output.ppm)\n");
+    printf("  --scene NAME         Scene to render: demo, particles, terrain, voxels, sdf,\n");
+    printf("                       points, lights\n");
+    printf("                       (default: demo)\n");
+    printf("  --particles N        Number of spheres in the particles/points scenes (default: 100000)\n");
+    printf("  --lights N           Number of point lights in the lights scene (default: 4096)\n");
+    printf("  --accel TYPE         Particle acceleration structure: bvh, grid (default: bvh)\n");
+    printf("  --terrain-size N     Heightfield samples per side in the terrain scene (default: 1024)\n");
+    printf("  --voxel-res N        Voxels per side in the voxels scene (default: 256)\n");
+    printf("  --sdf-steps N        Sphere tracing iteration cap (default: %d)\n",
+           SDF_DEFAULT_MAX_STEPS);
+    printf("  --sdf-relax W        Sphere tracing over-relaxation in [1, 2) (default: %.1f)\n",
+           SDF_DEFAULT_RELAXATION);
+    printf("  --points-file FILE   Raw float32 x,y,z file for the points scene (memory-mapped)\n");
+    printf("  --point-radius R     Shared point radius (default: derived from density)\n");
+    printf("  --threads N          Render threads (default: one per CPU)\n");
+    printf("  --half               Store 16-bit half floats in .exr output\n");
+    printf("  --aov LIST           Also write AOVs from the primary hit to a float .exr:\n");
+    printf("                       depth,normal,id,albedo,cost or all\n");
+    printf("  --aov-output FILE    AOV file (default: output name with .aov.exr)\n");
+    printf("  --shm NAME           Publish tiles live to POSIX shared memory /NAME (see fbview)\n");
+    printf("  --spp N              Progressive: stop after N samples per pixel\n");
+    printf("  --time-budget S      Progressive: stop after S seconds\n");
+    printf("  --target-noise X     Progressive: stop at relative noise X (e.g. 0.01)\n");
+    printf("  --update-interval S  Progressive: rewrite the output every S seconds\n");
+    printf("  --adaptive X         Progressive: stop sampling each tile at relative noise X\n");
+    printf("  --min-spp N          Adaptive: samples per pixel before a tile can stop "
+           "(default: %d)\n", PROGRESSIVE_DEFAULT_MIN_SAMPLES);
+    printf("  --sampler TYPE       Sequence for progressive samples and path bounces: sobol,\n");
+    printf("                       blue-noise, random (default: sobol)\n");
+    printf("  --denoise S          Progressive: denoise the output at strength S (e.g. 1)\n");
+    printf("                       (Ctrl-C or SIGTERM stops a progressive render and saves it)\n");
+    printf("  --preview N          Render at 1/N resolution (2, 4 or 8), upsample it guided\n");
+    printf("                       by full-resolution depth and object ids, and refine it to\n");
+    printf("                       full resolution, rewriting the output at every level\n");
+    printf("  --session            Keep the scene loaded and render a frame after every camera,\n");
+    printf("                       integrator or object command read from stdin (see README)\n");
+    printf("  --integrator TYPE    Light transport: direct, path (default: direct)\n");
+    printf("  --max-bounces N      Path: scattering events after the first hit (default: %d)\n",
+           INTEGRATOR_DEFAULT_MAX_BOUNCES);
+    printf("  --rr-bounces N       Path: bounces before Russian roulette (default: %d)\n",
+           INTEGRATOR_DEFAULT_ROULETTE_BOUNCES);
+    printf("  --light-samples N    Shade with N lights picked from the light tree (default: all)\n");
+    printf("  --cull-lights        Direct shading: give each tile only the lights that reach it\n");
+    printf("  --lights-file FILE   Replace the scene's lights with those in FILE, one per line:\n");
+    printf("                       x y z r g b intensity [falloff_start [radius]]\n");
+    printf("  --save-lights FILE   Write the scene's lights to FILE in that format\n");
+    printf("  --save-gbuffer FILE  Single pass: also save the primary hits to FILE for --relight\n");
+    printf("  --relight FILE       Shade the primary hits saved in FILE with the current lights\n");
+    printf("                       instead of rendering (image size comes from FILE)\n");
+    printf("  --relight-shadows    Relight: trace shadow rays against the scene geometry\n");
+    printf("  --tile-size N        Tile edge and output band height in pixels (default: %d)\n",
+           RENDER_DEFAULT_TILE_SIZE);
+    printf("  --progress MODE      Progress output: bar, quiet, json (default: bar)\n");
+    printf("  --progress-interval S  Seconds between progress reports (default: %.1f)\n",
+           PROGRESS_DEFAULT_INTERVAL);
     printf("  --help               Show this help message\n");
     printf("\nExample:\n");
     printf("  %s -w 800 -h 600 -o render.ppm\n", program_name);
+    printf("  %s --scene particles --particles 500000 --accel grid\n", program_name);
+    printf("  %s --scene lights -o base.png --save-gbuffer shot.gbuf --save-lights shot.lights\n",
+           program_name);
+    printf("  %s --relight shot.gbuf --scene lights --lights-file shot.lights -o relit.png\n",
+           program_name);
 }
 
 /**
- * @brief Create a camera for the demo scene
+ * @brief SIGINT/SIGTERM during a progressive render or preview: stop and keep the image
  */
-static Camera create_demo_camera(int width, int height) {
-    Vec3 camera_pos = vec3_create(0.0f, 0.0f, 0.0f);
-    Vec3 target = vec3_create(0.0f, 0.0f, -1.0f);
-    Vec3 up = vec3_create(0.0f, 1.0f, 0.0f);
-    
-    float aspect_ratio = (float)width / (float)height;
-    float viewport_height = 2.0f;
-    float viewport_width = viewport_height * aspect_ratio;
-    
-    return camera_create_orthographic(camera_pos, target, up,
-                                     viewport_width, viewport_height,
-                                     width, height);
+static void handle_stop_signal(int signal_number) {
+    (void)signal_number;
+    progressive_request_stop();
+    preview_request_stop();
 }
 
 /**
- * @brief Create the demo scene
+ * @brief Route SIGINT and SIGTERM to handle_stop_signal, once (a second signal kills)
  */
-static Scene create_demo_scene(void) {
-    // Create scene with a nice blue sky background
-    Color sky_color = color_create(0.5f, 0.7f, 1.0f);
-    Scene scene = scene_create(sky_color);
-    
-    // Create a red sphere in the center
-    static Sphere sphere = {0};
-    sphere = sphere_create(
-        vec3_create(0.0f, 0.0f, -1.0f),  // center
-        0.5f,                            // radius
-        color_create(0.8f, 0.3f, 0.3f)   // red color
-    );
-    scene_add_object(&scene, sphere_to_hittable(&sphere));
-    
-    // Create a green ground plane
-    Plane ground = plane_create_xz(
-        -0.5f,                           // y position
-        color_create(0.3f, 0.8f, 0.3f)   // green color
-    );
-    scene_add_object(&scene, plane_to_hittable(&ground));
-    
-    // Add a second smaller sphere for interest
-    Sphere small_sphere = sphere_create(
-        vec3_create(-1.0f, 0.0f, -1.0f), // center (to the left)
-        0.3f,                           // smaller radius
-        color_create(0.3f, 0.3f, 0.8f)  // blue color
-    );
-    scene_add_object(&scene, sphere_to_hittable(&small_sphere));
-    
-    // Add a point light above and to the side
-    PointLight light;
-    light.position = vec3_create(1.0f, 1.0f, 0.0f);
-    light.color = color_white();
-    light.intensity = 1.5f;
-    scene_add_light(&scene, light);
-    
-    // Add a second light for softer shadows
-    PointLight light2;
-    light2.position = vec3_create(-0.5f, 1.5f, 0.5f);
-    light2.color = color_create(1.0f, 0.9f, 0.8f); // Slightly warm
-    light2.intensity = 0.8f;
-    scene_add_light(&scene, light2);
-    
-    return scene;
+static void install_stop_handlers(void) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_stop_signal;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+}
+
+/**
+ * @brief Print how often the threads' hit caches answered a query
+ */
+static void print_hit_caches(const RenderStats *stats) {
+    if (stats->hit_queries > 0) {
+        printf("Hit cache: %.1f%% of %llu closest-hit queries found the cached primitive\n",
+               100.0 * (double)stats->hit_cache_hits / (double)stats->hit_queries,
+               (unsigned long long)stats->hit_queries);
+    }
+    if (stats->occlusion_queries > 0) {
+        printf("Occluder cache: %.1f%% of %llu shadow rays blocked by the cached primitive\n",
+               100.0 * (double)stats->occlusion_cache_hits / (double)stats->occlusion_queries,
+               (unsigned long long)stats->occlusion_queries);
+    }
+}
+
+/**
+ * @brief Replace a scene's lights with a light set file, reporting errors
+ */
+static bool load_lights(Scene *scene, const char *path) {
+    int error_line;
+    if (scene_load_lights(scene, path, &error_line)) {
+        return true;
+    }
+    if (error_line > 0) {
+        fprintf(stderr, "Error: %s:%d: expected x y z r g b intensity [falloff_start [radius]]\n",
+                path, error_line);
+    } else {
+        fprintf(stderr, "Error: Could not read lights from '%s'\n", path);
+    }
+    return false;
+}
+
+/**
+ * @brief Relight mode: shade a saved G-buffer with the current lights
+ * The demo scene is only built when its geometry (shadows) or its lights
+ * (no light set file) are needed.
+ */
+static int run_relight(const char *gbuffer_filename, const char *lights_filename,
+                       const char *save_lights_filename, bool shadows,
+                       const DemoSceneOptions *scene_options, const RenderSettings *settings,
+                       const char *output_filename) {
+    GBuffer gbuffer;
+    double load_start = timer_now_seconds();
+    if (!gbuffer_load(&gbuffer, gbuffer_filename)) {
+        fprintf(stderr, "Error: Could not read G-buffer '%s'\n", gbuffer_filename);
+        return 1;
+    }
+    double load_seconds = timer_now_seconds() - load_start;
+
+    DemoScene demo;
+    bool built = shadows || !lights_filename;
+    if (built) {
+        if (!demo_scene_build(&demo, scene_options, gbuffer.width, gbuffer.height)) {
+            fprintf(stderr, "Error: Could not build scene\n");
+            demo_scene_destroy(&demo);
+            gbuffer_destroy(&gbuffer);
+            return 1;
+        }
+    } else {
+        demo.scene = scene_create(gbuffer.background);
+    }
+    int status = 1;
+    FILE *output = NULL;
+    RenderStats stats;
+    if (lights_filename && !load_lights(&demo.scene, lights_filename)) {
+        goto cleanup;
+    }
+    if (save_lights_filename && !scene_save_lights(&demo.scene, save_lights_filename)) {
+        fprintf(stderr, "Error: Could not write lights to '%s'\n", save_lights_filename);
+        goto cleanup;
+    }
+    output = fopen(output_filename, "wb");
+    if (!output) {
+        fprintf(stderr, "Error: Could not open output file '%s'\n", output_filename);
+        goto cleanup;
+    }
+
+    printf("Ray Tracer Demonstration v0.1\n");
+    printf("Relighting %dx%d G-buffer '%s' to '%s'\n", gbuffer.width, gbuffer.height,
+           gbuffer_filename, output_filename);
+    printf("Lights: %d%s\n", demo.scene.light_count,
+           shadows ? ", with shadow rays" : ", unshadowed");
+    if (!relight_render(&gbuffer, &demo.scene, settings, shadows, output, &stats)) {
+        fprintf(stderr, "Error: Relighting failed\n");
+        goto cleanup;
+    }
+    printf("G-buffer load: %.1f ms\n", load_seconds * 1000.0);
+    printf("Relight time: %.1f ms (%d threads), %.1f of %d lights per tile\n",
+           stats.render_seconds * 1000.0, stats.thread_count, stats.lights_per_tile,
+           demo.scene.light_count);
+    print_hit_caches(&stats);
+    printf("Output: %.1f MB %s via %s\n", (double)stats.bytes_written / (1024.0 * 1024.0),
+           image_format_name(settings->output_format), stats.io_backend);
+    printf("Relight complete! Output written to '%s'\n", output_filename);
+    status = 0;
+
+cleanup:
+    if (output && fclose(output) != 0 && status == 0) {
+        fprintf(stderr, "Error: Could not write '%s'\n", output_filename);
+        status = 1;
+    }
+    if (built) {
+        demo_scene_destroy(&demo);
+    } else {
+        scene_destroy(&demo.scene);
+    }
+    gbuffer_destroy(&gbuffer);
+    return status;
 }
 
 /**
@@ -109,12 +246,66 @@ int main(int argc, char *argv[]) {
     int image_width = 400;
     int image_height = 225;
     const char *output_filename = "output.ppm";
+    const char *aov_filename = NULL;
+    char default_aov_filename[4096];
+    char shm_name[256];
+    DemoSceneOptions scene_options = demo_scene_default_options();
+    RenderSettings render_settings = render_default_settings();
+    ProgressiveSettings progressive = progressive_default_settings();
+    bool progressive_mode = false;
+    bool min_spp_given = false;
+    bool sampler_given = false;
+    int preview_factor = 0;
+    bool session_mode = false;
+    const char *lights_filename = NULL;
+    const char *save_lights_filename = NULL;
+    const char *save_gbuffer_filename = NULL;
+    const char *relight_filename = NULL;
+    bool relight_shadows = false;
     
     // Command line option structure
     static struct option long_options[] = {
         {"width",  required_argument, 0, 'w'},
         {"height", required_argument, 0, 'h'},
         {"output", required_argument, 0, 'o'},
+        {"scene",  required_argument, 0, 0},
+        {"particles", required_argument, 0, 0},
+        {"lights", required_argument, 0, 0},
+        {"accel",  required_argument, 0, 0},
+        {"terrain-size", required_argument, 0, 0},
+        {"voxel-res", required_argument, 0, 0},
+        {"sdf-steps", required_argument, 0, 0},
+        {"sdf-relax", required_argument, 0, 0},
+        {"points-file", required_argument, 0, 0},
+        {"point-radius", required_argument, 0, 0},
+        {"threads", required_argument, 0, 0},
+        {"tile-size", required_argument, 0, 0},
+        {"half", no_argument, 0, 0},
+        {"aov", required_argument, 0, 0},
+        {"aov-output", required_argument, 0, 0},
+        {"shm", required_argument, 0, 0},
+        {"spp", required_argument, 0, 0},
+        {"time-budget", required_argument, 0, 0},
+        {"target-noise", required_argument, 0, 0},
+        {"update-interval", required_argument, 0, 0},
+        {"adaptive", required_argument, 0, 0},
+        {"min-spp", required_argument, 0, 0},
+        {"sampler", required_argument, 0, 0},
+        {"denoise", required_argument, 0, 0},
+        {"preview", required_argument, 0, 0},
+        {"session", no_argument, 0, 0},
+        {"integrator", required_argument, 0, 0},
+        {"max-bounces", required_argument, 0, 0},
+        {"rr-bounces", required_argument, 0, 0},
+        {"light-samples", required_argument, 0, 0},
+        {"cull-lights", no_argument, 0, 0},
+        {"lights-file", required_argument, 0, 0},
+        {"save-lights", required_argument, 0, 0},
+        {"save-gbuffer", required_argument, 0, 0},
+        {"relight", required_argument, 0, 0},
+        {"relight-shadows", no_argument, 0, 0},
+        {"progress", required_argument, 0, 0},
+        {"progress-interval", required_argument, 0, 0},
         {"help",   no_argument,       0, 0},
         {0, 0, 0, 0}
     };
@@ -149,6 +340,205 @@ int main(int argc, char *argv[]) {
                 if (strcmp(long_options[option_index].name, "help") == 0) {
                     print_usage(argv[0]);
                     return 0;
+                } else if (strcmp(long_options[option_index].name, "scene") == 0) {
+                    if (!demo_scene_parse_name(optarg, &scene_options.kind)) {
+                        fprintf(stderr, "Error: Unknown scene '%s'\n", optarg);
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "particles") == 0) {
+                    scene_options.particle_count = atoi(optarg);
+                    if (scene_options.particle_count <= 0) {
+                        fprintf(stderr, "Error: Particle count must be positive\n");
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "lights") == 0) {
+                    scene_options.light_count = atoi(optarg);
+                    if (scene_options.light_count <= 0) {
+                        fprintf(stderr, "Error: Light count must be positive\n");
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "accel") == 0) {
+                    if (strcmp(optarg, "bvh") == 0) {
+                        scene_options.accel = ACCEL_BVH;
+                    } else if (strcmp(optarg, "grid") == 0) {
+                        scene_options.accel = ACCEL_GRID;
+                    } else {
+                        fprintf(stderr, "Error: Unknown acceleration structure '%s'\n", optarg);
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "terrain-size") == 0) {
+                    scene_options.terrain_size = atoi(optarg);
+                    if (scene_options.terrain_size < 2) {
+                        fprintf(stderr, "Error: Terrain size must be at least 2\n");
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "voxel-res") == 0) {
+                    scene_options.voxel_resolution = atoi(optarg);
+                    if (scene_options.voxel_resolution < 16) {
+                        fprintf(stderr, "Error: Voxel resolution must be at least 16\n");
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "sdf-steps") == 0) {
+                    scene_options.sdf_max_steps = atoi(optarg);
+                    if (scene_options.sdf_max_steps <= 0) {
+                        fprintf(stderr, "Error: SDF step count must be positive\n");
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "sdf-relax") == 0) {
+                    scene_options.sdf_relaxation = (float)atof(optarg);
+                    if (scene_options.sdf_relaxation < 1.0f ||
+                        scene_options.sdf_relaxation >= 2.0f) {
+                        fprintf(stderr, "Error: SDF relaxation must be in [1, 2)\n");
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "points-file") == 0) {
+                    scene_options.points_file = optarg;
+                } else if (strcmp(long_options[option_index].name, "point-radius") == 0) {
+                    scene_options.point_radius = (float)atof(optarg);
+                    if (scene_options.point_radius <= 0.0f) {
+                        fprintf(stderr, "Error: Point radius must be positive\n");
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "threads") == 0) {
+                    render_settings.thread_count = atoi(optarg);
+                    if (render_settings.thread_count <= 0) {
+                        fprintf(stderr, "Error: Thread count must be positive\n");
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "half") == 0) {
+                    render_settings.half_float = true;
+                } else if (strcmp(long_options[option_index].name, "aov") == 0) {
+                    if (!render_parse_aovs(optarg, &render_settings.aovs)) {
+                        fprintf(stderr, "Error: Unknown AOV in '%s'\n", optarg);
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "aov-output") == 0) {
+                    aov_filename = optarg;
+                } else if (strcmp(long_options[option_index].name, "shm") == 0) {
+                    // POSIX names are one path component with a leading slash
+                    const char *name = optarg[0] == '/' ? optarg + 1 : optarg;
+                    if (name[0] == '\0' || strchr(name, '/') || strlen(name) > 200) {
+                        fprintf(stderr, "Error: Invalid shared-memory name '%s'\n", optarg);
+                        return 1;
+                    }
+                    snprintf(shm_name, sizeof(shm_name), "/%s", name);
+                    render_settings.shm_name = shm_name;
+                } else if (strcmp(long_options[option_index].name, "spp") == 0) {
+                    progressive.max_samples = atoi(optarg);
+                    progressive_mode = true;
+                    if (progressive.max_samples <= 0) {
+                        fprintf(stderr, "Error: Sample count must be positive\n");
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "time-budget") == 0) {
+                    progressive.time_budget = atof(optarg);
+                    progressive_mode = true;
+                    if (progressive.time_budget <= 0.0) {
+                        fprintf(stderr, "Error: Time budget must be positive\n");
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "target-noise") == 0) {
+                    progressive.target_noise = atof(optarg);
+                    progressive_mode = true;
+                    if (progressive.target_noise <= 0.0) {
+                        fprintf(stderr, "Error: Target noise must be positive\n");
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "update-interval") == 0) {
+                    progressive.update_interval = atof(optarg);
+                    progressive_mode = true;
+                    if (progressive.update_interval <= 0.0) {
+                        fprintf(stderr, "Error: Update interval must be positive\n");
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "adaptive") == 0) {
+                    progressive.adaptive_threshold = atof(optarg);
+                    progressive_mode = true;
+                    if (progressive.adaptive_threshold <= 0.0) {
+                        fprintf(stderr, "Error: Adaptive threshold must be positive\n");
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "min-spp") == 0) {
+                    progressive.min_samples = atoi(optarg);
+                    min_spp_given = true;
+                    if (progressive.min_samples <= 0) {
+                        fprintf(stderr, "Error: Minimum samples must be positive\n");
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "denoise") == 0) {
+                    progressive.denoise_strength = (float)atof(optarg);
+                    if (progressive.denoise_strength <= 0.0f) {
+                        fprintf(stderr, "Error: Denoise strength must be positive\n");
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "preview") == 0) {
+                    preview_factor = atoi(optarg);
+                    if (!preview_factor_valid(preview_factor)) {
+                        fprintf(stderr, "Error: Preview factor must be 2, 4 or 8\n");
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "session") == 0) {
+                    session_mode = true;
+                } else if (strcmp(long_options[option_index].name, "sampler") == 0) {
+                    sampler_given = true;
+                    if (!sampler_parse_type(optarg, &render_settings.sampler)) {
+                        fprintf(stderr, "Error: Unknown sampler '%s' (use sobol, blue-noise "
+                                "or random)\n", optarg);
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "integrator") == 0) {
+                    if (!integrator_parse_type(optarg, &render_settings.integrator.type)) {
+                        fprintf(stderr, "Error: Unknown integrator '%s' (use direct or path)\n",
+                                optarg);
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "max-bounces") == 0) {
+                    render_settings.integrator.max_bounces = atoi(optarg);
+                    if (render_settings.integrator.max_bounces < 0) {
+                        fprintf(stderr, "Error: Bounce count must not be negative\n");
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "rr-bounces") == 0) {
+                    render_settings.integrator.roulette_bounces = atoi(optarg);
+                    if (render_settings.integrator.roulette_bounces < 0) {
+                        fprintf(stderr, "Error: Roulette bounce count must not be negative\n");
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "light-samples") == 0) {
+                    render_settings.integrator.light_samples = atoi(optarg);
+                    if (render_settings.integrator.light_samples <= 0) {
+                        fprintf(stderr, "Error: Light sample count must be positive\n");
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "cull-lights") == 0) {
+                    render_settings.cull_lights = true;
+                } else if (strcmp(long_options[option_index].name, "lights-file") == 0) {
+                    lights_filename = optarg;
+                } else if (strcmp(long_options[option_index].name, "save-lights") == 0) {
+                    save_lights_filename = optarg;
+                } else if (strcmp(long_options[option_index].name, "save-gbuffer") == 0) {
+                    save_gbuffer_filename = optarg;
+                } else if (strcmp(long_options[option_index].name, "relight") == 0) {
+                    relight_filename = optarg;
+                } else if (strcmp(long_options[option_index].name, "relight-shadows") == 0) {
+                    relight_shadows = true;
+                } else if (strcmp(long_options[option_index].name, "tile-size") == 0) {
+                    render_settings.tile_size = atoi(optarg);
+                    if (render_settings.tile_size <= 0) {
+                        fprintf(stderr, "Error: Tile size must be positive\n");
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "progress") == 0) {
+                    if (!progress_parse_mode(optarg, &render_settings.progress_mode)) {
+                        fprintf(stderr, "Error: Unknown progress mode '%s'\n", optarg);
+                        return 1;
+                    }
+                } else if (strcmp(long_options[option_index].name, "progress-interval") == 0) {
+                    render_settings.progress_interval = atof(optarg);
+                    if (render_settings.progress_interval <= 0.0) {
+                        fprintf(stderr, "Error: Progress interval must be positive\n");
+                        return 1;
+                    }
                 }
                 break;
                 
@@ -161,37 +551,304 @@ int main(int argc, char *argv[]) {
         }
     }
     
-    // Validate parameters
-    if (image_width > 4096 || image_height > 4096) {
-        fprintf(stderr, "Warning: Large image size may be slow\n");
+    render_settings.output_format = image_format_from_path(output_filename);
+    if (render_settings.half_float && render_settings.output_format != IMAGE_FORMAT_EXR) {
+        fprintf(stderr, "Error: --half requires .exr output\n");
+        return 1;
+    }
+    if (!progressive_mode && progressive.denoise_strength > 0.0f) {
+        fprintf(stderr, "Error: --denoise needs a progressive render (--spp, --time-budget, "
+                "--target-noise or --adaptive)\n");
+        return 1;
+    }
+    if (min_spp_given && progressive.adaptive_threshold <= 0.0) {
+        fprintf(stderr, "Error: --min-spp needs an adaptive render (--adaptive)\n");
+        return 1;
+    }
+    // A session can switch to the path integrator later
+    if (sampler_given && !progressive_mode && !session_mode &&
+        render_settings.integrator.type != INTEGRATOR_PATH) {
+        fprintf(stderr, "Error: --sampler needs a progressive or path-traced render (--spp, "
+                "--time-budget, --target-noise, --adaptive or --integrator path)\n");
+        return 1;
+    }
+    if (progressive_mode && render_settings.aovs) {
+        fprintf(stderr, "Error: --aov is not supported in progressive mode\n");
+        return 1;
+    }
+    if (render_settings.cull_lights &&
+        (progressive_mode || render_settings.integrator.type != INTEGRATOR_DIRECT ||
+         render_settings.integrator.light_samples > 0)) {
+        fprintf(stderr, "Error: --cull-lights needs a single-pass direct render without "
+                "--light-samples\n");
+        return 1;
+    }
+    if (preview_factor &&
+        (progressive_mode || render_settings.aovs || render_settings.cull_lights ||
+         save_gbuffer_filename || relight_filename)) {
+        fprintf(stderr, "Error: --preview cannot be combined with progressive, AOV, "
+                "light-culled, G-buffer or relight rendering\n");
+        return 1;
+    }
+    if (session_mode &&
+        (progressive_mode || render_settings.aovs || save_gbuffer_filename || relight_filename)) {
+        fprintf(stderr, "Error: --session renders single passes or previews and cannot be "
+                "combined with progressive, AOV, G-buffer or relight rendering\n");
+        return 1;
+    }
+    if (save_gbuffer_filename && progressive_mode) {
+        fprintf(stderr, "Error: --save-gbuffer needs a single-pass render\n");
+        return 1;
+    }
+    if (relight_shadows && !relight_filename) {
+        fprintf(stderr, "Error: --relight-shadows needs --relight\n");
+        return 1;
+    }
+    if (relight_filename) {
+        if (progressive_mode || render_settings.aovs || render_settings.shm_name ||
+            save_gbuffer_filename || render_settings.integrator.type != INTEGRATOR_DIRECT ||
+            render_settings.integrator.light_samples > 0) {
+            fprintf(stderr, "Error: --relight shades directly from the G-buffer and cannot be "
+                    "combined with progressive, AOV, live, path or light-sampled rendering\n");
+            return 1;
+        }
+        return run_relight(relight_filename, lights_filename, save_lights_filename,
+                           relight_shadows, &scene_options, &render_settings, output_filename);
+    }
+    if (render_settings.aovs && !aov_filename) {
+        // render.png -> render.aov.exr
+        const char *dot = strrchr(output_filename, '.');
+        const char *slash = strrchr(output_filename, '/');
+        int stem = dot && (!slash || dot > slash) ? (int)(dot - output_filename)
+                                                  : (int)strlen(output_filename);
+        snprintf(default_aov_filename, sizeof(default_aov_filename), "%.*s.aov.exr", stem,
+                 output_filename);
+        aov_filename = default_aov_filename;
+    }
+
+    // Images of any size stream through a bounded working set; only the file grows
+    double max_output_gb = (double)image_width * (double)image_height * 12.0 / 1e9;
+    if (max_output_gb > 1.0) {
+        fprintf(stderr, "Note: output may take up to %.1f GB of disk space\n", max_output_gb);
     }
     
     printf("Ray Tracer Demonstration v0.1\n");
     printf("Rendering %dx%d ray-traced scene to '%s'\n", image_width, image_height, output_filename);
-    printf("Scene: Red sphere and blue plane with point lighting\n");
+    printf("Scene: %s\n", demo_scene_description(scene_options.kind));
+    if (render_settings.integrator.type == INTEGRATOR_PATH) {
+        printf("Integrator: path, up to %d bounces, Russian roulette after %d\n",
+               render_settings.integrator.max_bounces, render_settings.integrator.roulette_bounces);
+    }
+    if (render_settings.shm_name) {
+        printf("Live framebuffer: %s (watch with: fbview %s)\n", render_settings.shm_name,
+               render_settings.shm_name + 1);
+    }
     
-    // Open output file
-    FILE *output = fopen(output_filename, "w");
-    if (!output) {
-        fprintf(stderr, "Error: Could not open output file '%s'\n", output_filename);
-        return 1;
+    // Open output file (progressive renders, previews and sessions replace it instead)
+    FILE *output = NULL;
+    if (!progressive_mode && !preview_factor && !session_mode) {
+        output = fopen(output_filename, "wb");
+        if (!output) {
+            fprintf(stderr, "Error: Could not open output file '%s'\n", output_filename);
+            return 1;
+        }
+    }
+    FILE *aov_output = NULL;
+    if (render_settings.aovs) {
+        aov_output = fopen(aov_filename, "wb");
+        if (!aov_output) {
+            fprintf(stderr, "Error: Could not open AOV file '%s'\n", aov_filename);
+            if (output) {
+                fclose(output);
+            }
+            return 1;
+        }
     }
     
     // Create camera and scene
-    Camera camera = create_demo_camera(image_width, image_height);
-    Scene scene = create_demo_scene();
+    DemoScene demo;
+    if (!demo_scene_build(&demo, &scene_options, image_width, image_height)) {
+        fprintf(stderr, "Error: Could not build scene\n");
+        demo_scene_destroy(&demo);
+        if (output) {
+            fclose(output);
+        }
+        if (aov_output) {
+            fclose(aov_output);
+        }
+        return 1;
+    }
+    GBuffer gbuffer;
+    bool setup_ok = true;
+    if (lights_filename) {
+        setup_ok = load_lights(&demo.scene, lights_filename);
+    }
+    if (setup_ok && save_lights_filename &&
+        !scene_save_lights(&demo.scene, save_lights_filename)) {
+        fprintf(stderr, "Error: Could not write lights to '%s'\n", save_lights_filename);
+        setup_ok = false;
+    }
+    if (setup_ok && save_gbuffer_filename) {
+        setup_ok = gbuffer_create(&gbuffer, image_width, image_height);
+        if (setup_ok) {
+            render_settings.gbuffer = &gbuffer;
+        } else {
+            fprintf(stderr, "Error: Out of memory for the G-buffer\n");
+        }
+    }
+    if (!setup_ok) {
+        demo_scene_destroy(&demo);
+        if (output) {
+            fclose(output);
+        }
+        if (aov_output) {
+            fclose(aov_output);
+        }
+        return 1;
+    }
+    if (render_settings.integrator.light_samples > 0) {
+        printf("Lights: %d, %d sampled per shading point from a %d-node light tree\n",
+               demo.scene.light_count, render_settings.integrator.light_samples,
+               demo.scene.light_tree.node_count);
+    }
     
+    if (session_mode) {
+        printf("Session: reading commands from stdin\n");
+        fflush(stdout);
+        SessionStats session_stats;
+        bool session_ok = session_run(&demo.camera, &demo.scene, &render_settings, preview_factor,
+                                      output_filename, stdin, stdout, &session_stats);
+        demo_scene_destroy(&demo);
+        if (!session_ok) {
+            fprintf(stderr, "Error: Session failed\n");
+            return 1;
+        }
+        printf("Session: %d commands, %d frames (%d complete, %d cancelled), first tile "
+               "%.1f ms after a command on average, %.1f ms at worst, %llu tiles reused\n",
+               session_stats.commands, session_stats.frames, session_stats.completed,
+               session_stats.cancelled, session_stats.mean_first_tile_seconds * 1000.0,
+               session_stats.max_first_tile_seconds * 1000.0,
+               (unsigned long long)session_stats.cached_tiles);
+        return 0;
+    }
+
     // Render the scene
-    render_scene(&camera, &scene, output);
+    RenderStats stats;
+    ProgressiveStats progressive_stats;
+    PreviewStats preview_stats;
+    bool rendered;
+    if (preview_factor) {
+        install_stop_handlers();
+        rendered = render_preview(&demo.camera, &demo.scene, &render_settings, preview_factor,
+                                  output_filename, &stats, &preview_stats);
+    } else if (progressive_mode) {
+        install_stop_handlers();
+        rendered = render_progressive(&demo.camera, &demo.scene, &render_settings, &progressive,
+                                      output_filename, &stats, &progressive_stats);
+    } else {
+        rendered = render_scene(&demo.camera, &demo.scene, &render_settings, output, aov_output,
+                                &stats);
+    }
+    if (!rendered) {
+        fprintf(stderr, "Error: Rendering failed\n");
+        if (output) {
+            fclose(output);
+        }
+        if (aov_output) {
+            fclose(aov_output);
+        }
+        if (render_settings.gbuffer) {
+            gbuffer_destroy(&gbuffer);
+        }
+        demo_scene_destroy(&demo);
+        return 1;
+    }
+    printf("Render time: %.1f ms (%d threads)\n", stats.render_seconds * 1000.0,
+           stats.thread_count);
+    if (render_settings.gbuffer) {
+        double save_start = timer_now_seconds();
+        bool saved = gbuffer_save(&gbuffer, save_gbuffer_filename);
+        gbuffer_destroy(&gbuffer);
+        if (!saved) {
+            fprintf(stderr, "Error: Could not write G-buffer '%s'\n", save_gbuffer_filename);
+            if (output) {
+                fclose(output);
+            }
+            if (aov_output) {
+                fclose(aov_output);
+            }
+            demo_scene_destroy(&demo);
+            return 1;
+        }
+        printf("G-buffer: primary hits written to '%s' in %.1f ms\n", save_gbuffer_filename,
+               (timer_now_seconds() - save_start) * 1000.0);
+    }
+    if (stats.empty_tiles > 0) {
+        printf("Screen-space culling: %llu empty tiles filled with the background\n",
+               (unsigned long long)stats.empty_tiles);
+    }
+    print_hit_caches(&stats);
+    if (render_settings.cull_lights) {
+        printf("Light culling: %.1f of %d lights per tile on average\n", stats.lights_per_tile,
+               demo.scene.light_count);
+    }
+    double raw_mb = (double)image_width * image_height *
+                    (double)image_format_pixel_bytes(render_settings.output_format) /
+                    (1024.0 * 1024.0);
+    if (preview_factor) {
+        printf("Preview: first frame at 1/%d resolution in %.1f ms (guide pass %.1f ms), "
+               "%d levels, last at 1/%d\n",
+               preview_factor, preview_stats.first_frame_seconds * 1000.0,
+               preview_stats.guide_seconds * 1000.0, preview_stats.levels,
+               preview_stats.final_factor);
+    }
+    if (progressive_mode) {
+        printf("Progressive: %d passes, %d-%d samples per pixel, noise %.4f, stopped by %s, "
+               "%d image updates\n",
+               progressive_stats.passes, progressive_stats.min_samples,
+               progressive_stats.max_samples, progressive_stats.noise,
+               progressive_stop_reason_name(progressive_stats.reason), progressive_stats.updates);
+        printf("Samples: %.2f per pixel on average (%.0f%% of uniform at %d), "
+               "%llu tiles converged\n",
+               progressive_stats.mean_samples,
+               progressive_stats.max_samples > 0
+                   ? 100.0 * progressive_stats.mean_samples / progressive_stats.max_samples
+                   : 0.0,
+               progressive_stats.max_samples,
+               (unsigned long long)progressive_stats.converged_tiles);
+        if (progressive.denoise_strength > 0.0f) {
+            printf("Denoise: strength %.2f, %.1f ms\n", progressive.denoise_strength,
+                   progressive_stats.denoise_seconds * 1000.0);
+        }
+    }
+    printf("Output: %.1f MB %s via %s, encode %.1f ms (%.0f MB/s) overlapped with rendering\n",
+           (double)stats.bytes_written / (1024.0 * 1024.0),
+           image_format_name(render_settings.output_format), stats.io_backend,
+           stats.encode_seconds * 1000.0,
+           stats.encode_seconds > 0.0 ? raw_mb / stats.encode_seconds : 0.0);
+    if (aov_output) {
+        printf("AOVs: %d channels, %.1f MB EXR written to '%s'\n",
+               render_aov_channel_count(render_settings.aovs),
+               (double)stats.aov_bytes_written / (1024.0 * 1024.0), aov_filename);
+    }
+    printf("Working set: %.1f MB of pixel and output buffers\n",
+           (double)stats.working_set_bytes / (1024.0 * 1024.0));
     
     // Cleanup
-    fclose(output);
+    if (output) {
+        fclose(output);
+    }
+    if (aov_output) {
+        fclose(aov_output);
+    }
+    demo_scene_destroy(&demo);
     
     printf("Render complete! Output written to '%s'\n", output_filename);
     printf("\nTo view the image:\n");
     printf("  - On macOS: open %s\n", output_filename);
     printf("  - On Linux: display %s  (ImageMagick)\n", output_filename);
-    printf("  - On Windows: Use any image viewer that supports PPM\n");
+    printf("  - On Windows: Use any image viewer that supports %s\n",
+           image_format_name(render_settings.output_format));
     
     return 0;
 } 
\ No newline at end of file
@@ -0,0 +1,174 @@
+/**
+ * @file output_pipeline.c
+ * @brief Asynchronous, in-order image output
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "output_pipeline.h"
+#include "timer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+/**
+ * @brief Pixels in a band (the last band may be short)
+ */
+static uint64_t band_pixels(const OutputPipeline *pipeline, int band) {
+    int first = band * pipeline->band_height;
+    int rows = pipeline->height - first < pipeline->band_height ? pipeline->height - first
+                                                                : pipeline->band_height;
+    return (uint64_t)rows * (uint64_t)pipeline->width;
+}
+
+static void *pipeline_writer(void *arg) {
+    OutputPipeline *pipeline = (OutputPipeline *)arg;
+    image_encoder_begin(&pipeline->encoder, &pipeline->sink);
+
+    for (int band = 0; band < pipeline->band_count; band++) {
+        int slot = band % pipeline->capacity;
+        double wait_start = timer_now_seconds();
+        pthread_mutex_lock(&pipeline->lock);
+        while (!pipeline->ready[slot] && !pipeline->aborted) {
+            pthread_cond_wait(&pipeline->band_ready, &pipeline->lock);
+        }
+        bool aborted = pipeline->aborted;
+        pthread_mutex_unlock(&pipeline->lock);
+        if (aborted) {
+            return NULL;
+        }
+        double encode_start = timer_now_seconds();
+        pipeline->wait_seconds += encode_start - wait_start;
+
+        image_encoder_write_band(&pipeline->encoder, &pipeline->sink, slot, band,
+                                 &pipeline->slots[(size_t)slot * pipeline->band_bytes]);
+        pipeline->encode_seconds += timer_now_seconds() - encode_start;
+
+        pthread_mutex_lock(&pipeline->lock);
+        pipeline->filled[slot] = 0;
+        pipeline->ready[slot] = false;
+        pipeline->next_write = band + 1;
+        pthread_cond_broadcast(&pipeline->slot_free);
+        pthread_mutex_unlock(&pipeline->lock);
+    }
+    image_encoder_end(&pipeline->encoder, &pipeline->sink);
+    return NULL;
+}
+
+/**
+ * @brief Release slot memory and the encoder
+ */
+static void pipeline_free(OutputPipeline *pipeline) {
+    image_encoder_destroy(&pipeline->encoder);
+    free(pipeline->slots);
+    free(pipeline->filled);
+    free(pipeline->ready);
+    pipeline->slots = NULL;
+    pipeline->filled = NULL;
+    pipeline->ready = NULL;
+}
+
+bool output_pipeline_start(OutputPipeline *pipeline, FILE *output, const ImageSpec *spec,
+                           int band_height, int capacity) {
+    int width = spec->width;
+    int height = spec->height;
+    memset(pipeline, 0, sizeof(*pipeline));
+    pipeline->width = width;
+    pipeline->height = height;
+    pipeline->band_height = band_height < height ? band_height : height;
+    pipeline->band_count = (height + pipeline->band_height - 1) / pipeline->band_height;
+    pipeline->capacity = capacity < pipeline->band_count ? capacity : pipeline->band_count;
+    pipeline->pixel_bytes = image_spec_pixel_bytes(spec);
+    pipeline->band_bytes = (size_t)pipeline->band_height * (size_t)width * pipeline->pixel_bytes;
+    pipeline->output = output;
+
+    // Continue from the stream's position, bypassing stdio buffering
+    fflush(output);
+    off_t start = ftello(output);
+    if (start < 0) {
+        start = 0;
+    }
+
+    pipeline->slots = malloc((size_t)pipeline->capacity * pipeline->band_bytes);
+    pipeline->filled = calloc((size_t)pipeline->capacity, sizeof(uint64_t));
+    pipeline->ready = calloc((size_t)pipeline->capacity, sizeof(bool));
+    if (!pipeline->slots || !pipeline->filled || !pipeline->ready ||
+        !image_encoder_init(&pipeline->encoder, spec, pipeline->band_height,
+                            pipeline->capacity)) {
+        pipeline_free(pipeline);
+        return false;
+    }
+    if (!file_sink_open(&pipeline->sink, fileno(output), (int64_t)start, true)) {
+        pipeline_free(pipeline);
+        return false;
+    }
+    pipeline->memory_bytes = (size_t)pipeline->capacity * pipeline->band_bytes +
+                             pipeline->encoder.memory_bytes +
+                             (size_t)FILE_SINK_BUFFER_COUNT * FILE_SINK_BUFFER_SIZE;
+    pthread_mutex_init(&pipeline->lock, NULL);
+    pthread_cond_init(&pipeline->band_ready, NULL);
+    pthread_cond_init(&pipeline->slot_free, NULL);
+    if (pthread_create(&pipeline->writer, NULL, pipeline_writer, pipeline) != 0) {
+        file_sink_close(&pipeline->sink);
+        pthread_mutex_destroy(&pipeline->lock);
+        pthread_cond_destroy(&pipeline->band_ready);
+        pthread_cond_destroy(&pipeline->slot_free);
+        pipeline_free(pipeline);
+        return false;
+    }
+    return true;
+}
+
+void *output_pipeline_acquire_band(OutputPipeline *pipeline, int band) {
+    pthread_mutex_lock(&pipeline->lock);
+    while (band >= pipeline->next_write + pipeline->capacity) {
+        pthread_cond_wait(&pipeline->slot_free, &pipeline->lock);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+    return &pipeline->slots[(size_t)(band % pipeline->capacity) * pipeline->band_bytes];
+}
+
+void output_pipeline_submit(OutputPipeline *pipeline, int band, uint64_t pixels) {
+    int slot = band % pipeline->capacity;
+    pthread_mutex_lock(&pipeline->lock);
+    pipeline->filled[slot] += pixels;
+    bool complete = pipeline->filled[slot] >= band_pixels(pipeline, band);
+    pthread_mutex_unlock(&pipeline->lock);
+    if (!complete) {
+        return;
+    }
+
+    // Only this caller sees the band complete, so it owns the slot until ready
+    double start = timer_now_seconds();
+    image_encoder_prepare_band(&pipeline->encoder, slot, band,
+                               &pipeline->slots[(size_t)slot * pipeline->band_bytes]);
+    double elapsed = timer_now_seconds() - start;
+
+    pthread_mutex_lock(&pipeline->lock);
+    pipeline->prepare_seconds += elapsed;
+    pipeline->ready[slot] = true;
+    pthread_cond_signal(&pipeline->band_ready);
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+void output_pipeline_abort(OutputPipeline *pipeline) {
+    pthread_mutex_lock(&pipeline->lock);
+    pipeline->aborted = true;
+    pthread_cond_signal(&pipeline->band_ready);
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+bool output_pipeline_finish(OutputPipeline *pipeline) {
+    pthread_join(pipeline->writer, NULL);
+    int64_t end = pipeline->sink.end;
+    pipeline->bytes_written = pipeline->sink.bytes_written;
+    pipeline->io_backend = file_sink_backend(&pipeline->sink);
+    bool ok = file_sink_close(&pipeline->sink) && !pipeline->aborted;
+    fseeko(pipeline->output, (off_t)end, SEEK_SET);
+
+    pthread_mutex_destroy(&pipeline->lock);
+    pthread_cond_destroy(&pipeline->band_ready);
+    pthread_cond_destroy(&pipeline->slot_free);
+    pipeline_free(pipeline);
+    return ok;
+}
@@ -59,12 +59,20 @@ bool plane_hit(const Hittable *hittable, const Ray *ray,
     hit_rec->t = t;
     hit_rec->point = ray_at(ray, t);
     hit_record_set_face_normal(hit_rec, ray, plane->normal);
+    hit_rec->albedo = plane->color;
     
     return true;
 }
 
+void plane_move(const Hittable *hittable, Vec3 offset) {
+    Plane *plane = (Plane *)hittable->data;
+    plane->point = vec3_add(plane->point, offset);
+}
+
 Hittable plane_to_hittable(Plane *plane) {
-    return hittable_create(plane, plane_hit);
+    Hittable hittable = hittable_create(plane, plane_hit);
+    hittable.move_func = plane_move;
+    return hittable;
 }
 
 float plane_distance_to_point(const Plane *plane, Vec3 point) {
@@ -76,6 +84,21 @@ bool plane_point_in_front(const Plane *plane, Vec3 point) {
     return plane_distance_to_point(plane, point) > 0.0f;
 }
 
+bool plane_reachable(const Plane *plane, Vec3 origin, const Vec3 *directions, int count) {
+    // A ray reaches the plane only if it heads towards it; that is a half-space of
+    // directions, which holds a combination of directions only if it holds one of them
+    float side = vec3_dot(vec3_sub(plane->point, origin), plane->normal);
+    if (side == 0.0f) {
+        return true;
+    }
+    for (int i = 0; i < count; i++) {
+        if (vec3_dot(directions[i], plane->normal) * side > 0.0f) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void plane_print(const Plane *plane) {
     printf("Plane {\n");
     printf("  point: ");
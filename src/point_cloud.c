@@ -0,0 +1,427 @@
+/**
+ * @file point_cloud.c
+ * @brief Compact point cloud with quantized positions and a Morton-split BVH
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "point_cloud.h"
+#include "sphere.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define QUANT_MAX 65535.0f
+#define POINT_CLOUD_STACK_SIZE 64
+
+/**
+ * @brief Spread the low 10 bits of v so there are two zero bits between each
+ */
+static uint32_t morton_expand(uint32_t v) {
+    v &= 0x3FFu;
+    v = (v | (v << 16)) & 0x030000FFu;
+    v = (v | (v << 8)) & 0x0300F00Fu;
+    v = (v | (v << 4)) & 0x030C30C3u;
+    v = (v | (v << 2)) & 0x09249249u;
+    return v;
+}
+
+static uint32_t morton_code(Vec3 p, Vec3 min, Vec3 scale) {
+    uint32_t x = (uint32_t)fminf(fmaxf((p.x - min.x) * scale.x, 0.0f), 1023.0f);
+    uint32_t y = (uint32_t)fminf(fmaxf((p.y - min.y) * scale.y, 0.0f), 1023.0f);
+    uint32_t z = (uint32_t)fminf(fmaxf((p.z - min.z) * scale.z, 0.0f), 1023.0f);
+    return (morton_expand(x) << 2) | (morton_expand(y) << 1) | morton_expand(z);
+}
+
+static Vec3 load_point(const float *positions, size_t index) {
+    return vec3_create(positions[3 * index], positions[3 * index + 1], positions[3 * index + 2]);
+}
+
+/**
+ * @brief Sort (morton << 32 | index) keys by their upper 32 bits
+ * LSD radix sort is stable, so points in the same Morton cell keep their
+ * input order. Returns whichever buffer holds the result.
+ */
+static uint64_t *radix_sort_keys(uint64_t *keys, uint64_t *scratch, size_t count) {
+    size_t counts[256];
+    for (int shift = 32; shift < 64; shift += 8) {
+        memset(counts, 0, sizeof(counts));
+        for (size_t i = 0; i < count; i++) {
+            counts[(keys[i] >> shift) & 0xFFu]++;
+        }
+        size_t sum = 0;
+        for (int b = 0; b < 256; b++) {
+            size_t c = counts[b];
+            counts[b] = sum;
+            sum += c;
+        }
+        for (size_t i = 0; i < count; i++) {
+            scratch[counts[(keys[i] >> shift) & 0xFFu]++] = keys[i];
+        }
+        uint64_t *swap = keys;
+        keys = scratch;
+        scratch = swap;
+    }
+    return keys;
+}
+
+/**
+ * @brief Center-point bounds of a leaf, recovered from its stored box
+ */
+static void leaf_frame(const PointCloud *cloud, const PointCloudNode *leaf,
+                       Vec3 *origin, Vec3 *step) {
+    const AABB *box = &leaf->bounds;
+    float r = cloud->radius;
+    *origin = vec3_create(box->min.x + r, box->min.y + r, box->min.z + r);
+    *step = vec3_create((box->max.x - box->min.x - 2.0f * r) / QUANT_MAX,
+                        (box->max.y - box->min.y - 2.0f * r) / QUANT_MAX,
+                        (box->max.z - box->min.z - 2.0f * r) / QUANT_MAX);
+}
+
+static uint16_t quantize(float value, float min, float extent) {
+    if (extent <= 0.0f) {
+        return 0;
+    }
+    float q = (value - min) / extent * QUANT_MAX + 0.5f;
+    return (uint16_t)fminf(fmaxf(q, 0.0f), QUANT_MAX);
+}
+
+/**
+ * @brief Split a sorted range where its Morton codes first differ
+ * Ranges whose points share one Morton cell are split in the middle.
+ * @return Index of the first point of the second half
+ */
+static size_t find_split(const uint64_t *keys, size_t first, size_t last, int *axis) {
+    uint32_t first_code = (uint32_t)(keys[first] >> 32);
+    uint32_t last_code = (uint32_t)(keys[last - 1] >> 32);
+    if (first_code == last_code) {
+        *axis = 0;
+        return first + (last - first) / 2;
+    }
+
+    int bit = 31;
+    while (!(((first_code ^ last_code) >> bit) & 1u)) {
+        bit--;
+    }
+    // Codes interleave x, y, z from high to low bit, so bit % 3 names the axis
+    *axis = bit % 3 == 2 ? 0 : (bit % 3 == 1 ? 1 : 2);
+
+    // First point with the bit set; codes agree on every bit above it
+    size_t lo = first, hi = last - 1;
+    while (lo + 1 < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if ((keys[mid] >> (32 + bit)) & 1u) {
+            hi = mid;
+        } else {
+            lo = mid;
+        }
+    }
+    return hi;
+}
+
+static size_t count_nodes(const uint64_t *keys, size_t first, size_t last) {
+    if (last - first <= POINT_CLOUD_LEAF_SIZE) {
+        return 1;
+    }
+    int axis;
+    size_t split = find_split(keys, first, last, &axis);
+    return 1 + count_nodes(keys, first, split) + count_nodes(keys, split, last);
+}
+
+/**
+ * @brief State shared by the recursive build
+ */
+typedef struct {
+    PointCloud *cloud;       ///< Cloud being built
+    const float *positions;  ///< Input positions
+    const uint64_t *keys;    ///< Sorted (morton << 32 | index) keys
+    uint32_t next_node;      ///< Next free node
+} BuildContext;
+
+static uint32_t build_node(BuildContext *context, size_t first, size_t last) {
+    PointCloud *cloud = context->cloud;
+    uint32_t index = context->next_node++;
+    PointCloudNode *node = &cloud->nodes[index];
+
+    if (last - first <= POINT_CLOUD_LEAF_SIZE) {
+        AABB centers = aabb_empty();
+        for (size_t i = first; i < last; i++) {
+            size_t source = (size_t)(context->keys[i] & 0xFFFFFFFFu);
+            centers = aabb_expand(centers, load_point(context->positions, source));
+        }
+        Vec3 pad = vec3_create(cloud->radius, cloud->radius, cloud->radius);
+        node->bounds = aabb_create(vec3_sub(centers.min, pad), vec3_add(centers.max, pad));
+        node->offset = (uint32_t)first;
+        node->count = (uint16_t)(last - first);
+        node->axis = 0;
+
+        // Quantize against the frame the hit test will reconstruct
+        Vec3 origin, step;
+        leaf_frame(cloud, node, &origin, &step);
+        Vec3 span = vec3_scale(step, QUANT_MAX);
+        for (size_t i = first; i < last; i++) {
+            Vec3 p = load_point(context->positions, (size_t)(context->keys[i] & 0xFFFFFFFFu));
+            cloud->positions[3 * i] = quantize(p.x, origin.x, span.x);
+            cloud->positions[3 * i + 1] = quantize(p.y, origin.y, span.y);
+            cloud->positions[3 * i + 2] = quantize(p.z, origin.z, span.z);
+        }
+        return index;
+    }
+
+    int axis;
+    size_t split = find_split(context->keys, first, last, &axis);
+    uint32_t left = build_node(context, first, split);
+    uint32_t right = build_node(context, split, last);
+    node = &cloud->nodes[index];
+    node->bounds = aabb_union(cloud->nodes[left].bounds, cloud->nodes[right].bounds);
+    node->offset = right;
+    node->count = 0;
+    node->axis = (uint16_t)axis;
+    return index;
+}
+
+bool point_cloud_build(PointCloud *cloud, const float *positions, size_t count,
+                       float radius, Color color) {
+    memset(cloud, 0, sizeof(*cloud));
+    cloud->color = color;
+    if (count == 0 || count > INT32_MAX) {
+        return false;
+    }
+
+    AABB bounds = aabb_empty();
+    for (size_t i = 0; i < count; i++) {
+        bounds = aabb_expand(bounds, load_point(positions, i));
+    }
+    Vec3 extent = aabb_extent(bounds);
+    if (radius <= 0.0f) {
+        // Same fill ratio as a uniform cloud: a quarter of the mean spacing
+        float volume = fmaxf(extent.x, 1e-6f) * fmaxf(extent.y, 1e-6f) * fmaxf(extent.z, 1e-6f);
+        radius = 0.25f * cbrtf(volume / (float)count);
+    }
+    cloud->radius = radius;
+
+    // Morton-sort the points; the tree is then built over contiguous ranges
+    uint64_t *keys = malloc(count * sizeof(uint64_t));
+    uint64_t *scratch = malloc(count * sizeof(uint64_t));
+    if (!keys || !scratch) {
+        free(keys);
+        free(scratch);
+        return false;
+    }
+    Vec3 scale = vec3_create(extent.x > 0.0f ? 1023.0f / extent.x : 0.0f,
+                             extent.y > 0.0f ? 1023.0f / extent.y : 0.0f,
+                             extent.z > 0.0f ? 1023.0f / extent.z : 0.0f);
+    for (size_t i = 0; i < count; i++) {
+        uint64_t code = morton_code(load_point(positions, i), bounds.min, scale);
+        keys[i] = (code << 32) | (uint64_t)i;
+    }
+    uint64_t *sorted = radix_sort_keys(keys, scratch, count);
+    free(sorted == keys ? scratch : keys);
+
+    size_t node_count = count_nodes(sorted, 0, count);
+    cloud->nodes = malloc(node_count * sizeof(PointCloudNode));
+    cloud->positions = malloc(count * 3 * sizeof(uint16_t));
+    if (!cloud->nodes || !cloud->positions) {
+        free(sorted);
+        point_cloud_destroy(cloud);
+        return false;
+    }
+    cloud->point_count = count;
+    cloud->node_count = node_count;
+
+    BuildContext context = {cloud, positions, sorted, 0};
+    build_node(&context, 0, count);
+    free(sorted);
+    return true;
+}
+
+bool point_cloud_load(PointCloud *cloud, const char *path, float radius, Color color) {
+    memset(cloud, 0, sizeof(*cloud));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0 ||
+        (size_t)info.st_size % (3 * sizeof(float)) != 0) {
+        close(fd);
+        return false;
+    }
+    size_t bytes = (size_t)info.st_size;
+    void *mapped = mmap(NULL, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    bool built = point_cloud_build(cloud, (const float *)mapped, bytes / (3 * sizeof(float)),
+                                   radius, color);
+    munmap(mapped, bytes);
+    return built;
+}
+
+void point_cloud_destroy(PointCloud *cloud) {
+    free(cloud->positions);
+    free(cloud->nodes);
+    cloud->positions = NULL;
+    cloud->nodes = NULL;
+    cloud->point_count = 0;
+    cloud->node_count = 0;
+}
+
+/**
+ * @brief Closest point of one leaf hit below *closest
+ * @param closest In: farthest accepted t; out: t of the hit
+ * @param hit_center Output center of the point hit
+ * @return true if a point of the leaf was hit
+ */
+static bool leaf_hit(const PointCloud *cloud, const PointCloudNode *node, const Ray *ray,
+                     float t_min, bool any_hit, float *closest, Vec3 *hit_center) {
+    Vec3 origin, step;
+    leaf_frame(cloud, node, &origin, &step);
+    const uint16_t *q = &cloud->positions[3 * (size_t)node->offset];
+    bool hit_anything = false;
+    for (int i = 0; i < node->count; i++, q += 3) {
+        Vec3 center = vec3_create(origin.x + (float)q[0] * step.x,
+                                  origin.y + (float)q[1] * step.y,
+                                  origin.z + (float)q[2] * step.z);
+        float t;
+        if (sphere_intersect(center, cloud->radius, ray, t_min, *closest, &t)) {
+            *closest = t;
+            *hit_center = center;
+            hit_anything = true;
+            if (any_hit) {
+                break;
+            }
+        }
+    }
+    return hit_anything;
+}
+
+/**
+ * @brief Traverse the cloud for the closest hit below *closest, or any hit
+ * @param skip Leaf the caller has already tested (-1: none)
+ * @param closest In: farthest accepted t; out: t of the hit
+ * @param hit_center Output center of the point hit
+ * @param hit_leaf Output leaf of the hit, left unchanged without a hit
+ */
+static bool point_cloud_traverse(const PointCloud *cloud, const Ray *ray, float t_min,
+                                 bool any_hit, int skip, float *closest, Vec3 *hit_center,
+                                 int *hit_leaf) {
+    Vec3 inv_dir = aabb_inverse_direction(ray);
+    int dir_negative[3] = {inv_dir.x < 0.0f, inv_dir.y < 0.0f, inv_dir.z < 0.0f};
+
+    uint32_t stack[POINT_CLOUD_STACK_SIZE];
+    int stack_size = 0;
+    uint32_t node_index = 0;
+    bool hit_anything = false;
+
+    for (;;) {
+        const PointCloudNode *node = &cloud->nodes[node_index];
+        if (aabb_hit(&node->bounds, ray, inv_dir, t_min, *closest, NULL, NULL)) {
+            if (node->count > 0) {
+                if ((int)node_index != skip &&
+                    leaf_hit(cloud, node, ray, t_min, any_hit, closest, hit_center)) {
+                    hit_anything = true;
+                    *hit_leaf = (int)node_index;
+                    if (any_hit) {
+                        return true;
+                    }
+                }
+            } else if (stack_size < POINT_CLOUD_STACK_SIZE) {
+                // The first child holds the lower Morton half along the split axis
+                if (dir_negative[node->axis]) {
+                    stack[stack_size++] = node_index + 1;
+                    node_index = node->offset;
+                } else {
+                    stack[stack_size++] = node->offset;
+                    node_index = node_index + 1;
+                }
+                continue;
+            }
+        }
+        if (stack_size == 0) {
+            break;
+        }
+        node_index = stack[--stack_size];
+    }
+    return hit_anything;
+}
+
+/**
+ * @brief Fill a hit record for the point centered at hit_center hit at t
+ */
+static void point_cloud_record(const PointCloud *cloud, const Ray *ray, float t, Vec3 hit_center,
+                               HitRecord *hit_rec) {
+    hit_rec->t = t;
+    hit_rec->point = ray_at(ray, t);
+    Vec3 outward_normal = vec3_div(vec3_sub(hit_rec->point, hit_center), cloud->radius);
+    hit_record_set_face_normal(hit_rec, ray, outward_normal);
+    hit_rec->albedo = cloud->color;
+}
+
+bool point_cloud_hit(const Hittable *hittable, const Ray *ray,
+                     float t_min, float t_max, HitRecord *hit_rec) {
+    const PointCloud *cloud = (const PointCloud *)hittable->data;
+    if (cloud->node_count == 0) {
+        return false;
+    }
+    float closest = t_max;
+    Vec3 hit_center = vec3_zero();
+    int hit_leaf;
+    if (!point_cloud_traverse(cloud, ray, t_min, false, -1, &closest, &hit_center, &hit_leaf)) {
+        return false;
+    }
+    point_cloud_record(cloud, ray, closest, hit_center, hit_rec);
+    return true;
+}
+
+bool point_cloud_hit_hinted(const Hittable *hittable, const Ray *ray, float t_min, float t_max,
+                            bool any_hit, HitHint *hint, HitRecord *hit_rec) {
+    const PointCloud *cloud = (const PointCloud *)hittable->data;
+    int *last = any_hit ? &hint->last_occluder : &hint->last_hit;
+    int cached = *last >= 0 && (size_t)*last < cloud->node_count &&
+                 cloud->nodes[*last].count > 0 ? *last : -1;
+    hint->answered = false;
+    if (cloud->node_count == 0) {
+        return false;
+    }
+    float closest = t_max;
+    Vec3 hit_center = vec3_zero();
+    bool hit = cached >= 0 && leaf_hit(cloud, &cloud->nodes[cached], ray, t_min, any_hit,
+                                       &closest, &hit_center);
+    int hit_leaf = cached;
+    if (!(hit && any_hit)) {
+        hit = point_cloud_traverse(cloud, ray, t_min, any_hit, cached, &closest, &hit_center,
+                                   &hit_leaf) || hit;
+    }
+    if (!hit) {
+        return false;
+    }
+    hint->answered = hit_leaf == cached;
+    *last = hit_leaf;
+    point_cloud_record(cloud, ray, closest, hit_center, hit_rec);
+    return true;
+}
+
+bool point_cloud_bounds(const Hittable *hittable, AABB *box) {
+    const PointCloud *cloud = (const PointCloud *)hittable->data;
+    if (cloud->node_count == 0) {
+        return false;
+    }
+    *box = cloud->nodes[0].bounds;
+    return true;
+}
+
+Hittable point_cloud_to_hittable(PointCloud *cloud) {
+    Hittable hittable = hittable_create_bounded(cloud, point_cloud_hit, point_cloud_bounds);
+    hittable.hinted_hit_func = point_cloud_hit_hinted;
+    return hittable;
+}
+
+size_t point_cloud_memory_bytes(const PointCloud *cloud) {
+    return cloud->point_count * 3 * sizeof(uint16_t) + cloud->node_count * sizeof(PointCloudNode);
+}
@@ -0,0 +1,549 @@
+/**
+ * @file preview.c
+ * @brief Reduced-resolution previews with joint bilateral upsampling
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "preview.h"
+#include "output_pipeline.h"
+#include "shared_framebuffer.h"
+#include "timer.h"
+#include <math.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/**
+ * @brief Band slots used when writing a level
+ */
+#define WRITE_PIPELINE_CAPACITY 2
+
+/**
+ * @brief Set by preview_request_stop (lock-free, so safe in signal handlers)
+ */
+static atomic_bool stop_requested = false;
+
+/**
+ * @brief Work done by one pass over the image rows
+ */
+typedef enum {
+    PREVIEW_PASS_GUIDES,  ///< Trace primary rays for depth and object index
+    PREVIEW_PASS_SHADE,   ///< Shade the samples new to the current level
+    PREVIEW_PASS_UPSAMPLE ///< Fill in the pixels between the samples
+} PreviewPass;
+
+/**
+ * @brief State shared by the workers of a preview
+ */
+typedef struct {
+    const Camera *camera;       ///< Camera
+    const Scene *scene;         ///< Scene
+    const IntegratorSettings *integrator; ///< Light transport
+    Sampler sampler;            ///< Random numbers of path-traced pixels
+    SceneObjectSet *tile_objects; ///< Objects the primary rays of each tile can hit
+    int tile_size;              ///< Tile edge in pixels
+    int tiles_x;                ///< Tiles per row
+    GBuffer guides;             ///< Primary hit of every pixel
+    Color *image;               ///< Shaded samples and the upsampled pixels between them
+    PreviewPass pass;           ///< Work of the current pass
+    int factor;                 ///< Sample spacing of the current level
+    int previous;               ///< Sample spacing of the level before (0: none)
+    bool cancellable;           ///< Stop requests abandon the current pass
+    const atomic_bool *cancel;  ///< Abandon any pass once set (NULL: never)
+    atomic_int next_row;        ///< Next row of the current pass to claim
+    atomic_int rows_done;       ///< Rows of the current pass completed
+    Progress *progress;         ///< Progress counters
+} PreviewJob;
+
+/**
+ * @brief Per-worker arguments
+ */
+typedef struct {
+    PreviewJob *job;         ///< Shared job
+    int index;               ///< Worker index (progress slot)
+    SceneHitCache hit_cache; ///< Objects this worker's rays hit last
+} PreviewWorker;
+
+bool preview_factor_valid(int factor) {
+    return factor == 2 || factor == 4 || factor == 8;
+}
+
+void preview_request_stop(void) {
+    atomic_store(&stop_requested, true);
+}
+
+/**
+ * @brief Samples of a level: every factor-th pixel of every factor-th row
+ */
+static uint64_t level_samples(int width, int height, int factor) {
+    return (uint64_t)((width + factor - 1) / factor) * (uint64_t)((height + factor - 1) / factor);
+}
+
+/**
+ * @brief Camera ray through the center of a pixel (row 0 is the top)
+ */
+static Ray pixel_ray(const Camera *camera, int i, int row) {
+    float u, v;
+    camera_pixel_to_uv(camera, i, camera->image_height - 1 - row, &u, &v);
+    return camera_get_ray(camera, u, v);
+}
+
+/**
+ * @brief Objects the primary ray of a pixel can hit
+ */
+static SceneObjectSet pixel_objects(const PreviewJob *job, int i, int row) {
+    return job->tile_objects[(row / job->tile_size) * job->tiles_x + i / job->tile_size];
+}
+
+/**
+ * @brief Record the primary hit of every pixel of a row
+ * @return Pixels traced
+ */
+static uint64_t guide_row(PreviewJob *job, PreviewWorker *worker, int row) {
+    int width = job->camera->image_width;
+    for (int i = 0; i < width; i++) {
+        Ray ray = pixel_ray(job->camera, i, row);
+        HitRecord rec;
+        bool hit = scene_hit_objects(job->scene, &ray, SCENE_RAY_EPSILON, INFINITY,
+                                     pixel_objects(job, i, row), &worker->hit_cache, &rec);
+        gbuffer_store(&job->guides, (size_t)row * (size_t)width + (size_t)i, hit ? &rec : NULL);
+    }
+    return (uint64_t)width;
+}
+
+/**
+ * @brief Shade the samples of a row that earlier levels did not shade
+ * Shading starts from the guide pass's primary hits, which are the hits
+ * render_scene finds, so the full-resolution level reproduces its image.
+ * @return Pixels shaded
+ */
+static uint64_t shade_row(PreviewJob *job, PreviewWorker *worker, int row) {
+    int width = job->camera->image_width;
+    int f = job->factor;
+    if (row % f != 0) {
+        return 0;
+    }
+    // Every other sample of an even row of samples belongs to the level before
+    bool old_row = job->previous > 0 && row % job->previous == 0;
+    int step = old_row ? 2 * f : f;
+    uint64_t shaded = 0;
+    for (int i = old_row ? f : 0; i < width; i += step) {
+        size_t pixel = (size_t)row * (size_t)width + (size_t)i;
+        Ray ray = pixel_ray(job->camera, i, row);
+        PathSample sample = {&job->sampler, (uint32_t)i, (uint32_t)row, 0};
+        HitRecord primary;
+        bool hit = gbuffer_hit(&job->guides, pixel, &primary);
+        job->image[pixel] = integrator_shade(job->scene, job->integrator, &sample, &ray,
+                                             hit ? &primary : NULL, &worker->hit_cache);
+        shaded++;
+    }
+    return shaded;
+}
+
+/**
+ * @brief How much a sample that sees the given surface tells about a pixel
+ * Samples on another object (or the background) get no weight; on the
+ * same object the weight falls off with the relative depth difference.
+ */
+static float range_weight(const PreviewJob *job, size_t pixel, size_t sample) {
+    const GBuffer *guides = &job->guides;
+    if (guides->object[pixel] != guides->object[sample]) {
+        return 0.0f;
+    }
+    if (guides->object[pixel] < 0) {
+        return 1.0f;
+    }
+    float z = guides->depth[pixel];
+    float dz = (guides->depth[sample] - z) / (PREVIEW_DEPTH_SIGMA * z);
+    return expf(-0.5f * dz * dz);
+}
+
+/**
+ * @brief Joint bilateral upsampling of one pixel from the current level's samples
+ * The four surrounding samples are weighted bilinearly and by their range
+ * weight. If none of them sees the pixel's surface, the ring of twelve
+ * samples around them is searched; failing that, the nearest sample is used.
+ */
+static Color upsample_pixel(const PreviewJob *job, int i, int row) {
+    int width = job->camera->image_width;
+    int height = job->camera->image_height;
+    int f = job->factor;
+    size_t pixel = (size_t)row * (size_t)width + (size_t)i;
+    int x0 = i / f * f;
+    int y0 = row / f * f;
+    int x1 = x0 + f < width ? x0 + f : x0;
+    int y1 = y0 + f < height ? y0 + f : y0;
+    float fx = (float)(i - x0) / (float)f;
+    float fy = (float)(row - y0) / (float)f;
+    int xs[2] = {x0, x1};
+    int ys[2] = {y0, y1};
+    float wx[2] = {1.0f - fx, fx};
+    float wy[2] = {1.0f - fy, fy};
+
+    Color sum = color_black();
+    float total = 0.0f;
+    float nearest_weight = -1.0f;
+    size_t nearest = 0;
+    for (int b = 0; b < 2; b++) {
+        for (int a = 0; a < 2; a++) {
+            size_t sample = (size_t)ys[b] * (size_t)width + (size_t)xs[a];
+            float spatial = wx[a] * wy[b];
+            if (spatial > nearest_weight) {
+                nearest_weight = spatial;
+                nearest = sample;
+            }
+            float w = spatial * range_weight(job, pixel, sample);
+            sum = color_add(sum, color_scale(job->image[sample], w));
+            total += w;
+        }
+    }
+    if (total > 0.0f) {
+        return color_scale(sum, 1.0f / total);
+    }
+
+    // A thin object or an edge: look for its samples one step further out
+    for (int y = y0 - f; y <= y0 + 2 * f; y += f) {
+        for (int x = x0 - f; x <= x0 + 2 * f; x += f) {
+            if (y < 0 || y >= height || x < 0 || x >= width) {
+                continue;
+            }
+            size_t sample = (size_t)y * (size_t)width + (size_t)x;
+            float dx = (float)(x - i) / (float)f;
+            float dy = (float)(y - row) / (float)f;
+            float w = range_weight(job, pixel, sample) / (1.0f + dx * dx + dy * dy);
+            sum = color_add(sum, color_scale(job->image[sample], w));
+            total += w;
+        }
+    }
+    return total > 0.0f ? color_scale(sum, 1.0f / total) : job->image[nearest];
+}
+
+/**
+ * @brief Fill in the pixels of a row that are not samples of the current level
+ */
+static void upsample_row(PreviewJob *job, int row) {
+    int width = job->camera->image_width;
+    int f = job->factor;
+    for (int i = 0; i < width; i++) {
+        if (row % f != 0 || i % f != 0) {
+            job->image[(size_t)row * (size_t)width + (size_t)i] = upsample_pixel(job, i, row);
+        }
+    }
+}
+
+static void *preview_worker(void *arg) {
+    PreviewWorker *worker = (PreviewWorker *)arg;
+    PreviewJob *job = worker->job;
+    int height = job->camera->image_height;
+    for (;;) {
+        if ((job->cancellable && atomic_load_explicit(&stop_requested, memory_order_relaxed)) ||
+            (job->cancel && atomic_load_explicit(job->cancel, memory_order_relaxed))) {
+            break;
+        }
+        int row = atomic_fetch_add_explicit(&job->next_row, 1, memory_order_relaxed);
+        if (row >= height) {
+            break;
+        }
+        double start = timer_now_seconds();
+        uint64_t rays = scene_hit_cache_rays(&worker->hit_cache);
+        uint64_t traced = 0;
+        if (job->pass == PREVIEW_PASS_GUIDES) {
+            traced = guide_row(job, worker, row);
+        } else if (job->pass == PREVIEW_PASS_SHADE) {
+            traced = shade_row(job, worker, row);
+        } else {
+            upsample_row(job, row);
+        }
+        atomic_fetch_add_explicit(&job->rows_done, 1, memory_order_relaxed);
+        if (traced > 0) {
+            progress_add_busy(job->progress, worker->index, timer_now_seconds() - start);
+            // Pixels are the work; shading with the path integrator casts more rays
+            progress_add_work(job->progress, traced,
+                              scene_hit_cache_rays(&worker->hit_cache) - rays);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Run one pass over every row
+ * @return false if a stop request cut the pass short
+ */
+static bool run_pass(PreviewJob *job, PreviewPass pass, PreviewWorker *workers,
+                     pthread_t *threads, int thread_count) {
+    job->pass = pass;
+    atomic_store(&job->next_row, 0);
+    atomic_store(&job->rows_done, 0);
+    int started = 0;
+    for (; started < thread_count; started++) {
+        if (pthread_create(&threads[started], NULL, preview_worker, &workers[started]) != 0) {
+            break;
+        }
+    }
+    if (started == 0) {
+        preview_worker(&workers[0]);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    return atomic_load(&job->rows_done) >= job->camera->image_height;
+}
+
+/**
+ * @brief Write the current level to a temporary file and move it into place
+ */
+static bool write_image(const PreviewJob *job, const RenderSettings *settings, const char *path,
+                        RenderStats *stats) {
+    int width = job->camera->image_width;
+    int height = job->camera->image_height;
+    char temp_path[4096];
+    if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", path) >= (int)sizeof(temp_path)) {
+        return false;
+    }
+    FILE *file = fopen(temp_path, "wb");
+    if (!file) {
+        return false;
+    }
+    OutputPipeline pipeline;
+    ImageSpec spec = image_spec_rgb(settings->output_format, settings->half_float, width, height);
+    if (!output_pipeline_start(&pipeline, file, &spec, job->tile_size, WRITE_PIPELINE_CAPACITY)) {
+        fclose(file);
+        remove(temp_path);
+        return false;
+    }
+    bool float_pixels = image_format_is_float(settings->output_format);
+    for (int band = 0; band < pipeline.band_count; band++) {
+        uint8_t *pixels = output_pipeline_acquire_band(&pipeline, band);
+        int y0 = band * pipeline.band_height;
+        int y1 = y0 + pipeline.band_height < height ? y0 + pipeline.band_height : height;
+        size_t first = (size_t)y0 * (size_t)width;
+        size_t count = (size_t)(y1 - y0) * (size_t)width;
+        for (size_t k = 0; k < count; k++) {
+            uint8_t *out = pixels + k * pipeline.pixel_bytes;
+            if (float_pixels) {
+                *(Color *)out = job->image[first + k];
+            } else {
+                color_to_u8(job->image[first + k], &out[0], &out[1], &out[2]);
+            }
+        }
+        output_pipeline_submit(&pipeline, band, (uint64_t)count);
+    }
+    bool ok = output_pipeline_finish(&pipeline);
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(temp_path, path) != 0) {
+        remove(temp_path);
+        return false;
+    }
+    stats->encode_seconds += pipeline.encode_seconds + pipeline.prepare_seconds;
+    stats->writer_wait_seconds += pipeline.wait_seconds;
+    stats->bytes_written = pipeline.bytes_written;
+    stats->io_backend = pipeline.io_backend;
+    stats->working_set_bytes = pipeline.memory_bytes;
+    return true;
+}
+
+/**
+ * @brief Copy the current level into the live framebuffer, tile by tile
+ * @param scratch One tile of pixels in the framebuffer's format
+ */
+static void publish_live(const PreviewJob *job, SharedFramebuffer *live, uint8_t *scratch) {
+    int width = job->camera->image_width;
+    int height = job->camera->image_height;
+    size_t pixel_bytes = live->header->pixel_bytes;
+    int tiles_y = (height + job->tile_size - 1) / job->tile_size;
+    for (int ty = 0; ty < tiles_y; ty++) {
+        for (int tx = 0; tx < job->tiles_x; tx++) {
+            int x0 = tx * job->tile_size;
+            int y0 = ty * job->tile_size;
+            int x1 = x0 + job->tile_size < width ? x0 + job->tile_size : width;
+            int y1 = y0 + job->tile_size < height ? y0 + job->tile_size : height;
+            size_t stride = (size_t)(x1 - x0) * pixel_bytes;
+            for (int row = y0; row < y1; row++) {
+                for (int i = x0; i < x1; i++) {
+                    Color c = job->image[(size_t)row * (size_t)width + (size_t)i];
+                    uint8_t *out = scratch + (size_t)(row - y0) * stride +
+                                   (size_t)(i - x0) * pixel_bytes;
+                    if (live->header->format == SHARED_FRAMEBUFFER_RGB32F) {
+                        *(Color *)out = c;
+                    } else {
+                        color_to_u8(c, &out[0], &out[1], &out[2]);
+                    }
+                }
+            }
+            shared_framebuffer_write_tile(live, (uint64_t)ty * (uint64_t)job->tiles_x +
+                                                    (uint64_t)tx,
+                                          scratch, stride);
+        }
+    }
+}
+
+bool render_preview(const Camera *camera, const Scene *scene, const RenderSettings *settings,
+                    int factor, const char *output_path, RenderStats *stats,
+                    PreviewStats *preview_stats) {
+    if (!preview_factor_valid(factor) || settings->aovs || settings->gbuffer ||
+        settings->cache || settings->cull_lights) {
+        return false;
+    }
+    int width = camera->image_width;
+    int height = camera->image_height;
+    int tile_size = settings->tile_size > 0 ? settings->tile_size : RENDER_DEFAULT_TILE_SIZE;
+    int tiles_x = (width + tile_size - 1) / tile_size;
+    uint64_t tile_count = (uint64_t)tiles_x * (uint64_t)((height + tile_size - 1) / tile_size);
+    int thread_count = settings->thread_count > 0 ? settings->thread_count
+                                                  : render_default_thread_count();
+    if (thread_count > height) {
+        thread_count = height;
+    }
+    double start = timer_now_seconds();
+
+    PreviewJob job;
+    SharedFramebuffer live;
+    SharedFramebuffer *live_output = NULL;
+    Progress progress;
+    RenderStats totals;
+    PreviewStats result;
+    memset(&totals, 0, sizeof(totals));
+    memset(&result, 0, sizeof(result));
+    job.camera = camera;
+    job.scene = scene;
+    job.integrator = &settings->integrator;
+    job.tile_size = tile_size;
+    job.tiles_x = tiles_x;
+    job.factor = factor;
+    job.previous = 0;
+    job.cancellable = false;
+    job.cancel = settings->cancel;
+    job.progress = &progress;
+    atomic_init(&job.next_row, 0);
+    atomic_init(&job.rows_done, 0);
+
+    size_t pixels = (size_t)width * (size_t)height;
+    size_t scratch_bytes = (size_t)tile_size * (size_t)tile_size *
+                           image_format_pixel_bytes(settings->output_format);
+    bool guides_ready = gbuffer_create(&job.guides, width, height);
+    job.image = malloc(pixels * sizeof(Color));
+    job.tile_objects = malloc((size_t)tile_count * sizeof(SceneObjectSet));
+    PreviewWorker *workers = calloc((size_t)thread_count, sizeof(PreviewWorker));
+    pthread_t *threads = malloc((size_t)thread_count * sizeof(pthread_t));
+    bool publish = settings->framebuffer || settings->shm_name;
+    uint8_t *scratch = publish ? malloc(scratch_bytes) : NULL;
+    bool ok = guides_ready && job.image && job.tile_objects && workers && threads &&
+              (scratch || !publish);
+    bool sampler_ready = ok && sampler_init(&job.sampler, settings->sampler, 0);
+    ok = sampler_ready;
+    if (ok) {
+        scene_bin_objects(scene, camera, tile_size, job.tile_objects);
+        for (int i = 0; i < thread_count; i++) {
+            workers[i].job = &job;
+            workers[i].index = i;
+            scene_hit_cache_init(&workers[i].hit_cache);
+        }
+    }
+    // The guide pass traces every pixel once, and so do all levels together
+    ok = ok && progress_start(&progress, settings->progress_mode, settings->progress_interval,
+                              2 * (uint64_t)pixels, thread_count, stderr);
+    bool progress_running = ok;
+    SharedFramebufferFormat live_format = image_format_is_float(settings->output_format)
+                                              ? SHARED_FRAMEBUFFER_RGB32F
+                                              : SHARED_FRAMEBUFFER_RGB8;
+    if (ok && settings->framebuffer) {
+        const SharedFramebufferHeader *header = settings->framebuffer->header;
+        ok = header->width == (uint32_t)width && header->height == (uint32_t)height &&
+             header->tile_size == (uint32_t)tile_size && header->format == (uint32_t)live_format;
+        live_output = ok ? settings->framebuffer : NULL;
+        if (ok) {
+            shared_framebuffer_set_state(live_output, SHARED_FRAMEBUFFER_RENDERING);
+        }
+    } else if (ok && settings->shm_name) {
+        ok = shared_framebuffer_create(&live, settings->shm_name, width, height, live_format,
+                                       tile_size);
+        live_output = ok ? &live : NULL;
+    }
+
+    if (ok) {
+        ok = run_pass(&job, PREVIEW_PASS_GUIDES, workers, threads, thread_count);
+        result.guide_seconds = timer_now_seconds() - start;
+    }
+    while (ok) {
+        // The first level is always finished, so there is an image to show
+        job.cancellable = result.levels > 0;
+        if (!run_pass(&job, PREVIEW_PASS_SHADE, workers, threads, thread_count) ||
+            (job.factor > 1 &&
+             !run_pass(&job, PREVIEW_PASS_UPSAMPLE, workers, threads, thread_count))) {
+            // A cancelled preview fails like a cancelled render; a stop request keeps its levels
+            ok = !(job.cancel && atomic_load(job.cancel));
+            break;
+        }
+        if (live_output) {
+            publish_live(&job, live_output, scratch);
+        }
+        ok = write_image(&job, settings, output_path, &totals);
+        result.levels++;
+        result.shaded_pixels += level_samples(width, height, job.factor) -
+                                (job.previous > 0 ? level_samples(width, height, job.previous)
+                                                  : 0);
+        result.final_factor = job.factor;
+        if (result.levels == 1) {
+            result.first_frame_seconds = timer_now_seconds() - start;
+        }
+        if (job.factor == 1 || atomic_load(&stop_requested)) {
+            break;
+        }
+        if (job.cancel && atomic_load(job.cancel)) {
+            ok = false;
+            break;
+        }
+        job.previous = job.factor;
+        job.factor /= 2;
+    }
+    if (progress_running) {
+        progress_set_total(&progress, atomic_load(&progress.work_done));
+        progress_finish(&progress);
+    }
+    if (live_output) {
+        shared_framebuffer_set_state(live_output, ok ? SHARED_FRAMEBUFFER_COMPLETE
+                                                     : SHARED_FRAMEBUFFER_FAILED);
+        if (live_output != settings->framebuffer) {
+            shared_framebuffer_close(live_output);
+        }
+    }
+
+    if (preview_stats) {
+        *preview_stats = result;
+    }
+    if (stats) {
+        *stats = totals;
+        stats->thread_count = thread_count;
+        stats->render_seconds = timer_now_seconds() - start;
+        stats->first_tile_seconds = result.first_frame_seconds;
+        stats->rays = progress_running ? atomic_load(&progress.rays) : 0;
+        stats->working_set_bytes += pixels * (2 * sizeof(Vec3) + 2 * sizeof(Color) +
+                                              sizeof(float) + sizeof(int32_t)) +
+                                    (size_t)tile_count * sizeof(SceneObjectSet);
+        for (int i = 0; workers && i < thread_count; i++) {
+            stats->hit_queries += workers[i].hit_cache.hit_queries;
+            stats->hit_cache_hits += workers[i].hit_cache.hit_hits;
+            stats->occlusion_queries += workers[i].hit_cache.occlusion_queries;
+            stats->occlusion_cache_hits += workers[i].hit_cache.occlusion_hits;
+        }
+    }
+
+    // A request applies to the preview it interrupted
+    atomic_store(&stop_requested, false);
+    free(scratch);
+    free(threads);
+    free(workers);
+    free(job.tile_objects);
+    free(job.image);
+    if (guides_ready) {
+        gbuffer_destroy(&job.guides);
+    }
+    if (sampler_ready) {
+        sampler_destroy(&job.sampler);
+    }
+    return ok;
+}
@@ -0,0 +1,186 @@
+/**
+ * @file progress.c
+ * @brief Lock-free, rate-limited render progress reporting
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "progress.h"
+#include "timer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @brief Longest the reporter sleeps before checking for shutdown
+ */
+#define PROGRESS_POLL_SECONDS 0.05
+
+bool progress_parse_mode(const char *name, ProgressMode *mode) {
+    if (strcmp(name, "bar") == 0) {
+        *mode = PROGRESS_BAR;
+    } else if (strcmp(name, "quiet") == 0) {
+        *mode = PROGRESS_QUIET;
+    } else if (strcmp(name, "json") == 0) {
+        *mode = PROGRESS_JSON;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void progress_sample(const Progress *progress, double now, ProgressSample *sample) {
+    uint64_t done = atomic_load_explicit(&progress->work_done, memory_order_relaxed);
+    uint64_t rays = atomic_load_explicit(&progress->rays, memory_order_relaxed);
+    uint64_t total = atomic_load_explicit(&progress->total_work, memory_order_relaxed);
+    sample->elapsed = now - progress->start_time;
+    sample->fraction = total > 0 ? (double)done / (double)total : 1.0;
+    if (sample->fraction > 1.0) {
+        sample->fraction = 1.0;
+    }
+    sample->rays_per_second = sample->elapsed > 0.0 ? (double)rays / sample->elapsed : 0.0;
+    sample->eta = sample->fraction > 0.0
+                      ? sample->elapsed * (1.0 - sample->fraction) / sample->fraction
+                      : -1.0;
+}
+
+/**
+ * @brief Print one report
+ * @param utilization Busy fraction per thread over the last interval
+ * @param final True for the last report of the job
+ */
+static void progress_report(const Progress *progress, const double *utilization, bool final) {
+    ProgressSample sample;
+    progress_sample(progress, timer_now_seconds(), &sample);
+    FILE *out = progress->stream;
+
+    if (progress->mode == PROGRESS_JSON) {
+        fprintf(out, "{\"event\":\"%s\",\"elapsed\":%.3f,\"percent\":%.2f,"
+                     "\"rays_per_sec\":%.0f,\"eta\":%.3f,\"utilization\":[",
+                final ? "done" : "progress", sample.elapsed, sample.fraction * 100.0,
+                sample.rays_per_second, sample.eta);
+        for (int i = 0; i < progress->thread_count; i++) {
+            fprintf(out, "%s%.3f", i > 0 ? "," : "", utilization[i]);
+        }
+        fprintf(out, "]}\n");
+    } else {
+        double average = 0.0;
+        for (int i = 0; i < progress->thread_count; i++) {
+            average += utilization[i];
+        }
+        average /= progress->thread_count > 0 ? progress->thread_count : 1;
+        fprintf(out, "\rRendering: %5.1f%% | %7.2f Mrays/s | ETA %6.1fs | %d threads, %3.0f%% busy ",
+                sample.fraction * 100.0, sample.rays_per_second * 1e-6,
+                sample.eta > 0.0 ? sample.eta : 0.0, progress->thread_count, average * 100.0);
+        if (final) {
+            fprintf(out, "\nDone in %.2fs.\n", sample.elapsed);
+        }
+    }
+    fflush(out);
+}
+
+/**
+ * @brief Busy fraction of each thread since the previous call
+ */
+static void progress_utilization(const Progress *progress, uint64_t *last_busy, double window,
+                                 double *utilization) {
+    for (int i = 0; i < progress->thread_count; i++) {
+        uint64_t busy = atomic_load_explicit(&progress->threads[i].busy_ns, memory_order_relaxed);
+        double fraction = window > 0.0 ? (double)(busy - last_busy[i]) * 1e-9 / window : 0.0;
+        utilization[i] = fraction > 1.0 ? 1.0 : fraction;
+        last_busy[i] = busy;
+    }
+}
+
+static void *progress_reporter(void *arg) {
+    Progress *progress = (Progress *)arg;
+    uint64_t *last_busy = calloc((size_t)progress->thread_count, sizeof(uint64_t));
+    double *utilization = calloc((size_t)progress->thread_count, sizeof(double));
+    if (!last_busy || !utilization) {
+        free(last_busy);
+        free(utilization);
+        return NULL;
+    }
+
+    double last_report = progress->start_time;
+    while (atomic_load(&progress->running)) {
+        double now = timer_now_seconds();
+        double wait = last_report + progress->interval - now;
+        if (wait <= 0.0) {
+            progress_utilization(progress, last_busy, now - last_report, utilization);
+            progress_report(progress, utilization, false);
+            last_report = now;
+            continue;
+        }
+        if (wait > PROGRESS_POLL_SECONDS) {
+            wait = PROGRESS_POLL_SECONDS;
+        }
+        struct timespec ts;
+        ts.tv_sec = (time_t)wait;
+        ts.tv_nsec = (long)((wait - (double)ts.tv_sec) * 1e9);
+        nanosleep(&ts, NULL);
+    }
+
+    free(last_busy);
+    free(utilization);
+    return NULL;
+}
+
+bool progress_start(Progress *progress, ProgressMode mode, double interval,
+                    uint64_t total_work, int thread_count, FILE *stream) {
+    progress->mode = mode;
+    progress->interval = interval > 0.0 ? interval : PROGRESS_DEFAULT_INTERVAL;
+    progress->stream = stream;
+    atomic_init(&progress->total_work, total_work);
+    atomic_init(&progress->work_done, 0);
+    atomic_init(&progress->rays, 0);
+    progress->thread_count = thread_count;
+    progress->has_reporter = false;
+    progress->start_time = timer_now_seconds();
+    atomic_init(&progress->running, true);
+
+    void *slots = NULL;
+    if (posix_memalign(&slots, _Alignof(ProgressThreadSlot),
+                       (size_t)thread_count * sizeof(ProgressThreadSlot)) != 0) {
+        progress->threads = NULL;
+        return false;
+    }
+    progress->threads = slots;
+    for (int i = 0; i < thread_count; i++) {
+        atomic_init(&progress->threads[i].busy_ns, 0);
+    }
+
+    if (mode != PROGRESS_QUIET) {
+        if (pthread_create(&progress->reporter, NULL, progress_reporter, progress) != 0) {
+            free(progress->threads);
+            progress->threads = NULL;
+            return false;
+        }
+        progress->has_reporter = true;
+    }
+    return true;
+}
+
+void progress_finish(Progress *progress) {
+    atomic_store(&progress->running, false);
+    if (progress->has_reporter) {
+        pthread_join(progress->reporter, NULL);
+        progress->has_reporter = false;
+    }
+
+    if (progress->mode != PROGRESS_QUIET && progress->threads) {
+        // Final report: utilization over the whole job
+        double elapsed = timer_now_seconds() - progress->start_time;
+        double *utilization = calloc((size_t)progress->thread_count, sizeof(double));
+        uint64_t *zero = calloc((size_t)progress->thread_count, sizeof(uint64_t));
+        if (utilization && zero) {
+            progress_utilization(progress, zero, elapsed, utilization);
+            progress_report(progress, utilization, true);
+        }
+        free(utilization);
+        free(zero);
+    }
+
+    free(progress->threads);
+    progress->threads = NULL;
+}
@@ -0,0 +1,666 @@
+/**
+ * @file progressive.c
+ * @brief Progressive rendering under a time, sample or noise budget
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "progressive.h"
+#include "denoise.h"
+#include "output_pipeline.h"
+#include "shared_framebuffer.h"
+#include "timer.h"
+#include <math.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/**
+ * @brief Floats accumulated per pixel: R, G, B and squared luminance
+ */
+#define ACCUM_CHANNELS 4
+
+/**
+ * @brief Floats accumulated per pixel for denoising: normal, depth, albedo
+ */
+#define GUIDE_CHANNELS 7
+
+/**
+ * @brief Band slots used when writing the accumulated image
+ */
+#define WRITE_PIPELINE_CAPACITY 2
+
+/**
+ * @brief Set by progressive_request_stop (lock-free, so safe in signal handlers)
+ */
+static atomic_bool stop_requested = false;
+
+/**
+ * @brief State shared by the workers of a progressive render
+ */
+typedef struct {
+    const Camera *camera;       ///< Camera
+    const Scene *scene;         ///< Scene
+    const IntegratorSettings *integrator; ///< Light transport
+    Sampler sampler;            ///< Places samples within pixels
+    float *accum;               ///< ACCUM_CHANNELS sums per pixel, top row first
+    float *guides;              ///< GUIDE_CHANNELS sums per pixel (NULL unless denoising)
+    uint32_t *tile_samples;     ///< Samples accumulated in each tile
+    SceneObjectSet *tile_objects; ///< Objects the camera rays of each tile can hit
+    uint64_t *active;           ///< Tiles the current pass samples
+    uint64_t active_count;      ///< Entries in active
+    bool float_pixels;          ///< Output and live pixels are Color instead of RGB8
+    int tile_size;              ///< Tile edge in pixels
+    int tiles_x;                ///< Tiles per row
+    uint64_t tile_count;        ///< Tiles in the image
+    double deadline;            ///< Wall-clock stop time (0: none)
+    atomic_uint_fast64_t next_tile; ///< Next tile of the current pass to claim
+    atomic_bool interrupted;    ///< A worker stopped the pass early
+    SharedFramebuffer *live;    ///< Live framebuffer (NULL if none)
+    Progress *progress;         ///< Progress counters
+} ProgressiveJob;
+
+/**
+ * @brief Per-worker arguments
+ */
+typedef struct {
+    ProgressiveJob *job;  ///< Shared job
+    int index;            ///< Worker index (progress slot)
+    uint8_t *scratch;     ///< One tile of output pixels for the live framebuffer
+    SceneHitCache hit_cache; ///< Objects this worker's rays hit last
+} ProgressiveWorker;
+
+ProgressiveSettings progressive_default_settings(void) {
+    ProgressiveSettings settings;
+    settings.max_samples = 0;
+    settings.time_budget = 0.0;
+    settings.target_noise = 0.0;
+    settings.update_interval = 0.0;
+    settings.adaptive_threshold = 0.0;
+    settings.min_samples = PROGRESSIVE_DEFAULT_MIN_SAMPLES;
+    settings.denoise_strength = 0.0f;
+    return settings;
+}
+
+const char *progressive_stop_reason_name(ProgressiveStopReason reason) {
+    switch (reason) {
+        case PROGRESSIVE_STOP_SAMPLES:
+            return "samples";
+        case PROGRESSIVE_STOP_DEADLINE:
+            return "deadline";
+        case PROGRESSIVE_STOP_NOISE:
+            return "noise";
+        case PROGRESSIVE_STOP_CONVERGED:
+            return "convergence";
+        default:
+            return "request";
+    }
+}
+
+void progressive_request_stop(void) {
+    atomic_store(&stop_requested, true);
+}
+
+/**
+ * @brief Offset of a sample within its pixel, in [-0.5, 0.5)
+ * Sample 0 sits at the pixel position; the sampler's sequence starts at
+ * sample 1, so its stratification covers every later sample.
+ */
+static float sample_offset(const Sampler *sampler, int x, int y, uint32_t sample,
+                           uint32_t dimension) {
+    if (sample == 0) {
+        return 0.0f;
+    }
+    return sampler_get(sampler, (uint32_t)x, (uint32_t)y, sample - 1, dimension) - 0.5f;
+}
+
+static float luminance(float r, float g, float b) {
+    return 0.2126f * r + 0.7152f * g + 0.0722f * b;
+}
+
+/**
+ * @brief Average of a pixel's samples in output format (black without samples)
+ */
+static void resolve_pixel(const float *accum, uint32_t samples, bool float_pixels, void *out) {
+    Color color = color_black();
+    if (samples > 0) {
+        float n = (float)samples;
+        color = color_create(accum[0] / n, accum[1] / n, accum[2] / n);
+    }
+    if (float_pixels) {
+        *(Color *)out = color;
+    } else {
+        uint8_t *rgb = out;
+        color_to_u8(color, &rgb[0], &rgb[1], &rgb[2]);
+    }
+}
+
+/**
+ * @brief Add one sample to every pixel of a tile
+ */
+static void sample_tile(ProgressiveWorker *worker, uint64_t tile) {
+    const ProgressiveJob *job = worker->job;
+    const Camera *camera = job->camera;
+    int width = camera->image_width;
+    int height = camera->image_height;
+    int x0 = (int)(tile % (uint64_t)job->tiles_x) * job->tile_size;
+    int y0 = (int)(tile / (uint64_t)job->tiles_x) * job->tile_size;
+    int x1 = x0 + job->tile_size < width ? x0 + job->tile_size : width;
+    int y1 = y0 + job->tile_size < height ? y0 + job->tile_size : height;
+    uint32_t sample = job->tile_samples[tile];
+    for (int row = y0; row < y1; row++) {
+        int j = height - 1 - row;
+        for (int i = x0; i < x1; i++) {
+            uint32_t pixel = (uint32_t)row * (uint32_t)width + (uint32_t)i;
+            float u, v;
+            camera_sample_to_uv(camera, i, j, sample_offset(&job->sampler, i, row, sample, 0),
+                                sample_offset(&job->sampler, i, row, sample, 1), &u, &v);
+            Ray ray = camera_get_ray(camera, u, v);
+            PathSample path = {&job->sampler, (uint32_t)i, (uint32_t)row, sample};
+            Color c;
+            HitRecord primary;
+            bool hit = integrator_trace_objects(job->scene, job->integrator, &path, &ray,
+                                                job->tile_objects[tile], &worker->hit_cache, &c,
+                                                &primary);
+            if (job->guides) {
+                float *guide = &job->guides[(size_t)pixel * GUIDE_CHANNELS];
+                Color albedo = hit ? primary.albedo : job->scene->background_color;
+                if (hit) {
+                    guide[0] += primary.normal.x;
+                    guide[1] += primary.normal.y;
+                    guide[2] += primary.normal.z;
+                    guide[3] += primary.t;
+                }
+                guide[4] += albedo.x;
+                guide[5] += albedo.y;
+                guide[6] += albedo.z;
+            }
+            float *accum = &job->accum[(size_t)pixel * ACCUM_CHANNELS];
+            float lum = luminance(c.x, c.y, c.z);
+            accum[0] += c.x;
+            accum[1] += c.y;
+            accum[2] += c.z;
+            accum[3] += lum * lum;
+        }
+    }
+    // Each tile has one owner per pass, and passes are separated by joins
+    uint32_t samples = ++job->tile_samples[tile];
+
+    if (job->live) {
+        size_t pixel_bytes = job->float_pixels ? sizeof(Color) : 3;
+        size_t stride = (size_t)(x1 - x0) * pixel_bytes;
+        for (int row = y0; row < y1; row++) {
+            for (int i = x0; i < x1; i++) {
+                size_t pixel = (size_t)row * (size_t)width + (size_t)i;
+                resolve_pixel(&job->accum[pixel * ACCUM_CHANNELS], samples, job->float_pixels,
+                              worker->scratch + (size_t)(row - y0) * stride +
+                                  (size_t)(i - x0) * pixel_bytes);
+            }
+        }
+        shared_framebuffer_write_tile(job->live, tile, worker->scratch, stride);
+    }
+}
+
+static void *progressive_worker(void *arg) {
+    ProgressiveWorker *worker = (ProgressiveWorker *)arg;
+    ProgressiveJob *job = worker->job;
+    for (;;) {
+        uint64_t next = atomic_fetch_add_explicit(&job->next_tile, 1, memory_order_relaxed);
+        if (next >= job->active_count) {
+            break;
+        }
+        uint64_t tile = job->active[next];
+        // Only tiles that already have a sample may be left, so none is written black
+        if (job->tile_samples[tile] > 0 &&
+            (atomic_load_explicit(&stop_requested, memory_order_relaxed) ||
+             (job->deadline > 0.0 && timer_now_seconds() >= job->deadline))) {
+            atomic_store_explicit(&job->interrupted, true, memory_order_relaxed);
+            break;
+        }
+        double start = timer_now_seconds();
+        // Camera, bounce and shadow rays all go through the worker's cache
+        uint64_t rays = scene_hit_cache_rays(&worker->hit_cache);
+        sample_tile(worker, tile);
+        progress_add_busy(job->progress, worker->index, timer_now_seconds() - start);
+        progress_add_work(job->progress, 1, scene_hit_cache_rays(&worker->hit_cache) - rays);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Run one pass over the active tiles (fewer if interrupted)
+ */
+static void run_pass(ProgressiveJob *job, ProgressiveWorker *workers, pthread_t *threads,
+                     int thread_count) {
+    atomic_store(&job->next_tile, 0);
+    int started = 0;
+    for (; started < thread_count; started++) {
+        if (pthread_create(&threads[started], NULL, progressive_worker, &workers[started]) != 0) {
+            break;
+        }
+    }
+    if (started == 0) {
+        progressive_worker(&workers[0]);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+/**
+ * @brief Sum over a tile's pixels of the squared standard error of their mean
+ *        luminance, relative to that luminance (at least PROGRESSIVE_NOISE_FLOOR)
+ * The tile must have at least two samples.
+ * @param pixels Set to the number of pixels in the tile
+ */
+static double tile_noise_sum(const ProgressiveJob *job, uint64_t tile, uint64_t *pixels) {
+    int width = job->camera->image_width;
+    int height = job->camera->image_height;
+    int x0 = (int)(tile % (uint64_t)job->tiles_x) * job->tile_size;
+    int y0 = (int)(tile / (uint64_t)job->tiles_x) * job->tile_size;
+    int x1 = x0 + job->tile_size < width ? x0 + job->tile_size : width;
+    int y1 = y0 + job->tile_size < height ? y0 + job->tile_size : height;
+    double n = (double)job->tile_samples[tile];
+    double total = 0.0;
+    for (int row = y0; row < y1; row++) {
+        for (int i = x0; i < x1; i++) {
+            const float *accum = &job->accum[((size_t)row * (size_t)width + (size_t)i) *
+                                             ACCUM_CHANNELS];
+            double mean = (double)luminance(accum[0], accum[1], accum[2]) / n;
+            double variance = ((double)accum[3] - n * mean * mean) / (n - 1.0);
+            double scale = mean > PROGRESSIVE_NOISE_FLOOR ? mean : PROGRESSIVE_NOISE_FLOOR;
+            total += (variance > 0.0 ? variance : 0.0) / (n * scale * scale);
+        }
+    }
+    *pixels = (uint64_t)(x1 - x0) * (uint64_t)(y1 - y0);
+    return total;
+}
+
+/**
+ * @brief Root mean square over pixels of the relative standard error of
+ *        their mean luminance (see tile_noise_sum)
+ * @return Infinity while some tile has fewer than two samples
+ */
+static double estimate_noise(const ProgressiveJob *job) {
+    double total = 0.0;
+    uint64_t pixels = 0;
+    for (uint64_t t = 0; t < job->tile_count; t++) {
+        if (job->tile_samples[t] < 2) {
+            return INFINITY;
+        }
+        uint64_t tile_pixels;
+        total += tile_noise_sum(job, t, &tile_pixels);
+        pixels += tile_pixels;
+    }
+    return sqrt(total / (double)pixels);
+}
+
+/**
+ * @brief Drop the tiles that need no more samples from the active list
+ * A tile is done at max_samples or, with adaptive sampling, once it has
+ * min_samples and its own noise is at or below the threshold.
+ * @return Tiles retired as converged
+ */
+static uint64_t retire_tiles(ProgressiveJob *job, const ProgressiveSettings *progressive) {
+    uint32_t min_samples = progressive->min_samples > 2 ? (uint32_t)progressive->min_samples : 2;
+    uint64_t kept = 0;
+    uint64_t converged = 0;
+    for (uint64_t k = 0; k < job->active_count; k++) {
+        uint64_t tile = job->active[k];
+        uint32_t samples = job->tile_samples[tile];
+        if (progressive->max_samples > 0 && samples >= (uint32_t)progressive->max_samples) {
+            continue;
+        }
+        if (progressive->adaptive_threshold > 0.0 && samples >= min_samples) {
+            uint64_t pixels;
+            double noise = sqrt(tile_noise_sum(job, tile, &pixels) / (double)pixels);
+            if (noise <= progressive->adaptive_threshold) {
+                converged++;
+                continue;
+            }
+        }
+        job->active[kept++] = tile;
+    }
+    job->active_count = kept;
+    return converged;
+}
+
+/**
+ * @brief Denoise the accumulated image, guided by the averaged primary features
+ * @param denoised Output colors, top row first
+ * @return false on allocation failure
+ */
+static bool denoise_accumulation(const ProgressiveJob *job, const RenderSettings *settings,
+                                 float strength, Color *denoised) {
+    int width = job->camera->image_width;
+    int height = job->camera->image_height;
+    size_t count = (size_t)width * (size_t)height;
+    Color *color = malloc(count * sizeof(Color));
+    Color *albedo = malloc(count * sizeof(Color));
+    Vec3 *normal = malloc(count * sizeof(Vec3));
+    float *depth = malloc(count * sizeof(float));
+    float *variance = malloc(count * sizeof(float));
+    bool ok = color && albedo && normal && depth && variance;
+    for (size_t p = 0; ok && p < count; p++) {
+        size_t tile = (p / (size_t)width / (size_t)job->tile_size) * (size_t)job->tiles_x +
+                      (p % (size_t)width) / (size_t)job->tile_size;
+        uint32_t samples = job->tile_samples[tile];
+        const float *accum = &job->accum[p * ACCUM_CHANNELS];
+        const float *guide = &job->guides[p * GUIDE_CHANNELS];
+        float inv = samples > 0 ? 1.0f / (float)samples : 0.0f;
+        resolve_pixel(accum, samples, true, &color[p]);
+        normal[p] = vec3_create(guide[0] * inv, guide[1] * inv, guide[2] * inv);
+        depth[p] = guide[3] * inv;
+        albedo[p] = color_create(guide[4] * inv, guide[5] * inv, guide[6] * inv);
+        // Variance of the mean luminance, unknown below two samples
+        variance[p] = DENOISE_UNKNOWN_VARIANCE;
+        if (samples > 1) {
+            float n = (float)samples;
+            float mean = luminance(accum[0], accum[1], accum[2]) / n;
+            float v = (accum[3] - n * mean * mean) / ((n - 1.0f) * n);
+            variance[p] = v > 0.0f ? v : 0.0f;
+        }
+    }
+    if (ok) {
+        DenoiseInput input = {width, height, color, variance, normal, depth, albedo};
+        DenoiseSettings denoise = denoise_default_settings();
+        denoise.strength = strength;
+        denoise.thread_count = settings->thread_count;
+        ok = denoise_image(&input, &denoise, denoised);
+    }
+    free(color);
+    free(albedo);
+    free(normal);
+    free(depth);
+    free(variance);
+    return ok;
+}
+
+/**
+ * @brief Write the accumulated (or denoised) image to a temporary file and
+ *        move it into place
+ * @param denoised Colors to write instead of the accumulation (NULL: accumulation)
+ */
+static bool write_image(const ProgressiveJob *job, const RenderSettings *settings,
+                        const Color *denoised, const char *path, RenderStats *stats) {
+    int width = job->camera->image_width;
+    int height = job->camera->image_height;
+    char temp_path[4096];
+    if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", path) >= (int)sizeof(temp_path)) {
+        return false;
+    }
+    FILE *file = fopen(temp_path, "wb");
+    if (!file) {
+        return false;
+    }
+    OutputPipeline pipeline;
+    ImageSpec spec = image_spec_rgb(settings->output_format, settings->half_float, width, height);
+    if (!output_pipeline_start(&pipeline, file, &spec, job->tile_size, WRITE_PIPELINE_CAPACITY)) {
+        fclose(file);
+        remove(temp_path);
+        return false;
+    }
+    for (int band = 0; band < pipeline.band_count; band++) {
+        uint8_t *pixels = output_pipeline_acquire_band(&pipeline, band);
+        int y0 = band * pipeline.band_height;
+        int y1 = y0 + pipeline.band_height < height ? y0 + pipeline.band_height : height;
+        const uint32_t *samples = &job->tile_samples[(size_t)band * (size_t)job->tiles_x];
+        for (int row = y0; row < y1; row++) {
+            for (int i = 0; i < width; i++) {
+                size_t pixel = (size_t)row * (size_t)width + (size_t)i;
+                uint8_t *out = pixels + (pixel - (size_t)y0 * (size_t)width) * pipeline.pixel_bytes;
+                if (!denoised) {
+                    resolve_pixel(&job->accum[pixel * ACCUM_CHANNELS],
+                                  samples[i / job->tile_size], job->float_pixels, out);
+                } else if (job->float_pixels) {
+                    *(Color *)out = denoised[pixel];
+                } else {
+                    color_to_u8(denoised[pixel], &out[0], &out[1], &out[2]);
+                }
+            }
+        }
+        output_pipeline_submit(&pipeline, band, (uint64_t)(y1 - y0) * (uint64_t)width);
+    }
+    bool ok = output_pipeline_finish(&pipeline);
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(temp_path, path) != 0) {
+        remove(temp_path);
+        return false;
+    }
+    stats->encode_seconds += pipeline.encode_seconds + pipeline.prepare_seconds;
+    stats->writer_wait_seconds += pipeline.wait_seconds;
+    stats->bytes_written = pipeline.bytes_written;
+    stats->io_backend = pipeline.io_backend;
+    stats->working_set_bytes = pipeline.memory_bytes;
+    return true;
+}
+
+/**
+ * @brief Write the image, denoised if requested
+ */
+static bool write_output(const ProgressiveJob *job, const RenderSettings *settings,
+                         const ProgressiveSettings *progressive, const char *path,
+                         RenderStats *stats, ProgressiveStats *result) {
+    if (!job->guides) {
+        return write_image(job, settings, NULL, path, stats);
+    }
+    double start = timer_now_seconds();
+    size_t count = (size_t)job->camera->image_width * (size_t)job->camera->image_height;
+    Color *denoised = malloc(count * sizeof(Color));
+    bool ok = denoised && denoise_accumulation(job, settings, progressive->denoise_strength,
+                                               denoised);
+    result->denoise_seconds += timer_now_seconds() - start;
+    ok = ok && write_image(job, settings, denoised, path, stats);
+    free(denoised);
+    return ok;
+}
+
+bool render_progressive(const Camera *camera, const Scene *scene, const RenderSettings *settings,
+                        const ProgressiveSettings *progressive, const char *output_path,
+                        RenderStats *stats, ProgressiveStats *progressive_stats) {
+    int width = camera->image_width;
+    int height = camera->image_height;
+    int tile_size = settings->tile_size > 0 ? settings->tile_size : RENDER_DEFAULT_TILE_SIZE;
+    int tiles_x = (width + tile_size - 1) / tile_size;
+    uint64_t tile_count = (uint64_t)tiles_x * (uint64_t)((height + tile_size - 1) / tile_size);
+    int thread_count = settings->thread_count > 0 ? settings->thread_count
+                                                  : render_default_thread_count();
+    if ((uint64_t)thread_count > tile_count) {
+        thread_count = (int)tile_count;
+    }
+    double start = timer_now_seconds();
+
+    ProgressiveJob job;
+    SharedFramebuffer live;
+    Progress progress;
+    RenderStats totals;
+    memset(&totals, 0, sizeof(totals));
+    job.camera = camera;
+    job.scene = scene;
+    job.integrator = &settings->integrator;
+    job.float_pixels = image_format_is_float(settings->output_format);
+    job.tile_size = tile_size;
+    job.tiles_x = tiles_x;
+    job.tile_count = tile_count;
+    job.deadline = progressive->time_budget > 0.0 ? start + progressive->time_budget : 0.0;
+    job.live = settings->shm_name ? &live : NULL;
+    job.progress = &progress;
+    atomic_init(&job.next_tile, 0);
+    atomic_init(&job.interrupted, false);
+
+    size_t accum_bytes = (size_t)width * (size_t)height * ACCUM_CHANNELS * sizeof(float);
+    size_t scratch_bytes = (size_t)tile_size * (size_t)tile_size *
+                           image_format_pixel_bytes(settings->output_format);
+    size_t guide_bytes = progressive->denoise_strength > 0.0f
+                             ? (size_t)width * (size_t)height * GUIDE_CHANNELS * sizeof(float)
+                             : 0;
+    job.accum = calloc(1, accum_bytes);
+    job.guides = guide_bytes ? calloc(1, guide_bytes) : NULL;
+    job.tile_samples = calloc((size_t)tile_count, sizeof(uint32_t));
+    job.active = malloc((size_t)tile_count * sizeof(uint64_t));
+    job.tile_objects = malloc((size_t)tile_count * sizeof(SceneObjectSet));
+    job.active_count = tile_count;
+    ProgressiveWorker *workers = calloc((size_t)thread_count, sizeof(ProgressiveWorker));
+    pthread_t *threads = malloc((size_t)thread_count * sizeof(pthread_t));
+    bool ok = job.accum && (job.guides || !guide_bytes) && job.tile_samples && job.active &&
+              job.tile_objects && workers && threads;
+    bool sampler_ready = ok && sampler_init(&job.sampler, settings->sampler, 0);
+    ok = sampler_ready;
+    for (uint64_t t = 0; ok && t < tile_count; t++) {
+        job.active[t] = t;
+    }
+    if (ok) {
+        scene_bin_objects(scene, camera, tile_size, job.tile_objects);
+    }
+    for (int i = 0; ok && i < thread_count; i++) {
+        workers[i].job = &job;
+        workers[i].index = i;
+        scene_hit_cache_init(&workers[i].hit_cache);
+        if (job.live) {
+            workers[i].scratch = malloc(scratch_bytes);
+            ok = workers[i].scratch != NULL;
+        }
+    }
+    uint64_t planned = tile_count * (uint64_t)(progressive->max_samples > 0
+                                                   ? progressive->max_samples : 1);
+    ok = ok && progress_start(&progress, settings->progress_mode, settings->progress_interval,
+                              planned, thread_count, stderr);
+    bool progress_running = ok;
+    if (ok && job.live) {
+        ok = shared_framebuffer_create(&live, settings->shm_name, width, height,
+                                       job.float_pixels ? SHARED_FRAMEBUFFER_RGB32F
+                                                        : SHARED_FRAMEBUFFER_RGB8,
+                                       tile_size);
+        if (!ok) {
+            job.live = NULL;
+        }
+    }
+
+    ProgressiveStats result;
+    memset(&result, 0, sizeof(result));
+    result.reason = PROGRESSIVE_STOP_REQUEST;
+    double last_update = start;
+    for (int pass = 0; ok; pass++) {
+        // The first pass always runs to the end (see progressive_worker)
+        if (pass > 0 && atomic_load(&stop_requested)) {
+            result.reason = PROGRESSIVE_STOP_REQUEST;
+            break;
+        }
+        if (pass > 0 && job.deadline > 0.0 && timer_now_seconds() >= job.deadline) {
+            result.reason = PROGRESSIVE_STOP_DEADLINE;
+            break;
+        }
+        if (job.live && pass > 0) {
+            shared_framebuffer_set_state(job.live, SHARED_FRAMEBUFFER_RENDERING);
+        }
+        run_pass(&job, workers, threads, thread_count);
+        result.passes = pass + 1;
+        if (atomic_load(&job.interrupted)) {
+            result.reason = atomic_load(&stop_requested) ? PROGRESSIVE_STOP_REQUEST
+                                                         : PROGRESSIVE_STOP_DEADLINE;
+            break;
+        }
+        result.converged_tiles += retire_tiles(&job, progressive);
+        if (job.active_count == 0) {
+            result.reason = result.converged_tiles > 0 ? PROGRESSIVE_STOP_CONVERGED
+                                                       : PROGRESSIVE_STOP_SAMPLES;
+            break;
+        }
+        if (progressive->target_noise > 0.0 && pass > 0 &&
+            estimate_noise(&job) <= progressive->target_noise) {
+            result.reason = PROGRESSIVE_STOP_NOISE;
+            break;
+        }
+
+        double now = timer_now_seconds();
+        uint64_t remaining = 0;
+        if (progressive->max_samples > 0) {
+            for (uint64_t k = 0; k < job.active_count; k++) {
+                remaining += (uint64_t)progressive->max_samples - job.tile_samples[job.active[k]];
+            }
+        } else {
+            // Open-ended: expect one more pass, or as many as fit in the budget
+            double passes = 1.0;
+            if (job.deadline > 0.0) {
+                double per_pass = (now - start) / (double)(pass + 1);
+                double fit = (job.deadline - now) / (per_pass > 0.0 ? per_pass : 1e-9);
+                passes = fit > passes ? fit : passes;
+            }
+            remaining = (uint64_t)((double)job.active_count * passes);
+        }
+        progress_set_total(&progress, atomic_load(&progress.work_done) + remaining);
+        if (progressive->update_interval > 0.0 &&
+            now - last_update >= progressive->update_interval) {
+            ok = write_output(&job, settings, progressive, output_path, &totals, &result);
+            result.updates++;
+            last_update = now;
+        }
+    }
+    if (progress_running) {
+        progress_set_total(&progress, atomic_load(&progress.work_done));
+        progress_finish(&progress);
+    }
+
+    if (ok) {
+        ok = write_output(&job, settings, progressive, output_path, &totals, &result);
+        result.updates++;
+    }
+    if (job.live) {
+        shared_framebuffer_set_state(job.live, ok ? SHARED_FRAMEBUFFER_COMPLETE
+                                                  : SHARED_FRAMEBUFFER_FAILED);
+        shared_framebuffer_close(job.live);
+    }
+    if (ok) {
+        result.noise = estimate_noise(&job);
+        result.min_samples = INT32_MAX;
+        for (uint64_t t = 0; t < tile_count; t++) {
+            int samples = (int)job.tile_samples[t];
+            int tile_x0 = (int)(t % (uint64_t)tiles_x) * tile_size;
+            int tile_y0 = (int)(t / (uint64_t)tiles_x) * tile_size;
+            int tile_w = tile_x0 + tile_size < width ? tile_size : width - tile_x0;
+            int tile_h = tile_y0 + tile_size < height ? tile_size : height - tile_y0;
+            result.samples += (uint64_t)samples * (uint64_t)tile_w * (uint64_t)tile_h;
+            result.min_samples = samples < result.min_samples ? samples : result.min_samples;
+            result.max_samples = samples > result.max_samples ? samples : result.max_samples;
+        }
+        result.mean_samples = (double)result.samples / ((double)width * (double)height);
+    }
+    if (progressive_stats) {
+        *progressive_stats = result;
+    }
+    if (stats) {
+        *stats = totals;
+        stats->thread_count = thread_count;
+        stats->render_seconds = timer_now_seconds() - start;
+        stats->rays = progress_running ? atomic_load(&progress.rays) : 0;
+        stats->working_set_bytes += accum_bytes + guide_bytes +
+                                    (size_t)tile_count * (sizeof(uint32_t) + sizeof(uint64_t)) +
+                                    (job.live ? (size_t)thread_count * scratch_bytes : 0);
+        for (int i = 0; workers && i < thread_count; i++) {
+            stats->hit_queries += workers[i].hit_cache.hit_queries;
+            stats->hit_cache_hits += workers[i].hit_cache.hit_hits;
+            stats->occlusion_queries += workers[i].hit_cache.occlusion_queries;
+            stats->occlusion_cache_hits += workers[i].hit_cache.occlusion_hits;
+        }
+    }
+
+    // A request applies to the render it interrupted
+    atomic_store(&stop_requested, false);
+    for (int i = 0; workers && i < thread_count; i++) {
+        free(workers[i].scratch);
+    }
+    free(workers);
+    free(threads);
+    free(job.accum);
+    free(job.guides);
+    free(job.tile_samples);
+    free(job.active);
+    free(job.tile_objects);
+    if (sampler_ready) {
+        sampler_destroy(&job.sampler);
+    }
+    return ok;
+}
@@ -0,0 +1,232 @@
+/**
+ * @file relight.c
+ * @brief Parallel re-shading of cached primary hits
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "relight.h"
+#include "output_pipeline.h"
+#include "timer.h"
+#include <math.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+/**
+ * @brief State shared by all relighting threads
+ */
+typedef struct {
+    const GBuffer *gbuffer;    ///< Primary hits
+    const Scene *scene;        ///< Lights (and shadow geometry)
+    OutputPipeline *output;    ///< Band pipeline to the writer thread
+    bool float_pixels;         ///< Bands hold linear Color values instead of RGB8
+    bool shadows;              ///< Trace shadow rays
+    int tile_size;             ///< Tile edge in pixels
+    int tiles_x;               ///< Tiles per band
+    uint64_t tile_count;       ///< Tiles in the image
+    atomic_uint_fast64_t next_tile; ///< Next tile to claim (scanline order)
+    atomic_uint_fast64_t tile_lights; ///< Sum of the light list lengths of all tiles
+    atomic_uint_fast64_t occlusion_queries; ///< Shadow rays of all workers
+    atomic_uint_fast64_t occlusion_hits; ///< ... blocked by a worker's cached primitive
+} RelightJob;
+
+/**
+ * @brief Keep only the lights of a list that reach a hit unblocked
+ * Lights facing away or out of reach add nothing and are dropped without
+ * tracing; the survivors keep their order, so shading sums in the same
+ * order as without shadows.
+ * @return Number of lights written to visible
+ */
+static int visible_lights(const Scene *scene, SceneHitCache *cache, const HitRecord *rec,
+                          const int *lights, int light_count, int *visible) {
+    int count = 0;
+    for (int i = 0; i < light_count; i++) {
+        const PointLight *light = &scene->lights[lights[i]];
+        Vec3 to_light = vec3_sub(light->position, rec->point);
+        float distance_squared = vec3_length_squared(to_light);
+        if (!point_light_reaches(light, distance_squared) ||
+            vec3_dot(rec->normal, to_light) <= 0.0f) {
+            continue;
+        }
+        float distance = sqrtf(distance_squared);
+        Ray shadow = {rec->point, vec3_scale(to_light, 1.0f / distance)};
+        if (!scene_occluded(scene, &shadow, SCENE_RAY_EPSILON, distance - SCENE_RAY_EPSILON,
+                            cache)) {
+            visible[count++] = lights[i];
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Shade one tile into its band
+ * @return Number of pixels shaded
+ */
+static uint64_t relight_tile(RelightJob *job, SceneHitCache *cache, uint64_t tile,
+                             void *band_pixels, int *lights, int *visible) {
+    const GBuffer *gbuffer = job->gbuffer;
+    int width = gbuffer->width;
+    int band = (int)(tile / (uint64_t)job->tiles_x);
+    int x0 = (int)(tile % (uint64_t)job->tiles_x) * job->tile_size;
+    int y0 = band * job->tile_size;
+    int x1 = x0 + job->tile_size < width ? x0 + job->tile_size : width;
+    int y1 = y0 + job->tile_size < gbuffer->height ? y0 + job->tile_size : gbuffer->height;
+
+    AABB bounds = aabb_empty();
+    for (int row = y0; row < y1; row++) {
+        for (int i = x0; i < x1; i++) {
+            size_t pixel = (size_t)row * (size_t)width + (size_t)i;
+            if (gbuffer->object[pixel] >= 0) {
+                bounds = aabb_expand(bounds, gbuffer->position[pixel]);
+            }
+        }
+    }
+    int light_count = scene_cull_lights(job->scene, bounds, lights);
+    atomic_fetch_add_explicit(&job->tile_lights, (uint64_t)light_count, memory_order_relaxed);
+
+    for (int row = y0; row < y1; row++) {
+        for (int i = x0; i < x1; i++) {
+            size_t pixel = (size_t)row * (size_t)width + (size_t)i;
+            size_t index = pixel - (size_t)y0 * (size_t)width;
+            HitRecord rec;
+            Color color = job->gbuffer->background;
+            if (gbuffer_hit(gbuffer, pixel, &rec)) {
+                if (job->shadows) {
+                    int count = visible_lights(job->scene, cache, &rec, lights, light_count,
+                                               visible);
+                    color = scene_shade_lights(job->scene, &rec, rec.albedo, visible, count);
+                } else {
+                    color = scene_shade_lights(job->scene, &rec, rec.albedo, lights, light_count);
+                }
+            }
+            if (job->float_pixels) {
+                ((Color *)band_pixels)[index] = color;
+            } else {
+                uint8_t *out = &((uint8_t *)band_pixels)[3 * index];
+                color_to_u8(color, &out[0], &out[1], &out[2]);
+            }
+        }
+    }
+    return (uint64_t)(x1 - x0) * (uint64_t)(y1 - y0);
+}
+
+static void *relight_worker(void *arg) {
+    RelightJob *job = (RelightJob *)arg;
+    // Without lights every list is empty, so there is nothing to allocate
+    int *lights = NULL;
+    int *visible = NULL;
+    if (job->scene->light_count > 0) {
+        size_t list_bytes = (size_t)job->scene->light_count * sizeof(int);
+        lights = malloc(list_bytes);
+        visible = job->shadows ? malloc(list_bytes) : NULL;
+        if (!lights || (job->shadows && !visible)) {
+            free(lights);
+            free(visible);
+            // Other workers finish the image; relight_render fails if none is left
+            return NULL;
+        }
+    }
+    SceneHitCache cache;
+    scene_hit_cache_init(&cache);
+    for (;;) {
+        uint64_t tile = atomic_fetch_add_explicit(&job->next_tile, 1, memory_order_relaxed);
+        if (tile >= job->tile_count) {
+            break;
+        }
+        int band = (int)(tile / (uint64_t)job->tiles_x);
+        void *pixels = output_pipeline_acquire_band(job->output, band);
+        uint64_t shaded = relight_tile(job, &cache, tile, pixels, lights, visible);
+        output_pipeline_submit(job->output, band, shaded);
+    }
+    free(lights);
+    free(visible);
+    atomic_fetch_add_explicit(&job->occlusion_queries, cache.occlusion_queries,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&job->occlusion_hits, cache.occlusion_hits, memory_order_relaxed);
+    return NULL;
+}
+
+bool relight_render(const GBuffer *gbuffer, const Scene *scene, const RenderSettings *settings,
+                    bool shadows, FILE *output, RenderStats *stats) {
+    int tile_size = settings->tile_size > 0 ? settings->tile_size : RENDER_DEFAULT_TILE_SIZE;
+    int tiles_x = (gbuffer->width + tile_size - 1) / tile_size;
+    int bands = (gbuffer->height + tile_size - 1) / tile_size;
+    uint64_t tile_count = (uint64_t)tiles_x * (uint64_t)bands;
+    int thread_count = settings->thread_count > 0 ? settings->thread_count
+                                                  : render_default_thread_count();
+    if ((uint64_t)thread_count > tile_count) {
+        thread_count = (int)tile_count;
+    }
+    int capacity = (thread_count + tiles_x - 1) / tiles_x + RENDER_PIPELINE_SPARE_BANDS;
+    double start = timer_now_seconds();
+
+    RelightJob job;
+    OutputPipeline pipeline;
+    job.gbuffer = gbuffer;
+    job.scene = scene;
+    job.output = &pipeline;
+    job.float_pixels = image_format_is_float(settings->output_format);
+    job.shadows = shadows;
+    job.tile_size = tile_size;
+    job.tiles_x = tiles_x;
+    job.tile_count = tile_count;
+    atomic_init(&job.next_tile, 0);
+    atomic_init(&job.tile_lights, 0);
+    atomic_init(&job.occlusion_queries, 0);
+    atomic_init(&job.occlusion_hits, 0);
+
+    pthread_t *threads = malloc((size_t)thread_count * sizeof(pthread_t));
+    if (!threads) {
+        return false;
+    }
+    ImageSpec spec = image_spec_rgb(settings->output_format, settings->half_float,
+                                    gbuffer->width, gbuffer->height);
+    if (!output_pipeline_start(&pipeline, output, &spec, tile_size, capacity)) {
+        free(threads);
+        return false;
+    }
+    int started = 0;
+    for (; started < thread_count; started++) {
+        if (pthread_create(&threads[started], NULL, relight_worker, &job) != 0) {
+            break;
+        }
+    }
+    if (started == 0) {
+        relight_worker(&job);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    if (atomic_load(&job.next_tile) < tile_count) {
+        // Every worker gave up before the last tile
+        output_pipeline_abort(&pipeline);
+        output_pipeline_finish(&pipeline);
+        return false;
+    }
+    bool ok = output_pipeline_finish(&pipeline);
+
+    if (stats) {
+        stats->thread_count = started > 0 ? started : 1;
+        stats->render_seconds = timer_now_seconds() - start;
+        stats->encode_seconds = pipeline.encode_seconds + pipeline.prepare_seconds;
+        stats->writer_wait_seconds = pipeline.wait_seconds;
+        stats->bytes_written = pipeline.bytes_written;
+        stats->aov_bytes_written = 0;
+        stats->io_backend = pipeline.io_backend;
+        stats->working_set_bytes = pipeline.memory_bytes;
+        stats->lights_per_tile = (double)atomic_load(&job.tile_lights) / (double)tile_count;
+        stats->cached_tiles = 0;
+        stats->empty_tiles = 0;
+        stats->hit_queries = 0;
+        stats->hit_cache_hits = 0;
+        stats->occlusion_queries = atomic_load(&job.occlusion_queries);
+        stats->occlusion_cache_hits = atomic_load(&job.occlusion_hits);
+        stats->first_tile_seconds = 0.0;
+        // Relighting traces shadow rays only, all through the workers' caches
+        stats->rays = atomic_load(&job.occlusion_queries);
+    }
+    return ok;
+}
@@ -0,0 +1,689 @@
+/**
+ * @file render.c
+ * @brief Multithreaded image rendering
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "render.h"
+#include "output_pipeline.h"
+#include "shared_framebuffer.h"
+#include "timer.h"
+#include <math.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/**
+ * @brief Name and EXR channels of each AOV, in RenderAov bit order
+ */
+static const struct {
+    const char *name;          ///< Name in AOV lists
+    int channel_count;         ///< Float channels
+    const char *channels[3];   ///< EXR channel names
+} aov_info[RENDER_AOV_COUNT] = {
+    {"depth", 1, {"Z"}},
+    {"normal", 3, {"N.X", "N.Y", "N.Z"}},
+    {"id", 1, {"id"}},
+    {"albedo", 3, {"albedo.R", "albedo.G", "albedo.B"}},
+    {"cost", 1, {"cost"}},
+};
+
+RenderSettings render_default_settings(void) {
+    RenderSettings settings;
+    settings.thread_count = 0;
+    settings.tile_size = RENDER_DEFAULT_TILE_SIZE;
+    settings.output_format = IMAGE_FORMAT_PPM;
+    settings.half_float = false;
+    settings.aovs = 0;
+    settings.shm_name = NULL;
+    settings.progress_mode = PROGRESS_BAR;
+    settings.progress_interval = PROGRESS_DEFAULT_INTERVAL;
+    settings.integrator = integrator_default_settings();
+    settings.sampler = SAMPLER_SOBOL;
+    settings.cull_lights = false;
+    settings.gbuffer = NULL;
+    settings.cache = NULL;
+    settings.framebuffer = NULL;
+    settings.cancel = NULL;
+    return settings;
+}
+
+int render_default_thread_count(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+bool render_parse_aovs(const char *list, unsigned *aovs) {
+    *aovs = 0;
+    const char *name = list;
+    for (;;) {
+        size_t length = strcspn(name, ",");
+        bool known = false;
+        if (length == 3 && strncmp(name, "all", 3) == 0) {
+            *aovs = (1u << RENDER_AOV_COUNT) - 1;
+            known = true;
+        }
+        for (int i = 0; i < RENDER_AOV_COUNT && !known; i++) {
+            if (strlen(aov_info[i].name) == length && strncmp(name, aov_info[i].name, length) == 0) {
+                *aovs |= 1u << i;
+                known = true;
+            }
+        }
+        if (!known) {
+            return false;
+        }
+        if (name[length] == '\0') {
+            return true;
+        }
+        name += length + 1;
+    }
+}
+
+int render_aov_channel_count(unsigned aovs) {
+    int count = 0;
+    for (int i = 0; i < RENDER_AOV_COUNT; i++) {
+        if (aovs & (1u << i)) {
+            count += aov_info[i].channel_count;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief State shared by all render workers
+ */
+typedef struct {
+    const Camera *camera;      ///< Camera
+    const Scene *scene;        ///< Scene
+    const IntegratorSettings *integrator; ///< Light transport
+    Sampler sampler;           ///< Random numbers of path-traced pixels
+    OutputPipeline *output;    ///< Band pipeline to the writer thread
+    OutputPipeline *aov_output; ///< AOV band pipeline (NULL without AOVs)
+    SharedFramebuffer *live;   ///< Live framebuffer (NULL if none)
+    GBuffer *gbuffer;          ///< Primary hit cache (NULL if none)
+    RenderCache *cache;        ///< Previous pixels and tile dependencies (NULL if none)
+    SceneObjectSet *tile_objects; ///< Objects the primary rays of each tile can hit
+    atomic_uint_fast64_t empty_tiles; ///< Tiles filled with the background without tracing
+    atomic_uint_fast64_t cached_tiles; ///< Tiles copied from the cache
+    bool float_pixels;         ///< Bands hold linear Color values instead of RGB8
+    unsigned aovs;             ///< RenderAov bits captured
+    int aov_channels;          ///< Floats per AOV pixel
+    int aov_offset[RENDER_AOV_COUNT]; ///< First channel of each captured AOV
+    int tile_size;             ///< Tile edge in pixels
+    int tiles_x;               ///< Tiles per band
+    uint64_t tile_count;       ///< Tiles in the image
+    atomic_uint_fast64_t next_tile; ///< Next tile to claim (scanline order)
+    const atomic_bool *cancel; ///< Stop claiming tiles once set (NULL: never)
+    double start;              ///< Start of the render (timer_now_seconds)
+    atomic_bool tile_finished; ///< Set by the worker that finished the first tile
+    double first_tile_seconds; ///< Written once, by that worker
+    bool cull_lights;          ///< Shade tiles from culled light lists
+    atomic_uint_fast64_t tile_lights; ///< Sum of the light list lengths of culled tiles
+    atomic_uint_fast64_t culled_tiles; ///< Tiles shaded from culled light lists
+    atomic_uint_fast64_t hit_queries; ///< Closest-hit queries of all workers' hit caches
+    atomic_uint_fast64_t hit_hits; ///< ... answered by the cached primitive
+    atomic_uint_fast64_t occlusion_queries; ///< Shadow queries of all workers' hit caches
+    atomic_uint_fast64_t occlusion_hits; ///< ... answered by the cached occluding primitive
+    Progress *progress;        ///< Progress counters
+} RenderJob;
+
+/**
+ * @brief Per-worker arguments
+ */
+typedef struct {
+    RenderJob *job;  ///< Shared job
+    int index;       ///< Worker index (progress slot)
+} RenderWorker;
+
+/**
+ * @brief Per-worker buffers for light culling (all NULL when not culling)
+ */
+typedef struct {
+    HitRecord *hits;   ///< Primary hit of each tile pixel
+    bool *hit;         ///< Whether each tile pixel hit a surface
+    int64_t *trace_ns; ///< Time spent tracing each tile pixel (cost AOV)
+    int *lights;       ///< Light list of the current tile
+} CullScratch;
+
+/**
+ * @brief Store the AOVs of one pixel
+ * @param job Job (selects the AOVs and their channels)
+ * @param out The pixel's AOV channels
+ * @param hit Whether the primary ray hit a surface
+ * @param rec Primary hit
+ * @param nanoseconds Time spent on the pixel
+ */
+static void store_aovs(const RenderJob *job, float *out, bool hit, const HitRecord *rec,
+                       int64_t nanoseconds) {
+    if (job->aovs & RENDER_AOV_DEPTH) {
+        out[job->aov_offset[0]] = hit ? rec->t : INFINITY;
+    }
+    if (job->aovs & RENDER_AOV_NORMAL) {
+        Vec3 normal = hit ? rec->normal : vec3_create(0.0f, 0.0f, 0.0f);
+        float *n = &out[job->aov_offset[1]];
+        n[0] = normal.x;
+        n[1] = normal.y;
+        n[2] = normal.z;
+    }
+    if (job->aovs & RENDER_AOV_OBJECT) {
+        out[job->aov_offset[2]] = hit ? (float)rec->object_index : -1.0f;
+    }
+    if (job->aovs & RENDER_AOV_ALBEDO) {
+        Color albedo = hit ? rec->albedo : job->scene->background_color;
+        float *a = &out[job->aov_offset[3]];
+        a[0] = albedo.x;
+        a[1] = albedo.y;
+        a[2] = albedo.z;
+    }
+    if (job->aovs & RENDER_AOV_COST) {
+        out[job->aov_offset[4]] = (float)nanoseconds;
+    }
+}
+
+/**
+ * @brief Store one pixel's color in its band
+ */
+static void store_pixel(const RenderJob *job, void *band_pixels, size_t index, Color color) {
+    if (job->float_pixels) {
+        ((Color *)band_pixels)[index] = color;
+    } else {
+        uint8_t *out = &((uint8_t *)band_pixels)[3 * index];
+        color_to_u8(color, &out[0], &out[1], &out[2]);
+    }
+}
+
+/**
+ * @brief Render one tile with light culling
+ * Traces every primary ray of the tile first, culls the lights against
+ * the bounds of the hit points, then shades with the surviving lights.
+ * Lights only drop out where they cannot reach, so the image is the same
+ * as without culling.
+ * @param visible Objects the tile's primary rays can hit
+ * @return Objects hit by the tile's primary rays
+ */
+static SceneObjectSet render_tile_culled(RenderJob *job, CullScratch *scratch,
+                                         SceneHitCache *hit_cache, SceneObjectSet visible,
+                                         int x0, int y0, int x1, int y1, void *band_pixels,
+                                         float *aov_pixels) {
+    const Camera *camera = job->camera;
+    const Scene *scene = job->scene;
+    int width = camera->image_width;
+    int tile_width = x1 - x0;
+    bool timed = aov_pixels && (job->aovs & RENDER_AOV_COST) != 0;
+    AABB bounds = aabb_empty();
+    for (int row = y0; row < y1; row++) {
+        int j = camera->image_height - 1 - row;
+        for (int i = x0; i < x1; i++) {
+            size_t k = (size_t)(row - y0) * (size_t)tile_width + (size_t)(i - x0);
+            float u, v;
+            camera_pixel_to_uv(camera, i, j, &u, &v);
+            Ray ray = camera_get_ray(camera, u, v);
+            int64_t start = timed ? timer_now_nanoseconds() : 0;
+            scratch->hit[k] = scene_hit_objects(scene, &ray, SCENE_RAY_EPSILON, INFINITY,
+                                                visible, hit_cache, &scratch->hits[k]);
+            if (scratch->hit[k]) {
+                bounds = aabb_expand(bounds, scratch->hits[k].point);
+            }
+            scratch->trace_ns[k] = timed ? timer_now_nanoseconds() - start : 0;
+        }
+    }
+    int light_count = scene_cull_lights(scene, bounds, scratch->lights);
+    atomic_fetch_add_explicit(&job->tile_lights, (uint64_t)light_count, memory_order_relaxed);
+    atomic_fetch_add_explicit(&job->culled_tiles, 1, memory_order_relaxed);
+
+    SceneObjectSet objects = 0;
+    for (int row = y0; row < y1; row++) {
+        size_t first = (size_t)(row - y0) * (size_t)width + (size_t)x0;
+        for (int i = x0; i < x1; i++) {
+            size_t k = (size_t)(row - y0) * (size_t)tile_width + (size_t)(i - x0);
+            size_t index = first + (size_t)(i - x0);
+            const HitRecord *rec = &scratch->hits[k];
+            int64_t start = timed ? timer_now_nanoseconds() : 0;
+            Color color = scratch->hit[k]
+                              ? scene_shade_lights(scene, rec, rec->albedo, scratch->lights,
+                                                   light_count)
+                              : scene->background_color;
+            if (aov_pixels) {
+                int64_t elapsed = timed ? timer_now_nanoseconds() - start + scratch->trace_ns[k]
+                                        : 0;
+                store_aovs(job, &aov_pixels[index * (size_t)job->aov_channels], scratch->hit[k],
+                           rec, elapsed);
+            }
+            if (job->gbuffer) {
+                gbuffer_store(job->gbuffer, (size_t)row * (size_t)width + (size_t)i,
+                              scratch->hit[k] ? rec : NULL);
+            }
+            if (job->cache) {
+                job->cache->pixels[(size_t)row * (size_t)width + (size_t)i] = color;
+                objects |= scratch->hit[k] ? (SceneObjectSet)1u << rec->object_index : 0;
+            }
+            store_pixel(job, band_pixels, index, color);
+        }
+    }
+    return objects;
+}
+
+/**
+ * @brief Fill a tile that no object can cover with the background
+ * Every primary ray of the tile misses, so none is traced.
+ */
+static void render_tile_empty(RenderJob *job, int x0, int y0, int x1, int y1, void *band_pixels,
+                              float *aov_pixels) {
+    int width = job->camera->image_width;
+    Color background = job->scene->background_color;
+    uint8_t rgb[3];
+    color_to_u8(background, &rgb[0], &rgb[1], &rgb[2]);
+    for (int row = y0; row < y1; row++) {
+        size_t first = (size_t)(row - y0) * (size_t)width + (size_t)x0;
+        for (int i = x0; i < x1; i++) {
+            size_t index = first + (size_t)(i - x0);
+            if (job->float_pixels) {
+                ((Color *)band_pixels)[index] = background;
+            } else {
+                memcpy(&((uint8_t *)band_pixels)[3 * index], rgb, 3);
+            }
+            if (aov_pixels) {
+                store_aovs(job, &aov_pixels[index * (size_t)job->aov_channels], false, NULL, 0);
+            }
+            size_t pixel = (size_t)row * (size_t)width + (size_t)i;
+            if (job->gbuffer) {
+                gbuffer_store(job->gbuffer, pixel, NULL);
+            }
+            if (job->cache) {
+                job->cache->pixels[pixel] = background;
+            }
+        }
+    }
+    atomic_fetch_add_explicit(&job->empty_tiles, 1, memory_order_relaxed);
+}
+
+/**
+ * @brief Render one tile into its band buffers
+ * @param job Shared job
+ * @param scratch Light culling buffers (hits NULL: shade every pixel independently)
+ * @param hit_cache Worker's hit cache
+ * @param tile Tile index
+ * @param band_pixels Image band
+ * @param aov_pixels AOV band (NULL without AOVs)
+ * @return Number of pixels rendered
+ */
+static uint64_t render_tile(RenderJob *job, CullScratch *scratch, SceneHitCache *hit_cache,
+                            uint64_t tile, void *band_pixels, float *aov_pixels) {
+    const Camera *camera = job->camera;
+    int width = camera->image_width;
+    int band = (int)(tile / (uint64_t)job->tiles_x);
+    int x0 = (int)(tile % (uint64_t)job->tiles_x) * job->tile_size;
+    int y0 = band * job->tile_size;
+    int x1 = x0 + job->tile_size < width ? x0 + job->tile_size : width;
+    int y1 = y0 + job->tile_size < camera->image_height ? y0 + job->tile_size
+                                                          : camera->image_height;
+    RenderCache *cache = job->cache;
+    if (cache && !cache->tile_dirty[tile]) {
+        // Nothing the tile shows has changed since the cached render
+        for (int row = y0; row < y1; row++) {
+            size_t first = (size_t)(row - y0) * (size_t)width + (size_t)x0;
+            const Color *cached = &cache->pixels[(size_t)row * (size_t)width + (size_t)x0];
+            for (int i = 0; i < x1 - x0; i++) {
+                store_pixel(job, band_pixels, first + (size_t)i, cached[i]);
+            }
+        }
+        atomic_fetch_add_explicit(&job->cached_tiles, 1, memory_order_relaxed);
+        return (uint64_t)(x1 - x0) * (uint64_t)(y1 - y0);
+    }
+    SceneObjectSet visible = job->tile_objects[tile];
+    if (visible == 0) {
+        render_tile_empty(job, x0, y0, x1, y1, band_pixels, aov_pixels);
+        if (cache) {
+            cache->tile_objects[tile] = 0;
+            cache->tile_dirty[tile] = 0;
+        }
+        return (uint64_t)(x1 - x0) * (uint64_t)(y1 - y0);
+    }
+    if (scratch->hits) {
+        SceneObjectSet objects = render_tile_culled(job, scratch, hit_cache, visible, x0, y0, x1,
+                                                    y1, band_pixels, aov_pixels);
+        if (cache) {
+            cache->tile_objects[tile] = objects;
+            cache->tile_dirty[tile] = 0;
+        }
+        return (uint64_t)(x1 - x0) * (uint64_t)(y1 - y0);
+    }
+    SceneObjectSet objects = 0;
+    for (int row = y0; row < y1; row++) {
+        int j = camera->image_height - 1 - row;
+        size_t first = (size_t)(row - y0) * (size_t)width + (size_t)x0;
+        for (int i = x0; i < x1; i++) {
+            float u, v;
+            camera_pixel_to_uv(camera, i, j, &u, &v);
+            Ray ray = camera_get_ray(camera, u, v);
+            size_t index = first + (size_t)(i - x0);
+            PathSample sample = {&job->sampler, (uint32_t)i, (uint32_t)row, 0};
+            Color pixel_color;
+            bool timed = aov_pixels && (job->aovs & RENDER_AOV_COST) != 0;
+            int64_t start = timed ? timer_now_nanoseconds() : 0;
+            HitRecord primary;
+            bool hit = integrator_trace_objects(job->scene, job->integrator, &sample, &ray,
+                                                visible, hit_cache, &pixel_color, &primary);
+            if (aov_pixels) {
+                int64_t elapsed = timed ? timer_now_nanoseconds() - start : 0;
+                store_aovs(job, &aov_pixels[index * (size_t)job->aov_channels], hit, &primary,
+                           elapsed);
+            }
+            if (job->gbuffer) {
+                gbuffer_store(job->gbuffer, (size_t)row * (size_t)width + (size_t)i,
+                              hit ? &primary : NULL);
+            }
+            if (cache) {
+                cache->pixels[(size_t)row * (size_t)width + (size_t)i] = pixel_color;
+                objects |= hit ? (SceneObjectSet)1u << primary.object_index : 0;
+            }
+            store_pixel(job, band_pixels, index, pixel_color);
+        }
+    }
+    if (cache) {
+        cache->tile_objects[tile] = objects;
+        cache->tile_dirty[tile] = 0;
+    }
+    return (uint64_t)(x1 - x0) * (uint64_t)(y1 - y0);
+}
+
+static void *render_worker(void *arg) {
+    RenderWorker *worker = (RenderWorker *)arg;
+    RenderJob *job = worker->job;
+    CullScratch scratch = {NULL, NULL, NULL, NULL};
+    SceneHitCache hit_cache;
+    scene_hit_cache_init(&hit_cache);
+    if (job->cull_lights) {
+        size_t pixels = (size_t)job->tile_size * (size_t)job->tile_size;
+        scratch.hits = malloc(pixels * sizeof(HitRecord));
+        scratch.hit = malloc(pixels * sizeof(bool));
+        scratch.trace_ns = malloc(pixels * sizeof(int64_t));
+        scratch.lights = malloc((size_t)job->scene->light_count * sizeof(int));
+        if (!scratch.hits || !scratch.hit || !scratch.trace_ns || !scratch.lights) {
+            // Shading every light gives the same image, only slower
+            free(scratch.hits);
+            scratch.hits = NULL;
+        }
+    }
+    for (;;) {
+        if (job->cancel && atomic_load_explicit(job->cancel, memory_order_relaxed)) {
+            break;
+        }
+        uint64_t tile = atomic_fetch_add_explicit(&job->next_tile, 1, memory_order_relaxed);
+        if (tile >= job->tile_count) {
+            break;
+        }
+        int band = (int)(tile / (uint64_t)job->tiles_x);
+        void *pixels = output_pipeline_acquire_band(job->output, band);
+        float *aov_pixels = job->aov_output ? output_pipeline_acquire_band(job->aov_output, band)
+                                            : NULL;
+        double start = timer_now_seconds();
+        // Cached and empty tiles trace nothing; every other ray goes through the cache
+        uint64_t rays = scene_hit_cache_rays(&hit_cache);
+        uint64_t rendered = render_tile(job, &scratch, &hit_cache, tile, pixels, aov_pixels);
+        rays = scene_hit_cache_rays(&hit_cache) - rays;
+        if (job->live) {
+            size_t pixel_bytes = job->output->pixel_bytes;
+            size_t x0 = (size_t)(tile % (uint64_t)job->tiles_x) * (size_t)job->tile_size;
+            shared_framebuffer_write_tile(job->live, tile,
+                                          (uint8_t *)pixels + x0 * pixel_bytes,
+                                          (size_t)job->camera->image_width * pixel_bytes);
+        }
+        if (!atomic_load_explicit(&job->tile_finished, memory_order_relaxed) &&
+            !atomic_exchange(&job->tile_finished, true)) {
+            job->first_tile_seconds = timer_now_seconds() - job->start;
+        }
+        output_pipeline_submit(job->output, band, rendered);
+        if (aov_pixels) {
+            output_pipeline_submit(job->aov_output, band, rendered);
+        }
+        progress_add_busy(job->progress, worker->index, timer_now_seconds() - start);
+        progress_add_work(job->progress, 1, rays);
+    }
+    free(scratch.hits);
+    free(scratch.hit);
+    free(scratch.trace_ns);
+    free(scratch.lights);
+    atomic_fetch_add_explicit(&job->hit_queries, hit_cache.hit_queries, memory_order_relaxed);
+    atomic_fetch_add_explicit(&job->hit_hits, hit_cache.hit_hits, memory_order_relaxed);
+    atomic_fetch_add_explicit(&job->occlusion_queries, hit_cache.occlusion_queries,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&job->occlusion_hits, hit_cache.occlusion_hits,
+                              memory_order_relaxed);
+    return NULL;
+}
+
+/**
+ * @brief Publish the final state of the live framebuffer and unmap it
+ * A framebuffer passed in through the settings stays mapped.
+ */
+static void close_live(SharedFramebuffer *live, const RenderSettings *settings, bool ok) {
+    if (live) {
+        shared_framebuffer_set_state(live, ok ? SHARED_FRAMEBUFFER_COMPLETE
+                                              : SHARED_FRAMEBUFFER_FAILED);
+        if (live != settings->framebuffer) {
+            shared_framebuffer_close(live);
+        }
+    }
+}
+
+/**
+ * @brief render_scene with the sampler already set up
+ */
+static bool render_with_sampler(const Camera *camera, const Scene *scene,
+                                const RenderSettings *settings, const Sampler *sampler,
+                                FILE *output, FILE *aov_output, RenderStats *stats) {
+    int tile_size = settings->tile_size > 0 ? settings->tile_size : RENDER_DEFAULT_TILE_SIZE;
+    int tiles_x = (camera->image_width + tile_size - 1) / tile_size;
+    int bands = (camera->image_height + tile_size - 1) / tile_size;
+    uint64_t tile_count = (uint64_t)tiles_x * (uint64_t)bands;
+    int thread_count = settings->thread_count > 0 ? settings->thread_count
+                                                  : render_default_thread_count();
+    if ((uint64_t)thread_count > tile_count) {
+        thread_count = (int)tile_count;
+    }
+    // Enough bands for every thread to hold a tile, plus slack for the writer
+    int capacity = (thread_count + tiles_x - 1) / tiles_x + RENDER_PIPELINE_SPARE_BANDS;
+    double start = timer_now_seconds();
+
+    RenderJob job;
+    OutputPipeline pipeline;
+    OutputPipeline aov_pipeline;
+    SharedFramebuffer live;
+    Progress progress;
+    job.camera = camera;
+    job.scene = scene;
+    job.integrator = &settings->integrator;
+    job.sampler = *sampler;
+    job.output = &pipeline;
+    job.aov_output = settings->aovs ? &aov_pipeline : NULL;
+    job.live = settings->framebuffer ? settings->framebuffer : settings->shm_name ? &live : NULL;
+    job.gbuffer = settings->gbuffer;
+    if (job.gbuffer) {
+        if (job.gbuffer->width != camera->image_width ||
+            job.gbuffer->height != camera->image_height) {
+            return false;
+        }
+        job.gbuffer->background = scene->background_color;
+    }
+    job.cache = settings->cache;
+    if (job.cache) {
+        if (job.cache->width != camera->image_width ||
+            job.cache->height != camera->image_height || job.cache->tile_size != tile_size ||
+            settings->aovs) {
+            return false;
+        }
+        // Paths depend on more than their primary hit, so only direct shading can reuse tiles
+        if (settings->integrator.type != INTEGRATOR_DIRECT) {
+            render_cache_invalidate_all(job.cache);
+        }
+    }
+    atomic_init(&job.cached_tiles, 0);
+    job.progress = &progress;
+    job.float_pixels = image_format_is_float(settings->output_format);
+    job.aovs = settings->aovs;
+    job.aov_channels = 0;
+
+    // AOV channels are packed in RenderAov order; the encoder sorts them by name
+    ImageSpec aov_spec = image_spec_rgb(IMAGE_FORMAT_EXR, false, camera->image_width,
+                                        camera->image_height);
+    aov_spec.channel_count = 0;
+    for (int i = 0; i < RENDER_AOV_COUNT; i++) {
+        job.aov_offset[i] = job.aov_channels;
+        if (settings->aovs & (1u << i)) {
+            for (int c = 0; c < aov_info[i].channel_count; c++) {
+                aov_spec.channel_names[aov_spec.channel_count++] = aov_info[i].channels[c];
+            }
+            job.aov_channels += aov_info[i].channel_count;
+        }
+    }
+    job.tile_size = tile_size;
+    job.tiles_x = tiles_x;
+    job.tile_count = tile_count;
+    atomic_init(&job.next_tile, 0);
+    job.cancel = settings->cancel;
+    job.start = start;
+    atomic_init(&job.tile_finished, false);
+    job.first_tile_seconds = 0.0;
+    // Culling only applies to deterministic direct shading, and a scene without lights
+    // has nothing to cull
+    job.cull_lights = settings->cull_lights && settings->integrator.type == INTEGRATOR_DIRECT &&
+                      settings->integrator.light_samples <= 0 && scene->light_count > 0;
+    atomic_init(&job.tile_lights, 0);
+    atomic_init(&job.culled_tiles, 0);
+    atomic_init(&job.hit_queries, 0);
+    atomic_init(&job.hit_hits, 0);
+    atomic_init(&job.occlusion_queries, 0);
+    atomic_init(&job.occlusion_hits, 0);
+    SharedFramebufferFormat live_format = job.float_pixels ? SHARED_FRAMEBUFFER_RGB32F
+                                                           : SHARED_FRAMEBUFFER_RGB8;
+    if (settings->framebuffer) {
+        const SharedFramebufferHeader *header = settings->framebuffer->header;
+        if (header->width != (uint32_t)camera->image_width ||
+            header->height != (uint32_t)camera->image_height ||
+            header->tile_size != (uint32_t)tile_size || header->format != (uint32_t)live_format) {
+            return false;
+        }
+        shared_framebuffer_set_state(job.live, SHARED_FRAMEBUFFER_RENDERING);
+    } else if (job.live && !shared_framebuffer_create(&live, settings->shm_name,
+                                                      camera->image_width, camera->image_height,
+                                                      live_format, tile_size)) {
+        return false;
+    }
+    RenderWorker *workers = malloc((size_t)thread_count * sizeof(RenderWorker));
+    pthread_t *threads = malloc((size_t)thread_count * sizeof(pthread_t));
+    job.tile_objects = malloc((size_t)tile_count * sizeof(SceneObjectSet));
+    if (!workers || !threads || !job.tile_objects ||
+        !progress_start(&progress, settings->progress_mode, settings->progress_interval,
+                        tile_count, thread_count, stderr)) {
+        free(workers);
+        free(threads);
+        free(job.tile_objects);
+        close_live(job.live, settings, false);
+        return false;
+    }
+    ImageSpec spec = image_spec_rgb(settings->output_format, settings->half_float,
+                                    camera->image_width, camera->image_height);
+    if (!output_pipeline_start(&pipeline, output, &spec, tile_size, capacity)) {
+        progress_finish(&progress);
+        free(workers);
+        free(threads);
+        free(job.tile_objects);
+        close_live(job.live, settings, false);
+        return false;
+    }
+    if (job.aov_output &&
+        !output_pipeline_start(job.aov_output, aov_output, &aov_spec, tile_size, capacity)) {
+        output_pipeline_abort(&pipeline);
+        output_pipeline_finish(&pipeline);
+        progress_finish(&progress);
+        free(workers);
+        free(threads);
+        free(job.tile_objects);
+        close_live(job.live, settings, false);
+        return false;
+    }
+
+    // Bin objects by screen rectangle so primary rays skip objects outside their tile
+    scene_bin_objects(scene, camera, tile_size, job.tile_objects);
+    atomic_init(&job.empty_tiles, 0);
+
+    int started = 0;
+    for (; started < thread_count; started++) {
+        workers[started].job = &job;
+        workers[started].index = started;
+        if (pthread_create(&threads[started], NULL, render_worker, &workers[started]) != 0) {
+            break;
+        }
+    }
+    // If some threads failed to start, the ones running still finish every tile
+    if (started == 0) {
+        render_worker(&(RenderWorker){&job, 0});
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    progress_finish(&progress);
+    bool cancelled = atomic_load(&job.next_tile) < tile_count;
+    if (cancelled) {
+        // Tiles were left unclaimed: the writer would wait for their bands forever
+        output_pipeline_abort(&pipeline);
+        if (job.aov_output) {
+            output_pipeline_abort(job.aov_output);
+        }
+    }
+    bool ok = output_pipeline_finish(&pipeline) && !cancelled;
+    double aov_encode_seconds = 0.0;
+    uint64_t aov_bytes = 0;
+    size_t aov_memory = 0;
+    if (job.aov_output) {
+        ok = output_pipeline_finish(job.aov_output) && ok;
+        aov_memory = job.aov_output->memory_bytes;
+        aov_encode_seconds = job.aov_output->encode_seconds + job.aov_output->prepare_seconds;
+        aov_bytes = job.aov_output->bytes_written;
+    }
+
+    if (stats) {
+        stats->thread_count = started > 0 ? started : 1;
+        stats->render_seconds = timer_now_seconds() - start;
+        stats->encode_seconds = pipeline.encode_seconds + pipeline.prepare_seconds +
+                                aov_encode_seconds;
+        stats->writer_wait_seconds = pipeline.wait_seconds;
+        stats->bytes_written = pipeline.bytes_written;
+        stats->aov_bytes_written = aov_bytes;
+        stats->io_backend = pipeline.io_backend;
+        stats->working_set_bytes = pipeline.memory_bytes + aov_memory;
+        uint64_t culled_tiles = atomic_load(&job.culled_tiles);
+        stats->lights_per_tile = culled_tiles > 0 ? (double)atomic_load(&job.tile_lights) /
+                                                        (double)culled_tiles
+                                                  : 0.0;
+        stats->cached_tiles = atomic_load(&job.cached_tiles);
+        stats->empty_tiles = atomic_load(&job.empty_tiles);
+        stats->hit_queries = atomic_load(&job.hit_queries);
+        stats->hit_cache_hits = atomic_load(&job.hit_hits);
+        stats->occlusion_queries = atomic_load(&job.occlusion_queries);
+        stats->occlusion_cache_hits = atomic_load(&job.occlusion_hits);
+        stats->first_tile_seconds = job.first_tile_seconds;
+        stats->rays = atomic_load(&progress.rays);
+    }
+    close_live(job.live, settings, ok);
+    free(workers);
+    free(threads);
+    free(job.tile_objects);
+    return ok;
+}
+
+bool render_scene(const Camera *camera, const Scene *scene, const RenderSettings *settings,
+                  FILE *output, FILE *aov_output, RenderStats *stats) {
+    Sampler sampler;
+    if (!sampler_init(&sampler, settings->sampler, 0)) {
+        return false;
+    }
+    bool ok = render_with_sampler(camera, scene, settings, &sampler, output, aov_output, stats);
+    sampler_destroy(&sampler);
+    return ok;
+}
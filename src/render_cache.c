@@ -0,0 +1,75 @@
+/**
+ * @file render_cache.c
+ * @brief Incremental re-rendering bookkeeping
+ */
+
+#include "render_cache.h"
+#include <stdlib.h>
+#include <string.h>
+
+bool render_cache_create(RenderCache *cache, int width, int height, int tile_size) {
+    cache->width = width;
+    cache->height = height;
+    cache->tile_size = tile_size;
+    cache->tiles_x = (width + tile_size - 1) / tile_size;
+    cache->tile_count = cache->tiles_x * ((height + tile_size - 1) / tile_size);
+    cache->pixels = malloc((size_t)width * (size_t)height * sizeof(Color));
+    cache->tile_objects = calloc((size_t)cache->tile_count, sizeof(SceneObjectSet));
+    cache->tile_dirty = malloc((size_t)cache->tile_count);
+    if (!cache->pixels || !cache->tile_objects || !cache->tile_dirty) {
+        render_cache_destroy(cache);
+        return false;
+    }
+    render_cache_invalidate_all(cache);
+    return true;
+}
+
+void render_cache_destroy(RenderCache *cache) {
+    free(cache->pixels);
+    free(cache->tile_objects);
+    free(cache->tile_dirty);
+    cache->pixels = NULL;
+    cache->tile_objects = NULL;
+    cache->tile_dirty = NULL;
+    cache->tile_count = 0;
+}
+
+void render_cache_invalidate_all(RenderCache *cache) {
+    memset(cache->tile_dirty, 1, (size_t)cache->tile_count);
+}
+
+bool render_cache_invalidate_object(RenderCache *cache, const Camera *camera, const Scene *scene,
+                                    int object_index) {
+    if (object_index < 0 || object_index >= scene->object_count) {
+        return false;
+    }
+    SceneObjectSet bit = (SceneObjectSet)1u << object_index;
+    for (int tile = 0; tile < cache->tile_count; tile++) {
+        if (cache->tile_objects[tile] & bit) {
+            cache->tile_dirty[tile] = 1;
+        }
+    }
+    AABB bounds;
+    if (!hittable_bounds(&scene->objects[object_index], &bounds)) {
+        render_cache_invalidate_all(cache);
+        return true;
+    }
+    int x0, y0, x1, y1;
+    if (camera_project_bounds(camera, bounds, &x0, &y0, &x1, &y1)) {
+        int s = cache->tile_size;
+        for (int ty = y0 / s; ty <= (y1 - 1) / s; ty++) {
+            for (int tx = x0 / s; tx <= (x1 - 1) / s; tx++) {
+                cache->tile_dirty[ty * cache->tiles_x + tx] = 1;
+            }
+        }
+    }
+    return true;
+}
+
+int render_cache_dirty_count(const RenderCache *cache) {
+    int count = 0;
+    for (int tile = 0; tile < cache->tile_count; tile++) {
+        count += cache->tile_dirty[tile] != 0;
+    }
+    return count;
+}
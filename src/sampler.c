@@ -0,0 +1,286 @@
+/**
+ * @file sampler.c
+ * @brief Low-discrepancy sample streams for pixel integration
+ */
+
+#include "sampler.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Sobol dimensions generated directly; higher ones are padded
+ */
+#define SOBOL_DIMENSIONS 4
+
+/**
+ * @brief Blue-noise mask generation: initial point density, kernel width and reach
+ */
+#define MASK_CELLS (SAMPLER_MASK_SIZE * SAMPLER_MASK_SIZE)
+#define MASK_INITIAL_POINTS (MASK_CELLS / 10)
+#define MASK_SIGMA 1.9f
+#define MASK_RADIUS 8
+
+/**
+ * @brief Sobol direction numbers (Joe and Kuo) for dimensions 1 to 3;
+ *        dimension 0 is the van der Corput sequence
+ */
+static const uint32_t sobol_directions[SOBOL_DIMENSIONS - 1][32] = {
+    {0x80000000u, 0xc0000000u, 0xa0000000u, 0xf0000000u, 0x88000000u, 0xcc000000u, 0xaa000000u,
+     0xff000000u, 0x80800000u, 0xc0c00000u, 0xa0a00000u, 0xf0f00000u, 0x88880000u, 0xcccc0000u,
+     0xaaaa0000u, 0xffff0000u, 0x80008000u, 0xc000c000u, 0xa000a000u, 0xf000f000u, 0x88008800u,
+     0xcc00cc00u, 0xaa00aa00u, 0xff00ff00u, 0x80808080u, 0xc0c0c0c0u, 0xa0a0a0a0u, 0xf0f0f0f0u,
+     0x88888888u, 0xccccccccu, 0xaaaaaaaau, 0xffffffffu},
+    {0x80000000u, 0xc0000000u, 0x60000000u, 0x90000000u, 0xe8000000u, 0x5c000000u, 0x8e000000u,
+     0xc5000000u, 0x68800000u, 0x9cc00000u, 0xee600000u, 0x55900000u, 0x80680000u, 0xc09c0000u,
+     0x60ee0000u, 0x90550000u, 0xe8808000u, 0x5cc0c000u, 0x8e606000u, 0xc5909000u, 0x6868e800u,
+     0x9c9c5c00u, 0xeeee8e00u, 0x5555c500u, 0x8000e880u, 0xc0005cc0u, 0x60008e60u, 0x9000c590u,
+     0xe8006868u, 0x5c009c9cu, 0x8e00eeeeu, 0xc5005555u},
+    {0x80000000u, 0xc0000000u, 0x20000000u, 0x50000000u, 0xf8000000u, 0x74000000u, 0xa2000000u,
+     0x93000000u, 0xd8800000u, 0x25400000u, 0x59e00000u, 0xe6d00000u, 0x78080000u, 0xb40c0000u,
+     0x82020000u, 0xc3050000u, 0x208f8000u, 0x51474000u, 0xfbea2000u, 0x75d93000u, 0xa0858800u,
+     0x914e5400u, 0xdbe79e00u, 0x25db6d00u, 0x58800080u, 0xe54000c0u, 0x79e00020u, 0xb6d00050u,
+     0x800800f8u, 0xc00c0074u, 0x200200a2u, 0x50050093u},
+};
+
+static uint32_t hash_u32(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x7FEB352Du;
+    h ^= h >> 15;
+    h *= 0x846CA68Bu;
+    h ^= h >> 16;
+    return h;
+}
+
+static uint32_t hash_combine(uint32_t seed, uint32_t value) {
+    return seed ^ (hash_u32(value) + 0x9E3779B9u + (seed << 6) + (seed >> 2));
+}
+
+static uint32_t reverse_bits(uint32_t x) {
+    x = (x << 16) | (x >> 16);
+    x = ((x & 0x00FF00FFu) << 8) | ((x & 0xFF00FF00u) >> 8);
+    x = ((x & 0x0F0F0F0Fu) << 4) | ((x & 0xF0F0F0F0u) >> 4);
+    x = ((x & 0x33333333u) << 2) | ((x & 0xCCCCCCCCu) >> 2);
+    x = ((x & 0x55555555u) << 1) | ((x & 0xAAAAAAAAu) >> 1);
+    return x;
+}
+
+/**
+ * @brief Owen scrambling of a 32-bit fraction (Laine-Karras style hash)
+ * Each bit is flipped depending only on the bits above it, which keeps
+ * every elementary interval of the sequence an elementary interval.
+ */
+static uint32_t nested_uniform_scramble(uint32_t x, uint32_t seed) {
+    x = reverse_bits(x);
+    x += seed;
+    x ^= x * 0x6C50B47Cu;
+    x ^= x * 0xB82F1E52u;
+    x ^= x * 0xC7AFE638u;
+    x ^= x * 0x8D22F6E6u;
+    return reverse_bits(x);
+}
+
+/**
+ * @brief Unscrambled Sobol point as a 32-bit fraction
+ */
+static uint32_t sobol(uint32_t index, uint32_t dimension) {
+    if (dimension == 0) {
+        return reverse_bits(index);
+    }
+    const uint32_t *directions = sobol_directions[dimension - 1];
+    uint32_t x = 0;
+    for (int bit = 0; index; index >>= 1, bit++) {
+        if (index & 1u) {
+            x ^= directions[bit];
+        }
+    }
+    return x;
+}
+
+static float to_unit(uint32_t x) {
+    return (float)(x >> 8) * (1.0f / 16777216.0f);
+}
+
+/**
+ * @brief Scrambled Sobol value; all dimensions of a group of four share a shuffled index
+ */
+static uint32_t scrambled_sobol(uint32_t index, uint32_t dimension, uint32_t seed) {
+    uint32_t group_seed = hash_combine(seed, dimension / SOBOL_DIMENSIONS);
+    uint32_t shuffled = nested_uniform_scramble(index, group_seed);
+    return nested_uniform_scramble(sobol(shuffled, dimension % SOBOL_DIMENSIONS),
+                                   hash_combine(group_seed, dimension % SOBOL_DIMENSIONS + 1));
+}
+
+/**
+ * @brief Add or remove a point's Gaussian footprint in the (toroidal) energy field
+ */
+static void splat(float *energy, const float *kernel, int cell, float sign) {
+    int cx = cell % SAMPLER_MASK_SIZE;
+    int cy = cell / SAMPLER_MASK_SIZE;
+    int span = 2 * MASK_RADIUS + 1;
+    for (int dy = -MASK_RADIUS; dy <= MASK_RADIUS; dy++) {
+        int y = (cy + dy) & (SAMPLER_MASK_SIZE - 1);
+        for (int dx = -MASK_RADIUS; dx <= MASK_RADIUS; dx++) {
+            int x = (cx + dx) & (SAMPLER_MASK_SIZE - 1);
+            energy[y * SAMPLER_MASK_SIZE + x] +=
+                sign * kernel[(dy + MASK_RADIUS) * span + dx + MASK_RADIUS];
+        }
+    }
+}
+
+/**
+ * @brief Densest point (want_set) or emptiest gap (!want_set); lowest index wins ties
+ */
+static int extreme_cell(const float *energy, const uint8_t *points, bool want_set) {
+    int best = -1;
+    for (int i = 0; i < MASK_CELLS; i++) {
+        if ((points[i] != 0) != want_set) {
+            continue;
+        }
+        if (best < 0 || (want_set ? energy[i] > energy[best] : energy[i] < energy[best])) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Rank every cell with the void-and-cluster method (Ulichney)
+ * A deterministic initial pattern is relaxed by moving its densest point
+ * into the emptiest gap until that no longer changes anything; points are
+ * then ranked by removing the densest ones and adding gaps.
+ */
+static bool build_mask(float *mask) {
+    int span = 2 * MASK_RADIUS + 1;
+    float kernel[(2 * MASK_RADIUS + 1) * (2 * MASK_RADIUS + 1)];
+    for (int dy = -MASK_RADIUS; dy <= MASK_RADIUS; dy++) {
+        for (int dx = -MASK_RADIUS; dx <= MASK_RADIUS; dx++) {
+            float d2 = (float)(dx * dx + dy * dy);
+            kernel[(dy + MASK_RADIUS) * span + dx + MASK_RADIUS] =
+                expf(-d2 / (2.0f * MASK_SIGMA * MASK_SIGMA));
+        }
+    }
+    float *energy = calloc(2 * MASK_CELLS, sizeof(float));
+    uint8_t *points = calloc(2 * MASK_CELLS, 1);
+    uint32_t *rank = malloc(MASK_CELLS * sizeof(uint32_t));
+    if (!energy || !points || !rank) {
+        free(energy);
+        free(points);
+        free(rank);
+        return false;
+    }
+
+    int count = 0;
+    for (uint32_t i = 0; count < MASK_INITIAL_POINTS; i++) {
+        int cell = (int)(hash_u32(i) % MASK_CELLS);
+        if (!points[cell]) {
+            points[cell] = 1;
+            splat(energy, kernel, cell, 1.0f);
+            count++;
+        }
+    }
+    for (int step = 0; step < MASK_CELLS; step++) {
+        int cluster = extreme_cell(energy, points, true);
+        points[cluster] = 0;
+        splat(energy, kernel, cluster, -1.0f);
+        int gap = extreme_cell(energy, points, false);
+        points[gap] = 1;
+        splat(energy, kernel, gap, 1.0f);
+        if (gap == cluster) {
+            break;
+        }
+    }
+
+    // Rank the initial points from a copy, then fill the gaps from the original
+    float *work_energy = energy + MASK_CELLS;
+    uint8_t *work_points = points + MASK_CELLS;
+    memcpy(work_energy, energy, MASK_CELLS * sizeof(float));
+    memcpy(work_points, points, MASK_CELLS);
+    for (int r = count - 1; r >= 0; r--) {
+        int cluster = extreme_cell(work_energy, work_points, true);
+        work_points[cluster] = 0;
+        splat(work_energy, kernel, cluster, -1.0f);
+        rank[cluster] = (uint32_t)r;
+    }
+    for (int r = count; r < MASK_CELLS; r++) {
+        int gap = extreme_cell(energy, points, false);
+        points[gap] = 1;
+        splat(energy, kernel, gap, 1.0f);
+        rank[gap] = (uint32_t)r;
+    }
+    for (int i = 0; i < MASK_CELLS; i++) {
+        mask[i] = ((float)rank[i] + 0.5f) / (float)MASK_CELLS;
+    }
+    free(energy);
+    free(points);
+    free(rank);
+    return true;
+}
+
+bool sampler_init(Sampler *sampler, SamplerType type, uint32_t seed) {
+    sampler->type = type;
+    sampler->seed = seed;
+    sampler->mask = NULL;
+    if (type != SAMPLER_BLUE_NOISE) {
+        return true;
+    }
+    sampler->mask = malloc(MASK_CELLS * sizeof(float));
+    if (!sampler->mask || !build_mask(sampler->mask)) {
+        free(sampler->mask);
+        sampler->mask = NULL;
+        return false;
+    }
+    return true;
+}
+
+void sampler_destroy(Sampler *sampler) {
+    free(sampler->mask);
+    sampler->mask = NULL;
+}
+
+bool sampler_parse_type(const char *name, SamplerType *type) {
+    if (strcmp(name, "sobol") == 0) {
+        *type = SAMPLER_SOBOL;
+    } else if (strcmp(name, "blue-noise") == 0) {
+        *type = SAMPLER_BLUE_NOISE;
+    } else if (strcmp(name, "random") == 0) {
+        *type = SAMPLER_RANDOM;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char *sampler_type_name(SamplerType type) {
+    switch (type) {
+        case SAMPLER_SOBOL:
+            return "sobol";
+        case SAMPLER_BLUE_NOISE:
+            return "blue-noise";
+        default:
+            return "random";
+    }
+}
+
+float sampler_get(const Sampler *sampler, uint32_t x, uint32_t y, uint32_t index,
+                  uint32_t dimension) {
+    switch (sampler->type) {
+        case SAMPLER_SOBOL: {
+            uint32_t pixel_seed = hash_combine(hash_combine(sampler->seed, x), y);
+            return to_unit(scrambled_sobol(index, dimension, pixel_seed));
+        }
+        case SAMPLER_BLUE_NOISE: {
+            // Each dimension reads the mask at its own toroidal offset
+            uint32_t offset = hash_u32(hash_combine(sampler->seed, dimension));
+            uint32_t mx = (x + offset) & (SAMPLER_MASK_SIZE - 1);
+            uint32_t my = (y + (offset >> 16)) & (SAMPLER_MASK_SIZE - 1);
+            float shift = sampler->mask[my * SAMPLER_MASK_SIZE + mx];
+            float value = to_unit(scrambled_sobol(index, dimension, sampler->seed)) + shift;
+            return value >= 1.0f ? value - 1.0f : value;
+        }
+        default: {
+            uint32_t h = hash_combine(hash_combine(hash_combine(sampler->seed, x), y), index);
+            return to_unit(hash_u32(hash_combine(h, dimension)));
+        }
+    }
+}
@@ -6,15 +6,21 @@
  */
 
 #include "scene.h"
+#include "plane.h"
+#include <ctype.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
-#define EPSILON 0.001f
-
 Scene scene_create(Color background_color) {
     Scene scene;
     scene.object_count = 0;
+    scene.lights = NULL;
     scene.light_count = 0;
+    scene.light_capacity = 0;
+    scene.light_tree.nodes = NULL;
+    scene.light_tree.node_count = 0;
     scene.background_color = background_color;
     return scene;
 }
@@ -24,35 +30,301 @@ bool scene_add_object(Scene *scene, Hittable object) {
         return false;
     }
     scene->objects[scene->object_count] = object;
+    scene->materials[scene->object_count].type = MATERIAL_DIFFUSE;
+    scene->materials[scene->object_count].roughness = 0.0f;
     scene->object_count++;
     return true;
 }
 
-bool scene_add_light(Scene *scene, PointLight light) {
-    if (scene->light_count >= 8) {
+bool scene_set_material(Scene *scene, int object_index, Material material) {
+    if (object_index < 0 || object_index >= scene->object_count) {
         return false;
     }
+    scene->materials[object_index] = material;
+    return true;
+}
+
+bool scene_add_light(Scene *scene, PointLight light) {
+    if (scene->light_count >= scene->light_capacity) {
+        int capacity = scene->light_capacity > 0 ? 2 * scene->light_capacity : 8;
+        PointLight *lights = realloc(scene->lights, (size_t)capacity * sizeof(PointLight));
+        if (!lights) {
+            return false;
+        }
+        scene->lights = lights;
+        scene->light_capacity = capacity;
+    }
+    light_tree_destroy(&scene->light_tree);
     scene->lights[scene->light_count] = light;
     scene->light_count++;
     return true;
 }
 
+bool scene_build_light_tree(Scene *scene) {
+    light_tree_destroy(&scene->light_tree);
+    return light_tree_build(&scene->light_tree, scene->lights, scene->light_count);
+}
+
+void scene_destroy(Scene *scene) {
+    light_tree_destroy(&scene->light_tree);
+    free(scene->lights);
+    scene->lights = NULL;
+    scene->light_count = 0;
+    scene->light_capacity = 0;
+}
+
+/**
+ * @brief Parse one light set line
+ * @return 1 for a light, 0 for a blank or comment line, -1 if malformed
+ */
+static int parse_light_line(char *line, PointLight *light) {
+    char *comment = strchr(line, '#');
+    if (comment) {
+        *comment = '\0';
+    }
+    float values[9];
+    int count = 0;
+    char *cursor = line;
+    for (;;) {
+        while (isspace((unsigned char)*cursor)) {
+            cursor++;
+        }
+        if (*cursor == '\0') {
+            break;
+        }
+        char *end;
+        float value = strtof(cursor, &end);
+        if (end == cursor || count == 9 || !isfinite(value)) {
+            return -1;
+        }
+        values[count++] = value;
+        cursor = end;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    if (count < 7 || values[6] < 0.0f || (count > 7 && values[7] < 0.0f) ||
+        (count > 8 && values[8] < 0.0f)) {
+        return -1;
+    }
+    light->position = vec3_create(values[0], values[1], values[2]);
+    light->color = color_create(values[3], values[4], values[5]);
+    light->intensity = values[6];
+    light->falloff_start = count > 7 ? values[7] : 0.0f;
+    light->radius = count > 8 ? values[8] : 0.0f;
+    return 1;
+}
+
+bool scene_load_lights(Scene *scene, const char *path, int *error_line) {
+    *error_line = 0;
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    // Parse into a separate scene so that a bad file leaves the lights alone
+    Scene loaded = scene_create(scene->background_color);
+    char line[1024];
+    int line_number = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file)) {
+        line_number++;
+        PointLight light;
+        int parsed = parse_light_line(line, &light);
+        if (parsed < 0) {
+            *error_line = line_number;
+            ok = false;
+        } else if (parsed > 0) {
+            ok = scene_add_light(&loaded, light);
+        }
+    }
+    ok = !ferror(file) && ok;
+    fclose(file);
+    if (ok) {
+        ok = scene_build_light_tree(&loaded);
+    }
+    if (!ok) {
+        scene_destroy(&loaded);
+        return false;
+    }
+    scene_destroy(scene);
+    scene->lights = loaded.lights;
+    scene->light_count = loaded.light_count;
+    scene->light_capacity = loaded.light_capacity;
+    scene->light_tree = loaded.light_tree;
+    return true;
+}
+
+bool scene_save_lights(const Scene *scene, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    fprintf(file, "# x y z r g b intensity falloff_start radius\n");
+    for (int i = 0; i < scene->light_count; i++) {
+        const PointLight *light = &scene->lights[i];
+        // %.9g round-trips every float exactly
+        fprintf(file, "%.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g\n", light->position.x,
+                light->position.y, light->position.z, light->color.x, light->color.y,
+                light->color.z, light->intensity, light->falloff_start, light->radius);
+    }
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+}
+
 bool scene_hit(const Scene *scene, const Ray *ray, float t_min, float t_max, HitRecord *hit_rec) {
+    return scene_hit_objects(scene, ray, t_min, t_max, SCENE_ALL_OBJECTS, NULL, hit_rec);
+}
+
+/**
+ * @brief Test one object, through its hint when a cache is given
+ */
+static bool object_hit(const Scene *scene, int index, const Ray *ray, float t_min, float t_max,
+                       bool any_hit, SceneHitCache *cache, HitRecord *hit_rec) {
+    if (!cache) {
+        return hittable_hit(&scene->objects[index], ray, t_min, t_max, hit_rec);
+    }
+    return hittable_hit_hinted(&scene->objects[index], ray, t_min, t_max, any_hit,
+                               &cache->hints[index], hit_rec);
+}
+
+bool scene_hit_objects(const Scene *scene, const Ray *ray, float t_min, float t_max,
+                       SceneObjectSet objects, SceneHitCache *cache, HitRecord *hit_rec) {
     HitRecord temp_rec;
     bool hit_anything = false;
     float closest_so_far = t_max;
-    
+    int first = cache ? cache->last_hit : -1;
+    if (first >= scene->object_count ||
+        (first >= 0 && !(objects & ((SceneObjectSet)1u << first)))) {
+        first = -1;
+    }
+    // The last closest hit is the likely one again: finding it first lets
+    // every other object reject against a tight t_max
+    if (first >= 0 &&
+        object_hit(scene, first, ray, t_min, closest_so_far, false, cache, &temp_rec)) {
+        hit_anything = true;
+        closest_so_far = temp_rec.t;
+        *hit_rec = temp_rec;
+        hit_rec->object_index = first;
+    }
+
     for (int i = 0; i < scene->object_count; i++) {
-        if (hittable_hit(&scene->objects[i], ray, t_min, closest_so_far, &temp_rec)) {
+        if (i != first && (objects & ((SceneObjectSet)1u << i)) &&
+            object_hit(scene, i, ray, t_min, closest_so_far, false, cache, &temp_rec)) {
             hit_anything = true;
             closest_so_far = temp_rec.t;
             *hit_rec = temp_rec;
+            hit_rec->object_index = i;
+        }
+    }
+
+    if (cache) {
+        cache->hit_queries++;
+        if (hit_anything) {
+            cache->hit_hits += hit_rec->object_index == first && cache->hints[first].answered;
+            cache->last_hit = hit_rec->object_index;
         }
     }
-    
     return hit_anything;
 }
 
+bool scene_occluded(const Scene *scene, const Ray *ray, float t_min, float t_max,
+                    SceneHitCache *cache) {
+    HitRecord rec;
+    int first = cache ? cache->last_occluder : -1;
+    if (cache) {
+        cache->occlusion_queries++;
+    }
+    if (first >= 0 && first < scene->object_count &&
+        object_hit(scene, first, ray, t_min, t_max, true, cache, &rec)) {
+        cache->occlusion_hits += cache->hints[first].answered;
+        return true;
+    }
+    for (int i = 0; i < scene->object_count; i++) {
+        if (i != first && object_hit(scene, i, ray, t_min, t_max, true, cache, &rec)) {
+            if (cache) {
+                cache->last_occluder = i;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void scene_hit_cache_init(SceneHitCache *cache) {
+    memset(cache, 0, sizeof(*cache));
+    cache->last_hit = -1;
+    cache->last_occluder = -1;
+    for (int i = 0; i < MAX_OBJECTS; i++) {
+        cache->hints[i] = hittable_hint_init();
+    }
+}
+
+/**
+ * @brief Whether a primary ray of a tile (or a sample within its pixels) can hit a plane
+ */
+static bool tile_reaches_plane(const Camera *camera, const Plane *plane, int tx, int ty,
+                               int tile_size) {
+    // Corner rays one pixel outside the tile, so jittered samples stay inside
+    int rows = camera->image_height - 1;
+    float columns = (float)(camera->image_width - 1);
+    float u0 = (float)(tx * tile_size - 1) / columns;
+    float u1 = (float)((tx + 1) * tile_size) / columns;
+    float v0 = (float)(rows - (ty + 1) * tile_size) / (float)rows;
+    float v1 = (float)(rows - ty * tile_size + 1) / (float)rows;
+    Vec3 directions[4] = {camera_get_ray(camera, u0, v0).direction,
+                          camera_get_ray(camera, u1, v0).direction,
+                          camera_get_ray(camera, u0, v1).direction,
+                          camera_get_ray(camera, u1, v1).direction};
+    return plane_reachable(plane, camera->origin, directions, 4);
+}
+
+void scene_bin_objects(const Scene *scene, const Camera *camera, int tile_size,
+                       SceneObjectSet *tile_objects) {
+    int tiles_x = (camera->image_width + tile_size - 1) / tile_size;
+    int tiles_y = (camera->image_height + tile_size - 1) / tile_size;
+    for (int tile = 0; tile < tiles_x * tiles_y; tile++) {
+        tile_objects[tile] = 0;
+    }
+    for (int i = 0; i < scene->object_count; i++) {
+        SceneObjectSet bit = (SceneObjectSet)1u << i;
+        const Hittable *object = &scene->objects[i];
+        AABB bounds;
+        int x0 = 0, y0 = 0, x1 = camera->image_width, y1 = camera->image_height;
+        if (hittable_bounds(object, &bounds) &&
+            !camera_project_bounds(camera, bounds, &x0, &y0, &x1, &y1)) {
+            continue;
+        }
+        for (int ty = y0 / tile_size; ty <= (y1 - 1) / tile_size; ty++) {
+            for (int tx = x0 / tile_size; tx <= (x1 - 1) / tile_size; tx++) {
+                // Planes are unbounded, but cover only the tiles on their side of the horizon
+                if (object->hit_func == plane_hit &&
+                    !tile_reaches_plane(camera, object->data, tx, ty, tile_size)) {
+                    continue;
+                }
+                tile_objects[ty * tiles_x + tx] |= bit;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Light one point light adds to a Lambertian surface
+ */
+static Color shade_light(const PointLight *light, const HitRecord *hit_rec, Color material_color) {
+    Vec3 to_light = vec3_sub(light->position, hit_rec->point);
+    float distance_squared = vec3_length_squared(to_light);
+    if (!point_light_reaches(light, distance_squared)) {
+        return color_black();
+    }
+    Vec3 light_dir = vec3_normalize(to_light);
+    float dot_product = vec3_dot(hit_rec->normal, light_dir);
+    float lambertian = fmaxf(0.0f, dot_product);
+    float attenuation = point_light_attenuation(light, distance_squared);
+    
+    Color light_contribution = color_multiply(material_color, light->color);
+    return color_scale(light_contribution, lambertian * light->intensity * attenuation);
+}
+
 Color scene_shade_lambertian(const Scene *scene, const HitRecord *hit_rec, Color material_color) {
     Color final_color = color_black();
     
@@ -62,79 +334,60 @@ Color scene_shade_lambertian(const Scene *scene, const HitRecord *hit_rec, Color
     
     // Add contribution from each light
     for (int i = 0; i < scene->light_count; i++) {
-        const PointLight *light = &scene->lights[i];
-        
-        Vec3 light_dir = vec3_normalize(vec3_sub(light->position, hit_rec->point));
-        float dot_product = vec3_dot(hit_rec->normal, light_dir);
-        float lambertian = fmaxf(0.0f, dot_product);
-        
-        Color light_contribution = color_multiply(material_color, light->color);
-        light_contribution = color_scale(light_contribution, lambertian * light->intensity);
-        
-        final_color = color_add(final_color, light_contribution);
+        final_color = color_add(final_color,
+                                shade_light(&scene->lights[i], hit_rec, material_color));
     }
     
     return final_color;
 }
 
-Color scene_ray_color(const Scene *scene, const Ray *ray, int depth) {
-    if (depth <= 0) {
-        return color_black();
+Color scene_shade_lights(const Scene *scene, const HitRecord *hit_rec, Color material_color,
+                         const int *light_indices, int light_count) {
+    Color final_color = color_scale(material_color, 0.1f);
+    for (int i = 0; i < light_count; i++) {
+        final_color = color_add(final_color, shade_light(&scene->lights[light_indices[i]],
+                                                         hit_rec, material_color));
     }
-    
-    HitRecord hit_rec;
-    if (scene_hit(scene, ray, EPSILON, INFINITY, &hit_rec)) {
-        // Get material color - for now, assume sphere data contains color
-        Color material_color = color_white(); // default
-        
-        // Try to get color from the hit object
-        // This is a simplified approach - in a real ray tracer you'd have a proper material system
-        for (int i = 0; i < scene->object_count; i++) {
-            HitRecord test_rec;
-            if (hittable_hit(&scene->objects[i], ray, EPSILON, hit_rec.t + EPSILON, &test_rec)) {
-                if (fabsf(test_rec.t - hit_rec.t) < EPSILON) {
-                    // This is likely the same object - try to get its color
-                    // For spheres, the data pointer contains the sphere structure
-                    const void *data = scene->objects[i].data;
-                    // Assume it's a sphere for now - in real code you'd have a material system
-                    material_color = color_create(0.7f, 0.3f, 0.3f); // default red
-                    break;
-                }
-            }
+    return final_color;
+}
+
+int scene_cull_lights(const Scene *scene, AABB bounds, int *light_indices) {
+    int count = 0;
+    for (int i = 0; i < scene->light_count; i++) {
+        const PointLight *light = &scene->lights[i];
+        Vec3 p = light->position;
+        // Squared distance from the light to the nearest point of the box
+        float dx = fmaxf(fmaxf(bounds.min.x - p.x, p.x - bounds.max.x), 0.0f);
+        float dy = fmaxf(fmaxf(bounds.min.y - p.y, p.y - bounds.max.y), 0.0f);
+        float dz = fmaxf(fmaxf(bounds.min.z - p.z, p.z - bounds.max.z), 0.0f);
+        if (point_light_reaches(light, dx * dx + dy * dy + dz * dz)) {
+            light_indices[count++] = i;
         }
-        
-        return scene_shade_lambertian(scene, &hit_rec, material_color);
     }
-    
-    return scene->background_color;
+    return count;
 }
 
-void render_scene(Camera *camera, Scene *scene, FILE *output) {
-    // Write PPM header
-    fprintf(output, "P3\n");
-    fprintf(output, "%d %d\n", camera->image_width, camera->image_height);
-    fprintf(output, "255\n");
+Color scene_ray_color(const Scene *scene, const Ray *ray, int depth) {
+    Color color;
+    HitRecord hit_rec;
+    scene_trace(scene, ray, depth, &color, &hit_rec);
+    return color;
+}
+
+bool scene_trace(const Scene *scene, const Ray *ray, int depth, Color *color, HitRecord *primary) {
+    if (depth <= 0) {
+        *color = color_black();
+        return false;
+    }
     
-    // Render each pixel
-    for (int j = camera->image_height - 1; j >= 0; j--) {
-        fprintf(stderr, "\rScanlines remaining: %d ", j);
-        fflush(stderr);
-        
-        for (int i = 0; i < camera->image_width; i++) {
-            float u, v;
-            camera_pixel_to_uv(camera, i, j, &u, &v);
-            
-            Ray ray = camera_get_ray(camera, u, v);
-            Color pixel_color = scene_ray_color(scene, &ray, 10);
-            
-            // Convert to PPM format
-            uint8_t r, g, b;
-            color_to_u8(pixel_color, &r, &g, &b);
-            fprintf(output, "%d %d %d\n", r, g, b);
-        }
+    if (scene_hit(scene, ray, SCENE_RAY_EPSILON, INFINITY, primary)) {
+        // Primitives report their material color in the hit record
+        *color = scene_shade_lambertian(scene, primary, primary->albedo);
+        return true;
     }
     
-    fprintf(stderr, "\nDone.\n");
+    *color = scene->background_color;
+    return false;
 }
 
 void scene_print(const Scene *scene) {
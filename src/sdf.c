@@ -0,0 +1,208 @@
+/**
+ * @file sdf.c
+ * @brief Signed-distance-field objects and sphere tracing
+ */
+
+#include "sdf.h"
+#include <math.h>
+
+#define SDF_DEFAULT_EPSILON 1e-4f
+
+SdfObject sdf_object_create(Color color) {
+    SdfObject sdf;
+    sdf.node_count = 0;
+    sdf.root = -1;
+    sdf.max_steps = SDF_DEFAULT_MAX_STEPS;
+    sdf.relaxation = SDF_DEFAULT_RELAXATION;
+    sdf.hit_epsilon = SDF_DEFAULT_EPSILON;
+    sdf.color = color;
+    return sdf;
+}
+
+static int sdf_push(SdfObject *sdf, SdfNode node) {
+    if (sdf->node_count >= SDF_MAX_NODES) {
+        return -1;
+    }
+    int index = sdf->node_count++;
+    sdf->nodes[index] = node;
+    sdf->root = index;
+    return index;
+}
+
+int sdf_add_sphere(SdfObject *sdf, Vec3 center, float radius) {
+    SdfNode node = {0};
+    node.type = SDF_SPHERE;
+    node.center = center;
+    node.radius = radius;
+    Vec3 r = vec3_create(radius, radius, radius);
+    node.bounds = aabb_create(vec3_sub(center, r), vec3_add(center, r));
+    return sdf_push(sdf, node);
+}
+
+int sdf_add_box(SdfObject *sdf, Vec3 center, Vec3 half_extent, float rounding) {
+    SdfNode node = {0};
+    node.type = SDF_BOX;
+    node.center = center;
+    node.half_extent = half_extent;
+    node.radius = rounding;
+    Vec3 e = vec3_add(half_extent, vec3_create(rounding, rounding, rounding));
+    node.bounds = aabb_create(vec3_sub(center, e), vec3_add(center, e));
+    return sdf_push(sdf, node);
+}
+
+static int sdf_add_binary(SdfObject *sdf, SdfNodeType type, int left, int right,
+                          float smoothness) {
+    if (left < 0 || right < 0 || left >= sdf->node_count || right >= sdf->node_count) {
+        return -1;
+    }
+    SdfNode node = {0};
+    node.type = type;
+    node.left = left;
+    node.right = right;
+    node.smoothness = smoothness;
+    node.bounds = aabb_union(sdf->nodes[left].bounds, sdf->nodes[right].bounds);
+    // The polynomial smooth minimum lies at most smoothness / 4 below the hard minimum
+    float pad = 0.25f * smoothness;
+    Vec3 p = vec3_create(pad, pad, pad);
+    node.bounds = aabb_create(vec3_sub(node.bounds.min, p), vec3_add(node.bounds.max, p));
+    return sdf_push(sdf, node);
+}
+
+int sdf_add_union(SdfObject *sdf, int left, int right) {
+    return sdf_add_binary(sdf, SDF_UNION, left, right, 0.0f);
+}
+
+int sdf_add_smooth_union(SdfObject *sdf, int left, int right, float smoothness) {
+    return sdf_add_binary(sdf, SDF_SMOOTH_UNION, left, right, smoothness);
+}
+
+void sdf_set_root(SdfObject *sdf, int root) {
+    if (root >= 0 && root < sdf->node_count) {
+        sdf->root = root;
+    }
+}
+
+static float sdf_node_evaluate(const SdfObject *sdf, int index, Vec3 p) {
+    const SdfNode *node = &sdf->nodes[index];
+    switch (node->type) {
+        case SDF_SPHERE:
+            return vec3_length(vec3_sub(p, node->center)) - node->radius;
+        case SDF_BOX: {
+            Vec3 d = vec3_sub(p, node->center);
+            Vec3 q = vec3_create(fabsf(d.x) - node->half_extent.x,
+                                 fabsf(d.y) - node->half_extent.y,
+                                 fabsf(d.z) - node->half_extent.z);
+            Vec3 outside = vec3_create(fmaxf(q.x, 0.0f), fmaxf(q.y, 0.0f), fmaxf(q.z, 0.0f));
+            float inside = fminf(fmaxf(q.x, fmaxf(q.y, q.z)), 0.0f);
+            return vec3_length(outside) + inside - node->radius;
+        }
+        case SDF_UNION:
+            return fminf(sdf_node_evaluate(sdf, node->left, p),
+                         sdf_node_evaluate(sdf, node->right, p));
+        case SDF_SMOOTH_UNION: {
+            float a = sdf_node_evaluate(sdf, node->left, p);
+            float b = sdf_node_evaluate(sdf, node->right, p);
+            float k = node->smoothness;
+            if (k <= 0.0f) {
+                return fminf(a, b);
+            }
+            float h = fmaxf(k - fabsf(a - b), 0.0f) / k;
+            return fminf(a, b) - h * h * k * 0.25f;
+        }
+    }
+    return INFINITY;
+}
+
+float sdf_evaluate(const SdfObject *sdf, Vec3 point) {
+    if (sdf->root < 0) {
+        return INFINITY;
+    }
+    return sdf_node_evaluate(sdf, sdf->root, point);
+}
+
+/**
+ * @brief Surface normal from a tetrahedral finite-difference gradient
+ */
+static Vec3 sdf_normal(const SdfObject *sdf, Vec3 p) {
+    const float h = 1e-3f;
+    Vec3 k0 = vec3_create(1.0f, -1.0f, -1.0f);
+    Vec3 k1 = vec3_create(-1.0f, -1.0f, 1.0f);
+    Vec3 k2 = vec3_create(-1.0f, 1.0f, -1.0f);
+    Vec3 k3 = vec3_create(1.0f, 1.0f, 1.0f);
+    Vec3 n = vec3_scale(k0, sdf_evaluate(sdf, vec3_add(p, vec3_scale(k0, h))));
+    n = vec3_add(n, vec3_scale(k1, sdf_evaluate(sdf, vec3_add(p, vec3_scale(k1, h)))));
+    n = vec3_add(n, vec3_scale(k2, sdf_evaluate(sdf, vec3_add(p, vec3_scale(k2, h)))));
+    n = vec3_add(n, vec3_scale(k3, sdf_evaluate(sdf, vec3_add(p, vec3_scale(k3, h)))));
+    return vec3_normalize(n);
+}
+
+bool sdf_hit(const Hittable *hittable, const Ray *ray, float t_min, float t_max,
+             HitRecord *hit_rec) {
+    const SdfObject *sdf = (const SdfObject *)hittable->data;
+    if (sdf->root < 0) {
+        return false;
+    }
+
+    // March only over the part of the ray inside the bounds
+    float t_enter, t_exit;
+    const AABB *box = &sdf->nodes[sdf->root].bounds;
+    if (!aabb_hit(box, ray, aabb_inverse_direction(ray), t_min, t_max, &t_enter, &t_exit)) {
+        return false;
+    }
+
+    // Over-relaxed sphere tracing (Keinert et al. 2014): take steps of
+    // relaxation * distance, and fall back to a plain step whenever the
+    // unbounding spheres of consecutive points stop overlapping.
+    float t = t_enter;
+    float sign = sdf_evaluate(sdf, ray_at(ray, t)) < 0.0f ? -1.0f : 1.0f;
+    float omega = sdf->relaxation;
+    float step = 0.0f;
+    float prev_radius = 0.0f;
+    bool hit = false;
+
+    for (int i = 0; i < sdf->max_steps; i++) {
+        float signed_radius = sign * sdf_evaluate(sdf, ray_at(ray, t));
+        float radius = fabsf(signed_radius);
+        bool overstepped = omega > 1.0f && radius + prev_radius < step;
+        if (overstepped) {
+            step -= omega * step;
+            omega = 1.0f;
+        } else {
+            // Past the end only once the step there is known not to have
+            // skipped a surface, so the result does not depend on t_max
+            if (t > t_exit) {
+                break;
+            }
+            if (radius < sdf->hit_epsilon) {
+                hit = true;
+                break;
+            }
+            step = signed_radius * omega;
+        }
+        prev_radius = radius;
+        t += step;
+    }
+
+    if (!hit || t < t_min || t > t_max) {
+        return false;
+    }
+
+    hit_rec->t = t;
+    hit_rec->point = ray_at(ray, t);
+    hit_record_set_face_normal(hit_rec, ray, sdf_normal(sdf, hit_rec->point));
+    hit_rec->albedo = sdf->color;
+    return true;
+}
+
+bool sdf_bounds(const Hittable *hittable, AABB *box) {
+    const SdfObject *sdf = (const SdfObject *)hittable->data;
+    if (sdf->root < 0) {
+        return false;
+    }
+    *box = sdf->nodes[sdf->root].bounds;
+    return true;
+}
+
+Hittable sdf_to_hittable(SdfObject *sdf) {
+    return hittable_create_bounded(sdf, sdf_hit, sdf_bounds);
+}
@@ -0,0 +1,407 @@
+/**
+ * @file session.c
+ * @brief Command-driven rendering with a resident scene
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "session.h"
+#include "preview.h"
+#include "timer.h"
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/**
+ * @brief Camera parameters the commands edit
+ */
+typedef struct {
+    Vec3 eye;       ///< Camera position
+    Vec3 target;    ///< Point looked at
+    float fov;      ///< Vertical field of view in degrees
+} SessionView;
+
+/**
+ * @brief Session state shared with the frame thread
+ * The command loop only changes the camera, settings and scene while no
+ * frame is running.
+ */
+typedef struct {
+    Scene *scene;               ///< Resident scene (objects moved by commands)
+    RenderCache cache;          ///< Pixels and tile dependencies (used if settings.cache is set)
+    int preview_factor;         ///< Starting preview factor of every frame (0: full frames)
+    Camera camera;              ///< Camera of the current frame
+    RenderSettings settings;    ///< Settings of the current frame
+    const char *output_path;    ///< Image replaced by completed frames
+    FILE *replies;              ///< Frame reports and errors
+    SharedFramebuffer live;     ///< Live framebuffer (mapped if settings.framebuffer is set)
+    atomic_bool cancel;         ///< Set to stop the frame in flight
+    pthread_t thread;           ///< Frame thread
+    bool running;               ///< The frame thread has not been joined yet
+    double command_time;        ///< When the command that started the frame was read
+    int timed_frames;           ///< Frames that finished at least one tile
+    SessionStats stats;         ///< Running totals (first tile times summed until the end)
+} Session;
+
+/**
+ * @brief Recover the eye, target and field of view of a perspective camera
+ */
+static SessionView view_from_camera(const Camera *camera) {
+    SessionView view;
+    Vec3 center = vec3_add(camera->lower_left, vec3_add(vec3_scale(camera->horizontal, 0.5f),
+                                                        vec3_scale(camera->vertical, 0.5f)));
+    float height = vec3_length(camera->vertical);
+    view.eye = camera->origin;
+    view.target = vec3_add(camera->origin, vec3_normalize(vec3_sub(center, camera->origin)));
+    view.fov = 2.0f * atanf(0.5f * height) * 180.0f / (float)M_PI;
+    return view;
+}
+
+/**
+ * @brief Whether two views give the same camera
+ */
+static bool views_equal(const SessionView *a, const SessionView *b) {
+    return a->eye.x == b->eye.x && a->eye.y == b->eye.y && a->eye.z == b->eye.z &&
+           a->target.x == b->target.x && a->target.y == b->target.y &&
+           a->target.z == b->target.z && a->fov == b->fov;
+}
+
+/**
+ * @brief Whether two integrator settings render the same image
+ */
+static bool integrators_equal(const IntegratorSettings *a, const IntegratorSettings *b) {
+    return a->type == b->type && a->max_bounces == b->max_bounces &&
+           a->roulette_bounces == b->roulette_bounces && a->light_samples == b->light_samples;
+}
+
+/**
+ * @brief Render the current frame under a temporary name and move it into place
+ */
+static bool write_frame(Session *session, RenderStats *stats) {
+    char temp_path[4096];
+    if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", session->output_path) >=
+        (int)sizeof(temp_path)) {
+        return false;
+    }
+    FILE *file = fopen(temp_path, "wb");
+    if (!file) {
+        return false;
+    }
+    bool ok = render_scene(&session->camera, session->scene, &session->settings, file, NULL,
+                           stats);
+    ok = fclose(file) == 0 && ok;
+    ok = ok && rename(temp_path, session->output_path) == 0;
+    if (!ok) {
+        remove(temp_path);
+    }
+    return ok;
+}
+
+static void *frame_thread(void *arg) {
+    Session *session = (Session *)arg;
+    int frame = session->stats.frames;
+    double start = timer_now_seconds();
+    RenderStats stats;
+    stats.first_tile_seconds = 0.0;
+    stats.cached_tiles = 0;
+    // A preview replaces the output itself, once per level
+    bool ok = session->preview_factor
+                  ? render_preview(&session->camera, session->scene, &session->settings,
+                                   session->preview_factor, session->output_path, &stats, NULL)
+                  : write_frame(session, &stats);
+    double end = timer_now_seconds();
+    session->stats.cached_tiles += stats.cached_tiles;
+    double first_tile = start - session->command_time + stats.first_tile_seconds;
+    if (stats.first_tile_seconds > 0.0) {
+        session->timed_frames++;
+        session->stats.mean_first_tile_seconds += first_tile;
+        if (first_tile > session->stats.max_first_tile_seconds) {
+            session->stats.max_first_tile_seconds = first_tile;
+        }
+    }
+    if (ok) {
+        session->stats.completed++;
+        fprintf(session->replies, "frame %d complete: first tile %.1f ms, last %.1f ms after the "
+                "command\n", frame, first_tile * 1000.0, (end - session->command_time) * 1000.0);
+    } else if (atomic_load(&session->cancel)) {
+        session->stats.cancelled++;
+        if (stats.first_tile_seconds > 0.0) {
+            fprintf(session->replies, "frame %d cancelled: first tile %.1f ms after the command, "
+                    "stopped after %.1f ms\n", frame, first_tile * 1000.0, (end - start) * 1000.0);
+        } else {
+            fprintf(session->replies, "frame %d cancelled after %.1f ms\n", frame,
+                    (end - start) * 1000.0);
+        }
+    } else {
+        fprintf(session->replies, "frame %d failed\n", frame);
+    }
+    fflush(session->replies);
+    return NULL;
+}
+
+/**
+ * @brief Render the current camera and settings on the frame thread
+ * @param command_time When the command asking for the frame was read
+ * @return false if the thread cannot be created
+ */
+static bool start_frame(Session *session, double command_time) {
+    session->stats.frames++;
+    session->command_time = command_time;
+    atomic_store(&session->cancel, false);
+    session->running = pthread_create(&session->thread, NULL, frame_thread, session) == 0;
+    return session->running;
+}
+
+/**
+ * @brief Wait for the frame in flight, cancelling it first if asked to
+ */
+static void finish_frame(Session *session, bool cancel) {
+    if (session->running) {
+        if (cancel) {
+            atomic_store(&session->cancel, true);
+        }
+        pthread_join(session->thread, NULL);
+        session->running = false;
+    }
+}
+
+/**
+ * @brief Parse a non-negative integer argument
+ */
+static bool parse_count(const char *args, int *value) {
+    char extra;
+    return sscanf(args, "%d %c", value, &extra) == 1 && *value >= 0;
+}
+
+/**
+ * @brief Apply one command to a copy of the view and integrator
+ * @param name Command name
+ * @param args Rest of the line
+ * @param view View to change
+ * @param integrator Integrator to change
+ * @return NULL on success, otherwise the reason the command was rejected
+ */
+static const char *apply_command(const char *name, const char *args, SessionView *view,
+                                 IntegratorSettings *integrator) {
+    char extra;
+    if (strcmp(name, "camera") == 0) {
+        float v[7];
+        int count = sscanf(args, "%f %f %f %f %f %f %f %c", &v[0], &v[1], &v[2], &v[3], &v[4],
+                           &v[5], &v[6], &extra);
+        if (count != 6 && count != 7) {
+            return "needs X Y Z TX TY TZ [FOV]";
+        }
+        Vec3 eye = vec3_create(v[0], v[1], v[2]);
+        Vec3 target = vec3_create(v[3], v[4], v[5]);
+        Vec3 forward = vec3_sub(target, eye);
+        if (vec3_length_squared(forward) == 0.0f ||
+            vec3_length_squared(vec3_cross(forward, vec3_create(0.0f, 1.0f, 0.0f))) == 0.0f) {
+            return "the target must be away from the eye and not straight above or below";
+        }
+        if (count == 7 && !(v[6] > 0.0f && v[6] < 180.0f)) {
+            return "the field of view must be between 0 and 180 degrees";
+        }
+        view->eye = eye;
+        view->target = target;
+        view->fov = count == 7 ? v[6] : view->fov;
+    } else if (strcmp(name, "move") == 0) {
+        float d[3];
+        if (sscanf(args, "%f %f %f %c", &d[0], &d[1], &d[2], &extra) != 3) {
+            return "needs DX DY DZ";
+        }
+        Vec3 offset = vec3_create(d[0], d[1], d[2]);
+        view->eye = vec3_add(view->eye, offset);
+        view->target = vec3_add(view->target, offset);
+    } else if (strcmp(name, "fov") == 0) {
+        float fov;
+        if (sscanf(args, "%f %c", &fov, &extra) != 1 || !(fov > 0.0f && fov < 180.0f)) {
+            return "the field of view must be between 0 and 180 degrees";
+        }
+        view->fov = fov;
+    } else if (strcmp(name, "integrator") == 0) {
+        char type_name[32];
+        if (sscanf(args, "%31s %c", type_name, &extra) != 1 ||
+            !integrator_parse_type(type_name, &integrator->type)) {
+            return "use direct or path";
+        }
+    } else if (strcmp(name, "max-bounces") == 0) {
+        if (!parse_count(args, &integrator->max_bounces)) {
+            return "needs a count of 0 or more";
+        }
+    } else if (strcmp(name, "rr-bounces") == 0) {
+        if (!parse_count(args, &integrator->roulette_bounces)) {
+            return "needs a count of 0 or more";
+        }
+    } else if (strcmp(name, "light-samples") == 0) {
+        if (!parse_count(args, &integrator->light_samples)) {
+            return "needs a count of 0 or more";
+        }
+    } else if (strcmp(name, "render") != 0) {
+        return "unknown command";
+    }
+    return NULL;
+}
+
+/**
+ * @brief Parse the arguments of a move-object command
+ * @param args Rest of the line
+ * @param scene Scene whose object is moved
+ * @param index Object index
+ * @param offset World-space translation
+ * @return NULL on success, otherwise the reason the command was rejected
+ */
+static const char *parse_object_move(const char *args, const Scene *scene, int *index,
+                                     Vec3 *offset) {
+    char extra;
+    float d[3];
+    if (sscanf(args, "%d %f %f %f %c", index, &d[0], &d[1], &d[2], &extra) != 4) {
+        return "needs I DX DY DZ";
+    }
+    if (*index < 0 || *index >= scene->object_count) {
+        return "no such object";
+    }
+    if (!scene->objects[*index].move_func) {
+        return "the object cannot be moved";
+    }
+    *offset = vec3_create(d[0], d[1], d[2]);
+    return NULL;
+}
+
+bool session_run(const Camera *camera, Scene *scene, const RenderSettings *settings,
+                 int preview_factor, const char *output_path, FILE *commands, FILE *replies,
+                 SessionStats *stats) {
+    if (settings->aovs || settings->gbuffer || settings->cache ||
+        (preview_factor && (!preview_factor_valid(preview_factor) || settings->cull_lights))) {
+        return false;
+    }
+    int tile_size = settings->tile_size > 0 ? settings->tile_size : RENDER_DEFAULT_TILE_SIZE;
+    double start = timer_now_seconds();
+    Session session;
+    memset(&session, 0, sizeof(session));
+    session.scene = scene;
+    session.camera = *camera;
+    session.settings = *settings;
+    session.settings.progress_mode = PROGRESS_QUIET;
+    session.settings.shm_name = NULL;
+    session.settings.cancel = &session.cancel;
+    session.preview_factor = preview_factor;
+    session.output_path = output_path;
+    session.replies = replies;
+    atomic_init(&session.cancel, false);
+    // Previews shade every level anew and cannot reuse cached tiles
+    if (!preview_factor) {
+        if (!render_cache_create(&session.cache, camera->image_width, camera->image_height,
+                                 tile_size)) {
+            return false;
+        }
+        session.settings.cache = &session.cache;
+    }
+    if (settings->shm_name) {
+        if (!shared_framebuffer_create(&session.live, settings->shm_name, camera->image_width,
+                                       camera->image_height,
+                                       image_format_is_float(settings->output_format)
+                                           ? SHARED_FRAMEBUFFER_RGB32F
+                                           : SHARED_FRAMEBUFFER_RGB8,
+                                       tile_size)) {
+            if (session.settings.cache) {
+                render_cache_destroy(&session.cache);
+            }
+            return false;
+        }
+        session.settings.framebuffer = &session.live;
+    }
+    SessionView view = view_from_camera(camera);
+
+    bool ok = start_frame(&session, start);
+    char line[SESSION_MAX_LINE];
+    while (ok && fgets(line, sizeof(line), commands)) {
+        double received = timer_now_seconds();
+        size_t length = strlen(line);
+        if (length == sizeof(line) - 1 && line[length - 1] != '\n') {
+            int c;
+            while ((c = fgetc(commands)) != EOF && c != '\n') {
+            }
+            session.stats.commands++;
+            fprintf(replies, "error: line longer than %d bytes\n", SESSION_MAX_LINE - 2);
+            fflush(replies);
+            continue;
+        }
+        char name[32];
+        int name_end = 0;
+        if (sscanf(line, "%31s%n", name, &name_end) != 1 || name[0] == '#') {
+            continue;
+        }
+        session.stats.commands++;
+        if (strcmp(name, "quit") == 0) {
+            finish_frame(&session, true);
+            break;
+        }
+        if (strcmp(name, "wait") == 0) {
+            finish_frame(&session, false);
+            continue;
+        }
+        if (strcmp(name, "move-object") == 0) {
+            int index;
+            Vec3 offset;
+            const char *error = parse_object_move(line + name_end, session.scene, &index, &offset);
+            if (error) {
+                fprintf(replies, "error: %s: %s\n", name, error);
+                fflush(replies);
+                continue;
+            }
+            finish_frame(&session, true);
+            hittable_move(&session.scene->objects[index], offset);
+            // Only the tiles that saw the object or now may see it are rendered again
+            if (session.settings.cache) {
+                render_cache_invalidate_object(&session.cache, &session.camera, session.scene,
+                                               index);
+            }
+            ok = start_frame(&session, received);
+            continue;
+        }
+        SessionView next_view = view;
+        IntegratorSettings next_integrator = session.settings.integrator;
+        const char *error = apply_command(name, line + name_end, &next_view, &next_integrator);
+        if (error) {
+            fprintf(replies, "error: %s: %s\n", name, error);
+            fflush(replies);
+            continue;
+        }
+        finish_frame(&session, true);
+        bool view_changed = !views_equal(&next_view, &view);
+        if (session.settings.cache &&
+            (view_changed || !integrators_equal(&next_integrator, &session.settings.integrator))) {
+            render_cache_invalidate_all(&session.cache);
+        }
+        if (view_changed) {
+            view = next_view;
+            // Same up vector and aspect ratio as the built-in scenes' cameras
+            session.camera = camera_create_perspective(
+                view.eye, view.target, vec3_create(0.0f, 1.0f, 0.0f), view.fov,
+                (float)camera->image_width / (float)camera->image_height, camera->image_width,
+                camera->image_height);
+        }
+        session.settings.integrator = next_integrator;
+        ok = start_frame(&session, received);
+    }
+    finish_frame(&session, false);
+    if (session.settings.framebuffer) {
+        shared_framebuffer_close(&session.live);
+    }
+    if (session.settings.cache) {
+        render_cache_destroy(&session.cache);
+    }
+    if (session.timed_frames > 0) {
+        session.stats.mean_first_tile_seconds /= session.timed_frames;
+    }
+    if (stats) {
+        *stats = session.stats;
+    }
+    return ok;
+}
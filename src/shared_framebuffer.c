@@ -0,0 +1,171 @@
+/**
+ * @file shared_framebuffer.c
+ * @brief Live framebuffer in POSIX shared memory
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "shared_framebuffer.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Alignment of the pixel data (a cache line)
+ */
+#define PIXEL_ALIGNMENT 64
+
+/**
+ * @brief Offset of the generation counters
+ */
+static size_t generations_offset(void) {
+    return (sizeof(SharedFramebufferHeader) + 7) & ~(size_t)7;
+}
+
+/**
+ * @brief Point the framebuffer at the parts of a mapping
+ */
+static void attach(SharedFramebuffer *framebuffer, void *mapping, size_t size) {
+    framebuffer->header = mapping;
+    framebuffer->generations = (_Atomic uint32_t *)((uint8_t *)mapping + generations_offset());
+    framebuffer->pixels = (uint8_t *)mapping + framebuffer->header->pixel_offset;
+    framebuffer->size = size;
+}
+
+bool shared_framebuffer_create(SharedFramebuffer *framebuffer, const char *name, int width,
+                               int height, SharedFramebufferFormat format, int tile_size) {
+    memset(framebuffer, 0, sizeof(*framebuffer));
+    uint32_t pixel_bytes = format == SHARED_FRAMEBUFFER_RGB32F ? 3 * sizeof(float) : 3;
+    uint32_t tiles_x = (uint32_t)((width + tile_size - 1) / tile_size);
+    uint32_t tiles_y = (uint32_t)((height + tile_size - 1) / tile_size);
+    size_t tile_count = (size_t)tiles_x * tiles_y;
+    size_t pixel_offset = generations_offset() + tile_count * sizeof(uint32_t);
+    pixel_offset = (pixel_offset + PIXEL_ALIGNMENT - 1) & ~(size_t)(PIXEL_ALIGNMENT - 1);
+    size_t size = pixel_offset + (size_t)width * (size_t)height * pixel_bytes;
+
+    // A fresh segment: viewers still mapping the previous one keep it intact
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    if (ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        shm_unlink(name);
+        return false;
+    }
+    void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        shm_unlink(name);
+        return false;
+    }
+
+    // New pages are zero: every generation starts even, every pixel black
+    SharedFramebufferHeader *header = mapping;
+    header->version = SHARED_FRAMEBUFFER_VERSION;
+    header->format = (uint32_t)format;
+    header->width = (uint32_t)width;
+    header->height = (uint32_t)height;
+    header->pixel_bytes = pixel_bytes;
+    header->tile_size = (uint32_t)tile_size;
+    header->tiles_x = tiles_x;
+    header->tiles_y = tiles_y;
+    header->pixel_offset = pixel_offset;
+    header->segment_bytes = size;
+    atomic_init(&header->state, SHARED_FRAMEBUFFER_RENDERING);
+    atomic_init(&header->frame, 1);
+    atomic_init(&header->tiles_written, 0);
+    // Readers check the magic last written
+    atomic_thread_fence(memory_order_release);
+    memcpy(header->magic, SHARED_FRAMEBUFFER_MAGIC, sizeof(header->magic));
+    attach(framebuffer, mapping, size);
+    framebuffer->writable = true;
+    return true;
+}
+
+bool shared_framebuffer_open(SharedFramebuffer *framebuffer, const char *name) {
+    memset(framebuffer, 0, sizeof(*framebuffer));
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(SharedFramebufferHeader)) {
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)info.st_size;
+    void *mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    const SharedFramebufferHeader *header = mapping;
+    bool valid = memcmp(header->magic, SHARED_FRAMEBUFFER_MAGIC, sizeof(header->magic)) == 0 &&
+                 header->version == SHARED_FRAMEBUFFER_VERSION &&
+                 header->segment_bytes == size;
+    atomic_thread_fence(memory_order_acquire);
+    if (!valid) {
+        munmap(mapping, size);
+        return false;
+    }
+    attach(framebuffer, mapping, size);
+    return true;
+}
+
+void shared_framebuffer_close(SharedFramebuffer *framebuffer) {
+    if (framebuffer->header) {
+        munmap(framebuffer->header, framebuffer->size);
+    }
+    memset(framebuffer, 0, sizeof(*framebuffer));
+}
+
+void shared_framebuffer_write_tile(SharedFramebuffer *framebuffer, uint64_t tile,
+                                   const void *pixels, size_t stride) {
+    SharedFramebufferHeader *header = framebuffer->header;
+    uint32_t tile_size = header->tile_size;
+    uint32_t x0 = (uint32_t)(tile % header->tiles_x) * tile_size;
+    uint32_t y0 = (uint32_t)(tile / header->tiles_x) * tile_size;
+    uint32_t x1 = x0 + tile_size < header->width ? x0 + tile_size : header->width;
+    uint32_t y1 = y0 + tile_size < header->height ? y0 + tile_size : header->height;
+    size_t row_bytes = (size_t)(x1 - x0) * header->pixel_bytes;
+    size_t image_stride = (size_t)header->width * header->pixel_bytes;
+
+    // Only this thread writes the tile, so its generation can be bumped without a CAS
+    _Atomic uint32_t *generation = &framebuffer->generations[tile];
+    uint32_t even = atomic_load_explicit(generation, memory_order_relaxed);
+    atomic_store_explicit(generation, even + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    const uint8_t *in = pixels;
+    uint8_t *out = framebuffer->pixels + (size_t)y0 * image_stride +
+                   (size_t)x0 * header->pixel_bytes;
+    for (uint32_t y = y0; y < y1; y++) {
+        memcpy(out, in, row_bytes);
+        in += stride;
+        out += image_stride;
+    }
+    atomic_store_explicit(generation, even + 2, memory_order_release);
+    atomic_fetch_add_explicit(&header->tiles_written, 1, memory_order_release);
+}
+
+void shared_framebuffer_set_state(SharedFramebuffer *framebuffer, SharedFramebufferState state) {
+    if (state == SHARED_FRAMEBUFFER_RENDERING) {
+        atomic_fetch_add_explicit(&framebuffer->header->frame, 1, memory_order_relaxed);
+    }
+    atomic_store_explicit(&framebuffer->header->state, (uint32_t)state, memory_order_release);
+}
+
+uint32_t shared_framebuffer_read_begin(const SharedFramebuffer *framebuffer, uint64_t tile) {
+    return atomic_load_explicit(&framebuffer->generations[tile], memory_order_acquire);
+}
+
+bool shared_framebuffer_read_end(const SharedFramebuffer *framebuffer, uint64_t tile,
+                                 uint32_t generation) {
+    atomic_thread_fence(memory_order_acquire);
+    return (generation & 1u) == 0 &&
+           atomic_load_explicit(&framebuffer->generations[tile], memory_order_relaxed) ==
+               generation;
+}
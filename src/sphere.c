@@ -21,26 +21,9 @@ bool sphere_hit(const Hittable *hittable, const Ray *ray,
                 float t_min, float t_max, HitRecord *hit_rec) {
     const Sphere *sphere = (const Sphere *)hittable->data;
     
-    // Ray-sphere intersection using quadratic formula
-    Vec3 oc = vec3_sub(ray->origin, sphere->center);
-    float a = vec3_dot(ray->direction, ray->direction);
-    float b = 2.0f * vec3_dot(oc, ray->direction);
-    float c = vec3_dot(oc, oc) - sphere->radius * sphere->radius;
-    
-    float discriminant = b * b - 4.0f * a * c;
-    if (discriminant < 0.0f) {
-        return false; // No intersection
-    }
-    
-    // Find the nearest intersection
-    float sqrt_discriminant = sqrtf(discriminant);
-    float root = (-b - sqrt_discriminant) / (2.0f * a);
-    
-    if (root < t_min || root > t_max) {
-        root = (-b + sqrt_discriminant) / (2.0f * a);
-        if (root < t_min || root > t_max) {
-            return false;
-        }
+    float root;
+    if (!sphere_intersect(sphere->center, sphere->radius, ray, t_min, t_max, &root)) {
+        return false;
     }
     
     // Fill hit record
@@ -48,12 +31,27 @@ bool sphere_hit(const Hittable *hittable, const Ray *ray,
     hit_rec->point = ray_at(ray, hit_rec->t);
     Vec3 outward_normal = vec3_div(vec3_sub(hit_rec->point, sphere->center), sphere->radius);
     hit_record_set_face_normal(hit_rec, ray, outward_normal);
+    hit_rec->albedo = sphere->color;
     
     return true;
 }
 
+bool sphere_bounds(const Hittable *hittable, AABB *box) {
+    const Sphere *sphere = (const Sphere *)hittable->data;
+    Vec3 r = vec3_create(sphere->radius, sphere->radius, sphere->radius);
+    *box = aabb_create(vec3_sub(sphere->center, r), vec3_add(sphere->center, r));
+    return true;
+}
+
+void sphere_move(const Hittable *hittable, Vec3 offset) {
+    Sphere *sphere = (Sphere *)hittable->data;
+    sphere->center = vec3_add(sphere->center, offset);
+}
+
 Hittable sphere_to_hittable(Sphere *sphere) {
-    return hittable_create(sphere, sphere_hit);
+    Hittable hittable = hittable_create_bounded(sphere, sphere_hit, sphere_bounds);
+    hittable.move_func = sphere_move;
+    return hittable;
 }
 
 Vec3 sphere_normal_at(const Sphere *sphere, Vec3 point) {
@@ -0,0 +1,364 @@
+/**
+ * @file voxel.c
+ * @brief Sparse voxel volume implementation
+ */
+
+#include "voxel.h"
+#include "aabb.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/**
+ * @brief 3D-DDA state over integer cells in [lo, hi)
+ */
+typedef struct {
+    int cell[3];
+    int step[3];
+    int lo[3];
+    int hi[3];
+    float t_next[3];
+    float t_delta[3];
+} Dda;
+
+/**
+ * @brief Start a DDA at parameter t
+ * @param origin Ray origin in cell units
+ * @param dir Ray direction in cell units
+ */
+static void dda_init(Dda *dda, const float origin[3], const float dir[3], float t,
+                     const int lo[3], const int hi[3]) {
+    for (int a = 0; a < 3; a++) {
+        dda->lo[a] = lo[a];
+        dda->hi[a] = hi[a];
+        int c = (int)floorf(origin[a] + t * dir[a]);
+        dda->cell[a] = c < lo[a] ? lo[a] : (c >= hi[a] ? hi[a] - 1 : c);
+        if (dir[a] > 0.0f) {
+            dda->step[a] = 1;
+            dda->t_next[a] = ((float)(dda->cell[a] + 1) - origin[a]) / dir[a];
+            dda->t_delta[a] = 1.0f / dir[a];
+        } else if (dir[a] < 0.0f) {
+            dda->step[a] = -1;
+            dda->t_next[a] = ((float)dda->cell[a] - origin[a]) / dir[a];
+            dda->t_delta[a] = -1.0f / dir[a];
+        } else {
+            dda->step[a] = 0;
+            dda->t_next[a] = INFINITY;
+            dda->t_delta[a] = INFINITY;
+        }
+    }
+}
+
+/**
+ * @brief Axis of the next cell boundary
+ */
+static int dda_next_axis(const Dda *dda) {
+    int axis = 0;
+    if (dda->t_next[1] < dda->t_next[axis]) {
+        axis = 1;
+    }
+    if (dda->t_next[2] < dda->t_next[axis]) {
+        axis = 2;
+    }
+    return axis;
+}
+
+/**
+ * @brief Step across the boundary on @p axis
+ * @return false if the DDA left its [lo, hi) range
+ */
+static bool dda_step(Dda *dda, int axis) {
+    dda->cell[axis] += dda->step[axis];
+    dda->t_next[axis] += dda->t_delta[axis];
+    return dda->cell[axis] >= dda->lo[axis] && dda->cell[axis] < dda->hi[axis];
+}
+
+static bool brick_voxel_solid(const VoxelBrick *brick, int lx, int ly, int lz) {
+    int bit = (lz * VOXEL_BRICK_SIZE + ly) * VOXEL_BRICK_SIZE + lx;
+    return (brick->occupancy[bit >> 6] >> (bit & 63)) & 1u;
+}
+
+bool voxel_volume_init(VoxelVolume *volume, int size_x, int size_y, int size_z,
+                       Vec3 origin, float voxel_size) {
+    memset(volume, 0, sizeof(*volume));
+    if (size_x <= 0 || size_y <= 0 || size_z <= 0 || voxel_size <= 0.0f) {
+        return false;
+    }
+    volume->origin = origin;
+    volume->voxel_size = voxel_size;
+    volume->size[0] = size_x;
+    volume->size[1] = size_y;
+    volume->size[2] = size_z;
+    for (int a = 0; a < 3; a++) {
+        volume->brick_res[a] = (volume->size[a] + VOXEL_BRICK_SIZE - 1) / VOXEL_BRICK_SIZE;
+    }
+
+    size_t cells = (size_t)volume->brick_res[0] * volume->brick_res[1] * volume->brick_res[2];
+    volume->brick_index = malloc(cells * sizeof(int32_t));
+    if (!volume->brick_index) {
+        return false;
+    }
+    for (size_t i = 0; i < cells; i++) {
+        volume->brick_index[i] = -1;
+    }
+    for (int m = 0; m < 256; m++) {
+        volume->palette[m] = color_white();
+    }
+    return true;
+}
+
+void voxel_volume_destroy(VoxelVolume *volume) {
+    free(volume->brick_index);
+    free(volume->bricks);
+    volume->brick_index = NULL;
+    volume->bricks = NULL;
+    volume->brick_count = 0;
+    volume->brick_capacity = 0;
+}
+
+static size_t voxel_volume_cell(const VoxelVolume *volume, int bx, int by, int bz) {
+    return ((size_t)bz * volume->brick_res[1] + by) * volume->brick_res[0] + bx;
+}
+
+static bool brick_empty(const VoxelBrick *brick) {
+    for (int w = 0; w < VOXEL_BRICK_VOXELS / 64; w++) {
+        if (brick->occupancy[w]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Free the slot of a brick without solid voxels
+ * The last brick moves into the slot, so allocated bricks stay packed and
+ * the array shrinks once most of it is unused.
+ */
+static void voxel_volume_remove_brick(VoxelVolume *volume, int32_t index) {
+    int32_t last = volume->brick_count - 1;
+    volume->brick_index[volume->bricks[index].cell] = -1;
+    if (index != last) {
+        volume->bricks[index] = volume->bricks[last];
+        volume->brick_index[volume->bricks[index].cell] = index;
+    }
+    volume->brick_count--;
+    if (volume->brick_capacity > 64 && volume->brick_count <= volume->brick_capacity / 4) {
+        int capacity = volume->brick_capacity / 2;
+        VoxelBrick *bricks = realloc(volume->bricks, (size_t)capacity * sizeof(VoxelBrick));
+        if (bricks) {
+            volume->bricks = bricks;
+            volume->brick_capacity = capacity;
+        }
+    }
+}
+
+bool voxel_volume_set(VoxelVolume *volume, int x, int y, int z, uint8_t material) {
+    if (x < 0 || y < 0 || z < 0 ||
+        x >= volume->size[0] || y >= volume->size[1] || z >= volume->size[2]) {
+        return false;
+    }
+    size_t cell = voxel_volume_cell(volume, x / VOXEL_BRICK_SIZE, y / VOXEL_BRICK_SIZE,
+                                    z / VOXEL_BRICK_SIZE);
+    int32_t index = volume->brick_index[cell];
+    if (index < 0) {
+        if (material == VOXEL_EMPTY) {
+            return true;
+        }
+        if (volume->brick_count == volume->brick_capacity) {
+            int capacity = volume->brick_capacity ? volume->brick_capacity * 2 : 64;
+            VoxelBrick *bricks = realloc(volume->bricks, (size_t)capacity * sizeof(VoxelBrick));
+            if (!bricks) {
+                return false;
+            }
+            volume->bricks = bricks;
+            volume->brick_capacity = capacity;
+        }
+        index = volume->brick_count++;
+        memset(&volume->bricks[index], 0, sizeof(VoxelBrick));
+        volume->bricks[index].cell = cell;
+        volume->brick_index[cell] = index;
+    }
+
+    VoxelBrick *brick = &volume->bricks[index];
+    int bit = ((z % VOXEL_BRICK_SIZE) * VOXEL_BRICK_SIZE + (y % VOXEL_BRICK_SIZE)) *
+              VOXEL_BRICK_SIZE + (x % VOXEL_BRICK_SIZE);
+    if (material == VOXEL_EMPTY) {
+        brick->occupancy[bit >> 6] &= ~((uint64_t)1 << (bit & 63));
+    } else {
+        brick->occupancy[bit >> 6] |= (uint64_t)1 << (bit & 63);
+    }
+    brick->materials[bit] = material;
+    if (material == VOXEL_EMPTY && brick_empty(brick)) {
+        voxel_volume_remove_brick(volume, index);
+    }
+    return true;
+}
+
+uint8_t voxel_volume_get(const VoxelVolume *volume, int x, int y, int z) {
+    if (x < 0 || y < 0 || z < 0 ||
+        x >= volume->size[0] || y >= volume->size[1] || z >= volume->size[2]) {
+        return VOXEL_EMPTY;
+    }
+    int32_t index = volume->brick_index[voxel_volume_cell(volume, x / VOXEL_BRICK_SIZE,
+                                                          y / VOXEL_BRICK_SIZE,
+                                                          z / VOXEL_BRICK_SIZE)];
+    if (index < 0) {
+        return VOXEL_EMPTY;
+    }
+    int bit = ((z % VOXEL_BRICK_SIZE) * VOXEL_BRICK_SIZE + (y % VOXEL_BRICK_SIZE)) *
+              VOXEL_BRICK_SIZE + (x % VOXEL_BRICK_SIZE);
+    return volume->bricks[index].materials[bit];
+}
+
+void voxel_volume_set_material(VoxelVolume *volume, uint8_t material, Color color) {
+    volume->palette[material] = color;
+}
+
+static AABB voxel_volume_box(const VoxelVolume *volume) {
+    Vec3 extent = vec3_create(volume->size[0] * volume->voxel_size,
+                              volume->size[1] * volume->voxel_size,
+                              volume->size[2] * volume->voxel_size);
+    return aabb_create(volume->origin, vec3_add(volume->origin, extent));
+}
+
+/**
+ * @brief DDA through the voxels of one brick
+ * @param brick_cell Coarse cell of the brick
+ * @param entry_axis Axis whose boundary the ray crossed to enter the brick
+ * @param t_hit Output parameter of the hit
+ * @param hit_axis Output axis of the face that was hit
+ * @param hit_voxel Output global voxel coordinates
+ */
+static bool brick_traverse(const VoxelVolume *volume, const VoxelBrick *brick_data,
+                           const int brick_cell[3],
+                           const float origin[3], const float dir[3], float t_start,
+                           float t_end, int entry_axis, float *t_hit, int *hit_axis,
+                           int hit_voxel[3]) {
+    int lo[3], hi[3];
+    for (int a = 0; a < 3; a++) {
+        lo[a] = brick_cell[a] * VOXEL_BRICK_SIZE;
+        hi[a] = lo[a] + VOXEL_BRICK_SIZE;
+        if (hi[a] > volume->size[a]) {
+            hi[a] = volume->size[a];
+        }
+    }
+
+    Dda dda;
+    dda_init(&dda, origin, dir, t_start, lo, hi);
+    float t = t_start;
+    int axis = entry_axis;
+    for (;;) {
+        if (brick_voxel_solid(brick_data, dda.cell[0] - lo[0], dda.cell[1] - lo[1],
+                              dda.cell[2] - lo[2])) {
+            *t_hit = t;
+            *hit_axis = axis;
+            hit_voxel[0] = dda.cell[0];
+            hit_voxel[1] = dda.cell[1];
+            hit_voxel[2] = dda.cell[2];
+            return true;
+        }
+        axis = dda_next_axis(&dda);
+        t = dda.t_next[axis];
+        if (t > t_end || !dda_step(&dda, axis)) {
+            return false;
+        }
+    }
+}
+
+bool voxel_volume_hit(const Hittable *hittable, const Ray *ray,
+                      float t_min, float t_max, HitRecord *hit_rec) {
+    const VoxelVolume *volume = (const VoxelVolume *)hittable->data;
+    if (volume->brick_count == 0) {
+        return false;
+    }
+
+    AABB box = voxel_volume_box(volume);
+    Vec3 inv_dir = aabb_inverse_direction(ray);
+    float t_enter, t_exit;
+    if (!aabb_hit(&box, ray, inv_dir, t_min, t_max, &t_enter, &t_exit)) {
+        return false;
+    }
+
+    // Axis of the entry face: the slab that is entered last
+    float entry[3] = {
+        fminf((box.min.x - ray->origin.x) * inv_dir.x, (box.max.x - ray->origin.x) * inv_dir.x),
+        fminf((box.min.y - ray->origin.y) * inv_dir.y, (box.max.y - ray->origin.y) * inv_dir.y),
+        fminf((box.min.z - ray->origin.z) * inv_dir.z, (box.max.z - ray->origin.z) * inv_dir.z)};
+    int axis = 0;
+    if (entry[1] > entry[axis]) {
+        axis = 1;
+    }
+    if (entry[2] > entry[axis]) {
+        axis = 2;
+    }
+
+    // Ray in voxel units, and in brick units for the coarse level
+    float inv_voxel = 1.0f / volume->voxel_size;
+    float origin_v[3] = {(ray->origin.x - volume->origin.x) * inv_voxel,
+                         (ray->origin.y - volume->origin.y) * inv_voxel,
+                         (ray->origin.z - volume->origin.z) * inv_voxel};
+    float dir_v[3] = {ray->direction.x * inv_voxel, ray->direction.y * inv_voxel,
+                      ray->direction.z * inv_voxel};
+    float origin_b[3], dir_b[3];
+    for (int a = 0; a < 3; a++) {
+        origin_b[a] = origin_v[a] / VOXEL_BRICK_SIZE;
+        dir_b[a] = dir_v[a] / VOXEL_BRICK_SIZE;
+    }
+
+    int lo[3] = {0, 0, 0};
+    Dda coarse;
+    dda_init(&coarse, origin_b, dir_b, t_enter, lo, volume->brick_res);
+    float t = t_enter;
+    float t_hit = 0.0f;
+    int hit_axis = axis;
+    int voxel[3];
+    bool hit = false;
+
+    for (;;) {
+        int32_t index = volume->brick_index[voxel_volume_cell(volume, coarse.cell[0],
+                                                              coarse.cell[1], coarse.cell[2])];
+        int next_axis = dda_next_axis(&coarse);
+        float t_brick_exit = fminf(coarse.t_next[next_axis], t_exit);
+        if (index >= 0 &&
+            brick_traverse(volume, &volume->bricks[index], coarse.cell, origin_v, dir_v, t,
+                           t_brick_exit, axis, &t_hit, &hit_axis, voxel)) {
+            hit = true;
+            break;
+        }
+        axis = next_axis;
+        t = coarse.t_next[axis];
+        if (t > t_exit || !dda_step(&coarse, axis)) {
+            break;
+        }
+    }
+
+    if (!hit) {
+        return false;
+    }
+
+    // The face crossed on hit_axis faces back along the ray
+    float d[3] = {ray->direction.x, ray->direction.y, ray->direction.z};
+    float n[3] = {0.0f, 0.0f, 0.0f};
+    n[hit_axis] = d[hit_axis] > 0.0f ? -1.0f : 1.0f;
+
+    uint8_t material = voxel_volume_get(volume, voxel[0], voxel[1], voxel[2]);
+    hit_rec->t = t_hit;
+    hit_rec->point = ray_at(ray, t_hit);
+    hit_record_set_face_normal(hit_rec, ray, vec3_create(n[0], n[1], n[2]));
+    hit_rec->albedo = volume->palette[material];
+    return true;
+}
+
+bool voxel_volume_bounds(const Hittable *hittable, AABB *box) {
+    *box = voxel_volume_box((const VoxelVolume *)hittable->data);
+    return true;
+}
+
+Hittable voxel_volume_to_hittable(VoxelVolume *volume) {
+    return hittable_create_bounded(volume, voxel_volume_hit, voxel_volume_bounds);
+}
+
+size_t voxel_volume_memory_bytes(const VoxelVolume *volume) {
+    size_t cells = (size_t)volume->brick_res[0] * volume->brick_res[1] * volume->brick_res[2];
+    return cells * sizeof(int32_t) + (size_t)volume->brick_count * sizeof(VoxelBrick);
+}
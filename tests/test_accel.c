@@ -0,0 +1,186 @@
+/**
+ * @file test_accel.c
+ * @brief Unit tests for the BVH and uniform grid acceleration structures
+ */
+
+#include "unity/unity.h"
+#include "bvh.h"
+#include "grid.h"
+#include "sphere.h"
+
+#define ACCEL_TEST_SPHERES 200
+
+static Sphere accel_spheres[ACCEL_TEST_SPHERES];
+static Hittable accel_hittables[ACCEL_TEST_SPHERES];
+
+static void make_sphere_cloud(void) {
+    unsigned int state = 12345u;
+    for (int i = 0; i < ACCEL_TEST_SPHERES; i++) {
+        float p[3];
+        for (int a = 0; a < 3; a++) {
+            state = state * 1664525u + 1013904223u;
+            p[a] = (float)(state >> 8) / 16777216.0f * 4.0f - 2.0f;
+        }
+        accel_spheres[i] = sphere_create(vec3_create(p[0], p[1], p[2]), 0.15f, color_red());
+        accel_hittables[i] = sphere_to_hittable(&accel_spheres[i]);
+    }
+}
+
+static bool brute_force_hit(const Ray *ray, HitRecord *hit_rec) {
+    bool hit_anything = false;
+    float closest = INFINITY;
+    HitRecord temp;
+    for (int i = 0; i < ACCEL_TEST_SPHERES; i++) {
+        if (hittable_hit(&accel_hittables[i], ray, 0.001f, closest, &temp)) {
+            hit_anything = true;
+            closest = temp.t;
+            *hit_rec = temp;
+        }
+    }
+    return hit_anything;
+}
+
+void test_aabb_hit(void) {
+    AABB box = aabb_create(vec3_create(-1.0f, -1.0f, -1.0f), vec3_create(1.0f, 1.0f, 1.0f));
+    Ray ray = ray_create(vec3_create(0.0f, 0.0f, 5.0f), vec3_create(0.0f, 0.0f, -1.0f));
+    float t0, t1;
+
+    TEST_ASSERT_TRUE(aabb_hit(&box, &ray, aabb_inverse_direction(&ray), 0.0f, INFINITY, &t0, &t1));
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 4.0f, t0);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 6.0f, t1);
+
+    Ray miss = ray_create(vec3_create(0.0f, 3.0f, 5.0f), vec3_create(0.0f, 0.0f, -1.0f));
+    TEST_ASSERT_FALSE(aabb_hit(&box, &miss, aabb_inverse_direction(&miss), 0.0f, INFINITY,
+                               NULL, NULL));
+
+    // Parallel to the x slab and running in its faces (0 * inf there), either sign of zero
+    Ray faces[4] = {
+        ray_create(vec3_create(1.0f, 0.0f, 5.0f), vec3_create(0.0f, 0.0f, -1.0f)),
+        ray_create(vec3_create(-1.0f, 0.0f, 5.0f), vec3_create(0.0f, 0.0f, -1.0f)),
+        ray_create(vec3_create(1.0f, 0.0f, 5.0f), vec3_create(-0.0f, 0.0f, -1.0f)),
+        ray_create(vec3_create(-1.0f, 0.0f, 5.0f), vec3_create(-0.0f, 0.0f, -1.0f)),
+    };
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(aabb_hit(&box, &faces[i], aabb_inverse_direction(&faces[i]), 0.0f,
+                                  INFINITY, &t0, &t1));
+        TEST_ASSERT_FLOAT_WITHIN(1e-5f, 4.0f, t0);
+        TEST_ASSERT_FLOAT_WITHIN(1e-5f, 6.0f, t1);
+    }
+}
+
+static void check_against_brute_force(const Hittable *accel) {
+    unsigned int state = 777u;
+    for (int i = 0; i < 500; i++) {
+        float d[3];
+        for (int a = 0; a < 3; a++) {
+            state = state * 1664525u + 1013904223u;
+            d[a] = (float)(state >> 8) / 16777216.0f * 2.0f - 1.0f;
+        }
+        Ray ray = ray_create(vec3_create(0.3f, -0.2f, 6.0f),
+                             vec3_create(d[0] * 0.5f, d[1] * 0.5f, -1.0f));
+        HitRecord expected, actual;
+        bool expected_hit = brute_force_hit(&ray, &expected);
+        bool actual_hit = hittable_hit(accel, &ray, 0.001f, INFINITY, &actual);
+        TEST_ASSERT_EQUAL(expected_hit, actual_hit);
+        if (expected_hit) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-5f, expected.t, actual.t);
+        }
+    }
+}
+
+/**
+ * @brief Scan coherent rays through an aggregate with one hint kept across them
+ * Closest and any hits must match the brute-force answers, and neighbouring
+ * rays must be answered by the remembered sphere now and then.
+ */
+static void check_hinted_against_brute_force(const Hittable *accel) {
+    HitHint hint = hittable_hint_init();
+    int hits = 0, answered = 0, blocked = 0, answered_blocked = 0;
+    for (int y = 0; y < 40; y++) {
+        for (int x = 0; x < 40; x++) {
+            Ray ray = ray_create(vec3_create(0.3f, -0.2f, 6.0f),
+                                 vec3_create((x - 19.5f) * 0.0125f, (y - 19.5f) * 0.0125f, -1.0f));
+            HitRecord expected, actual;
+            bool expected_hit = brute_force_hit(&ray, &expected);
+            bool actual_hit = hittable_hit_hinted(accel, &ray, 0.001f, INFINITY, false, &hint,
+                                                  &actual);
+            TEST_ASSERT_EQUAL(expected_hit, actual_hit);
+            if (expected_hit) {
+                TEST_ASSERT_FLOAT_WITHIN(1e-5f, expected.t, actual.t);
+                hits++;
+                answered += hint.answered;
+            }
+            // Shadow ray from the origin up to just short of the closest hit (always open)
+            // and past it (blocked if anything was hit)
+            float t_max = expected_hit ? 0.999f * expected.t : INFINITY;
+            TEST_ASSERT_FALSE(hittable_hit_hinted(accel, &ray, 0.001f, t_max, true, &hint,
+                                                  &actual));
+            if (expected_hit) {
+                TEST_ASSERT_TRUE(hittable_hit_hinted(accel, &ray, 0.001f, INFINITY, true, &hint,
+                                                     &actual));
+                blocked++;
+                answered_blocked += hint.answered;
+            }
+        }
+    }
+    TEST_ASSERT_TRUE(hits > 0 && answered > 0 && answered < hits);
+    TEST_ASSERT_TRUE(answered_blocked > 0 && answered_blocked <= blocked);
+}
+
+void test_bvh_matches_brute_force(void) {
+    make_sphere_cloud();
+    Bvh bvh;
+    TEST_ASSERT_TRUE(bvh_build(&bvh, accel_hittables, ACCEL_TEST_SPHERES));
+    Hittable hittable = bvh_to_hittable(&bvh);
+    check_against_brute_force(&hittable);
+    check_hinted_against_brute_force(&hittable);
+    bvh_destroy(&bvh);
+}
+
+void test_bvh_skewed_distribution_finds_every_hit(void) {
+    // Geometrically spaced spheres: SAH splits peel off a few at a time, and far out the
+    // spheres are thinner than a float step, so their boxes are flat in x and the vertical
+    // rays through their centres run in the boxes' faces
+    float x = 1.0f;
+    for (int i = 0; i < ACCEL_TEST_SPHERES; i++) {
+        accel_spheres[i] = sphere_create(vec3_create(x, 0.0f, 0.0f), 0.1f, color_red());
+        accel_hittables[i] = sphere_to_hittable(&accel_spheres[i]);
+        x *= 1.2f;
+    }
+    Bvh bvh;
+    TEST_ASSERT_TRUE(bvh_build(&bvh, accel_hittables, ACCEL_TEST_SPHERES));
+    Hittable hittable = bvh_to_hittable(&bvh);
+    int misses = 0;
+    for (int i = 0; i < ACCEL_TEST_SPHERES; i++) {
+        const Sphere *sphere = &accel_spheres[i];
+        Ray ray = ray_create(vec3_create(sphere->center.x, 3.0f * sphere->radius, 0.0f),
+                             vec3_create(0.0f, -1.0f, 0.0f));
+        HitRecord expected, actual;
+        TEST_ASSERT_TRUE(brute_force_hit(&ray, &expected));
+        if (!hittable_hit(&hittable, &ray, 0.001f, INFINITY, &actual)) {
+            misses++;
+        } else {
+            TEST_ASSERT_FLOAT_WITHIN(1e-5f * expected.t, expected.t, actual.t);
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(0, misses);
+    bvh_destroy(&bvh);
+}
+
+void test_grid_matches_brute_force(void) {
+    make_sphere_cloud();
+    Grid grid;
+    TEST_ASSERT_TRUE(grid_build(&grid, accel_hittables, ACCEL_TEST_SPHERES, 0.0f));
+    TEST_ASSERT_TRUE(grid.res[0] > 1 && grid.res[1] > 1 && grid.res[2] > 1);
+    Hittable hittable = grid_to_hittable(&grid);
+    check_against_brute_force(&hittable);
+    check_hinted_against_brute_force(&hittable);
+    grid_destroy(&grid);
+}
+
+void run_accel_tests(void) {
+    RUN_TEST(test_aabb_hit);
+    RUN_TEST(test_bvh_matches_brute_force);
+    RUN_TEST(test_bvh_skewed_distribution_finds_every_hit);
+    RUN_TEST(test_grid_matches_brute_force);
+}
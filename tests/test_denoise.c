@@ -0,0 +1,61 @@
+/**
+ * @file test_denoise.c
+ * @brief Unit tests for the guided a-trous denoiser
+ */
+
+#include "unity/unity.h"
+#include "denoise.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define W 64
+#define H 48
+
+void test_denoise_smooths_noise_but_keeps_feature_edges(void) {
+    // Two flat walls meeting at x = W/2, with uniform noise of +-0.1 on top
+    static Color clean[W * H], noisy[W * H], albedo[W * H], out[W * H], out_threads[W * H];
+    static Vec3 normal[W * H];
+    static float depth[W * H], variance[W * H];
+    unsigned int state = 12345u;
+    for (int p = 0; p < W * H; p++) {
+        bool left = p % W < W / 2;
+        float value = left ? 0.2f : 0.8f;
+        state = state * 1664525u + 1013904223u;
+        float noise = 0.2f * ((float)(state >> 8) / 16777216.0f - 0.5f);
+        clean[p] = color_create(value, value, value);
+        noisy[p] = color_create(value + noise, value + noise, value + noise);
+        albedo[p] = color_create(1.0f, 1.0f, 1.0f);
+        normal[p] = left ? vec3_create(0.0f, 0.0f, 1.0f) : vec3_create(1.0f, 0.0f, 0.0f);
+        depth[p] = 2.0f;
+        variance[p] = 0.2f * 0.2f / 12.0f;
+    }
+    DenoiseInput input = {W, H, noisy, variance, normal, depth, albedo};
+    DenoiseSettings settings = denoise_default_settings();
+    settings.thread_count = 1;
+    TEST_ASSERT_TRUE(denoise_image(&input, &settings, out));
+
+    double noisy_error = 0.0, error = 0.0, edge_error = 0.0;
+    for (int p = 0; p < W * H; p++) {
+        noisy_error += (noisy[p].x - clean[p].x) * (noisy[p].x - clean[p].x);
+        error += (out[p].x - clean[p].x) * (out[p].x - clean[p].x);
+        if (p % W == W / 2 - 1 || p % W == W / 2) {
+            edge_error = fmax(edge_error, fabs(out[p].x - clean[p].x));
+        }
+    }
+    TEST_ASSERT_TRUE(error < 0.1 * noisy_error);
+    // Nothing bleeds across the change of normal
+    TEST_ASSERT_TRUE(edge_error < 0.05);
+
+    // Same result on several threads; strength 0 copies the input
+    settings.thread_count = 3;
+    TEST_ASSERT_TRUE(denoise_image(&input, &settings, out_threads));
+    TEST_ASSERT_EQUAL(0, memcmp(out, out_threads, sizeof(out)));
+    settings.strength = 0.0f;
+    TEST_ASSERT_TRUE(denoise_image(&input, &settings, out));
+    TEST_ASSERT_EQUAL(0, memcmp(out, noisy, sizeof(out)));
+}
+
+void run_denoise_tests(void) {
+    RUN_TEST(test_denoise_smooths_noise_but_keeps_feature_edges);
+}
@@ -0,0 +1,87 @@
+/**
+ * @file test_heightfield.c
+ * @brief Unit tests for heightfield terrain intersection
+ */
+
+#include "unity/unity.h"
+#include "heightfield.h"
+#include <stdlib.h>
+
+static Heightfield make_ramp(int size) {
+    // Height rises linearly along x: y = x over a 4 x 4 square
+    float *heights = malloc((size_t)size * size * sizeof(float));
+    for (int z = 0; z < size; z++) {
+        for (int x = 0; x < size; x++) {
+            heights[z * size + x] = 4.0f * (float)x / (float)(size - 1);
+        }
+    }
+    Heightfield hf;
+    heightfield_build(&hf, heights, size, size, vec3_create(0.0f, 0.0f, 0.0f), 4.0f, 4.0f,
+                      color_green());
+    return hf;
+}
+
+void test_heightfield_mipmap_root_range(void) {
+    Heightfield hf = make_ramp(37);
+    const HeightRange *root = hf.levels[hf.level_count - 1];
+
+    TEST_ASSERT_EQUAL_INT(1, hf.level_width[hf.level_count - 1]);
+    TEST_ASSERT_EQUAL_INT(1, hf.level_depth[hf.level_count - 1]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.0f, root->min);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 4.0f, root->max);
+    heightfield_destroy(&hf);
+}
+
+void test_heightfield_vertical_ray_hits_surface(void) {
+    Heightfield hf = make_ramp(37);
+    Hittable hittable = heightfield_to_hittable(&hf);
+
+    // Straight down at x = 1.3: the ramp is at y = 1.3
+    Ray ray = ray_create(vec3_create(1.3f, 10.0f, 2.1f), vec3_create(0.0f, -1.0f, 0.0f));
+    HitRecord hit_rec;
+    TEST_ASSERT_TRUE(hittable_hit(&hittable, &ray, 0.001f, INFINITY, &hit_rec));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.3f, hit_rec.point.y);
+    TEST_ASSERT_TRUE(hit_rec.front_face);
+
+    // The ramp normal points up and back along -x
+    TEST_ASSERT_TRUE(hit_rec.normal.y > 0.0f);
+    TEST_ASSERT_TRUE(hit_rec.normal.x < 0.0f);
+    heightfield_destroy(&hf);
+}
+
+void test_heightfield_grazing_ray(void) {
+    Heightfield hf = make_ramp(64);
+    Hittable hittable = heightfield_to_hittable(&hf);
+
+    // Horizontal ray at y = 2 travelling along +x meets the ramp at x = 2
+    Ray ray = ray_create(vec3_create(-1.0f, 2.0f, 1.7f), vec3_create(1.0f, 0.0f, 0.0f));
+    HitRecord hit_rec;
+    TEST_ASSERT_TRUE(hittable_hit(&hittable, &ray, 0.001f, INFINITY, &hit_rec));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 3.0f, hit_rec.t);
+
+    // Same ray above the terrain misses it
+    Ray above = ray_create(vec3_create(-1.0f, 4.5f, 1.7f), vec3_create(1.0f, 0.0f, 0.0f));
+    TEST_ASSERT_FALSE(hittable_hit(&hittable, &above, 0.001f, INFINITY, &hit_rec));
+    heightfield_destroy(&hf);
+}
+
+void test_heightfield_failed_build_is_empty(void) {
+    Heightfield hf;
+    float *heights = calloc(4, sizeof(float));
+    TEST_ASSERT_FALSE(heightfield_build(&hf, heights, 1, 4, vec3_create(0.0f, 0.0f, 0.0f), 4.0f,
+                                        4.0f, color_green()));
+    Hittable hittable = heightfield_to_hittable(&hf);
+    AABB box;
+    TEST_ASSERT_FALSE(hittable_bounds(&hittable, &box));
+    Ray ray = ray_create(vec3_create(1.0f, 10.0f, 1.0f), vec3_create(0.0f, -1.0f, 0.0f));
+    HitRecord hit_rec;
+    TEST_ASSERT_FALSE(hittable_hit(&hittable, &ray, 0.001f, INFINITY, &hit_rec));
+    heightfield_destroy(&hf);
+}
+
+void run_heightfield_tests(void) {
+    RUN_TEST(test_heightfield_mipmap_root_range);
+    RUN_TEST(test_heightfield_vertical_ray_hits_surface);
+    RUN_TEST(test_heightfield_grazing_ray);
+    RUN_TEST(test_heightfield_failed_build_is_empty);
+}
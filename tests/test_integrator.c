@@ -0,0 +1,118 @@
+/**
+ * @file test_integrator.c
+ * @brief Unit tests for the path integrator
+ */
+
+#include "unity/unity.h"
+#include "integrator.h"
+#include "plane.h"
+#include "sphere.h"
+
+/**
+ * @brief Path settings with the given limits
+ */
+static IntegratorSettings path_settings(int max_bounces, int roulette_bounces) {
+    IntegratorSettings settings = integrator_default_settings();
+    settings.type = INTEGRATOR_PATH;
+    settings.max_bounces = max_bounces;
+    settings.roulette_bounces = roulette_bounces;
+    return settings;
+}
+
+void test_path_diffuse_plane_under_sky_is_unbiased(void) {
+    // Every bounce off the plane escapes to the sky, so each path gives albedo * sky
+    Plane ground = plane_create_xz(0.0f, color_create(0.5f, 0.25f, 0.75f));
+    Scene scene = scene_create(color_create(2.0f, 2.0f, 2.0f));
+    scene_add_object(&scene, plane_to_hittable(&ground));
+    Sampler sampler;
+    TEST_ASSERT_TRUE(sampler_init(&sampler, SAMPLER_SOBOL, 0));
+    Ray ray = ray_create(vec3_create(0.0f, 1.0f, 0.0f), vec3_create(0.3f, -1.0f, 0.2f));
+
+    IntegratorSettings exact = path_settings(4, 4);
+    PathSample sample = {&sampler, 3, 5, 0};
+    Color color;
+    HitRecord primary;
+    TEST_ASSERT_TRUE(integrator_trace(&scene, &exact, &sample, &ray, &color, &primary));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, color.x);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.5f, color.y);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.5f, color.z);
+
+    // Russian roulette from the first vertex kills paths but keeps the mean
+    IntegratorSettings roulette = path_settings(4, 0);
+    Color sum = color_black();
+    int killed = 0;
+    for (uint32_t i = 0; i < 4096; i++) {
+        sample.index = i;
+        integrator_trace(&scene, &roulette, &sample, &ray, &color, &primary);
+        killed += color.x == 0.0f;
+        sum = color_add(sum, color);
+    }
+    TEST_ASSERT_GREATER_THAN(1000, killed);
+    TEST_ASSERT_FLOAT_WITHIN(0.02f, 1.0f, sum.x / 4096.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.5f, sum.y / 4096.0f);
+    sampler_destroy(&sampler);
+}
+
+void test_path_shadows_and_mirrors(void) {
+    Plane ground = plane_create_xz(0.0f, color_white());
+    Sphere blocker = sphere_create(vec3_create(0.0f, 2.0f, 0.0f), 0.5f, color_white());
+    Scene scene = scene_create(color_white());
+    scene_add_object(&scene, plane_to_hittable(&ground));
+    scene_add_object(&scene, sphere_to_hittable(&blocker));
+    PointLight light = {vec3_create(0.0f, 4.0f, 0.0f), color_white(), 1.0f, 0.0f, 0.0f};
+    scene_add_light(&scene, light);
+    IntegratorSettings settings = path_settings(0, 8);
+    Sampler sampler;
+    TEST_ASSERT_TRUE(sampler_init(&sampler, SAMPLER_SOBOL, 0));
+    PathSample sample = {&sampler, 0, 0, 0};
+    Color color;
+    HitRecord primary;
+
+    // The sphere shadows the ground right below the light, but not further out
+    Ray shadowed = ray_create(vec3_create(0.0f, 1.0f, 1.0f), vec3_create(0.0f, -1.0f, -1.0f));
+    TEST_ASSERT_TRUE(integrator_trace(&scene, &settings, &sample, &shadowed, &color, &primary));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, color.x);
+    Ray lit = ray_create(vec3_create(3.0f, 1.0f, 0.0f), vec3_create(0.0f, -1.0f, 0.0f));
+    integrator_trace(&scene, &settings, &sample, &lit, &color, &primary);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.8f, color.x);
+
+    // A mirror shows the sky behind the camera, but only if it may scatter once
+    TEST_ASSERT_TRUE(scene_set_material(&scene, 1, (Material){MATERIAL_REFLECTIVE, 0.0f}));
+    Ray mirrored = ray_create(vec3_create(3.0f, 2.0f, 0.0f), vec3_create(-1.0f, 0.0f, 0.0f));
+    TEST_ASSERT_TRUE(integrator_trace(&scene, &settings, &sample, &mirrored, &color, &primary));
+    TEST_ASSERT_EQUAL_INT(1, primary.object_index);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, color.x);
+    settings.max_bounces = 1;
+    integrator_trace(&scene, &settings, &sample, &mirrored, &color, &primary);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, color.x);
+    sampler_destroy(&sampler);
+    scene_destroy(&scene);
+}
+
+void test_path_deep_bounces_run_iteratively(void) {
+    // A ray trapped between two parallel mirrors reflects max_bounces times
+    Plane floor = plane_create_xz(0.0f, color_white());
+    Plane ceiling = plane_create(vec3_create(0.0f, 1.0f, 0.0f), vec3_create(0.0f, -1.0f, 0.0f),
+                                 color_white());
+    Scene scene = scene_create(color_white());
+    scene_add_object(&scene, plane_to_hittable(&floor));
+    scene_add_object(&scene, plane_to_hittable(&ceiling));
+    scene_set_material(&scene, 0, (Material){MATERIAL_REFLECTIVE, 0.0f});
+    scene_set_material(&scene, 1, (Material){MATERIAL_REFLECTIVE, 0.0f});
+    IntegratorSettings settings = path_settings(1000000, 1000000);
+    Sampler sampler;
+    TEST_ASSERT_TRUE(sampler_init(&sampler, SAMPLER_SOBOL, 0));
+    PathSample sample = {&sampler, 0, 0, 0};
+    Ray ray = ray_create(vec3_create(0.0f, 0.5f, 0.0f), vec3_create(0.0f, 1.0f, 0.0f));
+    Color color;
+    HitRecord primary;
+    TEST_ASSERT_TRUE(integrator_trace(&scene, &settings, &sample, &ray, &color, &primary));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, color.x);
+    sampler_destroy(&sampler);
+}
+
+void run_integrator_tests(void) {
+    RUN_TEST(test_path_diffuse_plane_under_sky_is_unbiased);
+    RUN_TEST(test_path_shadows_and_mirrors);
+    RUN_TEST(test_path_deep_bounces_run_iteratively);
+}
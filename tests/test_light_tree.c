@@ -0,0 +1,90 @@
+/**
+ * @file test_light_tree.c
+ * @brief Unit tests for the light hierarchy
+ */
+
+#include "unity/unity.h"
+#include "light_tree.h"
+#include <math.h>
+
+#define TEST_LIGHT_COUNT 300
+
+/**
+ * @brief Unshadowed light of one point light on a surface, summed over channels
+ */
+static float contribution(const PointLight *light, Vec3 point, Vec3 normal) {
+    Vec3 to_light = vec3_sub(light->position, point);
+    float distance_squared = vec3_length_squared(to_light);
+    float cosine = vec3_dot(normal, to_light) / sqrtf(distance_squared);
+    if (cosine <= 0.0f) {
+        return 0.0f;
+    }
+    return point_light_power(light) * cosine * point_light_attenuation(light, distance_squared);
+}
+
+void test_light_tree_sampling_is_unbiased(void) {
+    PointLight lights[TEST_LIGHT_COUNT];
+    unsigned int state = 12345u;
+    for (int i = 0; i < TEST_LIGHT_COUNT; i++) {
+        float values[5];
+        for (int k = 0; k < 5; k++) {
+            state = state * 1664525u + 1013904223u;
+            values[k] = (float)(state >> 8) / 16777216.0f;
+        }
+        lights[i].position = vec3_create(8.0f * values[0] - 4.0f, 4.0f * values[1] - 2.0f,
+                                         8.0f * values[2] - 4.0f);
+        lights[i].color = color_create(values[3], 0.5f, 1.0f - values[3]);
+        lights[i].intensity = 0.5f + values[4];
+        // Mix lights with and without falloff
+        lights[i].falloff_start = (i % 3 == 0) ? 0.0f : 0.25f;
+        lights[i].radius = 0.0f;
+    }
+    LightTree tree;
+    TEST_ASSERT_TRUE(light_tree_build(&tree, lights, TEST_LIGHT_COUNT));
+    TEST_ASSERT_EQUAL_INT(2 * TEST_LIGHT_COUNT - 1, tree.node_count);
+
+    Vec3 point = vec3_create(0.5f, 0.0f, -0.5f);
+    Vec3 normal = vec3_normalize(vec3_create(0.2f, 1.0f, 0.1f));
+    double exact = 0.0;
+    for (int i = 0; i < TEST_LIGHT_COUNT; i++) {
+        exact += contribution(&lights[i], point, normal);
+    }
+
+    // Stratified picks: the mean of contribution / pdf must match the sum over all lights
+    const int picks = 1 << 16;
+    double estimate = 0.0;
+    for (int s = 0; s < picks; s++) {
+        float pdf;
+        int index = light_tree_sample(&tree, point, normal, ((float)s + 0.5f) / (float)picks,
+                                      &pdf);
+        if (index < 0) {
+            continue;
+        }
+        TEST_ASSERT_TRUE(index < TEST_LIGHT_COUNT);
+        TEST_ASSERT_TRUE(pdf > 0.0f && pdf <= 1.0f);
+        float value = contribution(&lights[index], point, normal);
+        // Lights behind the surface are never chosen
+        TEST_ASSERT_TRUE(value > 0.0f);
+        estimate += value / pdf;
+    }
+    estimate /= picks;
+    TEST_ASSERT_FLOAT_WITHIN(0.01 * exact, exact, estimate);
+    light_tree_destroy(&tree);
+}
+
+void test_light_tree_rejects_points_facing_away(void) {
+    PointLight light = {vec3_create(0.0f, 2.0f, 0.0f), color_white(), 1.0f, 0.0f, 0.0f};
+    LightTree tree;
+    TEST_ASSERT_TRUE(light_tree_build(&tree, &light, 1));
+    float pdf;
+    TEST_ASSERT_EQUAL_INT(0, light_tree_sample(&tree, vec3_zero(), vec3_unit_y(), 0.3f, &pdf));
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, pdf);
+    TEST_ASSERT_EQUAL_INT(-1, light_tree_sample(&tree, vec3_zero(), vec3_negate(vec3_unit_y()),
+                                                0.3f, &pdf));
+    light_tree_destroy(&tree);
+}
+
+void run_light_tree_tests(void) {
+    RUN_TEST(test_light_tree_sampling_is_unbiased);
+    RUN_TEST(test_light_tree_rejects_points_facing_away);
+}
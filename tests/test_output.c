@@ -0,0 +1,437 @@
+/**
+ * @file test_output.c
+ * @brief Unit tests for file output and image encoders
+ */
+
+#include "unity/unity.h"
+#include "file_sink.h"
+#include "deflate.h"
+#include "image_encoder.h"
+#include "shared_framebuffer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/**
+ * @brief Write a pattern larger than all sink buffers and read it back
+ */
+static void check_round_trip(bool allow_ring) {
+    size_t size = FILE_SINK_BUFFER_SIZE * (FILE_SINK_BUFFER_COUNT + 2) + 12345;
+    uint8_t *data = malloc(size);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = (uint8_t)(i * 31 + (i >> 12));
+    }
+
+    FILE *file = tmpfile();
+    TEST_ASSERT_NOT_NULL(file);
+    fputs("header", file);
+    fflush(file);
+
+    FileSink sink;
+    TEST_ASSERT_TRUE(file_sink_open(&sink, fileno(file), 6, allow_ring));
+    if (!allow_ring) {
+        TEST_ASSERT_EQUAL_STRING("pwrite", file_sink_backend(&sink));
+    }
+    // Mix small reserved writes with one large copy
+    for (int i = 0; i < 1000; i++) {
+        uint8_t *out = file_sink_reserve(&sink, 16);
+        TEST_ASSERT_NOT_NULL(out);
+        for (int j = 0; j < 10; j++) {
+            out[j] = data[i * 10 + j];
+        }
+        file_sink_commit(&sink, 10);
+    }
+    TEST_ASSERT_TRUE(file_sink_write(&sink, data + 10000, size - 10000));
+    TEST_ASSERT_TRUE(file_sink_close(&sink));
+
+    uint8_t *read_back = malloc(size + 6);
+    rewind(file);
+    TEST_ASSERT_EQUAL(size + 6, fread(read_back, 1, size + 7, file));
+    TEST_ASSERT_EQUAL_MEMORY("header", read_back, 6);
+    TEST_ASSERT_EQUAL_MEMORY(data, read_back + 6, size);
+    fclose(file);
+    free(data);
+    free(read_back);
+}
+
+void test_file_sink_pwrite_round_trip(void) {
+    check_round_trip(false);
+}
+
+void test_file_sink_async_round_trip(void) {
+    // Uses io_uring when the platform allows it, otherwise falls back to pwrite
+    check_round_trip(true);
+}
+
+void test_checksums_match_reference_values(void) {
+    const uint8_t *text = (const uint8_t *)"123456789";
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926u, crc32_update(0, text, 9));
+    TEST_ASSERT_EQUAL_HEX32(0x091E01DEu, adler32_update(1, text, 9));
+    // Combining per-chunk checksums gives the checksum of the whole
+    uint32_t first = adler32_update(1, text, 4);
+    uint32_t second = adler32_update(1, text + 4, 5);
+    TEST_ASSERT_EQUAL_HEX32(0x091E01DEu, adler32_combine(first, second, 5));
+}
+
+void test_deflate_stores_incompressible_chunks(void) {
+    size_t size = 70000;
+    uint8_t *input = malloc(size);
+    uint32_t state = 12345;
+    for (size_t i = 0; i < size; i++) {
+        state = state * 1664525u + 1013904223u;
+        input[i] = (uint8_t)(state >> 24);
+    }
+    DeflateScratch *scratch = malloc(sizeof(DeflateScratch));
+    uint8_t *output = malloc(deflate_bound(size));
+    size_t written = deflate_compress_chunk(scratch, input, size, true, output);
+
+    // Two stored blocks (65535 + 4465 bytes), only the second final
+    TEST_ASSERT_EQUAL(size + 10, written);
+    TEST_ASSERT_EQUAL_HEX8(0x00, output[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, output[1]);
+    TEST_ASSERT_EQUAL_MEMORY(input, output + 5, 65535);
+    TEST_ASSERT_EQUAL_HEX8(0x01, output[65540]);
+    TEST_ASSERT_EQUAL_MEMORY(input + 65535, output + 65545, size - 65535);
+
+    // Repetitive data compresses well with the fixed code
+    memset(input, 7, size);
+    written = deflate_compress_chunk(scratch, input, size, false, output);
+    TEST_ASSERT_TRUE(written < 1000);
+    // Non-final chunks end on an empty stored block
+    TEST_ASSERT_EQUAL_MEMORY("\x00\x00\xFF\xFF", output + written - 4, 4);
+    free(input);
+    free(scratch);
+    free(output);
+}
+
+/**
+ * @brief Bit reader for inflate (DEFLATE packs bits from the low end of each byte)
+ */
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    size_t bit;
+} InflateBits;
+
+static unsigned inflate_bit(InflateBits *in) {
+    TEST_ASSERT_TRUE(in->bit < in->size * 8);
+    unsigned value = (in->data[in->bit >> 3] >> (in->bit & 7)) & 1u;
+    in->bit++;
+    return value;
+}
+
+static unsigned inflate_bits(InflateBits *in, int count) {
+    unsigned value = 0;
+    for (int i = 0; i < count; i++) {
+        value |= inflate_bit(in) << i;
+    }
+    return value;
+}
+
+/**
+ * @brief Read one literal/length symbol of the fixed Huffman code
+ * Codes are packed from their most significant bit.
+ */
+static int inflate_fixed_symbol(InflateBits *in) {
+    unsigned code = 0;
+    for (int i = 0; i < 7; i++) {
+        code = (code << 1) | inflate_bit(in);
+    }
+    if (code <= 23) {
+        return 256 + (int)code;
+    }
+    code = (code << 1) | inflate_bit(in);
+    if (code >= 48 && code <= 191) {
+        return (int)code - 48;
+    }
+    if (code >= 192 && code <= 199) {
+        return 280 + (int)code - 192;
+    }
+    code = (code << 1) | inflate_bit(in);
+    TEST_ASSERT_TRUE(code >= 400 && code <= 511);
+    return 144 + (int)code - 400;
+}
+
+/**
+ * @brief Minimal inflate for the block types the compressor emits (stored and fixed Huffman)
+ * @return Decompressed size
+ */
+static size_t inflate_decode(const uint8_t *data, size_t size, uint8_t *output, size_t capacity) {
+    static const int length_base[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,
+                                        15, 17, 19, 23, 27, 31, 35, 43, 51,  59,
+                                        67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const int distance_base[30] = {1,    2,    3,    4,    5,    7,     9,     13,
+                                          17,   25,   33,   49,   65,   97,    129,   193,
+                                          257,  385,  513,  769,  1025, 1537,  2049,  3073,
+                                          4097, 6145, 8193, 12289, 16385, 24577};
+    InflateBits in = {data, size, 0};
+    size_t out = 0;
+    bool final = false;
+    while (!final) {
+        final = inflate_bit(&in) != 0;
+        unsigned type = inflate_bits(&in, 2);
+        if (type == 0) {
+            in.bit = (in.bit + 7) & ~(size_t)7;
+            size_t pos = in.bit >> 3;
+            TEST_ASSERT_TRUE(pos + 4 <= size);
+            size_t length = data[pos] | (size_t)data[pos + 1] << 8;
+            TEST_ASSERT_EQUAL_HEX16(0xFFFF, length ^ (data[pos + 2] | data[pos + 3] << 8));
+            TEST_ASSERT_TRUE(pos + 4 + length <= size && out + length <= capacity);
+            memcpy(output + out, data + pos + 4, length);
+            out += length;
+            in.bit = (pos + 4 + length) * 8;
+            continue;
+        }
+        TEST_ASSERT_EQUAL_UINT(1, type);
+        for (;;) {
+            int symbol = inflate_fixed_symbol(&in);
+            if (symbol < 256) {
+                TEST_ASSERT_TRUE(out < capacity);
+                output[out++] = (uint8_t)symbol;
+                continue;
+            }
+            if (symbol == 256) {
+                break;
+            }
+            int index = symbol - 257;
+            TEST_ASSERT_TRUE(index < 29);
+            int length = length_base[index] +
+                         (int)inflate_bits(&in, index >= 8 && index < 28 ? (index - 4) / 4 : 0);
+            unsigned distance_code = 0;
+            for (int i = 0; i < 5; i++) {
+                distance_code = (distance_code << 1) | inflate_bit(&in);
+            }
+            TEST_ASSERT_TRUE(distance_code < 30);
+            int extra = distance_code < 4 ? 0 : (int)distance_code / 2 - 1;
+            size_t distance = (size_t)distance_base[distance_code] + inflate_bits(&in, extra);
+            TEST_ASSERT_TRUE(distance <= out && out + (size_t)length <= capacity);
+            for (int i = 0; i < length; i++, out++) {
+                output[out] = output[out - distance];
+            }
+        }
+    }
+    return out;
+}
+
+void test_deflate_chunks_inflate_to_the_input(void) {
+    // Mixed data: noise, runs, and copies of earlier bytes from across the window
+    size_t size = 300000;
+    uint8_t *input = malloc(size);
+    uint32_t state = 4242;
+    size_t filled = 0;
+    while (filled < size) {
+        state = state * 1664525u + 1013904223u;
+        size_t length = 3 + (state >> 16) % 400;
+        length = length < size - filled ? length : size - filled;
+        unsigned kind = (state >> 8) % 3;
+        size_t distance = 1 + (state >> 4) % DEFLATE_WINDOW_SIZE;
+        for (size_t i = 0; i < length; i++, filled++) {
+            state = state * 1664525u + 1013904223u;
+            if (kind == 0 || distance > filled) {
+                input[filled] = (uint8_t)(state >> 24);
+            } else if (kind == 1) {
+                input[filled] = (uint8_t)(filled / 64);
+            } else {
+                input[filled] = input[filled - distance];
+            }
+        }
+    }
+
+    // Independently compressed chunks concatenate into one stream
+    const size_t chunk_size = 70000;
+    DeflateScratch *scratch = malloc(sizeof(DeflateScratch));
+    uint8_t *stream = malloc(deflate_bound(size) + deflate_bound(chunk_size) * 5);
+    size_t stream_size = 0;
+    for (size_t start = 0; start < size; start += chunk_size) {
+        size_t length = size - start < chunk_size ? size - start : chunk_size;
+        stream_size += deflate_compress_chunk(scratch, input + start, length,
+                                              start + length == size, stream + stream_size);
+    }
+    TEST_ASSERT_TRUE(stream_size < size);
+
+    uint8_t *output = malloc(size);
+    TEST_ASSERT_EQUAL(size, inflate_decode(stream, stream_size, output, size));
+    TEST_ASSERT_EQUAL_MEMORY(input, output, size);
+    free(input);
+    free(scratch);
+    free(stream);
+    free(output);
+}
+
+/**
+ * @brief Minimal QOI decoder for 3-channel images
+ */
+static void qoi_decode(const uint8_t *data, int pixels, uint8_t *rgb) {
+    uint8_t index[64][3] = {{0}};
+    bool index_opaque[64] = {false};
+    uint8_t px[3] = {0, 0, 0};
+    int run = 0;
+    const uint8_t *p = data + 14;
+    for (int i = 0; i < pixels; i++) {
+        if (run > 0) {
+            run--;
+        } else {
+            uint8_t op = *p++;
+            if (op == 0xFE) {
+                px[0] = p[0];
+                px[1] = p[1];
+                px[2] = p[2];
+                p += 3;
+            } else if ((op >> 6) == 0) {
+                TEST_ASSERT_TRUE(index_opaque[op]);
+                memcpy(px, index[op], 3);
+            } else if ((op >> 6) == 1) {
+                px[0] = (uint8_t)(px[0] + ((op >> 4) & 3) - 2);
+                px[1] = (uint8_t)(px[1] + ((op >> 2) & 3) - 2);
+                px[2] = (uint8_t)(px[2] + (op & 3) - 2);
+            } else if ((op >> 6) == 2) {
+                int dg = (op & 63) - 32;
+                uint8_t second = *p++;
+                px[0] = (uint8_t)(px[0] + dg - 8 + (second >> 4));
+                px[1] = (uint8_t)(px[1] + dg);
+                px[2] = (uint8_t)(px[2] + dg - 8 + (second & 15));
+            } else {
+                run = op & 63;
+            }
+            int h = (px[0] * 3 + px[1] * 5 + px[2] * 7 + 255 * 11) % 64;
+            memcpy(index[h], px, 3);
+            index_opaque[h] = true;
+        }
+        memcpy(&rgb[3 * i], px, 3);
+    }
+    TEST_ASSERT_EQUAL_MEMORY("\0\0\0\0\0\0\0\1", p, 8);
+}
+
+void test_qoi_encoder_round_trip(void) {
+    enum { W = 37, H = 11, BAND = 4 };
+    uint8_t image[W * H * 3];
+    for (int i = 0; i < W * H; i++) {
+        // Runs, small steps and large jumps
+        int x = i % W;
+        image[3 * i] = (uint8_t)(x < 10 ? 50 : x * 7);
+        image[3 * i + 1] = (uint8_t)(x < 10 ? 60 : (i * 13) & 0xFF);
+        image[3 * i + 2] = (uint8_t)(i / W);
+    }
+    TEST_ASSERT_EQUAL(IMAGE_FORMAT_QOI, image_format_from_path("out/render.QOI"));
+    TEST_ASSERT_EQUAL(IMAGE_FORMAT_PNG, image_format_from_path("render.png"));
+    TEST_ASSERT_EQUAL(IMAGE_FORMAT_PPM, image_format_from_path("render"));
+
+    FILE *file = tmpfile();
+    TEST_ASSERT_NOT_NULL(file);
+    FileSink sink;
+    ImageEncoder encoder;
+    TEST_ASSERT_TRUE(file_sink_open(&sink, fileno(file), 0, false));
+    ImageSpec spec = image_spec_rgb(IMAGE_FORMAT_QOI, false, W, H);
+    TEST_ASSERT_TRUE(image_encoder_init(&encoder, &spec, BAND, 2));
+    image_encoder_begin(&encoder, &sink);
+    for (int band = 0; band * BAND < H; band++) {
+        const uint8_t *rgb = &image[band * BAND * W * 3];
+        image_encoder_prepare_band(&encoder, band % 2, band, rgb);
+        image_encoder_write_band(&encoder, &sink, band % 2, band, rgb);
+    }
+    image_encoder_end(&encoder, &sink);
+    image_encoder_destroy(&encoder);
+    TEST_ASSERT_TRUE(file_sink_close(&sink));
+
+    uint8_t encoded[W * H * 4 + 64];
+    rewind(file);
+    size_t size = fread(encoded, 1, sizeof(encoded), file);
+    fclose(file);
+    TEST_ASSERT_TRUE(size > 22);
+    TEST_ASSERT_EQUAL_MEMORY("qoif", encoded, 4);
+    uint8_t decoded[W * H * 3];
+    qoi_decode(encoded, W * H, decoded);
+    TEST_ASSERT_EQUAL_MEMORY(image, decoded, sizeof(image));
+}
+
+void test_pfm_writes_float_rows_bottom_up(void) {
+    enum { W = 5, H = 7, BAND = 3 };
+    Color image[W * H];
+    for (int i = 0; i < W * H; i++) {
+        // Unclamped values survive
+        image[i] = color_create((float)i * 0.5f, -1.0f, 100.0f + (float)i);
+    }
+    FILE *file = tmpfile();
+    TEST_ASSERT_NOT_NULL(file);
+    FileSink sink;
+    ImageEncoder encoder;
+    TEST_ASSERT_TRUE(file_sink_open(&sink, fileno(file), 0, false));
+    ImageSpec spec = image_spec_rgb(IMAGE_FORMAT_PFM, false, W, H);
+    TEST_ASSERT_TRUE(image_encoder_init(&encoder, &spec, BAND, 1));
+    image_encoder_begin(&encoder, &sink);
+    for (int band = 0; band * BAND < H; band++) {
+        const Color *pixels = &image[band * BAND * W];
+        image_encoder_prepare_band(&encoder, 0, band, pixels);
+        image_encoder_write_band(&encoder, &sink, 0, band, pixels);
+    }
+    image_encoder_end(&encoder, &sink);
+    image_encoder_destroy(&encoder);
+    TEST_ASSERT_TRUE(file_sink_close(&sink));
+
+    rewind(file);
+    char magic[3] = {0};
+    int width = 0, height = 0;
+    float scale = 0.0f;
+    TEST_ASSERT_EQUAL(4, fscanf(file, "%2s %d %d %f", magic, &width, &height, &scale));
+    fgetc(file);
+    TEST_ASSERT_EQUAL_STRING("PF", magic);
+    TEST_ASSERT_EQUAL(W, width);
+    TEST_ASSERT_EQUAL(H, height);
+    Color stored[W * H];
+    TEST_ASSERT_EQUAL(W * H, fread(stored, sizeof(Color), W * H, file));
+    fclose(file);
+    for (int y = 0; y < H; y++) {
+        // First stored row is the bottom of the image
+        TEST_ASSERT_EQUAL_MEMORY(&image[(H - 1 - y) * W], &stored[y * W], W * sizeof(Color));
+    }
+}
+
+void test_shared_framebuffer_publishes_tiles(void) {
+    enum { W = 10, H = 7, TILE = 4 };
+    char name[64];
+    snprintf(name, sizeof(name), "/raydemo-test-%ld", (long)getpid());
+    SharedFramebuffer writer, reader;
+    TEST_ASSERT_TRUE(shared_framebuffer_create(&writer, name, W, H, SHARED_FRAMEBUFFER_RGB8,
+                                               TILE));
+    TEST_ASSERT_TRUE(shared_framebuffer_open(&reader, name));
+    shm_unlink(name);
+    TEST_ASSERT_EQUAL(3, reader.header->tiles_x);
+    TEST_ASSERT_EQUAL(2, reader.header->tiles_y);
+    TEST_ASSERT_EQUAL(SHARED_FRAMEBUFFER_RENDERING, reader.header->state);
+
+    // The bottom-right tile (2 x 3 pixels) from a band buffer of full rows
+    uint8_t band[TILE * W * 3];
+    for (int i = 0; i < TILE * W * 3; i++) {
+        band[i] = (uint8_t)(i + 1);
+    }
+    uint32_t before = shared_framebuffer_read_begin(&reader, 5);
+    shared_framebuffer_write_tile(&writer, 5, band + 8 * 3, W * 3);
+    TEST_ASSERT_FALSE(shared_framebuffer_read_end(&reader, 5, before));
+    uint32_t generation = shared_framebuffer_read_begin(&reader, 5);
+    TEST_ASSERT_EQUAL(2, generation);
+    for (int y = 4; y < H; y++) {
+        const uint8_t *row = reader.pixels + (size_t)(y * W + 8) * 3;
+        TEST_ASSERT_EQUAL_MEMORY(band + ((y - 4) * W + 8) * 3, row, 2 * 3);
+    }
+    TEST_ASSERT_TRUE(shared_framebuffer_read_end(&reader, 5, generation));
+    TEST_ASSERT_EQUAL(0, reader.pixels[(4 * W + 7) * 3]);
+    TEST_ASSERT_EQUAL(1, reader.header->tiles_written);
+
+    shared_framebuffer_set_state(&writer, SHARED_FRAMEBUFFER_COMPLETE);
+    TEST_ASSERT_EQUAL(SHARED_FRAMEBUFFER_COMPLETE, reader.header->state);
+    shared_framebuffer_close(&writer);
+    shared_framebuffer_close(&reader);
+}
+
+void run_output_tests(void) {
+    RUN_TEST(test_file_sink_pwrite_round_trip);
+    RUN_TEST(test_file_sink_async_round_trip);
+    RUN_TEST(test_checksums_match_reference_values);
+    RUN_TEST(test_deflate_stores_incompressible_chunks);
+    RUN_TEST(test_deflate_chunks_inflate_to_the_input);
+    RUN_TEST(test_qoi_encoder_round_trip);
+    RUN_TEST(test_pfm_writes_float_rows_bottom_up);
+    RUN_TEST(test_shared_framebuffer_publishes_tiles);
+}
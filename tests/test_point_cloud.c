@@ -0,0 +1,122 @@
+/**
+ * @file test_point_cloud.c
+ * @brief Unit tests for the compact point cloud
+ */
+
+#include "unity/unity.h"
+#include "point_cloud.h"
+#include "sphere.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_POINTS 1000
+
+static void fill_points(float *positions, int count) {
+    unsigned int state = 12345u;
+    for (int i = 0; i < 3 * count; i++) {
+        state = state * 1664525u + 1013904223u;
+        positions[i] = (float)(state >> 8) / 16777216.0f * 4.0f - 2.0f;
+    }
+}
+
+void test_point_cloud_matches_brute_force(void) {
+    float *positions = malloc(TEST_POINTS * 3 * sizeof(float));
+    fill_points(positions, TEST_POINTS);
+    PointCloud cloud;
+    TEST_ASSERT_TRUE(point_cloud_build(&cloud, positions, TEST_POINTS, 0.05f, color_white()));
+    TEST_ASSERT_EQUAL_UINT64(TEST_POINTS, cloud.point_count);
+    Hittable hittable = point_cloud_to_hittable(&cloud);
+
+    for (int r = 0; r < 64; r++) {
+        float angle = (float)r * 0.1f;
+        Ray ray = ray_create(vec3_create(3.0f * cosf(angle), 0.3f * sinf(3.0f * angle), 3.0f * sinf(angle)),
+                             vec3_create(-cosf(angle), 0.05f, -sinf(angle)));
+        float closest = INFINITY;
+        for (int i = 0; i < TEST_POINTS; i++) {
+            Vec3 center = vec3_create(positions[3 * i], positions[3 * i + 1], positions[3 * i + 2]);
+            float t;
+            if (sphere_intersect(center, 0.05f, &ray, 0.001f, closest, &t)) {
+                closest = t;
+            }
+        }
+        HitRecord hit_rec;
+        bool hit = hittable_hit(&hittable, &ray, 0.001f, INFINITY, &hit_rec);
+        TEST_ASSERT_EQUAL(closest < INFINITY, hit);
+        if (hit) {
+            // Quantization moves centers by at most a leaf extent / 65535
+            TEST_ASSERT_FLOAT_WITHIN(1e-3f, closest, hit_rec.t);
+        }
+    }
+    point_cloud_destroy(&cloud);
+    free(positions);
+}
+
+void test_point_cloud_hint_matches_plain_hit(void) {
+    float *positions = malloc(TEST_POINTS * 3 * sizeof(float));
+    fill_points(positions, TEST_POINTS);
+    PointCloud cloud;
+    TEST_ASSERT_TRUE(point_cloud_build(&cloud, positions, TEST_POINTS, 0.05f, color_white()));
+    Hittable hittable = point_cloud_to_hittable(&cloud);
+
+    // Neighbouring rays, one hint kept across them as a render thread does
+    HitHint hint = hittable_hint_init();
+    int hits = 0, answered = 0, answered_blocked = 0;
+    for (int y = 0; y < 40; y++) {
+        for (int x = 0; x < 40; x++) {
+            Ray ray = ray_create(vec3_create(0.1f, 0.2f, 6.0f),
+                                 vec3_create((x - 19.5f) * 0.004f, (y - 19.5f) * 0.004f, -1.0f));
+            HitRecord expected, actual;
+            bool expected_hit = hittable_hit(&hittable, &ray, 0.001f, INFINITY, &expected);
+            TEST_ASSERT_EQUAL(expected_hit, hittable_hit_hinted(&hittable, &ray, 0.001f, INFINITY,
+                                                                false, &hint, &actual));
+            if (!expected_hit) {
+                continue;
+            }
+            TEST_ASSERT_EQUAL_FLOAT(expected.t, actual.t);
+            TEST_ASSERT_EQUAL_FLOAT(expected.normal.z, actual.normal.z);
+            hits++;
+            answered += hint.answered;
+            TEST_ASSERT_FALSE(hittable_hit_hinted(&hittable, &ray, 0.001f, 0.999f * expected.t,
+                                                  true, &hint, &actual));
+            TEST_ASSERT_TRUE(hittable_hit_hinted(&hittable, &ray, 0.001f, INFINITY, true, &hint,
+                                                 &actual));
+            answered_blocked += hint.answered;
+        }
+    }
+    TEST_ASSERT_TRUE(hits > 0 && answered > 0 && answered < hits);
+    TEST_ASSERT_TRUE(answered_blocked > 0);
+    point_cloud_destroy(&cloud);
+    free(positions);
+}
+
+void test_point_cloud_load_maps_raw_file(void) {
+    const char *path = "test_point_cloud.bin";
+    float positions[3 * 20];
+    fill_points(positions, 20);
+    FILE *file = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(file);
+    fwrite(positions, sizeof(float), 3 * 20, file);
+    fclose(file);
+
+    PointCloud cloud;
+    TEST_ASSERT_TRUE(point_cloud_load(&cloud, path, 0.1f, color_red()));
+    TEST_ASSERT_EQUAL_UINT64(20, cloud.point_count);
+    AABB box;
+    Hittable hittable = point_cloud_to_hittable(&cloud);
+    TEST_ASSERT_TRUE(hittable_bounds(&hittable, &box));
+    float min_x = positions[0];
+    for (int i = 1; i < 20; i++) {
+        min_x = fminf(min_x, positions[3 * i]);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, min_x - 0.1f, box.min.x);
+    point_cloud_destroy(&cloud);
+    remove(path);
+
+    TEST_ASSERT_FALSE(point_cloud_load(&cloud, "does_not_exist.bin", 0.1f, color_red()));
+}
+
+void run_point_cloud_tests(void) {
+    RUN_TEST(test_point_cloud_matches_brute_force);
+    RUN_TEST(test_point_cloud_hint_matches_plain_hit);
+    RUN_TEST(test_point_cloud_load_maps_raw_file);
+}
@@ -0,0 +1,845 @@
+/**
+ * @file test_render.c
+ * @brief Unit tests for multithreaded rendering and progress reporting
+ */
+
+#include "unity/unity.h"
+#include "render.h"
+#include "demo_scenes.h"
+#include "preview.h"
+#include "progressive.h"
+#include "relight.h"
+#include "session.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * @brief Render a scene with the given settings into a malloc'd buffer
+ */
+static char *render_settings_to_buffer(const DemoScene *demo, const RenderSettings *settings,
+                                       long *size, RenderStats *stats) {
+    FILE *file = tmpfile();
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_TRUE(render_scene(&demo->camera, &demo->scene, settings, file, NULL, stats));
+    *size = ftell(file);
+    char *buffer = malloc((size_t)*size);
+    rewind(file);
+    TEST_ASSERT_EQUAL(1, fread(buffer, (size_t)*size, 1, file));
+    fclose(file);
+    return buffer;
+}
+
+/**
+ * @brief Render the default scene into a malloc'd buffer
+ */
+static char *render_to_buffer(const DemoScene *demo, int threads, int tile_size, long *size) {
+    RenderSettings settings = render_default_settings();
+    settings.thread_count = threads;
+    settings.tile_size = tile_size;
+    settings.progress_mode = PROGRESS_QUIET;
+    return render_settings_to_buffer(demo, &settings, size, NULL);
+}
+
+void test_render_output_independent_of_threads_and_tiles(void) {
+    DemoSceneOptions options = demo_scene_default_options();
+    DemoScene demo;
+    TEST_ASSERT_TRUE(demo_scene_build(&demo, &options, 64, 36));
+
+    long single_size, multi_size, tiled_size;
+    char *single = render_to_buffer(&demo, 1, RENDER_DEFAULT_TILE_SIZE, &single_size);
+    char *multi = render_to_buffer(&demo, 3, RENDER_DEFAULT_TILE_SIZE, &multi_size);
+    // Tiles that do not divide the image, with more bands than ring slots
+    char *tiled = render_to_buffer(&demo, 2, 5, &tiled_size);
+    TEST_ASSERT_EQUAL(0, strncmp(single, "P3\n64 36\n255\n", 13));
+    TEST_ASSERT_EQUAL(single_size, multi_size);
+    TEST_ASSERT_EQUAL(0, memcmp(single, multi, (size_t)single_size));
+    TEST_ASSERT_EQUAL(single_size, tiled_size);
+    TEST_ASSERT_EQUAL(0, memcmp(single, tiled, (size_t)single_size));
+    free(single);
+    free(multi);
+    free(tiled);
+    demo_scene_destroy(&demo);
+}
+
+void test_render_aovs_leave_image_unchanged(void) {
+    DemoSceneOptions options = demo_scene_default_options();
+    DemoScene demo;
+    TEST_ASSERT_TRUE(demo_scene_build(&demo, &options, 24, 16));
+    long plain_size;
+    char *plain = render_to_buffer(&demo, 2, 8, &plain_size);
+
+    unsigned aovs;
+    TEST_ASSERT_TRUE(render_parse_aovs("albedo,depth", &aovs));
+    TEST_ASSERT_EQUAL(RENDER_AOV_ALBEDO | RENDER_AOV_DEPTH, aovs);
+    TEST_ASSERT_FALSE(render_parse_aovs("depth,motion", &aovs));
+    TEST_ASSERT_TRUE(render_parse_aovs("all", &aovs));
+    TEST_ASSERT_EQUAL(9, render_aov_channel_count(aovs));
+
+    RenderSettings settings = render_default_settings();
+    settings.thread_count = 2;
+    settings.tile_size = 8;
+    settings.progress_mode = PROGRESS_QUIET;
+    settings.aovs = aovs;
+    FILE *file = tmpfile();
+    FILE *aov_file = tmpfile();
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_NOT_NULL(aov_file);
+    TEST_ASSERT_TRUE(render_scene(&demo.camera, &demo.scene, &settings, file, aov_file, NULL));
+
+    TEST_ASSERT_EQUAL(plain_size, ftell(file));
+    char *image = malloc((size_t)plain_size);
+    rewind(file);
+    TEST_ASSERT_EQUAL(1, fread(image, (size_t)plain_size, 1, file));
+    TEST_ASSERT_EQUAL(0, memcmp(plain, image, (size_t)plain_size));
+
+    // EXR magic, then the channel list sorted by name
+    char header[256];
+    long aov_size = ftell(aov_file);
+    rewind(aov_file);
+    TEST_ASSERT_EQUAL(1, fread(header, sizeof(header), 1, aov_file));
+    TEST_ASSERT_TRUE(aov_size > 24 * 16 * 4);
+    TEST_ASSERT_EQUAL_HEX8(0x76, header[0]);
+    TEST_ASSERT_EQUAL_STRING("channels", &header[8]);
+    const char *expected[9] = {"N.X", "N.Y", "N.Z", "Z", "albedo.B", "albedo.G", "albedo.R",
+                               "cost", "id"};
+    const char *name = &header[8 + 9 + 7 + 4];
+    for (int i = 0; i < 9; i++) {
+        TEST_ASSERT_EQUAL_STRING(expected[i], name);
+        name += strlen(name) + 1 + 16;
+    }
+    fclose(file);
+    fclose(aov_file);
+    free(plain);
+    free(image);
+    demo_scene_destroy(&demo);
+}
+
+void test_render_light_culling_leaves_image_unchanged(void) {
+    DemoSceneOptions options = demo_scene_default_options();
+    options.kind = DEMO_SCENE_LIGHTS;
+    options.light_count = 512;
+    DemoScene demo;
+    TEST_ASSERT_TRUE(demo_scene_build(&demo, &options, 48, 27));
+    long plain_size, culled_size;
+    char *plain = render_to_buffer(&demo, 2, 8, &plain_size);
+
+    RenderSettings settings = render_default_settings();
+    settings.thread_count = 2;
+    settings.tile_size = 8;
+    settings.progress_mode = PROGRESS_QUIET;
+    settings.cull_lights = true;
+    RenderStats stats;
+    char *culled = render_settings_to_buffer(&demo, &settings, &culled_size, &stats);
+    TEST_ASSERT_EQUAL(plain_size, culled_size);
+    TEST_ASSERT_EQUAL(0, memcmp(plain, culled, (size_t)plain_size));
+    TEST_ASSERT_TRUE(stats.lights_per_tile > 0.0);
+    TEST_ASSERT_TRUE(stats.lights_per_tile < 0.5 * options.light_count);
+    free(plain);
+    free(culled);
+
+    // Without lights there is nothing to cull
+    scene_destroy(&demo.scene);
+    plain = render_to_buffer(&demo, 2, 8, &plain_size);
+    culled = render_settings_to_buffer(&demo, &settings, &culled_size, &stats);
+    TEST_ASSERT_EQUAL(plain_size, culled_size);
+    TEST_ASSERT_EQUAL(0, memcmp(plain, culled, (size_t)plain_size));
+    TEST_ASSERT_TRUE(stats.lights_per_tile == 0.0);
+    free(plain);
+    free(culled);
+    demo_scene_destroy(&demo);
+}
+
+void test_render_cache_rerenders_only_edited_tiles(void) {
+    DemoSceneOptions options = demo_scene_default_options();
+    DemoScene demo;
+    TEST_ASSERT_TRUE(demo_scene_build(&demo, &options, 64, 36));
+    RenderSettings settings = render_default_settings();
+    settings.thread_count = 2;
+    settings.tile_size = 8;
+    settings.progress_mode = PROGRESS_QUIET;
+    RenderCache cache;
+    TEST_ASSERT_TRUE(render_cache_create(&cache, 64, 36, 8));
+    settings.cache = &cache;
+    long size;
+    RenderStats stats;
+    free(render_settings_to_buffer(&demo, &settings, &size, &stats));
+    TEST_ASSERT_EQUAL(0, stats.cached_tiles);
+    TEST_ASSERT_EQUAL_INT(0, render_cache_dirty_count(&cache));
+    uint64_t full_rays = stats.rays;
+
+    // Move the small sphere sideways: tiles where it was and where it is now change
+    int object = 0;
+    while (demo.scene.objects[object].data != &demo.spheres[1]) {
+        object++;
+    }
+    demo.spheres[1].center.x += 0.4f;
+    TEST_ASSERT_FALSE(render_cache_invalidate_object(&cache, &demo.camera, &demo.scene,
+                                                     demo.scene.object_count));
+    TEST_ASSERT_FALSE(render_cache_invalidate_object(&cache, &demo.camera, &demo.scene, -1));
+    TEST_ASSERT_EQUAL_INT(0, render_cache_dirty_count(&cache));
+    TEST_ASSERT_TRUE(render_cache_invalidate_object(&cache, &demo.camera, &demo.scene, object));
+    int dirty = render_cache_dirty_count(&cache);
+    TEST_ASSERT_TRUE(dirty > 0 && dirty < cache.tile_count);
+    long incremental_size;
+    char *incremental = render_settings_to_buffer(&demo, &settings, &incremental_size, &stats);
+    TEST_ASSERT_EQUAL(cache.tile_count - dirty, stats.cached_tiles);
+    // Only the dirty tiles' rays are traced (and counted)
+    TEST_ASSERT_EQUAL(stats.hit_queries + stats.occlusion_queries, stats.rays);
+    TEST_ASSERT_TRUE(stats.rays > 0 && stats.rays <= (uint64_t)dirty * 8 * 8);
+    TEST_ASSERT_TRUE(stats.rays < full_rays);
+
+    long full_size;
+    char *full = render_to_buffer(&demo, 2, 8, &full_size);
+    TEST_ASSERT_EQUAL(full_size, incremental_size);
+    TEST_ASSERT_EQUAL(0, memcmp(full, incremental, (size_t)full_size));
+    free(incremental);
+    free(full);
+    render_cache_destroy(&cache);
+    demo_scene_destroy(&demo);
+}
+
+void test_scene_bin_objects_covers_every_primary_hit(void) {
+    DemoSceneOptions options = demo_scene_default_options();
+    DemoScene demo;
+    TEST_ASSERT_TRUE(demo_scene_build(&demo, &options, 64, 36));
+    int tile_size = 8;
+    int tiles_x = (64 + tile_size - 1) / tile_size;
+    int tile_count = tiles_x * ((36 + tile_size - 1) / tile_size);
+    SceneObjectSet *tile_objects = malloc((size_t)tile_count * sizeof(SceneObjectSet));
+    TEST_ASSERT_NOT_NULL(tile_objects);
+    scene_bin_objects(&demo.scene, &demo.camera, tile_size, tile_objects);
+    int empty = 0;
+    for (int tile = 0; tile < tile_count; tile++) {
+        empty += tile_objects[tile] == 0;
+    }
+    // The sky above the ground plane has nothing to trace
+    TEST_ASSERT_TRUE(empty > 0);
+
+    for (int row = 0; row < 36; row++) {
+        for (int i = 0; i < 64; i++) {
+            float u, v;
+            camera_pixel_to_uv(&demo.camera, i, 35 - row, &u, &v);
+            Ray ray = camera_get_ray(&demo.camera, u, v);
+            HitRecord rec;
+            if (scene_hit(&demo.scene, &ray, SCENE_RAY_EPSILON, INFINITY, &rec)) {
+                SceneObjectSet set = tile_objects[(row / tile_size) * tiles_x + i / tile_size];
+                TEST_ASSERT_TRUE(set & ((SceneObjectSet)1u << rec.object_index));
+            }
+        }
+    }
+
+    RenderSettings settings = render_default_settings();
+    settings.thread_count = 2;
+    settings.tile_size = tile_size;
+    settings.progress_mode = PROGRESS_QUIET;
+    RenderStats stats;
+    long size;
+    free(render_settings_to_buffer(&demo, &settings, &size, &stats));
+    TEST_ASSERT_EQUAL(empty, stats.empty_tiles);
+    // One camera ray per pixel of the other tiles (the sky tiles are full 8x8 tiles)
+    TEST_ASSERT_EQUAL(64 * 36 - empty * tile_size * tile_size, stats.rays);
+    free(tile_objects);
+    demo_scene_destroy(&demo);
+}
+
+void test_scene_hit_cache_keeps_closest_hits(void) {
+    DemoSceneOptions options = demo_scene_default_options();
+    options.kind = DEMO_SCENE_SDF;
+    DemoScene demo;
+    TEST_ASSERT_TRUE(demo_scene_build(&demo, &options, 48, 27));
+    SceneHitCache cache;
+    scene_hit_cache_init(&cache);
+    Vec3 light = demo.scene.lights[0].position;
+    for (int j = 0; j < 27; j++) {
+        for (int i = 0; i < 48; i++) {
+            float u, v;
+            camera_pixel_to_uv(&demo.camera, i, j, &u, &v);
+            Ray ray = camera_get_ray(&demo.camera, u, v);
+            HitRecord expected, rec;
+            bool hit = scene_hit(&demo.scene, &ray, SCENE_RAY_EPSILON, INFINITY, &expected);
+            TEST_ASSERT_EQUAL(hit, scene_hit_objects(&demo.scene, &ray, SCENE_RAY_EPSILON,
+                                                     INFINITY, SCENE_ALL_OBJECTS, &cache, &rec));
+            if (!hit) {
+                continue;
+            }
+            TEST_ASSERT_EQUAL_INT(expected.object_index, rec.object_index);
+            TEST_ASSERT_EQUAL_FLOAT(expected.t, rec.t);
+
+            Vec3 to_light = vec3_sub(light, rec.point);
+            float distance = vec3_length(to_light);
+            Ray shadow = {rec.point, vec3_scale(to_light, 1.0f / distance)};
+            HitRecord blocker;
+            float t_max = distance - SCENE_RAY_EPSILON;
+            TEST_ASSERT_EQUAL(
+                scene_hit(&demo.scene, &shadow, SCENE_RAY_EPSILON, t_max, &blocker),
+                scene_occluded(&demo.scene, &shadow, SCENE_RAY_EPSILON, t_max, &cache));
+        }
+    }
+    TEST_ASSERT_EQUAL(48 * 27, cache.hit_queries);
+    TEST_ASSERT_TRUE(cache.hit_hits > 0 && cache.hit_hits < cache.hit_queries);
+    TEST_ASSERT_TRUE(cache.occlusion_queries > 0);
+    demo_scene_destroy(&demo);
+}
+
+void test_relight_matches_direct_render(void) {
+    DemoSceneOptions options = demo_scene_default_options();
+    options.kind = DEMO_SCENE_LIGHTS;
+    options.light_count = 64;
+    DemoScene demo;
+    TEST_ASSERT_TRUE(demo_scene_build(&demo, &options, 40, 24));
+    RenderSettings settings = render_default_settings();
+    settings.thread_count = 2;
+    settings.tile_size = 8;
+    settings.progress_mode = PROGRESS_QUIET;
+    GBuffer captured;
+    TEST_ASSERT_TRUE(gbuffer_create(&captured, 40, 24));
+    settings.gbuffer = &captured;
+    long size;
+    free(render_settings_to_buffer(&demo, &settings, &size, NULL));
+    settings.gbuffer = NULL;
+
+    char gbuffer_path[256];
+    char lights_path[256];
+    snprintf(gbuffer_path, sizeof(gbuffer_path), "/tmp/raydemo-relight-%ld.gbuf", (long)getpid());
+    snprintf(lights_path, sizeof(lights_path), "/tmp/raydemo-relight-%ld.lights", (long)getpid());
+    TEST_ASSERT_TRUE(gbuffer_save(&captured, gbuffer_path));
+    gbuffer_destroy(&captured);
+    GBuffer gbuffer;
+    TEST_ASSERT_TRUE(gbuffer_load(&gbuffer, gbuffer_path));
+    TEST_ASSERT_EQUAL_INT(40, gbuffer.width);
+
+    // New light positions and colors survive a round trip through a light set file
+    for (int i = 0; i < demo.scene.light_count; i++) {
+        demo.scene.lights[i].position.y += 0.1f;
+        demo.scene.lights[i].color.y *= 0.5f;
+    }
+    TEST_ASSERT_TRUE(scene_save_lights(&demo.scene, lights_path));
+    int error_line;
+    TEST_ASSERT_TRUE(scene_load_lights(&demo.scene, lights_path, &error_line));
+    TEST_ASSERT_EQUAL_INT(64, demo.scene.light_count);
+    FILE *bad = fopen(lights_path, "w");
+    TEST_ASSERT_NOT_NULL(bad);
+    fprintf(bad, "# comment\n\n0 1 0  1 1 1  2\n0 1 0 1 1\n");
+    fclose(bad);
+    TEST_ASSERT_FALSE(scene_load_lights(&demo.scene, lights_path, &error_line));
+    TEST_ASSERT_EQUAL_INT(4, error_line);
+    TEST_ASSERT_EQUAL_INT(64, demo.scene.light_count);
+
+    long direct_size;
+    char *direct = render_settings_to_buffer(&demo, &settings, &direct_size, NULL);
+    FILE *file = tmpfile();
+    TEST_ASSERT_NOT_NULL(file);
+    RenderStats stats;
+    TEST_ASSERT_TRUE(relight_render(&gbuffer, &demo.scene, &settings, false, file, &stats));
+    TEST_ASSERT_EQUAL(direct_size, ftell(file));
+    char *relit = malloc((size_t)direct_size);
+    rewind(file);
+    TEST_ASSERT_EQUAL(1, fread(relit, (size_t)direct_size, 1, file));
+    fclose(file);
+    TEST_ASSERT_EQUAL(0, memcmp(direct, relit, (size_t)direct_size));
+    TEST_ASSERT_TRUE(stats.lights_per_tile < options.light_count);
+    TEST_ASSERT_EQUAL(0, stats.rays);
+
+    // Shadowed relighting traces only shadow rays
+    file = tmpfile();
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_TRUE(relight_render(&gbuffer, &demo.scene, &settings, true, file, &stats));
+    fclose(file);
+    TEST_ASSERT_TRUE(stats.rays > 0);
+    TEST_ASSERT_EQUAL(stats.occlusion_queries, stats.rays);
+
+    // Without lights nothing is traced
+    scene_destroy(&demo.scene);
+    file = tmpfile();
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_TRUE(relight_render(&gbuffer, &demo.scene, &settings, true, file, &stats));
+    fclose(file);
+    TEST_ASSERT_EQUAL(0, stats.rays);
+
+    remove(gbuffer_path);
+    remove(lights_path);
+    free(direct);
+    free(relit);
+    gbuffer_destroy(&gbuffer);
+    demo_scene_destroy(&demo);
+}
+
+void test_progressive_first_sample_matches_single_pass(void) {
+    DemoSceneOptions options = demo_scene_default_options();
+    DemoScene demo;
+    TEST_ASSERT_TRUE(demo_scene_build(&demo, &options, 40, 24));
+    long single_size;
+    char *single = render_to_buffer(&demo, 2, 16, &single_size);
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/raydemo-progressive-%ld.ppm", (long)getpid());
+    RenderSettings settings = render_default_settings();
+    settings.thread_count = 2;
+    settings.tile_size = 16;
+    settings.progress_mode = PROGRESS_QUIET;
+    ProgressiveSettings progressive = progressive_default_settings();
+    progressive.max_samples = 1;
+    ProgressiveStats stats;
+    TEST_ASSERT_TRUE(render_progressive(&demo.camera, &demo.scene, &settings, &progressive, path,
+                                        NULL, &stats));
+    TEST_ASSERT_EQUAL(PROGRESSIVE_STOP_SAMPLES, stats.reason);
+    TEST_ASSERT_EQUAL(1, stats.passes);
+    FILE *file = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL(file);
+    char *image = malloc((size_t)single_size + 1);
+    TEST_ASSERT_EQUAL(single_size, (long)fread(image, 1, (size_t)single_size + 1, file));
+    fclose(file);
+    TEST_ASSERT_EQUAL(0, memcmp(single, image, (size_t)single_size));
+
+    // More samples, and a stop request or a deadline that come before the first pass: the
+    // first pass still completes, so no tile is left black
+    progressive.max_samples = 3;
+    TEST_ASSERT_TRUE(render_progressive(&demo.camera, &demo.scene, &settings, &progressive, path,
+                                        NULL, &stats));
+    TEST_ASSERT_EQUAL(3, stats.min_samples);
+    TEST_ASSERT_EQUAL(3, stats.max_samples);
+    TEST_ASSERT_TRUE(stats.noise >= 0.0 && stats.noise < 1.0);
+    for (int deadline = 0; deadline < 2; deadline++) {
+        if (deadline) {
+            progressive.time_budget = 1e-9;
+        } else {
+            progressive_request_stop();
+        }
+        TEST_ASSERT_TRUE(render_progressive(&demo.camera, &demo.scene, &settings, &progressive,
+                                            path, NULL, &stats));
+        TEST_ASSERT_EQUAL(deadline ? PROGRESSIVE_STOP_DEADLINE : PROGRESSIVE_STOP_REQUEST,
+                          stats.reason);
+        TEST_ASSERT_EQUAL(1, stats.passes);
+        TEST_ASSERT_EQUAL(1, stats.updates);
+        TEST_ASSERT_EQUAL(1, stats.min_samples);
+        TEST_ASSERT_EQUAL(1, stats.max_samples);
+        file = fopen(path, "rb");
+        TEST_ASSERT_NOT_NULL(file);
+        TEST_ASSERT_EQUAL(single_size, (long)fread(image, 1, (size_t)single_size + 1, file));
+        fclose(file);
+        TEST_ASSERT_EQUAL(0, memcmp(single, image, (size_t)single_size));
+    }
+    remove(path);
+    free(single);
+    free(image);
+    demo_scene_destroy(&demo);
+}
+
+void test_path_integrator_counts_bounce_and_shadow_rays(void) {
+    DemoSceneOptions options = demo_scene_default_options();
+    DemoScene demo;
+    TEST_ASSERT_TRUE(demo_scene_build(&demo, &options, 40, 24));
+    RenderSettings settings = render_default_settings();
+    settings.thread_count = 2;
+    settings.tile_size = 8;
+    settings.progress_mode = PROGRESS_QUIET;
+    settings.integrator.type = INTEGRATOR_PATH;
+    long size;
+    RenderStats stats;
+    free(render_settings_to_buffer(&demo, &settings, &size, &stats));
+    uint64_t traced_pixels = 40 * 24 - stats.empty_tiles * 8 * 8;
+    TEST_ASSERT_EQUAL(stats.hit_queries + stats.occlusion_queries, stats.rays);
+    TEST_ASSERT_TRUE(stats.hit_queries > traced_pixels);
+    TEST_ASSERT_TRUE(stats.occlusion_queries > 0);
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/raydemo-path-rays-%ld.ppm", (long)getpid());
+    ProgressiveSettings progressive = progressive_default_settings();
+    progressive.max_samples = 2;
+    TEST_ASSERT_TRUE(render_progressive(&demo.camera, &demo.scene, &settings, &progressive, path,
+                                        &stats, NULL));
+    TEST_ASSERT_EQUAL(stats.hit_queries + stats.occlusion_queries, stats.rays);
+    TEST_ASSERT_TRUE(stats.hit_queries > 2 * 40 * 24);
+    TEST_ASSERT_TRUE(stats.occlusion_queries > 0);
+    remove(path);
+    demo_scene_destroy(&demo);
+}
+
+void test_progressive_adaptive_retires_converged_tiles(void) {
+    DemoSceneOptions options = demo_scene_default_options();
+    DemoScene demo;
+    TEST_ASSERT_TRUE(demo_scene_build(&demo, &options, 40, 24));
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/raydemo-adaptive-%ld.ppm", (long)getpid());
+    RenderSettings settings = render_default_settings();
+    settings.thread_count = 2;
+    settings.tile_size = 8;
+    settings.progress_mode = PROGRESS_QUIET;
+    ProgressiveSettings progressive = progressive_default_settings();
+    progressive.max_samples = 64;
+    progressive.min_samples = 4;
+    progressive.adaptive_threshold = 0.02;
+    ProgressiveStats stats;
+    TEST_ASSERT_TRUE(render_progressive(&demo.camera, &demo.scene, &settings, &progressive, path,
+                                        NULL, &stats));
+    TEST_ASSERT_EQUAL(PROGRESSIVE_STOP_CONVERGED, stats.reason);
+    TEST_ASSERT_TRUE(stats.converged_tiles > 0);
+    TEST_ASSERT_EQUAL(4, stats.min_samples);
+    TEST_ASSERT_TRUE(stats.max_samples > 4 && stats.max_samples <= 64);
+    TEST_ASSERT_TRUE(stats.samples < 64u * 40u * 24u);
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, (double)stats.samples / (40.0 * 24.0), stats.mean_samples);
+    remove(path);
+    demo_scene_destroy(&demo);
+}
+
+/**
+ * @brief Read a whole file (caller frees)
+ */
+static char *read_file(const char *path, long *size) {
+    FILE *file = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL(file);
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    rewind(file);
+    char *data = malloc((size_t)*size);
+    TEST_ASSERT_EQUAL(*size, (long)fread(data, 1, (size_t)*size, file));
+    fclose(file);
+    return data;
+}
+
+void test_progressive_is_independent_of_threads_and_tiles(void) {
+    DemoSceneOptions options = demo_scene_default_options();
+    DemoScene demo;
+    TEST_ASSERT_TRUE(demo_scene_build(&demo, &options, 40, 24));
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/raydemo-sampler-%ld.pfm", (long)getpid());
+    RenderSettings settings = render_default_settings();
+    settings.output_format = IMAGE_FORMAT_PFM;
+    settings.progress_mode = PROGRESS_QUIET;
+    ProgressiveSettings progressive = progressive_default_settings();
+    progressive.max_samples = 6;
+    SamplerType types[] = {SAMPLER_SOBOL, SAMPLER_BLUE_NOISE};
+    for (int t = 0; t < 2; t++) {
+        settings.sampler = types[t];
+        settings.thread_count = 1;
+        settings.tile_size = 16;
+        TEST_ASSERT_TRUE(render_progressive(&demo.camera, &demo.scene, &settings, &progressive,
+                                            path, NULL, NULL));
+        long first_size;
+        char *first = read_file(path, &first_size);
+        settings.thread_count = 3;
+        settings.tile_size = 8;
+        TEST_ASSERT_TRUE(render_progressive(&demo.camera, &demo.scene, &settings, &progressive,
+                                            path, NULL, NULL));
+        long second_size;
+        char *second = read_file(path, &second_size);
+        TEST_ASSERT_EQUAL(first_size, second_size);
+        TEST_ASSERT_EQUAL(0, memcmp(first, second, (size_t)first_size));
+        free(first);
+        free(second);
+    }
+    remove(path);
+    demo_scene_destroy(&demo);
+}
+
+void test_preview_refines_to_the_full_render(void) {
+    DemoSceneOptions options = demo_scene_default_options();
+    DemoScene demo;
+    TEST_ASSERT_TRUE(demo_scene_build(&demo, &options, 40, 24));
+    RenderSettings settings = render_default_settings();
+    settings.thread_count = 2;
+    settings.tile_size = 8;
+    settings.progress_mode = PROGRESS_QUIET;
+    settings.integrator.type = INTEGRATOR_PATH;
+    long full_size;
+    char *full = render_settings_to_buffer(&demo, &settings, &full_size, NULL);
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/raydemo-preview-%ld.ppm", (long)getpid());
+    PreviewStats preview;
+    RenderStats stats;
+    TEST_ASSERT_TRUE(render_preview(&demo.camera, &demo.scene, &settings, 4, path, &stats,
+                                    &preview));
+    TEST_ASSERT_EQUAL(3, preview.levels);
+    // Guide rays plus the bounce and shadow rays of the shaded paths
+    TEST_ASSERT_EQUAL(stats.hit_queries + stats.occlusion_queries, stats.rays);
+    TEST_ASSERT_TRUE(stats.hit_queries > 40 * 24);
+    TEST_ASSERT_EQUAL(1, preview.final_factor);
+    TEST_ASSERT_EQUAL(40 * 24, preview.shaded_pixels);
+    TEST_ASSERT_TRUE(stats.first_tile_seconds == preview.first_frame_seconds);
+    long size;
+    char *image = read_file(path, &size);
+    TEST_ASSERT_EQUAL(full_size, size);
+    TEST_ASSERT_EQUAL(0, memcmp(full, image, (size_t)size));
+    free(image);
+
+    // A stop request keeps only the first level, upsampled to the full size
+    preview_request_stop();
+    TEST_ASSERT_TRUE(render_preview(&demo.camera, &demo.scene, &settings, 4, path, NULL,
+                                    &preview));
+    TEST_ASSERT_EQUAL(1, preview.levels);
+    TEST_ASSERT_EQUAL(4, preview.final_factor);
+    TEST_ASSERT_EQUAL(10 * 6, preview.shaded_pixels);
+    image = read_file(path, &size);
+    TEST_ASSERT_EQUAL(0, strncmp(image, "P3\n40 24\n255\n", 13));
+    TEST_ASSERT_TRUE(size != full_size || memcmp(full, image, (size_t)size) != 0);
+    free(image);
+
+    // Cancelling fails the preview before its first level
+    atomic_bool cancel;
+    atomic_init(&cancel, true);
+    settings.cancel = &cancel;
+    TEST_ASSERT_FALSE(render_preview(&demo.camera, &demo.scene, &settings, 4, path, NULL,
+                                     &preview));
+    TEST_ASSERT_EQUAL(0, preview.levels);
+    remove(path);
+    free(full);
+    demo_scene_destroy(&demo);
+}
+
+void test_path_render_and_preview_use_the_sampler_setting(void) {
+    DemoSceneOptions options = demo_scene_default_options();
+    DemoScene demo;
+    TEST_ASSERT_TRUE(demo_scene_build(&demo, &options, 40, 24));
+    RenderSettings settings = render_default_settings();
+    settings.thread_count = 2;
+    settings.tile_size = 8;
+    settings.progress_mode = PROGRESS_QUIET;
+    settings.integrator.type = INTEGRATOR_PATH;
+    long sobol_size;
+    char *sobol = render_settings_to_buffer(&demo, &settings, &sobol_size, NULL);
+    settings.sampler = SAMPLER_BLUE_NOISE;
+    long blue_size;
+    char *blue = render_settings_to_buffer(&demo, &settings, &blue_size, NULL);
+    TEST_ASSERT_TRUE(blue_size != sobol_size || memcmp(blue, sobol, (size_t)blue_size) != 0);
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/raydemo-preview-sampler-%ld.ppm", (long)getpid());
+    TEST_ASSERT_TRUE(render_preview(&demo.camera, &demo.scene, &settings, 2, path, NULL, NULL));
+    long size;
+    char *image = read_file(path, &size);
+    TEST_ASSERT_EQUAL(blue_size, size);
+    TEST_ASSERT_EQUAL(0, memcmp(blue, image, (size_t)size));
+    free(image);
+    remove(path);
+    free(blue);
+    free(sobol);
+    demo_scene_destroy(&demo);
+}
+
+void test_render_cancel_stops_before_the_next_tile(void) {
+    DemoSceneOptions options = demo_scene_default_options();
+    DemoScene demo;
+    TEST_ASSERT_TRUE(demo_scene_build(&demo, &options, 64, 36));
+    atomic_bool cancel;
+    atomic_init(&cancel, true);
+    RenderSettings settings = render_default_settings();
+    settings.thread_count = 2;
+    settings.tile_size = 8;
+    settings.progress_mode = PROGRESS_QUIET;
+    settings.cancel = &cancel;
+    FILE *file = tmpfile();
+    TEST_ASSERT_NOT_NULL(file);
+    RenderStats stats;
+    TEST_ASSERT_FALSE(render_scene(&demo.camera, &demo.scene, &settings, file, NULL, &stats));
+    TEST_ASSERT_EQUAL(0, stats.hit_queries);
+    fclose(file);
+
+    // Not cancelled: the first tile is timed
+    atomic_store(&cancel, false);
+    long size;
+    char *image = render_settings_to_buffer(&demo, &settings, &size, &stats);
+    TEST_ASSERT_TRUE(stats.first_tile_seconds > 0.0);
+    TEST_ASSERT_TRUE(stats.first_tile_seconds <= stats.render_seconds);
+    free(image);
+    demo_scene_destroy(&demo);
+}
+
+void test_session_renders_after_each_command(void) {
+    DemoSceneOptions options = demo_scene_default_options();
+    DemoScene demo;
+    TEST_ASSERT_TRUE(demo_scene_build(&demo, &options, 40, 24));
+    RenderSettings settings = render_default_settings();
+    settings.thread_count = 2;
+    settings.tile_size = 8;
+    settings.progress_mode = PROGRESS_QUIET;
+
+    FILE *commands = tmpfile();
+    FILE *replies = tmpfile();
+    TEST_ASSERT_NOT_NULL(commands);
+    TEST_ASSERT_NOT_NULL(replies);
+    fputs("integrator path\nwait\n# comment\n\ncamera 0 0.5 1 0 0 -1 70\nbogus 1\n", commands);
+    rewind(commands);
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/raydemo-session-%ld.ppm", (long)getpid());
+    SessionStats stats;
+    TEST_ASSERT_TRUE(session_run(&demo.camera, &demo.scene, &settings, 0, path, commands,
+                                 replies, &stats));
+    TEST_ASSERT_EQUAL(4, stats.commands);
+    TEST_ASSERT_EQUAL(3, stats.frames);
+    TEST_ASSERT_EQUAL(3, stats.completed + stats.cancelled);
+    // "wait" lets the path-traced frame finish, and the end of the input the last one
+    TEST_ASSERT_TRUE(stats.completed >= 2);
+    TEST_ASSERT_TRUE(stats.max_first_tile_seconds > 0.0);
+    fclose(commands);
+
+    char text[512];
+    rewind(replies);
+    size_t length = fread(text, 1, sizeof(text) - 1, replies);
+    text[length] = '\0';
+    fclose(replies);
+    TEST_ASSERT_NOT_NULL(strstr(text, "frame 2 complete: first tile "));
+    TEST_ASSERT_NOT_NULL(strstr(text, "frame 3 complete: first tile "));
+    TEST_ASSERT_NOT_NULL(strstr(text, "error: bogus: unknown command\n"));
+
+    // The last frame matches a plain render of the same camera and integrator
+    demo.camera = camera_create_perspective(vec3_create(0.0f, 0.5f, 1.0f),
+                                            vec3_create(0.0f, 0.0f, -1.0f),
+                                            vec3_create(0.0f, 1.0f, 0.0f), 70.0f,
+                                            40.0f / 24.0f, 40, 24);
+    settings.integrator.type = INTEGRATOR_PATH;
+    long expected_size;
+    char *expected = render_settings_to_buffer(&demo, &settings, &expected_size, NULL);
+    long size;
+    char *image = read_file(path, &size);
+    TEST_ASSERT_EQUAL(expected_size, size);
+    TEST_ASSERT_EQUAL(0, memcmp(expected, image, (size_t)size));
+    remove(path);
+    free(expected);
+    free(image);
+    demo_scene_destroy(&demo);
+}
+
+void test_session_moves_objects_through_the_cache(void) {
+    DemoSceneOptions options = demo_scene_default_options();
+    DemoScene demo;
+    TEST_ASSERT_TRUE(demo_scene_build(&demo, &options, 40, 24));
+    RenderSettings settings = render_default_settings();
+    settings.thread_count = 2;
+    settings.tile_size = 8;
+    settings.progress_mode = PROGRESS_QUIET;
+
+    FILE *commands = tmpfile();
+    FILE *replies = tmpfile();
+    TEST_ASSERT_NOT_NULL(commands);
+    TEST_ASSERT_NOT_NULL(replies);
+    int object = 0;
+    while (demo.scene.objects[object].data != &demo.spheres[1]) {
+        object++;
+    }
+    float x = demo.spheres[1].center.x;
+    fprintf(commands, "wait\nmove-object %d 0 0 0\nmove-object 0 0.1\nmove-object %d 0.4 0 0\n",
+            demo.scene.object_count, object);
+    rewind(commands);
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/raydemo-session-move-%ld.ppm", (long)getpid());
+    SessionStats stats;
+    TEST_ASSERT_TRUE(session_run(&demo.camera, &demo.scene, &settings, 0, path, commands,
+                                 replies, &stats));
+    TEST_ASSERT_EQUAL(2, stats.frames);
+    TEST_ASSERT_EQUAL(2, stats.completed);
+    // The second frame renders only where the sphere was and is
+    int tiles = ((40 + 7) / 8) * ((24 + 7) / 8);
+    TEST_ASSERT_TRUE(stats.cached_tiles > 0 && stats.cached_tiles < (uint64_t)tiles);
+    TEST_ASSERT_EQUAL_FLOAT(x + 0.4f, demo.spheres[1].center.x);
+    fclose(commands);
+
+    char text[512];
+    rewind(replies);
+    size_t length = fread(text, 1, sizeof(text) - 1, replies);
+    text[length] = '\0';
+    fclose(replies);
+    TEST_ASSERT_NOT_NULL(strstr(text, "error: move-object: no such object\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "error: move-object: needs I DX DY DZ\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "frame 2 complete: first tile "));
+
+    // The reused tiles give the same image as a full render of the moved scene
+    long expected_size;
+    char *expected = render_settings_to_buffer(&demo, &settings, &expected_size, NULL);
+    long size;
+    char *image = read_file(path, &size);
+    TEST_ASSERT_EQUAL(expected_size, size);
+    TEST_ASSERT_EQUAL(0, memcmp(expected, image, (size_t)size));
+    remove(path);
+    free(expected);
+    free(image);
+    demo_scene_destroy(&demo);
+}
+
+void test_session_previews_refine_to_the_full_frame(void) {
+    DemoSceneOptions options = demo_scene_default_options();
+    DemoScene demo;
+    TEST_ASSERT_TRUE(demo_scene_build(&demo, &options, 40, 24));
+    RenderSettings settings = render_default_settings();
+    settings.thread_count = 2;
+    settings.tile_size = 8;
+    settings.progress_mode = PROGRESS_QUIET;
+
+    FILE *commands = tmpfile();
+    FILE *replies = tmpfile();
+    TEST_ASSERT_NOT_NULL(commands);
+    TEST_ASSERT_NOT_NULL(replies);
+    fputs("camera 0 0.5 1 0 0 -1 70\n", commands);
+    rewind(commands);
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/raydemo-session-preview-%ld.ppm", (long)getpid());
+    SessionStats stats;
+    TEST_ASSERT_FALSE(session_run(&demo.camera, &demo.scene, &settings, 3, path, commands,
+                                  replies, &stats));
+    TEST_ASSERT_TRUE(session_run(&demo.camera, &demo.scene, &settings, 4, path, commands,
+                                 replies, &stats));
+    TEST_ASSERT_EQUAL(2, stats.frames);
+    TEST_ASSERT_EQUAL(2, stats.completed + stats.cancelled);
+    TEST_ASSERT_TRUE(stats.completed >= 1);
+    TEST_ASSERT_EQUAL(0, stats.cached_tiles);
+    fclose(commands);
+    fclose(replies);
+
+    // The last frame is refined up to the full render of its camera
+    demo.camera = camera_create_perspective(vec3_create(0.0f, 0.5f, 1.0f),
+                                            vec3_create(0.0f, 0.0f, -1.0f),
+                                            vec3_create(0.0f, 1.0f, 0.0f), 70.0f,
+                                            40.0f / 24.0f, 40, 24);
+    long expected_size;
+    char *expected = render_settings_to_buffer(&demo, &settings, &expected_size, NULL);
+    long size;
+    char *image = read_file(path, &size);
+    TEST_ASSERT_EQUAL(expected_size, size);
+    TEST_ASSERT_EQUAL(0, memcmp(expected, image, (size_t)size));
+    remove(path);
+    free(expected);
+    free(image);
+    demo_scene_destroy(&demo);
+}
+
+void test_progress_sample_estimates_eta(void) {
+    Progress progress;
+    TEST_ASSERT_TRUE(progress_start(&progress, PROGRESS_QUIET, 1.0, 200, 2, stderr));
+    progress_add_work(&progress, 50, 1000);
+    progress_add_work(&progress, 50, 1000);
+
+    ProgressSample sample;
+    progress_sample(&progress, progress.start_time + 4.0, &sample);
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, 0.5, sample.fraction);
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, 500.0, sample.rays_per_second);
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, 4.0, sample.eta);
+    progress_finish(&progress);
+
+    ProgressMode mode;
+    TEST_ASSERT_TRUE(progress_parse_mode("json", &mode));
+    TEST_ASSERT_EQUAL(PROGRESS_JSON, mode);
+    TEST_ASSERT_FALSE(progress_parse_mode("verbose", &mode));
+}
+
+void run_render_tests(void) {
+    RUN_TEST(test_render_output_independent_of_threads_and_tiles);
+    RUN_TEST(test_render_aovs_leave_image_unchanged);
+    RUN_TEST(test_render_light_culling_leaves_image_unchanged);
+    RUN_TEST(test_render_cache_rerenders_only_edited_tiles);
+    RUN_TEST(test_scene_bin_objects_covers_every_primary_hit);
+    RUN_TEST(test_scene_hit_cache_keeps_closest_hits);
+    RUN_TEST(test_relight_matches_direct_render);
+    RUN_TEST(test_progressive_first_sample_matches_single_pass);
+    RUN_TEST(test_path_integrator_counts_bounce_and_shadow_rays);
+    RUN_TEST(test_progressive_adaptive_retires_converged_tiles);
+    RUN_TEST(test_progressive_is_independent_of_threads_and_tiles);
+    RUN_TEST(test_preview_refines_to_the_full_render);
+    RUN_TEST(test_path_render_and_preview_use_the_sampler_setting);
+    RUN_TEST(test_render_cancel_stops_before_the_next_tile);
+    RUN_TEST(test_session_renders_after_each_command);
+    RUN_TEST(test_session_moves_objects_through_the_cache);
+    RUN_TEST(test_session_previews_refine_to_the_full_frame);
+    RUN_TEST(test_progress_sample_estimates_eta);
+}
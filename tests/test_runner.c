@@ -10,6 +10,17 @@
 // External test functions
 extern void run_vec3_tests(void);
 extern void run_sphere_tests(void);
+extern void run_accel_tests(void);
+extern void run_heightfield_tests(void);
+extern void run_voxel_tests(void);
+extern void run_sdf_tests(void);
+extern void run_point_cloud_tests(void);
+extern void run_render_tests(void);
+extern void run_output_tests(void);
+extern void run_sampler_tests(void);
+extern void run_denoise_tests(void);
+extern void run_integrator_tests(void);
+extern void run_light_tree_tests(void);
 
 void setUp(void) {
     // Global setup
@@ -25,6 +36,17 @@ int main(void) {
     // Run all test suites
     run_vec3_tests();
     run_sphere_tests();
+    run_accel_tests();
+    run_heightfield_tests();
+    run_voxel_tests();
+    run_sdf_tests();
+    run_point_cloud_tests();
+    run_render_tests();
+    run_output_tests();
+    run_sampler_tests();
+    run_denoise_tests();
+    run_integrator_tests();
+    run_light_tree_tests();
     
     return UNITY_END();
 }
\ No newline at end of file
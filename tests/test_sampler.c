@@ -0,0 +1,55 @@
+/**
+ * @file test_sampler.c
+ * @brief Unit tests for the low-discrepancy sampler
+ */
+
+#include "unity/unity.h"
+#include "sampler.h"
+#include <stdbool.h>
+
+void test_sampler_sobol_stratifies_each_pixel(void) {
+    Sampler sampler;
+    TEST_ASSERT_TRUE(sampler_init(&sampler, SAMPLER_SOBOL, 7));
+    // The first 16 samples of any pixel cover each cell of a 4 x 4 grid once
+    for (uint32_t pixel = 0; pixel < 8; pixel++) {
+        bool covered[16] = {false};
+        for (uint32_t index = 0; index < 16; index++) {
+            float u = sampler_get(&sampler, pixel * 37, pixel * 11, index, 0);
+            float v = sampler_get(&sampler, pixel * 37, pixel * 11, index, 1);
+            TEST_ASSERT_TRUE(u >= 0.0f && u < 1.0f && v >= 0.0f && v < 1.0f);
+            int cell = (int)(v * 4.0f) * 4 + (int)(u * 4.0f);
+            TEST_ASSERT_FALSE(covered[cell]);
+            covered[cell] = true;
+        }
+    }
+    // Neighbouring pixels get decorrelated sequences
+    TEST_ASSERT_TRUE(sampler_get(&sampler, 0, 0, 0, 0) != sampler_get(&sampler, 1, 0, 0, 0));
+    sampler_destroy(&sampler);
+}
+
+void test_sampler_blue_noise_mask_is_a_permutation(void) {
+    Sampler sampler;
+    TEST_ASSERT_TRUE(sampler_init(&sampler, SAMPLER_BLUE_NOISE, 0));
+    static bool seen[SAMPLER_MASK_SIZE * SAMPLER_MASK_SIZE];
+    for (int i = 0; i < SAMPLER_MASK_SIZE * SAMPLER_MASK_SIZE; i++) {
+        int rank = (int)(sampler.mask[i] * (float)(SAMPLER_MASK_SIZE * SAMPLER_MASK_SIZE));
+        TEST_ASSERT_FALSE(seen[rank]);
+        seen[rank] = true;
+    }
+    // Adjacent mask cells rarely hold similar ranks (no low-frequency clumps)
+    int similar = 0;
+    for (int i = 0; i < SAMPLER_MASK_SIZE * SAMPLER_MASK_SIZE; i++) {
+        int right = (i & ~(SAMPLER_MASK_SIZE - 1)) | ((i + 1) & (SAMPLER_MASK_SIZE - 1));
+        float d = sampler.mask[i] - sampler.mask[right];
+        similar += d > -0.05f && d < 0.05f;
+    }
+    TEST_ASSERT_TRUE(similar < SAMPLER_MASK_SIZE * SAMPLER_MASK_SIZE / 20);
+    float value = sampler_get(&sampler, 3, 5, 9, 1);
+    TEST_ASSERT_TRUE(value >= 0.0f && value < 1.0f);
+    sampler_destroy(&sampler);
+}
+
+void run_sampler_tests(void) {
+    RUN_TEST(test_sampler_sobol_stratifies_each_pixel);
+    RUN_TEST(test_sampler_blue_noise_mask_is_a_permutation);
+}
@@ -0,0 +1,89 @@
+/**
+ * @file test_sdf.c
+ * @brief Unit tests for signed-distance-field objects
+ */
+
+#include "unity/unity.h"
+#include "sdf.h"
+#include "sphere.h"
+
+void test_sdf_sphere_matches_analytic_sphere(void) {
+    SdfObject sdf = sdf_object_create(color_red());
+    sdf_add_sphere(&sdf, vec3_create(0.0f, 0.0f, -3.0f), 1.0f);
+    Hittable hittable = sdf_to_hittable(&sdf);
+    Sphere sphere = sphere_create(vec3_create(0.0f, 0.0f, -3.0f), 1.0f, color_red());
+    Hittable reference = sphere_to_hittable(&sphere);
+
+    Ray ray = ray_create(vec3_create(0.1f, 0.2f, 0.0f), vec3_create(0.05f, -0.1f, -1.0f));
+    HitRecord hit_rec, ref_rec;
+    TEST_ASSERT_TRUE(hittable_hit(&reference, &ray, 0.001f, INFINITY, &ref_rec));
+    TEST_ASSERT_TRUE(hittable_hit(&hittable, &ray, 0.001f, INFINITY, &hit_rec));
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, ref_rec.t, hit_rec.t);
+    TEST_ASSERT_FLOAT_WITHIN(1e-2f, ref_rec.normal.z, hit_rec.normal.z);
+
+    // Misses outside the bounds, and respects t_max
+    Ray miss = ray_create(vec3_create(2.0f, 0.0f, 0.0f), vec3_create(0.0f, 0.0f, -1.0f));
+    TEST_ASSERT_FALSE(hittable_hit(&hittable, &miss, 0.001f, INFINITY, &hit_rec));
+    TEST_ASSERT_FALSE(hittable_hit(&hittable, &ray, 0.001f, 1.5f, &hit_rec));
+}
+
+void test_sdf_smooth_union_bounds_contain_surface(void) {
+    SdfObject sdf = sdf_object_create(color_white());
+    int a = sdf_add_sphere(&sdf, vec3_create(-0.5f, 0.0f, 0.0f), 0.5f);
+    int b = sdf_add_box(&sdf, vec3_create(0.5f, 0.0f, 0.0f), vec3_create(0.3f, 0.3f, 0.3f), 0.1f);
+    int root = sdf_add_smooth_union(&sdf, a, b, 0.4f);
+    TEST_ASSERT_EQUAL_INT(root, sdf.root);
+
+    Hittable hittable = sdf_to_hittable(&sdf);
+    AABB box;
+    TEST_ASSERT_TRUE(hittable_bounds(&hittable, &box));
+
+    // Every point on the bounds is outside (or on) the blended surface
+    float corners[2] = {0.0f, 1.0f};
+    for (int i = 0; i < 2; i++) {
+        Vec3 p = vec3_create(box.min.x + corners[i] * (box.max.x - box.min.x), 0.0f, 0.0f);
+        TEST_ASSERT_TRUE(sdf_evaluate(&sdf, p) >= -1e-5f);
+        p = vec3_create(0.0f, box.min.y + corners[i] * (box.max.y - box.min.y), 0.0f);
+        TEST_ASSERT_TRUE(sdf_evaluate(&sdf, p) >= -1e-5f);
+    }
+    TEST_ASSERT_TRUE(sdf_evaluate(&sdf, vec3_zero()) < 0.0f);
+
+    // Without over-relaxation the trace reaches the same surface
+    Ray ray = ray_create(vec3_create(0.0f, 2.0f, 0.0f), vec3_create(0.0f, -1.0f, 0.0f));
+    HitRecord relaxed, plain;
+    TEST_ASSERT_TRUE(hittable_hit(&hittable, &ray, 0.001f, INFINITY, &relaxed));
+    sdf.relaxation = 1.0f;
+    TEST_ASSERT_TRUE(hittable_hit(&hittable, &ray, 0.001f, INFINITY, &plain));
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, plain.t, relaxed.t);
+}
+
+void test_sdf_relaxed_overshoot_near_exit_still_hits(void) {
+    SdfObject sdf = sdf_object_create(color_white());
+    sdf_add_sphere(&sdf, vec3_create(0.0f, 0.0f, -3.0f), 1.0f);
+    Hittable hittable = sdf_to_hittable(&sdf);
+
+    // A t_max just past the surface ends the march range there. Relaxed
+    // steps that overshoot the surface and that end still have to find it.
+    int misses = 0;
+    for (int i = 0; i < 64; i++) {
+        float x = -0.9f + 1.8f * (float)i / 63.0f;
+        Ray ray = ray_create(vec3_create(x, 0.3f, 0.0f), vec3_create(0.0f, 0.0f, -1.0f));
+        HitRecord full, bounded;
+        TEST_ASSERT_TRUE(hittable_hit(&hittable, &ray, 0.001f, INFINITY, &full));
+        for (int k = 1; k <= 4; k++) {
+            float t_max = full.t + 0.01f * (float)k;
+            if (!hittable_hit(&hittable, &ray, 0.001f, t_max, &bounded)) {
+                misses++;
+            } else {
+                TEST_ASSERT_FLOAT_WITHIN(1e-4f, full.t, bounded.t);
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(0, misses);
+}
+
+void run_sdf_tests(void) {
+    RUN_TEST(test_sdf_sphere_matches_analytic_sphere);
+    RUN_TEST(test_sdf_smooth_union_bounds_contain_surface);
+    RUN_TEST(test_sdf_relaxed_overshoot_near_exit_still_hits);
+}
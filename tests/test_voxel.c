@@ -0,0 +1,182 @@
+/**
+ * @file test_voxel.c
+ * @brief Unit tests for the sparse voxel volume
+ */
+
+#include "unity/unity.h"
+#include "voxel.h"
+#include "aabb.h"
+
+void test_voxel_bricks_allocated_on_demand(void) {
+    VoxelVolume volume;
+    TEST_ASSERT_TRUE(voxel_volume_init(&volume, 64, 64, 64, vec3_zero(), 1.0f));
+    TEST_ASSERT_EQUAL_INT(0, volume.brick_count);
+
+    TEST_ASSERT_TRUE(voxel_volume_set(&volume, 3, 4, 5, 7));
+    TEST_ASSERT_TRUE(voxel_volume_set(&volume, 6, 1, 2, 9));
+    TEST_ASSERT_EQUAL_INT(1, volume.brick_count);
+    TEST_ASSERT_EQUAL_UINT8(7, voxel_volume_get(&volume, 3, 4, 5));
+    TEST_ASSERT_EQUAL_UINT8(VOXEL_EMPTY, voxel_volume_get(&volume, 40, 40, 40));
+    TEST_ASSERT_FALSE(voxel_volume_set(&volume, 64, 0, 0, 1));
+    voxel_volume_destroy(&volume);
+}
+
+void test_voxel_ray_skips_empty_bricks(void) {
+    VoxelVolume volume;
+    voxel_volume_init(&volume, 64, 64, 64, vec3_zero(), 0.5f);
+    voxel_volume_set_material(&volume, 3, color_red());
+    voxel_volume_set(&volume, 50, 10, 10, 3);
+    Hittable hittable = voxel_volume_to_hittable(&volume);
+
+    // Along +x through voxel (50, 10, 10): its -x face is at x = 25
+    Ray ray = ray_create(vec3_create(-5.0f, 5.25f, 5.25f), vec3_create(1.0f, 0.0f, 0.0f));
+    HitRecord hit_rec;
+    TEST_ASSERT_TRUE(hittable_hit(&hittable, &ray, 0.001f, INFINITY, &hit_rec));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 30.0f, hit_rec.t);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, -1.0f, hit_rec.normal.x);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, hit_rec.albedo.x);
+
+    // A parallel ray one voxel higher misses
+    Ray miss = ray_create(vec3_create(-5.0f, 5.75f, 5.25f), vec3_create(1.0f, 0.0f, 0.0f));
+    TEST_ASSERT_FALSE(hittable_hit(&hittable, &miss, 0.001f, INFINITY, &hit_rec));
+
+    // Diagonal ray from above lands on the top face
+    Ray down = ray_create(vec3_create(25.2f, 40.0f, 5.3f), vec3_create(0.0f, -1.0f, 0.0f));
+    TEST_ASSERT_TRUE(hittable_hit(&hittable, &down, 0.001f, INFINITY, &hit_rec));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 5.5f, hit_rec.point.y);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, hit_rec.normal.y);
+    voxel_volume_destroy(&volume);
+}
+
+static unsigned int voxel_random(unsigned int *state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+/**
+ * @brief Closest solid voxel along a ray by testing every voxel's box
+ */
+static bool brute_force_voxel_hit(const VoxelVolume *volume, const Ray *ray, float *t_hit) {
+    Vec3 inv_dir = aabb_inverse_direction(ray);
+    float closest = INFINITY;
+    for (int z = 0; z < volume->size[2]; z++) {
+        for (int y = 0; y < volume->size[1]; y++) {
+            for (int x = 0; x < volume->size[0]; x++) {
+                if (voxel_volume_get(volume, x, y, z) == VOXEL_EMPTY) {
+                    continue;
+                }
+                Vec3 min = vec3_add(volume->origin,
+                                    vec3_scale(vec3_create((float)x, (float)y, (float)z),
+                                               volume->voxel_size));
+                AABB box = aabb_create(min, vec3_add(min, vec3_create(volume->voxel_size,
+                                                                      volume->voxel_size,
+                                                                      volume->voxel_size)));
+                float t_enter, t_exit;
+                if (aabb_hit(&box, ray, inv_dir, 0.001f, closest, &t_enter, &t_exit)) {
+                    closest = t_enter;
+                }
+            }
+        }
+    }
+    *t_hit = closest;
+    return closest < INFINITY;
+}
+
+void test_voxel_traversal_matches_brute_force(void) {
+    // Sizes that are not multiples of the brick size leave partial bricks at the far faces
+    VoxelVolume volume;
+    TEST_ASSERT_TRUE(voxel_volume_init(&volume, 37, 21, 30, vec3_create(1.0f, -2.0f, 0.5f),
+                                       0.25f));
+    unsigned int state = 2024u;
+    for (int i = 0; i < 900; i++) {
+        int x = (int)(voxel_random(&state) % 37);
+        int y = (int)(voxel_random(&state) % 21);
+        int z = (int)(voxel_random(&state) % 30);
+        TEST_ASSERT_TRUE(voxel_volume_set(&volume, x, y, z, (uint8_t)(1 + i % 5)));
+    }
+    // Clear one corner region so that some bricks lose all their voxels again
+    for (int z = 0; z < 16; z++) {
+        for (int y = 0; y < 16; y++) {
+            for (int x = 0; x < 16; x++) {
+                TEST_ASSERT_TRUE(voxel_volume_set(&volume, x, y, z, VOXEL_EMPTY));
+            }
+        }
+    }
+    int occupied = 0;
+    for (int bz = 0; bz < volume.brick_res[2]; bz++) {
+        for (int by = 0; by < volume.brick_res[1]; by++) {
+            for (int bx = 0; bx < volume.brick_res[0]; bx++) {
+                bool solid = false;
+                for (int v = 0; v < VOXEL_BRICK_VOXELS && !solid; v++) {
+                    solid = voxel_volume_get(&volume, bx * VOXEL_BRICK_SIZE + v % 8,
+                                             by * VOXEL_BRICK_SIZE + v / 8 % 8,
+                                             bz * VOXEL_BRICK_SIZE + v / 64) != VOXEL_EMPTY;
+                }
+                occupied += solid;
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(occupied, volume.brick_count);
+
+    Hittable hittable = voxel_volume_to_hittable(&volume);
+    Vec3 center = vec3_create(1.0f + 37 * 0.125f, -2.0f + 21 * 0.125f, 0.5f + 30 * 0.125f);
+    int hits = 0;
+    for (int r = 0; r < 300; r++) {
+        float p[6];
+        for (int a = 0; a < 6; a++) {
+            p[a] = (float)voxel_random(&state) / 16777216.0f * 2.0f - 1.0f;
+        }
+        // From outside the volume towards a random point inside it
+        Vec3 origin = vec3_add(center, vec3_scale(vec3_normalize(vec3_create(p[0], p[1], p[2])),
+                                                  12.0f));
+        Vec3 target = vec3_add(center, vec3_create(p[3] * 4.6f, p[4] * 2.6f, p[5] * 3.7f));
+        Ray ray = ray_create(origin, vec3_sub(target, origin));
+        float expected_t;
+        bool expected = brute_force_voxel_hit(&volume, &ray, &expected_t);
+        HitRecord hit_rec;
+        TEST_ASSERT_EQUAL(expected, hittable_hit(&hittable, &ray, 0.001f, INFINITY, &hit_rec));
+        if (expected) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-4f * expected_t, expected_t, hit_rec.t);
+            TEST_ASSERT_TRUE(vec3_dot(hit_rec.normal, ray.direction) < 0.0f);
+            hits++;
+        }
+    }
+    TEST_ASSERT_TRUE(hits > 0 && hits < 300);
+    voxel_volume_destroy(&volume);
+}
+
+void test_voxel_clearing_frees_empty_bricks(void) {
+    VoxelVolume volume;
+    TEST_ASSERT_TRUE(voxel_volume_init(&volume, 64, 64, 64, vec3_zero(), 1.0f));
+    TEST_ASSERT_TRUE(voxel_volume_set(&volume, 1, 1, 1, 4));
+    TEST_ASSERT_TRUE(voxel_volume_set(&volume, 2, 1, 1, 4));
+    TEST_ASSERT_TRUE(voxel_volume_set(&volume, 20, 30, 40, 5));
+    TEST_ASSERT_TRUE(voxel_volume_set(&volume, 60, 60, 60, 6));
+    TEST_ASSERT_EQUAL_INT(3, volume.brick_count);
+
+    // Emptying the first brick moves the last one into its slot
+    TEST_ASSERT_TRUE(voxel_volume_set(&volume, 1, 1, 1, VOXEL_EMPTY));
+    TEST_ASSERT_EQUAL_INT(3, volume.brick_count);
+    TEST_ASSERT_TRUE(voxel_volume_set(&volume, 2, 1, 1, VOXEL_EMPTY));
+    TEST_ASSERT_EQUAL_INT(2, volume.brick_count);
+    TEST_ASSERT_EQUAL_UINT8(VOXEL_EMPTY, voxel_volume_get(&volume, 2, 1, 1));
+    TEST_ASSERT_EQUAL_UINT8(5, voxel_volume_get(&volume, 20, 30, 40));
+    TEST_ASSERT_EQUAL_UINT8(6, voxel_volume_get(&volume, 60, 60, 60));
+
+    // The moved brick can still be cleared through its new slot
+    TEST_ASSERT_TRUE(voxel_volume_set(&volume, 60, 60, 60, VOXEL_EMPTY));
+    TEST_ASSERT_TRUE(voxel_volume_set(&volume, 20, 30, 40, VOXEL_EMPTY));
+    TEST_ASSERT_EQUAL_INT(0, volume.brick_count);
+    Hittable hittable = voxel_volume_to_hittable(&volume);
+    Ray ray = ray_create(vec3_create(20.5f, 80.0f, 40.5f), vec3_create(0.0f, -1.0f, 0.0f));
+    HitRecord hit_rec;
+    TEST_ASSERT_FALSE(hittable_hit(&hittable, &ray, 0.001f, INFINITY, &hit_rec));
+    voxel_volume_destroy(&volume);
+}
+
+void run_voxel_tests(void) {
+    RUN_TEST(test_voxel_bricks_allocated_on_demand);
+    RUN_TEST(test_voxel_ray_skips_empty_bricks);
+    RUN_TEST(test_voxel_traversal_matches_brute_force);
+    RUN_TEST(test_voxel_clearing_frees_empty_bricks);
+}
@@ -0,0 +1,154 @@
+/**
+ * @file fbview.c
+ * @brief Reference viewer for the shared-memory framebuffer
+ *
+ * Maps a framebuffer published with `raydemo --shm NAME` read-only and
+ * draws it in a 24-bit color terminal, two pixel rows per character cell,
+ * redrawing whenever tiles change until the render finishes (or, with
+ * --follow, through every frame of a `raydemo --session`). Pixels are
+ * sampled in place from the mapping; each sample is checked against its
+ * tile's generation counter and the frame is redrawn if a tile was being
+ * written meanwhile.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "shared_framebuffer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @brief Seconds between checks for new tiles
+ */
+#define POLL_INTERVAL 0.1
+
+/**
+ * @brief Read one pixel as RGB8
+ * @return false if its tile changed while it was read
+ */
+static bool sample(const SharedFramebuffer *fb, uint32_t x, uint32_t y, uint8_t rgb[3]) {
+    const SharedFramebufferHeader *header = fb->header;
+    uint64_t tile = (uint64_t)(y / header->tile_size) * header->tiles_x + x / header->tile_size;
+    uint32_t generation = shared_framebuffer_read_begin(fb, tile);
+    const uint8_t *pixel = fb->pixels + ((size_t)y * header->width + x) * header->pixel_bytes;
+    if (header->format == SHARED_FRAMEBUFFER_RGB32F) {
+        float value[3];
+        memcpy(value, pixel, sizeof(value));
+        for (int c = 0; c < 3; c++) {
+            float v = value[c] < 0.0f ? 0.0f : value[c] > 1.0f ? 1.0f : value[c];
+            rgb[c] = (uint8_t)(255.0f * v);
+        }
+    } else {
+        memcpy(rgb, pixel, 3);
+    }
+    return shared_framebuffer_read_end(fb, tile, generation);
+}
+
+/**
+ * @brief Draw the image scaled to a number of columns
+ * @return false if some tile was caught mid-write
+ */
+static bool draw(const SharedFramebuffer *fb, int columns) {
+    const SharedFramebufferHeader *header = fb->header;
+    uint32_t width = header->width;
+    uint32_t height = header->height;
+    uint32_t cols = (uint32_t)columns < width ? (uint32_t)columns : width;
+    // Terminal cells are about twice as tall as wide; each holds two pixel rows
+    uint32_t rows = (uint32_t)((uint64_t)height * cols / width);
+    rows = rows < 2 ? 2 : rows & ~1u;
+    bool consistent = true;
+
+    uint64_t tiles = (uint64_t)header->tiles_x * header->tiles_y;
+    uint64_t done = 0;
+    for (uint64_t t = 0; t < tiles; t++) {
+        done += shared_framebuffer_read_begin(fb, t) >= 2;
+    }
+    uint32_t state = atomic_load_explicit(&header->state, memory_order_acquire);
+    printf("\033[H%ux%u %s, frame %u, %llu/%llu tiles (%.0f%%)\033[K\n", width, height,
+           header->format == SHARED_FRAMEBUFFER_RGB32F ? "float" : "RGB8",
+           atomic_load_explicit(&header->frame, memory_order_relaxed),
+           (unsigned long long)done, (unsigned long long)tiles,
+           100.0 * (double)done / (double)tiles);
+    for (uint32_t row = 0; row < rows; row += 2) {
+        for (uint32_t col = 0; col < cols; col++) {
+            uint32_t x = (uint32_t)((uint64_t)col * width / cols);
+            uint32_t y_top = (uint32_t)((uint64_t)row * height / rows);
+            uint32_t y_bottom = (uint32_t)((uint64_t)(row + 1) * height / rows);
+            uint8_t top[3], bottom[3];
+            consistent &= sample(fb, x, y_top, top);
+            consistent &= sample(fb, x, y_bottom, bottom);
+            printf("\033[38;2;%u;%u;%um\033[48;2;%u;%u;%um\xE2\x96\x80", top[0], top[1], top[2],
+                   bottom[0], bottom[1], bottom[2]);
+        }
+        printf("\033[0m\n");
+    }
+    printf("%s\033[K\n", state == SHARED_FRAMEBUFFER_RENDERING ? "rendering"
+                         : state == SHARED_FRAMEBUFFER_COMPLETE ? "complete"
+                                                                : "stopped");
+    fflush(stdout);
+    return consistent;
+}
+
+static void sleep_seconds(double seconds) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - (double)ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
+}
+
+int main(int argc, char *argv[]) {
+    const char *name = NULL;
+    int columns = 80;
+    bool once = false;
+    bool follow = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--once") == 0) {
+            once = true;
+        } else if (strcmp(argv[i], "--follow") == 0) {
+            follow = true;
+        } else if (strcmp(argv[i], "--columns") == 0 && i + 1 < argc) {
+            columns = atoi(argv[++i]);
+        } else if (!name && argv[i][0] != '-') {
+            name = argv[i];
+        } else {
+            name = NULL;
+            break;
+        }
+    }
+    if (!name || columns <= 0) {
+        fprintf(stderr, "Usage: %s NAME [--columns N] [--once | --follow]\n", argv[0]);
+        fprintf(stderr, "Shows the framebuffer of 'raydemo --shm NAME' as it renders.\n");
+        return 1;
+    }
+    char path[256];
+    snprintf(path, sizeof(path), "%s%s", name[0] == '/' ? "" : "/", name);
+
+    SharedFramebuffer fb;
+    while (!shared_framebuffer_open(&fb, path)) {
+        if (once) {
+            fprintf(stderr, "Error: No framebuffer at '%s'\n", path);
+            return 1;
+        }
+        sleep_seconds(POLL_INTERVAL);
+    }
+    printf("\033[2J");
+    uint64_t drawn = UINT64_MAX;
+    uint32_t drawn_state = SHARED_FRAMEBUFFER_RENDERING;
+    for (;;) {
+        uint32_t state = atomic_load_explicit(&fb.header->state, memory_order_acquire);
+        uint64_t written = atomic_load_explicit(&fb.header->tiles_written, memory_order_acquire);
+        if (written != drawn || state != drawn_state) {
+            // Redraw on the next poll if a tile changed under the reader
+            drawn = draw(&fb, columns) ? written : UINT64_MAX;
+            drawn_state = state;
+        }
+        if (once || (!follow && state != SHARED_FRAMEBUFFER_RENDERING && drawn == written)) {
+            break;
+        }
+        sleep_seconds(POLL_INTERVAL);
+    }
+    shared_framebuffer_close(&fb);
+    return 0;
+}